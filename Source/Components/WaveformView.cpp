@@ -1,7 +1,9 @@
 #include "WaveformView.h"
 
-WaveformView::WaveformView(juce::AudioFormatManager& fm, juce::AudioThumbnailCache& cache)
-    : formatManager(fm), audioThumbnail(512, formatManager, cache),
+WaveformView::WaveformView(juce::AudioFormatManager& fm, juce::AudioThumbnailCache& cache,
+                           JobScheduler& scheduler)
+    : formatManager(fm), thumbnailCache(cache), audioThumbnail(512, formatManager, cache),
+      jobScheduler(scheduler),
       waveformColor(juce::Colour(0xff00d4ff)),
       backgroundColor(juce::Colour(0xff1a1a1a)),
       positionColor(juce::Colour(0xffff6b35)),
@@ -14,6 +16,7 @@ WaveformView::WaveformView(juce::AudioFormatManager& fm, juce::AudioThumbnailCac
 
 WaveformView::~WaveformView()
 {
+    jobScheduler.cancelGroup(jobGroup);
     audioThumbnail.removeChangeListener(this);
 }
 
@@ -134,7 +137,33 @@ void WaveformView::timerCallback()
 
 void WaveformView::loadTrack(const Track& track)
 {
-    audioThumbnail.setSource(new juce::FileInputSource(track.getFile()));
+    // Anything still building the previous thumbnail is dropped first
+    jobScheduler.cancelGroup(jobGroup);
+    audioThumbnail.clear();
+    
+    auto file = track.getFile();
+    auto hash = file.hashCode64() ^ file.getLastModificationTime().toMilliseconds();
+    
+    if (!thumbnailCache.loadThumb(audioThumbnail, hash))
+    {
+        JobScheduler::DecodeConsumer consumer;
+        consumer.onStart = [this](double sampleRate, int numChannels, juce::int64 length) {
+            audioThumbnail.reset(numChannels, sampleRate, length);
+        };
+        consumer.onBlock = [this](const juce::AudioBuffer<float>& block, juce::int64 start, int numSamples) {
+            audioThumbnail.addBlock(start, block, 0, numSamples);
+        };
+        consumer.onFinished = [this, hash](bool completed) {
+            if (completed)
+                thumbnailCache.storeThumb(audioThumbnail, hash);
+        };
+        
+        // A deck that is on screen comes before background analysis
+        jobScheduler.addDecode(file, isShowing() ? JobScheduler::Priority::VisibleWaveform
+                                                 : JobScheduler::Priority::Analysis,
+                               jobGroup, std::move(consumer));
+    }
+    
     currentPosition = 0.0;
     playbackPosition = 0.0;
     clearCuePoint();
@@ -1,13 +1,15 @@
 #pragma once
 #include <JuceHeader.h>
 #include "../Model/Track.h"
+#include "../Model/JobScheduler.h"
 
 class WaveformView : public juce::Component,
                     public juce::ChangeListener,
                     public juce::Timer
 {
 public:
-    WaveformView(juce::AudioFormatManager& formatManager, juce::AudioThumbnailCache& cache);
+    WaveformView(juce::AudioFormatManager& formatManager, juce::AudioThumbnailCache& cache,
+                 JobScheduler& jobScheduler);
     ~WaveformView() override;
     
     void paint(juce::Graphics& g) override;
@@ -50,8 +52,14 @@ public:
     
 private:
     juce::AudioFormatManager& formatManager;
+    juce::AudioThumbnailCache& thumbnailCache;
     juce::AudioThumbnail audioThumbnail;
     
+    // The thumbnail is built from the scheduler's shared read of the file, so a
+    // track loaded on a deck is decoded once for both the deck and its waveform
+    JobScheduler& jobScheduler;
+    const juce::String jobGroup { juce::Uuid().toString() };
+    
     // Current state
     double currentPosition = 0.0;
     double playbackPosition = 0.0;
@@ -3,15 +3,17 @@
 DJController::DJController() : thumbnailCache(100)
 {
     formatManager.registerBasicFormats();
+    libraryDatabase.load();
     setupAudioEngines();
     
     // Setup audio channels
-    setAudioChannels(0, 2);
+    setAudioChannels(0, numOutputChannels);
 }
 
 DJController::~DJController()
 {
     shutdownAudio();
+    libraryDatabase.saveIfChanged();
 }
 
 void DJController::prepareToPlay(int samplesPerBlockExpected, double sampleRate)
@@ -19,41 +21,110 @@ void DJController::prepareToPlay(int samplesPerBlockExpected, double sampleRate)
     deck1->prepareToPlay(samplesPerBlockExpected, sampleRate);
     deck2->prepareToPlay(samplesPerBlockExpected, sampleRate);
     mixerSource.prepareToPlay(samplesPerBlockExpected, sampleRate);
+    currentSampleRate = sampleRate;
+    maxBlockSize = juce::jmax(1, samplesPerBlockExpected);
+    eventScheduler.prepareToPlay(samplesPerBlockExpected, sampleRate);
+    crossfader.prepareToPlay(samplesPerBlockExpected, sampleRate);
+    masterFilter.prepareToPlay(samplesPerBlockExpected, sampleRate);
+    masterLimiter.prepareToPlay(samplesPerBlockExpected, sampleRate);
+    
+    // Deck buffers are reused every callback so the audio thread never allocates
+    deck1Buffer.setSize(2, samplesPerBlockExpected);
+    deck2Buffer.setSize(2, samplesPerBlockExpected);
+    cueBuffer.setSize(2, samplesPerBlockExpected);
+    pflDelayBuffer.setSize(2, getMasterLatencySamples());
+    pflDelayBuffer.clear();
+    pflDelayPosition = 0;
+    samplerBuffer.setSize(2, samplesPerBlockExpected);
+    sampler.prepareToPlay(samplesPerBlockExpected, sampleRate);
+    
+    headphoneOutput.prepare(samplesPerBlockExpected, sampleRate);
 }
 
 void DJController::getNextAudioBlock(const juce::AudioSourceChannelInfo& bufferToFill)
 {
+    // A device may hand over more than it announced; render that in prepared-size
+    // pieces so nothing on the audio thread has to grow its buffers
+    if (bufferToFill.numSamples > maxBlockSize)
+    {
+        for (int offset = 0; offset < bufferToFill.numSamples; offset += maxBlockSize)
+        {
+            juce::AudioSourceChannelInfo chunk(bufferToFill.buffer, bufferToFill.startSample + offset,
+                                               juce::jmin(maxBlockSize, bufferToFill.numSamples - offset));
+            getNextAudioBlock(chunk);
+        }
+        return;
+    }
+    
     // Clear the buffer first
     bufferToFill.clearActiveBufferRegion();
     
-    // Create temporary buffers for each deck
-    juce::AudioBuffer<float> deck1Buffer(bufferToFill.buffer->getNumChannels(), bufferToFill.numSamples);
-    juce::AudioBuffer<float> deck2Buffer(bufferToFill.buffer->getNumChannels(), bufferToFill.numSamples);
+    // Decks and master are stereo; any further outputs belong to the cue bus
+    int numChannels = juce::jmin(2, bufferToFill.buffer->getNumChannels());
+    int numSamples = bufferToFill.numSamples;
     
-    // Get audio from each deck
-    juce::AudioSourceChannelInfo deck1Info(&deck1Buffer, 0, bufferToFill.numSamples);
-    juce::AudioSourceChannelInfo deck2Info(&deck2Buffer, 0, bufferToFill.numSamples);
+    // Resize within the preallocated capacity
+    deck1Buffer.setSize(2, numSamples, false, false, true);
+    deck2Buffer.setSize(2, numSamples, false, false, true);
+    samplerBuffer.setSize(2, numSamples, false, false, true);
     
-    deck1->getNextAudioBlock(deck1Info);
-    deck2->getNextAudioBlock(deck2Info);
+    // Render the decks in segments split at scheduled actions, so each one lands on its exact sample
+    auto beatClock = getMasterBeatClock();
+    eventScheduler.beginBlock(numSamples, beatClock);
+    sampler.setMasterTempo(beatClock.running ? 60.0 * currentSampleRate / beatClock.samplesPerBeat : 0.0);
     
-    // Apply crossfader mixing
-    double deck1Gain = calculateDeckGain(0);
-    double deck2Gain = calculateDeckGain(1);
+    int renderedSamples = 0;
+    int eventOffset = 0;
+    EventScheduler::Event event;
+    
+    while (eventScheduler.getNextEvent(eventOffset, event))
+    {
+        renderDecks(renderedSamples, eventOffset - renderedSamples);
+        renderedSamples = eventOffset;
+        applyDeckEvent(event);
+    }
+    
+    renderDecks(renderedSamples, numSamples - renderedSamples);
+    eventScheduler.endBlock();
+    
+    // Per-sample crossfader gains, ramped towards the latest fader position
+    crossfader.processGains(numSamples);
+    auto* deck1Gains = crossfader.getDeckGains(0);
+    auto* deck2Gains = crossfader.getDeckGains(1);
     
     // Mix the decks into the output buffer
-    for (int channel = 0; channel < bufferToFill.buffer->getNumChannels(); ++channel)
+    for (int channel = 0; channel < numChannels; ++channel)
     {
         auto* outputData = bufferToFill.buffer->getWritePointer(channel, bufferToFill.startSample);
-        auto* deck1Data = deck1Buffer.getReadPointer(channel);
-        auto* deck2Data = deck2Buffer.getReadPointer(channel);
         
-        for (int sample = 0; sample < bufferToFill.numSamples; ++sample)
-        {
-            outputData[sample] = (deck1Data[sample] * deck1Gain + deck2Data[sample] * deck2Gain) * masterGain;
-        }
+        juce::FloatVectorOperations::multiply(outputData, deck1Buffer.getReadPointer(channel), deck1Gains, numSamples);
+        juce::FloatVectorOperations::addWithMultiply(outputData, deck2Buffer.getReadPointer(channel), deck2Gains, numSamples);
+        juce::FloatVectorOperations::addWithMultiply(outputData, samplerBuffer.getReadPointer(channel), static_cast<float>(samplerGain), numSamples);
+        juce::FloatVectorOperations::multiply(outputData, static_cast<float>(masterGain), numSamples);
     }
     
+    // Sweep filter sits ahead of the limiter so resonant peaks are still caught
+    masterFilter.process(*bufferToFill.buffer, bufferToFill.startSample, numSamples);
+    
+    // Brickwall the master before it reaches the outputs, the cue blend and the recorder
+    masterLimiter.process(*bufferToFill.buffer, bufferToFill.startSample, numSamples);
+    
+    if (onLimiterGainReductionChanged)
+        onLimiterGainReductionChanged(masterLimiter.getGainReductionDb());
+    
+    if (onMasterLevelsChanged && numChannels > 0)
+    {
+        float rms = 0.0f;
+        for (int channel = 0; channel < numChannels; ++channel)
+            rms = juce::jmax(rms, bufferToFill.buffer->getRMSLevel(channel, bufferToFill.startSample, numSamples));
+        
+        onMasterLevelsChanged(rms, bufferToFill.buffer->getMagnitude(0, bufferToFill.startSample, numSamples));
+    }
+    
+    // Headphone cue only costs anything when it has somewhere to go
+    if (bufferToFill.buffer->getNumChannels() >= 4 || headphoneOutput.isActive())
+        renderCueBus(bufferToFill);
+    
     // Handle recording if active
     if (recordingWriter != nullptr)
     {
@@ -79,8 +150,8 @@ void DJController::releaseResources()
 
 void DJController::setupAudioEngines()
 {
-    deck1 = std::make_unique<AudioEngine>(formatManager);
-    deck2 = std::make_unique<AudioEngine>(formatManager);
+    deck1 = std::make_unique<AudioEngine>(formatManager, jobScheduler);
+    deck2 = std::make_unique<AudioEngine>(formatManager, jobScheduler);
     
     // Setup callbacks for deck 1
     deck1->onPositionChanged = [this](double position) {
@@ -92,43 +163,96 @@ void DJController::setupAudioEngines()
         handleDeckPositionChange(1, position);
     };
     
+    deck1->onHotCuesChanged = [this]() {
+        handleDeckHotCuesChange(0);
+    };
+    
+    deck2->onHotCuesChanged = [this]() {
+        handleDeckHotCuesChange(1);
+    };
+    
+    deck1->onNextTrackNeeded = [this]() {
+        queueAutoPlayTrack(0);
+    };
+    
+    deck2->onNextTrackNeeded = [this]() {
+        queueAutoPlayTrack(1);
+    };
+    
+    // A track counts as played once it starts playing, not when it is loaded.
+    // One that follows on gaplessly is already playing when it arrives.
+    deck1->onTrackLoaded = [this]() {
+        playRecorded[0] = false;
+        if (deck1->isPlaying())
+            recordDeckPlay(0);
+    };
+    
+    deck2->onTrackLoaded = [this]() {
+        playRecorded[1] = false;
+        if (deck2->isPlaying())
+            recordDeckPlay(1);
+    };
+    
+    deck1->onPlaybackStarted = [this]() {
+        recordDeckPlay(0);
+    };
+    
+    deck2->onPlaybackStarted = [this]() {
+        recordDeckPlay(1);
+    };
+    
     // Setup playlist callbacks
     playlistManager.onPlaylistChanged = [this]() {
+        // A reordered playlist can change what comes next
+        refreshAutoPlay(playlistManager);
+        
         if (onPlaylistChanged)
             onPlaylistChanged();
     };
 }
 
-void DJController::loadTrackToDeck(int deckIndex, const Track& track)
+void DJController::loadTrackToDeck(int deckIndex, const Track& track, PlaylistManager* sourcePlaylist)
 {
+    if (deckIndex < 0 || deckIndex >= 2)
+        return;
+    
+    // Set first: loading asks for the track that follows straight away
+    deckPlaylists[deckIndex] = sourcePlaylist;
+    
     if (deckIndex == 0)
         deck1->loadTrack(track);
     else if (deckIndex == 1)
         deck2->loadTrack(track);
 }
 
+void DJController::recordDeckPlay(int deckIndex)
+{
+    AudioEngine* deck = (deckIndex == 0) ? deck1.get() : deck2.get();
+    if (playRecorded[deckIndex] || deck == nullptr || deck->getCurrentTrack() == nullptr)
+        return;
+    
+    playRecorded[deckIndex] = true;
+    
+    // Play counts rank search results, so often-played tracks come up first
+    auto file = deck->getCurrentTrack()->getFile();
+    auto playCount = libraryDatabase.recordPlay(file);
+    if (playCount > 0 && onTrackPlayCountChanged)
+        onTrackPlayCountChanged(file, playCount);
+}
+
 void DJController::playDeck(int deckIndex)
 {
-    if (deckIndex == 0)
-        deck1->play();
-    else if (deckIndex == 1)
-        deck2->play();
+    scheduleDeckEvent(EventScheduler::Action::Play, deckIndex, 0, true);
 }
 
 void DJController::pauseDeck(int deckIndex)
 {
-    if (deckIndex == 0)
-        deck1->pause();
-    else if (deckIndex == 1)
-        deck2->pause();
+    scheduleDeckEvent(EventScheduler::Action::Pause, deckIndex, 0, false);
 }
 
 void DJController::stopDeck(int deckIndex)
 {
-    if (deckIndex == 0)
-        deck1->stop();
-    else if (deckIndex == 1)
-        deck2->stop();
+    scheduleDeckEvent(EventScheduler::Action::Stop, deckIndex, 0, false);
 }
 
 void DJController::setDeckPosition(int deckIndex, double position)
@@ -171,12 +295,147 @@ void DJController::setDeckEQ(int deckIndex, double low, double mid, double high)
     }
 }
 
+void DJController::triggerHotCue(int deckIndex, int cueIndex)
+{
+    AudioEngine* deck = (deckIndex == 0) ? deck1.get() : deck2.get();
+    if (deck == nullptr)
+        return;
+    
+    // Storing a cue on an empty pad happens here; only the jump goes to the audio thread
+    if (deck->hasHotCue(cueIndex))
+        scheduleDeckEvent(EventScheduler::Action::HotCue, deckIndex, cueIndex, true);
+    else
+        deck->triggerHotCue(cueIndex);
+}
+
+void DJController::setHotCue(int deckIndex, int cueIndex)
+{
+    AudioEngine* deck = (deckIndex == 0) ? deck1.get() : deck2.get();
+    if (deck)
+        deck->setHotCue(cueIndex, deck->getPosition());
+}
+
+void DJController::clearHotCue(int deckIndex, int cueIndex)
+{
+    AudioEngine* deck = (deckIndex == 0) ? deck1.get() : deck2.get();
+    if (deck)
+        deck->clearHotCue(cueIndex);
+}
+
+void DJController::setQuantizeEnabled(bool enabled)
+{
+    quantizeEnabled = enabled;
+    deck1->setQuantizeEnabled(enabled);
+    deck2->setQuantizeEnabled(enabled);
+}
+
+void DJController::setDeckSlip(int deckIndex, bool enabled)
+{
+    AudioEngine* deck = (deckIndex == 0) ? deck1.get() : deck2.get();
+    if (deck)
+        deck->setSlipEnabled(enabled);
+}
+
+void DJController::setDeckReverse(int deckIndex, bool enabled)
+{
+    scheduleDeckEvent(EventScheduler::Action::Reverse, deckIndex, enabled ? 1 : 0, false);
+}
+
+void DJController::startLoopRoll(int deckIndex, double beats)
+{
+    int sixteenths = juce::jmax(1, juce::roundToInt(beats * 16.0));
+    scheduleDeckEvent(EventScheduler::Action::LoopRoll, deckIndex, sixteenths, true);
+}
+
+void DJController::stopLoopRoll(int deckIndex)
+{
+    scheduleDeckEvent(EventScheduler::Action::LoopRoll, deckIndex, 0, false);
+}
+
+void DJController::setCensor(int deckIndex, bool held)
+{
+    scheduleDeckEvent(EventScheduler::Action::Censor, deckIndex, held ? 1 : 0, false);
+}
+
+bool DJController::loadSamplerPad(int pad, const juce::File& file)
+{
+    return sampler.loadPad(pad, file, formatManager);
+}
+
+void DJController::clearSamplerPad(int pad)
+{
+    sampler.clearPad(pad);
+}
+
+void DJController::triggerSamplerPad(int pad)
+{
+    scheduleDeckEvent(EventScheduler::Action::SamplerPad, 0, pad, true);
+}
+
+void DJController::releaseSamplerPad(int pad)
+{
+    scheduleDeckEvent(EventScheduler::Action::SamplerRelease, 0, pad, false);
+}
+
+void DJController::setSamplerPadLooping(int pad, bool looping)
+{
+    sampler.setPadLooping(pad, looping);
+}
+
+void DJController::setSamplerPadTempo(int pad, double bpm)
+{
+    sampler.setPadTempo(pad, bpm);
+}
+
+void DJController::setSamplerPadGain(int pad, float gain)
+{
+    sampler.setPadGain(pad, gain);
+}
+
+void DJController::setSamplerGain(double gain)
+{
+    samplerGain = juce::jlimit(0.0, 2.0, gain);
+}
+
+void DJController::setDeckEffectEnabled(int deckIndex, EffectsRack::EffectType type, bool enabled)
+{
+    AudioEngine* deck = (deckIndex == 0) ? deck1.get() : deck2.get();
+    if (deck)
+        deck->getEffectsRack().setEnabled(type, enabled);
+}
+
+void DJController::setDeckEffectMix(int deckIndex, EffectsRack::EffectType type, float mix)
+{
+    AudioEngine* deck = (deckIndex == 0) ? deck1.get() : deck2.get();
+    if (deck)
+        deck->getEffectsRack().setMix(type, mix);
+}
+
+void DJController::setDeckEffectAmount(int deckIndex, EffectsRack::EffectType type, float amount)
+{
+    AudioEngine* deck = (deckIndex == 0) ? deck1.get() : deck2.get();
+    if (deck)
+        deck->getEffectsRack().setAmount(type, amount);
+}
+
+void DJController::setDeckEffectBeats(int deckIndex, EffectsRack::EffectType type, float beats)
+{
+    AudioEngine* deck = (deckIndex == 0) ? deck1.get() : deck2.get();
+    if (deck)
+        deck->getEffectsRack().setBeats(type, beats);
+}
+
 void DJController::setCrossfader(double position)
 {
-    crossfaderPosition = juce::jlimit(-1.0, 1.0, position);
+    crossfader.setPosition(position);
     
     if (onCrossfaderChanged)
-        onCrossfaderChanged(crossfaderPosition);
+        onCrossfaderChanged(crossfader.getPosition());
+}
+
+void DJController::setCrossfaderCurve(Crossfader::Curve curve)
+{
+    crossfader.setCurve(curve);
 }
 
 void DJController::setMasterGain(double gain)
@@ -189,6 +448,53 @@ void DJController::setCueGain(double gain)
     cueGain = juce::jlimit(0.0, 2.0, gain);
 }
 
+void DJController::setMasterFilter(double position)
+{
+    masterFilter.setPosition(static_cast<float>(position));
+}
+
+void DJController::setMasterFilterResonance(double resonance)
+{
+    masterFilter.setResonance(static_cast<float>(resonance));
+}
+
+void DJController::setLimiterEnabled(bool enabled)
+{
+    masterLimiter.setEnabled(enabled);
+}
+
+void DJController::setLimiterCeiling(double ceilingDb)
+{
+    masterLimiter.setCeiling(ceilingDb);
+}
+
+void DJController::setDeckPFL(int deckIndex, bool enabled)
+{
+    if (deckIndex == 0 || deckIndex == 1)
+        deckPFL[deckIndex] = enabled;
+}
+
+bool DJController::isDeckPFLEnabled(int deckIndex) const
+{
+    return (deckIndex == 0 || deckIndex == 1) && deckPFL[deckIndex].load();
+}
+
+void DJController::setCueMix(double mix)
+{
+    cueMix = juce::jlimit(0.0, 1.0, mix);
+}
+
+bool DJController::setHeadphoneDevice(const juce::String& outputDeviceName)
+{
+    if (outputDeviceName.isEmpty())
+    {
+        headphoneOutput.close();
+        return true;
+    }
+    
+    return headphoneOutput.open(outputDeviceName);
+}
+
 void DJController::loadPlaylistFromDirectory(const juce::File& directory)
 {
     playlistManager.loadTracksFromDirectory(directory);
@@ -201,21 +507,20 @@ void DJController::loadPlaylistFromFiles(const juce::Array<juce::File>& files)
 
 void DJController::syncDecks()
 {
-    // Get BPM from both decks' current tracks
-    auto* track1 = deck1->getCurrentTrack();
-    auto* track2 = deck2->getCurrentTrack();
+    scheduleDeckEvent(EventScheduler::Action::Sync, 1, 0, false);
+}
+
+void DJController::applySync()
+{
+    // Get BPM from both decks' loaded tracks (zero when nothing is loaded)
+    double bpm1 = deck1->getTrackBPM();
+    double bpm2 = deck2->getTrackBPM();
     
-    if (track1 && track2)
+    if (bpm1 > 0.0 && bpm2 > 0.0)
     {
-        int bpm1 = track1->getBPM();
-        int bpm2 = track2->getBPM();
-        
-        if (bpm1 > 0 && bpm2 > 0)
-        {
-            // Sync deck 2 to deck 1's BPM
-            double speedRatio = static_cast<double>(bpm1) / static_cast<double>(bpm2);
-            deck2->setSpeed(speedRatio);
-        }
+        // Sync deck 2 to deck 1's BPM
+        double speedRatio = bpm1 / bpm2;
+        deck2->setSpeed(speedRatio);
     }
 }
 
@@ -262,21 +567,67 @@ void DJController::setAutoCrossfadeTime(double seconds)
     autoCrossfadeTime = juce::jmax(1.0, seconds);
 }
 
-double DJController::calculateDeckGain(int deckIndex) const
+void DJController::enableAutoPlay(int deckIndex, bool enable)
 {
-    // Calculate gain based on crossfader position
-    if (deckIndex == 0) // Deck 1
+    AudioEngine* deck = (deckIndex == 0) ? deck1.get() : (deckIndex == 1) ? deck2.get() : nullptr;
+    if (deck == nullptr)
+        return;
+    
+    autoPlayEnabled[deckIndex] = enable;
+    deck->setAutoPlayEnabled(enable);
+}
+
+bool DJController::isAutoPlayEnabled(int deckIndex) const
+{
+    return deckIndex >= 0 && deckIndex < 2 && autoPlayEnabled[deckIndex];
+}
+
+void DJController::refreshAutoPlay(const PlaylistManager& playlist)
+{
+    for (int deckIndex = 0; deckIndex < 2; ++deckIndex)
     {
-        // When crossfader is at -1.0 (full left), deck 1 is at full volume
-        // When crossfader is at 1.0 (full right), deck 1 is silent
-        return juce::jmax(0.0, (1.0 - crossfaderPosition) * 0.5);
+        if (autoPlayEnabled[deckIndex] && deckPlaylists[deckIndex] == &playlist)
+            queueAutoPlayTrack(deckIndex);
     }
-    else // Deck 2
+}
+
+void DJController::setAutoPlayTrimSilence(bool trim)
+{
+    deck1->setTrimSilence(trim);
+    deck2->setTrimSilence(trim);
+}
+
+void DJController::queueAutoPlayTrack(int deckIndex)
+{
+    AudioEngine* deck = (deckIndex == 0) ? deck1.get() : deck2.get();
+    auto* playlist = autoPlayEnabled[deckIndex] ? deckPlaylists[deckIndex] : nullptr;
+    
+    if (deck == nullptr || playlist == nullptr || deck->getCurrentTrack() == nullptr)
+        return;
+    
+    // Whatever follows the current track in playlist order
+    int index = playlist->indexOf(deck->getCurrentTrack()->getFile());
+    
+    if (index >= 0)
     {
-        // When crossfader is at -1.0 (full left), deck 2 is silent
-        // When crossfader is at 1.0 (full right), deck 2 is at full volume
-        return juce::jmax(0.0, (1.0 + crossfaderPosition) * 0.5);
+        if (auto next = playlist->getTrack(index + 1))
+        {
+            // Already being prepared; starting over would throw away the buffered head
+            if (deck->getNextTrack() == nullptr || deck->getNextTrack()->getFile() != next->getFile())
+                deck->queueNextTrack(*next);
+            return;
+        }
     }
+    
+    // End of the playlist, or the track isn't in it
+    deck->clearNextTrack();
+}
+
+double DJController::calculateDeckGain(int deckIndex) const
+{
+    // Gain at the fader's resting position on the selected curve;
+    // the audio thread ramps towards this per sample
+    return crossfader.getGainForPosition(deckIndex, crossfader.getPosition());
 }
 
 void DJController::handleDeckPositionChange(int deckIndex, double position)
@@ -299,6 +650,215 @@ void DJController::handleDeckLevelsChange(int deckIndex)
     }
 }
 
+void DJController::renderDecks(int startSample, int numSamples)
+{
+    if (numSamples <= 0)
+        return;
+    
+    juce::AudioSourceChannelInfo deck1Info(&deck1Buffer, startSample, numSamples);
+    juce::AudioSourceChannelInfo deck2Info(&deck2Buffer, startSample, numSamples);
+    
+    deck1->getNextAudioBlock(deck1Info);
+    deck2->getNextAudioBlock(deck2Info);
+    sampler.render(samplerBuffer, startSample, numSamples);
+}
+
+void DJController::scheduleDeckEvent(EventScheduler::Action action, int deckIndex, int parameter, bool quantizable)
+{
+    auto grid = (quantizable && quantizeEnabled) ? quantizeGrid : EventScheduler::Grid::None;
+    
+    // While the device is running the action is applied inside the callback at its own sample;
+    // with no callbacks coming (device closed, queue full) it is applied straight away
+    bool audioRunning = juce::Time::getMillisecondCounterHiRes() - eventScheduler.getLastBlockTimeMs() < 250.0;
+    
+    if (audioRunning && eventScheduler.post(action, deckIndex, parameter, grid))
+        return;
+    
+    EventScheduler::Event event;
+    event.action = action;
+    event.deckIndex = deckIndex;
+    event.parameter = parameter;
+    applyDeckEvent(event);
+}
+
+void DJController::applyDeckEvent(const EventScheduler::Event& event)
+{
+    AudioEngine* deck = (event.deckIndex == 0) ? deck1.get() : deck2.get();
+    if (deck == nullptr)
+        return;
+    
+    switch (event.action)
+    {
+        case EventScheduler::Action::Play:
+            deck->play();
+            break;
+        case EventScheduler::Action::Pause:
+            deck->pause();
+            break;
+        case EventScheduler::Action::Stop:
+            deck->stop();
+            break;
+        case EventScheduler::Action::Cue:
+            deck->setCuePoint(deck->getPosition());
+            deck->jumpToCue();
+            break;
+        case EventScheduler::Action::HotCue:
+            if (deck->hasHotCue(event.parameter))
+                deck->setPosition(deck->getHotCue(event.parameter));
+            break;
+        case EventScheduler::Action::ToggleLoop:
+            deck->enableLoop(!deck->isLoopEnabled());
+            break;
+        case EventScheduler::Action::Sync:
+            applySync();
+            break;
+        case EventScheduler::Action::Reverse:
+            deck->setReverse(event.parameter != 0);
+            break;
+        case EventScheduler::Action::LoopRoll:
+            if (event.parameter > 0)
+                deck->startLoopRoll(event.parameter / 16.0);
+            else
+                deck->stopLoopRoll();
+            break;
+        case EventScheduler::Action::Censor:
+            if (event.parameter != 0)
+                deck->startCensor();
+            else
+                deck->stopCensor();
+            break;
+        case EventScheduler::Action::SamplerPad:
+            sampler.triggerPad(event.parameter);
+            break;
+        case EventScheduler::Action::SamplerRelease:
+            sampler.releasePad(event.parameter);
+            break;
+    }
+}
+
+EventScheduler::BeatClock DJController::getMasterBeatClock() const
+{
+    EventScheduler::BeatClock clock;
+    
+    // The master is the playing deck with a known tempo that the crossfader favours
+    AudioEngine* master = nullptr;
+    double masterDeckGain = -1.0;
+    
+    for (int deckIndex = 0; deckIndex < 2; ++deckIndex)
+    {
+        AudioEngine* deck = (deckIndex == 0) ? deck1.get() : deck2.get();
+        
+        if (deck->isPlaying() && deck->getTrackBPM() > 0.0 && calculateDeckGain(deckIndex) > masterDeckGain)
+        {
+            master = deck;
+            masterDeckGain = calculateDeckGain(deckIndex);
+        }
+    }
+    
+    if (master == nullptr)
+        return clock;
+    
+    double beatLength = 60.0 / master->getTrackBPM();
+    double offset = master->getBeatGridOffset();
+    double position = master->getPosition();
+    double speed = juce::jmax(0.01, master->getSpeed());
+    
+    // Track time runs at the deck's speed, so a beat lasts beatLength / speed of output time
+    auto nextBeat = static_cast<juce::int64>(std::ceil((position - offset) / beatLength));
+    
+    clock.running = true;
+    clock.nextBeatIndex = nextBeat;
+    clock.samplesPerBeat = beatLength / speed * currentSampleRate;
+    clock.samplesToNextBeat = (offset + static_cast<double>(nextBeat) * beatLength - position) / speed * currentSampleRate;
+    return clock;
+}
+
+void DJController::handleDeckHotCuesChange(int deckIndex)
+{
+    AudioEngine* deck = (deckIndex == 0) ? deck1.get() : deck2.get();
+    if (deck && deck->getCurrentTrack())
+        playlistManager.updateHotCues(*deck->getCurrentTrack());
+    
+    if (onDeckHotCuesChanged)
+        onDeckHotCuesChanged(deckIndex);
+}
+
+void DJController::renderCueBus(const juce::AudioSourceChannelInfo& bufferToFill)
+{
+    int numSamples = bufferToFill.numSamples;
+    cueBuffer.setSize(2, numSamples, false, false, true);
+    cueBuffer.clear();
+    
+    // Pre-fader listen taps the deck buffers already rendered for the master,
+    // so the decks are never pulled twice
+    float mix = static_cast<float>(cueMix.load());
+    float gain = static_cast<float>(cueGain);
+    float cueLevel = (1.0f - mix) * gain;
+    float masterLevel = mix * gain;
+    int numMasterChannels = juce::jmin(2, bufferToFill.buffer->getNumChannels());
+    
+    for (int channel = 0; channel < 2; ++channel)
+    {
+        auto* cueData = cueBuffer.getWritePointer(channel);
+        
+        if (deckPFL[0].load())
+            juce::FloatVectorOperations::addWithMultiply(cueData, deck1Buffer.getReadPointer(channel), cueLevel, numSamples);
+        if (deckPFL[1].load())
+            juce::FloatVectorOperations::addWithMultiply(cueData, deck2Buffer.getReadPointer(channel), cueLevel, numSamples);
+    }
+    
+    // The master has been through the limiter's lookahead; PFL is held back as long so the blend stays in time
+    int delaySize = pflDelayBuffer.getNumSamples();
+    
+    if (delaySize > 0)
+    {
+        for (int channel = 0; channel < 2; ++channel)
+        {
+            auto* cueData = cueBuffer.getWritePointer(channel);
+            auto* delayData = pflDelayBuffer.getWritePointer(channel);
+            int position = pflDelayPosition;
+            
+            for (int i = 0; i < numSamples; ++i)
+            {
+                std::swap(cueData[i], delayData[position]);
+                
+                if (++position >= delaySize)
+                    position = 0;
+            }
+        }
+        
+        pflDelayPosition = (pflDelayPosition + numSamples) % delaySize;
+    }
+    
+    for (int channel = 0; channel < 2; ++channel)
+    {
+        auto* cueData = cueBuffer.getWritePointer(channel);
+        
+        if (masterLevel > 0.0f && numMasterChannels > 0)
+        {
+            int masterChannel = juce::jmin(channel, numMasterChannels - 1);
+            juce::FloatVectorOperations::addWithMultiply(cueData, bufferToFill.buffer->getReadPointer(masterChannel, bufferToFill.startSample), masterLevel, numSamples);
+        }
+    }
+    
+    if (bufferToFill.buffer->getNumChannels() >= 4)
+    {
+        bufferToFill.buffer->copyFrom(2, bufferToFill.startSample, cueBuffer, 0, 0, numSamples);
+        bufferToFill.buffer->copyFrom(3, bufferToFill.startSample, cueBuffer, 1, 0, numSamples);
+    }
+    else
+    {
+        headphoneOutput.push(cueBuffer.getReadPointer(0), cueBuffer.getReadPointer(1), numSamples);
+    }
+    
+    if (onCueLevelsChanged)
+    {
+        float rms = juce::jmax(cueBuffer.getRMSLevel(0, 0, numSamples), cueBuffer.getRMSLevel(1, 0, numSamples));
+        float peak = cueBuffer.getMagnitude(0, numSamples);
+        onCueLevelsChanged(rms, peak);
+    }
+}
+
 // Additional deck control implementations
 void DJController::togglePlay(int deckIndex)
 {
@@ -314,12 +874,7 @@ void DJController::togglePlay(int deckIndex)
 
 void DJController::cue(int deckIndex)
 {
-    AudioEngine* deck = (deckIndex == 0) ? deck1.get() : deck2.get();
-    if (deck)
-    {
-        deck->setCuePoint(deck->getPosition());
-        setDeckPosition(deckIndex, deck->getCuePoint());
-    }
+    scheduleDeckEvent(EventScheduler::Action::Cue, deckIndex, 0, true);
 }
 
 void DJController::loadTrack(int deckIndex)
@@ -334,7 +889,7 @@ void DJController::loadTrack(int deckIndex)
         
         if (selectedFile.existsAsFile())
         {
-            Track track(selectedFile);
+            Track track = libraryDatabase.getTrack(selectedFile);
             
             if (track.isValid())
             {
@@ -359,11 +914,7 @@ void DJController::toggleSync(int deckIndex)
 
 void DJController::toggleLoop(int deckIndex)
 {
-    AudioEngine* deck = (deckIndex == 0) ? deck1.get() : deck2.get();
-    if (deck)
-    {
-        deck->enableLoop(!deck->isLoopEnabled());
-    }
+    scheduleDeckEvent(EventScheduler::Action::ToggleLoop, deckIndex, 0, true);
 }
 
 void DJController::adjustPosition(int deckIndex, double delta)
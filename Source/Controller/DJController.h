@@ -2,12 +2,22 @@
 #include <JuceHeader.h>
 #include "../Model/AudioEngine.h"
 #include "../Model/PlaylistManager.h"
+#include "../Model/LibraryDatabase.h"
 #include "../Model/Track.h"
+#include "../Model/Crossfader.h"
+#include "../Model/HeadphoneOutput.h"
+#include "../Model/MasterLimiter.h"
+#include "../Model/MasterFilter.h"
+#include "../Model/EventScheduler.h"
+#include "../Model/Sampler.h"
 #include <memory>
 
 class DJController : public juce::AudioAppComponent
 {
 public:
+    // Outputs 1/2 carry the master, 3/4 the headphone cue when the interface has them
+    static constexpr int numOutputChannels = 4;
+    
     DJController();
     ~DJController() override;
     
@@ -17,7 +27,7 @@ public:
     void releaseResources() override;
     
     // Deck control
-    void loadTrackToDeck(int deckIndex, const Track& track);
+    void loadTrackToDeck(int deckIndex, const Track& track, PlaylistManager* sourcePlaylist = nullptr);
     void playDeck(int deckIndex);
     void pauseDeck(int deckIndex);
     void stopDeck(int deckIndex);
@@ -26,6 +36,28 @@ public:
     void setDeckSpeed(int deckIndex, double speed);
     void setDeckEQ(int deckIndex, double low, double mid, double high);
     
+    // Deck effects
+    void setDeckEffectEnabled(int deckIndex, EffectsRack::EffectType type, bool enabled);
+    void setDeckEffectMix(int deckIndex, EffectsRack::EffectType type, float mix);
+    void setDeckEffectAmount(int deckIndex, EffectsRack::EffectType type, float amount);
+    void setDeckEffectBeats(int deckIndex, EffectsRack::EffectType type, float beats);
+    
+    // Hot cues
+    void triggerHotCue(int deckIndex, int cueIndex);
+    void setHotCue(int deckIndex, int cueIndex); // at the deck's current position
+    void clearHotCue(int deckIndex, int cueIndex);
+    void setQuantizeEnabled(bool enabled);
+    bool isQuantizeEnabled() const { return quantizeEnabled; }
+    void setQuantizeGrid(EventScheduler::Grid grid) { quantizeGrid = grid; } // what quantized actions wait for
+    EventScheduler::Grid getQuantizeGrid() const { return quantizeGrid; }
+    
+    // Slip, reverse and rolls
+    void setDeckSlip(int deckIndex, bool enabled);
+    void setDeckReverse(int deckIndex, bool enabled);
+    void startLoopRoll(int deckIndex, double beats);
+    void stopLoopRoll(int deckIndex);
+    void setCensor(int deckIndex, bool held);
+    
     // Additional deck controls
     void togglePlay(int deckIndex);
     void cue(int deckIndex);
@@ -38,9 +70,42 @@ public:
     
     // Crossfader and mixer
     void setCrossfader(double position); // -1.0 (deck 1) to 1.0 (deck 2)
+    void setCrossfaderCurve(Crossfader::Curve curve);
+    Crossfader::Curve getCrossfaderCurve() const { return crossfader.getCurve(); }
+    double getDeckCrossfaderGain(int deckIndex) const { return calculateDeckGain(deckIndex); }
     void setMasterGain(double gain);
     void setCueGain(double gain);
     
+    // Master filter
+    void setMasterFilter(double position); // -1.0 low-pass, 0.0 off, 1.0 high-pass
+    void setMasterFilterResonance(double resonance);
+    
+    // Master limiter
+    void setLimiterEnabled(bool enabled);
+    bool isLimiterEnabled() const { return masterLimiter.isEnabled(); }
+    void setLimiterCeiling(double ceilingDb);
+    float getLimiterGainReduction() const { return masterLimiter.getGainReductionDb(); }
+    int getMasterLatencySamples() const { return masterLimiter.getLatencySamples(); }
+    
+    // Sampler
+    bool loadSamplerPad(int pad, const juce::File& file);
+    void clearSamplerPad(int pad);
+    void triggerSamplerPad(int pad);
+    void releaseSamplerPad(int pad);
+    void setSamplerPadLooping(int pad, bool looping);
+    void setSamplerPadTempo(int pad, double bpm);
+    void setSamplerPadGain(int pad, float gain);
+    void setSamplerGain(double gain);
+    Sampler& getSampler() { return sampler; }
+    
+    // Headphone cue bus
+    void setDeckPFL(int deckIndex, bool enabled);
+    bool isDeckPFLEnabled(int deckIndex) const;
+    void setCueMix(double mix); // 0.0 = cue only, 1.0 = master only
+    bool setHeadphoneDevice(const juce::String& outputDeviceName); // empty closes it
+    juce::String getHeadphoneDeviceName() const { return headphoneOutput.getDeviceName(); }
+    juce::StringArray getHeadphoneDeviceNames() { return headphoneOutput.getAvailableDeviceNames(); }
+    
     // Playlist management
     PlaylistManager& getPlaylistManager() { return playlistManager; }
     void loadPlaylistFromDirectory(const juce::File& directory);
@@ -53,6 +118,8 @@ public:
     // Audio format manager access
     juce::AudioFormatManager& getFormatManager() { return formatManager; }
     juce::AudioThumbnailCache& getThumbnailCache() { return thumbnailCache; }
+    JobScheduler& getJobScheduler() { return jobScheduler; }
+    LibraryDatabase& getLibraryDatabase() { return libraryDatabase; }
     
     // BPM sync and beat matching
     void syncDecks();
@@ -68,16 +135,31 @@ public:
     void enableAutoCrossfade(bool enable);
     void setAutoCrossfadeTime(double seconds);
     
+    // Auto-play: the deck runs on through the playlist its track was loaded from,
+    // in order, joining tracks without a gap. Call refreshAutoPlay when that
+    // playlist is edited so the queued track follows the new order.
+    void enableAutoPlay(int deckIndex, bool enable);
+    bool isAutoPlayEnabled(int deckIndex) const;
+    void setAutoPlayTrimSilence(bool trim);
+    void refreshAutoPlay(const PlaylistManager& playlist);
+    
     // Callbacks for UI updates
     std::function<void(int, double)> onDeckPositionChanged;
     std::function<void(int, float, float)> onDeckLevelsChanged; // RMS, Peak
     std::function<void(double)> onCrossfaderChanged;
+    std::function<void(float, float)> onCueLevelsChanged; // RMS, Peak
+    std::function<void(float, float)> onMasterLevelsChanged; // RMS, Peak
+    std::function<void(float)> onLimiterGainReductionChanged; // dB
     std::function<void()> onPlaylistChanged;
+    std::function<void(int)> onDeckHotCuesChanged;
+    std::function<void(const juce::File&, int)> onTrackPlayCountChanged;
     
 private:
     // Audio components
     juce::AudioFormatManager formatManager;
     juce::AudioThumbnailCache thumbnailCache;
+    JobScheduler jobScheduler { formatManager };
+    LibraryDatabase libraryDatabase;
     
     // Audio engines
     std::unique_ptr<AudioEngine> deck1;
@@ -87,15 +169,37 @@ private:
     juce::MixerAudioSource mixerSource;
     
     // Playlist
-    PlaylistManager playlistManager;
+    PlaylistManager playlistManager { jobScheduler, libraryDatabase };
     
     // Mixer state
-    double crossfaderPosition = 0.0; // -1.0 to 1.0
+    Crossfader crossfader;
+    juce::AudioBuffer<float> deck1Buffer;
+    juce::AudioBuffer<float> deck2Buffer;
     double masterGain = 0.8;
+    Sampler sampler;
+    juce::AudioBuffer<float> samplerBuffer;
+    double samplerGain = 0.8;
+    MasterFilter masterFilter;
+    MasterLimiter masterLimiter;
     double cueGain = 0.8;
     
+    // Cue bus state
+    std::atomic<bool> deckPFL[2] { { false }, { false } };
+    std::atomic<double> cueMix { 0.0 };
+    juce::AudioBuffer<float> cueBuffer;
+    juce::AudioBuffer<float> pflDelayBuffer; // holds PFL back by the master's latency
+    int pflDelayPosition = 0;
+    HeadphoneOutput headphoneOutput;
+    
     // Beat sync
     bool beatSyncEnabled = false;
+    bool quantizeEnabled = false;
+    
+    // Transport actions, applied on the audio thread at their exact sample
+    EventScheduler eventScheduler;
+    EventScheduler::Grid quantizeGrid = EventScheduler::Grid::Beat;
+    double currentSampleRate = 44100.0;
+    int maxBlockSize = 512; // as prepared; larger callbacks are rendered in pieces this size
     
     // Recording
     std::unique_ptr<juce::AudioFormatWriter> recordingWriter;
@@ -104,6 +208,9 @@ private:
     // Auto-mix
     bool autoCrossfadeEnabled = false;
     double autoCrossfadeTime = 10.0;
+    bool autoPlayEnabled[2] { false, false };
+    PlaylistManager* deckPlaylists[2] { nullptr, nullptr }; // where each deck's track came from
+    bool playRecorded[2] { false, false }; // the deck's track has been counted as played
     
     // Internal methods
     void setupAudioEngines();
@@ -111,6 +218,15 @@ private:
     double calculateDeckGain(int deckIndex) const;
     void handleDeckPositionChange(int deckIndex, double position);
     void handleDeckLevelsChange(int deckIndex);
+    void handleDeckHotCuesChange(int deckIndex);
+    void recordDeckPlay(int deckIndex);
+    void queueAutoPlayTrack(int deckIndex);
+    void renderCueBus(const juce::AudioSourceChannelInfo& bufferToFill);
+    void renderDecks(int startSample, int numSamples);
+    void scheduleDeckEvent(EventScheduler::Action action, int deckIndex, int parameter, bool quantizable);
+    void applyDeckEvent(const EventScheduler::Event& event);
+    void applySync();
+    EventScheduler::BeatClock getMasterBeatClock() const;
     
     JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR(DJController)
 };
\ No newline at end of file
@@ -72,7 +72,7 @@ public:
             setContentOwned (mainView.release(), true);
             
             // Setup audio
-            setAudioChannels (0, 2); // No input, stereo output
+            setAudioChannels (0, DJController::numOutputChannels); // No input, master + headphone cue pairs
 
            #if JUCE_IOS || JUCE_ANDROID
             setFullScreen (true);
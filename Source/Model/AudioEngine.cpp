@@ -1,8 +1,19 @@
 #include "AudioEngine.h"
 
-AudioEngine::AudioEngine(juce::AudioFormatManager& fm)
-    : formatManager(fm), resampleSource(&transportSource, false, 2)
+AudioEngine::AudioEngine(juce::AudioFormatManager& fm, JobScheduler& scheduler)
+    : formatManager(fm), jobScheduler(scheduler), deckSource(fm, readAheadThread), resampleSource(&transportSource, false, 2)
 {
+    static_assert(loopWindowSlot < DeckSource::numWindows, "DeckSource needs a window per cue");
+    static_assert(JobScheduler::decodeBlockSize % DecodeCache::chunkSize == 0, "Decoded blocks must fill whole cache chunks");
+    readAheadThread.startThread();
+    publishTrackInfo();
+    
+    // Listen for the end of the stream, and for gapless switches inside the deck source
+    transportSource.addChangeListener(this);
+    deckSource.onTrackAdvanced = [this](juce::int64 startSample) {
+        advanceToNextTrack(startSample);
+    };
+    
     // Setup EQ filters
     lowEQFilter.setCoefficients(juce::IIRCoefficients::makeLowShelf(44100, 250.0f, 1.0f, 1.0f));
     midEQFilter.setCoefficients(juce::IIRCoefficients::makePeakFilter(44100, 1000.0f, 1.0f, 1.0f));
@@ -11,13 +22,23 @@ AudioEngine::AudioEngine(juce::AudioFormatManager& fm)
 
 AudioEngine::~AudioEngine()
 {
+    cancelPendingUpdate();
+    jobScheduler.cancelGroup(jobGroup);
+    transportSource.removeChangeListener(this);
+    deckSource.onTrackAdvanced = nullptr;
     transportSource.setSource(nullptr);
+    deckSource.clearTrack();
+    readAheadThread.stopThread(1000);
 }
 
 void AudioEngine::prepareToPlay(int samplesPerBlockExpected, double sampleRate)
 {
+    outputSampleRate = sampleRate;
     transportSource.prepareToPlay(samplesPerBlockExpected, sampleRate);
     resampleSource.prepareToPlay(samplesPerBlockExpected, sampleRate);
+    effectsRack.prepareToPlay(samplesPerBlockExpected, sampleRate);
+    gateGain.reset(sampleRate, 0.005);
+    gateGain.setCurrentAndTargetValue(gateOpen.load() ? 1.0f : 0.0f);
     
     // Update EQ filter coefficients for the actual sample rate
     lowEQFilter.setCoefficients(juce::IIRCoefficients::makeLowShelf(sampleRate, 250.0f, 1.0f, juce::Decibels::decibelsToGain(lowEQGain)));
@@ -27,23 +48,58 @@ void AudioEngine::prepareToPlay(int samplesPerBlockExpected, double sampleRate)
 
 void AudioEngine::getNextAudioBlock(const juce::AudioSourceChannelInfo& bufferToFill)
 {
-    if (readerSource.get() == nullptr)
+    if (!deckSource.hasTrack())
     {
         bufferToFill.clearActiveBufferRegion();
         return;
     }
     
-    // Check loop bounds before getting audio
-    checkLoopBounds();
+    // Paused: the transport isn't pulled at all, so the playhead stays put
+    gateGain.setTargetValue(gateOpen.load() ? 1.0f : 0.0f);
+    bool silent = !gateGain.isSmoothing() && gateGain.getCurrentValue() <= 0.0f;
+    
+    if (silent)
+    {
+        bufferToFill.clearActiveBufferRegion();
+    }
+    else
+    {
+        // Get audio from the resample source; loops wrap inside the deck source on the exact sample
+        resampleSource.getNextAudioBlock(bufferToFill);
+        
+        // Fade on play and pause, however short the segment the controller asked for
+        int sample = 0;
+        
+        for (; sample < bufferToFill.numSamples && gateGain.isSmoothing(); ++sample)
+        {
+            auto gain = gateGain.getNextValue();
+            for (int channel = 0; channel < bufferToFill.buffer->getNumChannels(); ++channel)
+                bufferToFill.buffer->getWritePointer(channel, bufferToFill.startSample)[sample] *= gain;
+        }
+        
+        // A pause that finished fading mid-block stays silent for the rest of it
+        if (sample < bufferToFill.numSamples && gateGain.getCurrentValue() <= 0.0f)
+        {
+            for (int channel = 0; channel < bufferToFill.buffer->getNumChannels(); ++channel)
+                bufferToFill.buffer->clear(channel, bufferToFill.startSample + sample, bufferToFill.numSamples - sample);
+        }
+    }
     
-    // Get audio from the resample source
-    resampleSource.getNextAudioBlock(bufferToFill);
+    // The shadow playhead runs on at normal playback speed whatever the deck is doing
+    if (shadowActive.load() && !silent)
+    {
+        double advance = bufferToFill.numSamples * currentSpeed / outputSampleRate;
+        shadowPosition = juce::jmin(getTrackLength(), shadowPosition.load() + advance);
+    }
     
     // Apply gain
     bufferToFill.buffer->applyGain(bufferToFill.startSample, bufferToFill.numSamples, currentGain);
     
     // Apply EQ
-    applyEQ(*bufferToFill.buffer);
+    applyEQ(*bufferToFill.buffer, bufferToFill.startSample, bufferToFill.numSamples);
+    
+    // Effects rack (bypassed slots cost nothing)
+    effectsRack.process(*bufferToFill.buffer, bufferToFill.startSample, bufferToFill.numSamples);
     
     // Update audio levels for meters
     updateAudioLevels(bufferToFill);
@@ -57,11 +113,28 @@ void AudioEngine::releaseResources()
 {
     transportSource.releaseResources();
     resampleSource.releaseResources();
+    effectsRack.releaseResources();
 }
 
 void AudioEngine::changeListenerCallback(juce::ChangeBroadcaster* source)
 {
-    // Handle transport source state changes
+    if (source != &transportSource || !transportSource.hasStreamFinished())
+        return;
+    
+    // End of the track. A gapless switch never gets here, so this is the fallback
+    // for a next track the deck source couldn't join (different sample rate)
+    gateOpen = false;
+    
+    if (autoPlayEnabled && nextTrack != nullptr)
+    {
+        Track track = *nextTrack;
+        loadTrack(track);
+        play();
+    }
+    else if (onPlaybackStopped)
+    {
+        onPlaybackStopped();
+    }
 }
 
 void AudioEngine::loadTrack(const Track& track)
@@ -71,57 +144,220 @@ void AudioEngine::loadTrack(const Track& track)
     if (!track.isValid())
         return;
     
-    auto* reader = formatManager.createReaderFor(track.getFile());
-    if (reader != nullptr)
+    // A new load supersedes whatever was still being read for the last one
+    jobScheduler.cancelGroup(jobGroup);
+    
+    // Detach first so the audio thread is out of the deck source while it swaps readers
+    transportSource.setSource(nullptr);
+    currentTrack.reset();
+    nextTrack.reset();
+    publishTrackInfo();
+    shadowActive = false;
+    reverseEnabled = false;
+    rollActive = false;
+    censorActive = false;
+    loopEnabled = false;
+    
+    if (deckSource.setTrack(track.getFile()))
     {
         currentTrack = std::make_unique<Track>(track);
-        readerSource = std::make_unique<juce::AudioFormatReaderSource>(reader, true);
-        transportSource.setSource(readerSource.get(), 0, nullptr, reader->sampleRate);
+        publishTrackInfo();
+        transportSource.setSource(&deckSource, 0, nullptr, deckSource.getSourceSampleRate());
+        transportSource.start();
         
         // Reset position and cue point
         setPosition(0.0);
-        setCuePoint(0.0);
-        
-        if (onTrackLoaded)
-            onTrackLoaded();
+        prepareTrack(0.0);
+    }
+}
+
+void AudioEngine::prepareTrack(double startPosition)
+{
+    setCuePoint(startPosition);
+    updateEffectsTempo();
+    requestCacheFill();
+    requestSeekIndex();
+    
+    // Pre-decode the track's stored hot cues
+    for (int index = 0; index < Track::numHotCues; ++index)
+    {
+        if (currentTrack->hasHotCue(index))
+            deckSource.setWindow(index, secondsToSourceSamples(currentTrack->getHotCue(index)));
+    }
+    
+    if (onTrackLoaded)
+        onTrackLoaded();
+    
+    if (autoPlayEnabled && onNextTrackNeeded)
+        onNextTrackNeeded();
+}
+
+void AudioEngine::publishTrackInfo()
+{
+    // The audio thread reads these, never the Track, which a load frees
+    trackBPM = currentTrack != nullptr ? static_cast<double>(currentTrack->getBPM()) : 0.0;
+    beatGridOffset = currentTrack != nullptr ? currentTrack->getBeatGridOffset() : 0.0;
+    
+    for (int index = 0; index < Track::numHotCues; ++index)
+        hotCuePositions[static_cast<size_t>(index)] = currentTrack != nullptr ? currentTrack->getHotCue(index) : -1.0;
+}
+
+void AudioEngine::requestCacheFill()
+{
+    jobScheduler.cancelGroup(jobGroup);
+    
+    // The cache is filled from the scheduler's read of the file, which the waveform
+    // shares; the deck's own loader only decodes around the playhead meanwhile
+    int generation = deckSource.getTrackGeneration();
+    deckSource.setCacheFilledExternally(true);
+    
+    JobScheduler::DecodeConsumer consumer;
+    consumer.onBlock = [this, generation](const juce::AudioBuffer<float>& block, juce::int64 start, int numSamples) {
+        deckSource.fillCache(block, start, numSamples, generation);
+    };
+    consumer.onFinished = [this, generation](bool) {
+        // That read only kept what was near the playhead as it went past; from here on
+        // (or if it was cancelled) the loader follows the playhead itself
+        if (generation == deckSource.getTrackGeneration())
+            deckSource.setCacheFilledExternally(false);
+    };
+    
+    jobScheduler.addDecode(currentTrack->getFile(), JobScheduler::Priority::DeckLoad, jobGroup, std::move(consumer));
+}
+
+void AudioEngine::requestSeekIndex()
+{
+    // An MP3 the library hasn't indexed yet plays through the plain decoder for now;
+    // the index is built off the message thread and every later open of the file uses it
+    auto file = currentTrack->getFile();
+    
+    if (SeekIndex::needsIndex(file))
+    {
+        jobScheduler.addJob(file, JobScheduler::Priority::DeckLoad, jobGroup, [file](const std::atomic<bool>& shouldStop) {
+            SeekIndex::buildIndexFor(file, shouldStop);
+        });
+    }
+}
+
+void AudioEngine::setAutoPlayEnabled(bool enabled)
+{
+    if (autoPlayEnabled == enabled)
+        return;
+    
+    autoPlayEnabled = enabled;
+    
+    if (!enabled)
+        clearNextTrack();
+    else if (currentTrack != nullptr && onNextTrackNeeded)
+        onNextTrackNeeded();
+}
+
+void AudioEngine::setTrimSilence(bool shouldTrim)
+{
+    if (trimSilence == shouldTrim)
+        return;
+    
+    trimSilence = shouldTrim;
+    
+    // Prepare the next track again so its trim points match
+    if (nextTrack != nullptr)
+    {
+        Track track = *nextTrack;
+        queueNextTrack(track);
     }
 }
 
+void AudioEngine::queueNextTrack(const Track& track)
+{
+    if (currentTrack == nullptr || !track.isValid())
+        return;
+    
+    // The playlist entry carries the analysis (BPM, grid, cues), so it is ready when we switch
+    nextTrack = std::make_unique<Track>(track);
+    deckSource.queueNextTrack(track.getFile(), trimSilence);
+}
+
+void AudioEngine::clearNextTrack()
+{
+    nextTrack.reset();
+    deckSource.cancelNextTrack();
+}
+
+void AudioEngine::advanceToNextTrack(juce::int64 startSample)
+{
+    if (nextTrack == nullptr)
+        return;
+    
+    currentTrack = std::move(nextTrack);
+    publishTrackInfo();
+    
+    // Loops, rolls and reverse belonged to the old track
+    shadowActive = false;
+    reverseEnabled = false;
+    rollActive = false;
+    censorActive = false;
+    loopEnabled = false;
+    applyLoopRegion();
+    applyReverse();
+    
+    prepareTrack(static_cast<double>(startSample) / deckSource.getSourceSampleRate());
+}
+
 void AudioEngine::play()
 {
-    transportSource.start();
-    if (onPlaybackStarted)
-        onPlaybackStarted();
+    if (!deckSource.hasTrack())
+        return;
+    
+    gateOpen = true;
+    startedPending = true;
+    triggerAsyncUpdate();
 }
 
 void AudioEngine::pause()
 {
-    transportSource.stop();
+    gateOpen = false;
 }
 
 void AudioEngine::stop()
 {
-    transportSource.stop();
+    gateOpen = false;
     setPosition(0.0);
-    if (onPlaybackStopped)
+    stoppedPending = true;
+    triggerAsyncUpdate();
+}
+
+void AudioEngine::handleAsyncUpdate()
+{
+    // The transport only stops by itself, at the end of a track
+    if (gateOpen.load() && deckSource.hasTrack() && !transportSource.isPlaying())
+        transportSource.start();
+    
+    if (cueWindowPending.exchange(false) && deckSource.hasTrack())
+        deckSource.setWindow(cueWindowSlot, secondsToSourceSamples(cuePoint.load()));
+    
+    if (startedPending.exchange(false) && onPlaybackStarted)
+        onPlaybackStarted();
+    
+    if (stoppedPending.exchange(false) && onPlaybackStopped)
         onPlaybackStopped();
 }
 
 bool AudioEngine::isPlaying() const
 {
-    return transportSource.isPlaying();
+    return gateOpen.load();
 }
 
 bool AudioEngine::isPaused() const
 {
-    return !transportSource.isPlaying() && getPosition() > 0.0;
+    return !gateOpen.load() && getPosition() > 0.0;
 }
 
 void AudioEngine::setPosition(double positionInSeconds)
 {
-    if (readerSource.get() != nullptr)
+    // Straight to the deck source, which applies it at the start of the next block
+    if (deckSource.hasTrack())
     {
-        transportSource.setPosition(positionInSeconds);
+        deckSource.setNextReadPosition(secondsToSourceSamples(juce::jmax(0.0, positionInSeconds)));
     }
 }
 
@@ -155,6 +391,7 @@ void AudioEngine::setSpeed(double speed)
 {
     currentSpeed = juce::jlimit(0.5, 2.0, speed);
     resampleSource.setResamplingRatio(currentSpeed);
+    updateEffectsTempo();
 }
 
 void AudioEngine::setPitch(double pitch)
@@ -185,26 +422,181 @@ void AudioEngine::setHighEQ(double gain)
 void AudioEngine::setCuePoint(double position)
 {
     cuePoint = juce::jlimit(0.0, getTrackLength(), position);
+    
+    // The window is re-decoded from the message thread
+    cueWindowPending = true;
+    triggerAsyncUpdate();
 }
 
 void AudioEngine::jumpToCue()
 {
-    setPosition(cuePoint);
+    setPosition(cuePoint.load());
+}
+
+void AudioEngine::setHotCue(int index, double position)
+{
+    if (currentTrack == nullptr || index < 0 || index >= Track::numHotCues)
+        return;
+    
+    if (quantizeEnabled)
+        position = quantizePosition(position);
+    
+    position = juce::jlimit(0.0, getTrackLength(), position);
+    currentTrack->setHotCue(index, position);
+    hotCuePositions[static_cast<size_t>(index)] = position;
+    deckSource.setWindow(index, secondsToSourceSamples(position));
+    
+    if (onHotCuesChanged)
+        onHotCuesChanged();
+}
+
+void AudioEngine::clearHotCue(int index)
+{
+    if (currentTrack == nullptr || !currentTrack->hasHotCue(index))
+        return;
+    
+    currentTrack->clearHotCue(index);
+    hotCuePositions[static_cast<size_t>(index)] = -1.0;
+    deckSource.clearWindow(index);
+    
+    if (onHotCuesChanged)
+        onHotCuesChanged();
+}
+
+void AudioEngine::triggerHotCue(int index)
+{
+    if (currentTrack == nullptr)
+        return;
+    
+    if (currentTrack->hasHotCue(index))
+        setPosition(currentTrack->getHotCue(index));
+    else
+        setHotCue(index, getPosition());
+}
+
+double AudioEngine::getHotCue(int index) const
+{
+    if (index < 0 || index >= Track::numHotCues)
+        return -1.0;
+    
+    return hotCuePositions[static_cast<size_t>(index)].load();
+}
+
+double AudioEngine::quantizePosition(double position) const
+{
+    double bpm = trackBPM.load();
+    if (bpm <= 0.0)
+        return position;
+    
+    // Snap to the nearest beat of the track's grid
+    double beatLength = 60.0 / bpm;
+    double offset = beatGridOffset.load();
+    double snapped = offset + std::round((position - offset) / beatLength) * beatLength;
+    
+    return juce::jlimit(0.0, getTrackLength(), snapped);
 }
 
 void AudioEngine::setLoopStart(double position)
 {
     loopStart = juce::jlimit(0.0, getTrackLength(), position);
+    
+    if (deckSource.hasTrack())
+        deckSource.setWindow(loopWindowSlot, secondsToSourceSamples(loopStart));
+    
+    applyLoopRegion();
 }
 
 void AudioEngine::setLoopEnd(double position)
 {
     loopEnd = juce::jlimit(loopStart, getTrackLength(), position);
+    applyLoopRegion();
 }
 
 void AudioEngine::enableLoop(bool enable)
 {
     loopEnabled = enable;
+    applyLoopRegion();
+    updateSlipState();
+}
+
+void AudioEngine::setSlipEnabled(bool enabled)
+{
+    slipEnabled = enabled;
+    
+    // Switching slip off mid-move keeps playing from where we are
+    if (!enabled && !rollActive && !censorActive)
+        shadowActive = false;
+    else
+        updateSlipState();
+}
+
+void AudioEngine::setReverse(bool enabled)
+{
+    reverseEnabled = enabled;
+    
+    // Shadow starts before reversing, the snap-back happens after turning forwards
+    if (enabled)
+        updateSlipState();
+    
+    applyReverse();
+    
+    if (!enabled)
+        updateSlipState();
+}
+
+void AudioEngine::startLoopRoll(double beats)
+{
+    double bpm = trackBPM.load();
+    if (bpm <= 0.0 || beats <= 0.0)
+        return;
+    
+    double beatLength = 60.0 / bpm;
+    double start = getPosition();
+    
+    // A new roll starts on the beat just gone; changing length mid-roll keeps the start
+    if (rollActive)
+    {
+        start = rollStart;
+    }
+    else if (quantizeEnabled)
+    {
+        double offset = beatGridOffset.load();
+        start = juce::jmax(0.0, offset + std::floor((start - offset) / beatLength) * beatLength);
+    }
+    
+    rollActive = true;
+    updateSlipState();
+    
+    rollStart = start;
+    rollEnd = juce::jmin(getTrackLength(), start + beats * beatLength);
+    applyLoopRegion();
+}
+
+void AudioEngine::stopLoopRoll()
+{
+    if (!rollActive)
+        return;
+    
+    rollActive = false;
+    applyLoopRegion();
+    updateSlipState();
+}
+
+void AudioEngine::startCensor()
+{
+    censorActive = true;
+    updateSlipState();
+    applyReverse();
+}
+
+void AudioEngine::stopCensor()
+{
+    if (!censorActive)
+        return;
+    
+    censorActive = false;
+    applyReverse();
+    updateSlipState();
 }
 
 void AudioEngine::updateAudioLevels(const juce::AudioSourceChannelInfo& bufferToFill)
@@ -231,25 +623,57 @@ void AudioEngine::updateAudioLevels(const juce::AudioSourceChannelInfo& bufferTo
     peakLevel = currentPeak;
 }
 
-void AudioEngine::applyEQ(juce::AudioBuffer<float>& buffer)
+void AudioEngine::applyEQ(juce::AudioBuffer<float>& buffer, int startSample, int numSamples)
 {
+    // Only the requested region: the controller renders blocks in segments
     for (int channel = 0; channel < buffer.getNumChannels(); ++channel)
     {
-        auto* channelData = buffer.getWritePointer(channel);
-        lowEQFilter.processSamples(channelData, buffer.getNumSamples());
-        midEQFilter.processSamples(channelData, buffer.getNumSamples());
-        highEQFilter.processSamples(channelData, buffer.getNumSamples());
+        auto* channelData = buffer.getWritePointer(channel, startSample);
+        lowEQFilter.processSamples(channelData, numSamples);
+        midEQFilter.processSamples(channelData, numSamples);
+        highEQFilter.processSamples(channelData, numSamples);
     }
 }
 
-void AudioEngine::checkLoopBounds()
+void AudioEngine::applyLoopRegion()
 {
-    if (loopEnabled && loopEnd > loopStart)
+    if (rollActive)
+        deckSource.setLoop(secondsToSourceSamples(rollStart), secondsToSourceSamples(rollEnd), true);
+    else
+        deckSource.setLoop(secondsToSourceSamples(loopStart), secondsToSourceSamples(loopEnd), loopEnabled);
+}
+
+void AudioEngine::applyReverse()
+{
+    deckSource.setReverse(reverseEnabled || censorActive);
+}
+
+void AudioEngine::updateSlipState()
+{
+    bool shouldSlip = rollActive || censorActive || (slipEnabled && (loopEnabled || reverseEnabled));
+    
+    if (shouldSlip && !shadowActive.load())
     {
-        auto currentPos = getPosition();
-        if (currentPos >= loopEnd)
-        {
-            setPosition(loopStart);
-        }
+        shadowPosition = getPosition();
+        shadowActive = true;
     }
+    else if (!shouldSlip && shadowActive.load())
+    {
+        // Rejoin the shadow; the deck source plays it from RAM straight away
+        shadowActive = false;
+        setPosition(shadowPosition.load());
+    }
+}
+
+void AudioEngine::updateEffectsTempo()
+{
+    // Beat-synced effects follow the track's tempo at the current playback speed;
+    // sync changes the speed from the audio thread, so the published tempo is used
+    double bpm = trackBPM.load();
+    effectsRack.setTempo(bpm > 0.0 ? bpm * currentSpeed : 120.0 * currentSpeed);
+}
+
+juce::int64 AudioEngine::secondsToSourceSamples(double seconds) const
+{
+    return static_cast<juce::int64>(seconds * deckSource.getSourceSampleRate());
 }
\ No newline at end of file
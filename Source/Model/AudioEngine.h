@@ -1,13 +1,18 @@
 #pragma once
 #include <JuceHeader.h>
 #include "Track.h"
+#include "EffectsRack.h"
+#include "DeckSource.h"
+#include "JobScheduler.h"
 #include <functional>
+#include <array>
 
 class AudioEngine : public juce::AudioSource,
-                   public juce::ChangeListener
+                   public juce::ChangeListener,
+                   private juce::AsyncUpdater
 {
 public:
-    AudioEngine(juce::AudioFormatManager& formatManager);
+    AudioEngine(juce::AudioFormatManager& formatManager, JobScheduler& jobScheduler);
     ~AudioEngine() override;
     
     // AudioSource interface
@@ -18,7 +23,11 @@ public:
     // ChangeListener interface
     void changeListenerCallback(juce::ChangeBroadcaster* source) override;
     
-    // Playback control
+    // Playback control. Play, pause, stop, seeks and the cue and loop actions are
+    // safe to call from the audio callback: play and pause open and close a gate in
+    // front of the transport, which keeps running while a track is loaded, seeks are
+    // only published to the deck source, and anything the message thread has to do
+    // or hear about is posted to it. Loading a track is message thread only.
     void loadTrack(const Track& track);
     void play();
     void pause();
@@ -49,6 +58,9 @@ public:
     double getMidEQ() const { return midEQGain; }
     double getHighEQ() const { return highEQGain; }
     
+    // Effects
+    EffectsRack& getEffectsRack() { return effectsRack; }
+    
     // Audio analysis
     float getRMSLevel() const { return rmsLevel; }
     float getPeakLevel() const { return peakLevel; }
@@ -56,7 +68,25 @@ public:
     // Cue points
     void setCuePoint(double position);
     void jumpToCue();
-    double getCuePoint() const { return cuePoint; }
+    double getCuePoint() const { return cuePoint.load(); }
+    
+    // Hot cues, stored on the loaded track and kept pre-decoded for instant jumps.
+    // Reading them is safe from the audio callback; changing them is not
+    void setHotCue(int index, double position);
+    void clearHotCue(int index);
+    void triggerHotCue(int index); // jumps, or stores the current position on an empty pad
+    double getHotCue(int index) const;
+    bool hasHotCue(int index) const { return getHotCue(index) >= 0.0; }
+    bool isHotCueReady(int index) const { return deckSource.isWindowReady(index); }
+    
+    // Beat grid quantize for cue placement
+    void setQuantizeEnabled(bool enabled) { quantizeEnabled = enabled; }
+    bool isQuantizeEnabled() const { return quantizeEnabled; }
+    double quantizePosition(double position) const;
+    
+    // The loaded track's tempo and grid, safe to read from the audio callback
+    double getTrackBPM() const { return trackBPM.load(); }
+    double getBeatGridOffset() const { return beatGridOffset.load(); }
     
     // Loop functionality
     void setLoopStart(double position);
@@ -64,26 +94,65 @@ public:
     void enableLoop(bool enable);
     bool isLoopEnabled() const { return loopEnabled; }
     
+    // Slip mode: while looping, rolling or playing in reverse a shadow playhead
+    // keeps running at normal speed, and playback rejoins it on release
+    void setSlipEnabled(bool enabled);
+    bool isSlipEnabled() const { return slipEnabled; }
+    bool isSlipping() const { return shadowActive.load(); }
+    double getShadowPosition() const { return shadowPosition.load(); }
+    
+    // Reverse play and rolls; rolls and censor always slip
+    void setReverse(bool enabled);
+    bool isReverse() const { return reverseEnabled; }
+    void startLoopRoll(double beats);
+    void stopLoopRoll();
+    bool isRolling() const { return rollActive; }
+    void startCensor();
+    void stopCensor();
+    
+    // Auto-play: the owner supplies the next track whenever onNextTrackNeeded asks.
+    // It is opened and buffered in the background, then joined on the exact last
+    // sample of the current track (after its trailing silence, when trimming).
+    // If the two can't be joined the next track is loaded when this one ends.
+    void setAutoPlayEnabled(bool enabled);
+    bool isAutoPlayEnabled() const { return autoPlayEnabled; }
+    void setTrimSilence(bool shouldTrim);
+    bool isTrimSilenceEnabled() const { return trimSilence; }
+    void queueNextTrack(const Track& track);
+    void clearNextTrack();
+    const Track* getNextTrack() const { return nextTrack.get(); }
+    
     // Callbacks
     std::function<void()> onTrackLoaded;
     std::function<void()> onPlaybackStarted;
     std::function<void()> onPlaybackStopped;
     std::function<void(double)> onPositionChanged;
+    std::function<void()> onHotCuesChanged;
+    std::function<void()> onNextTrackNeeded;
     
-    // Current track
+    // Current track, message thread only: a load replaces it
     const Track* getCurrentTrack() const { return currentTrack.get(); }
     
 private:
     juce::AudioFormatManager& formatManager;
-    std::unique_ptr<juce::AudioFormatReaderSource> readerSource;
+    JobScheduler& jobScheduler;
+    const juce::String jobGroup { juce::Uuid().toString() };
+    juce::TimeSliceThread readAheadThread { "Deck Read-Ahead" };
+    DeckSource deckSource;
     juce::AudioTransportSource transportSource;
     juce::ResamplingAudioSource resampleSource;
     
     // Audio effects chain
     juce::IIRFilter lowEQFilter, midEQFilter, highEQFilter;
+    EffectsRack effectsRack;
     
     // Current state
     std::unique_ptr<Track> currentTrack;
+    
+    // What the audio thread needs of the current track, copied out on every change
+    std::atomic<double> trackBPM { 0.0 };
+    std::atomic<double> beatGridOffset { 0.0 };
+    std::array<std::atomic<double>, Track::numHotCues> hotCuePositions;
     double currentGain = 1.0;
     double currentSpeed = 1.0;
     double currentPitch = 0.0;
@@ -95,16 +164,56 @@ private:
     float rmsLevel = 0.0f;
     float peakLevel = 0.0f;
     
+    // Auto-play
+    std::unique_ptr<Track> nextTrack;
+    bool autoPlayEnabled = false;
+    bool trimSilence = false;
+    
+    // Transport gate, faded over a few milliseconds
+    std::atomic<bool> gateOpen { false };
+    juce::SmoothedValue<float> gateGain;
+    
+    // Posted to the message thread
+    std::atomic<bool> startedPending { false };
+    std::atomic<bool> stoppedPending { false };
+    std::atomic<bool> cueWindowPending { false };
+    
     // Cue and loop
-    double cuePoint = 0.0;
+    std::atomic<double> cuePoint { 0.0 };
     double loopStart = 0.0;
     double loopEnd = 0.0;
     bool loopEnabled = false;
+    bool quantizeEnabled = false;
+    
+    // Slip, reverse and rolls
+    bool slipEnabled = false;
+    bool reverseEnabled = false;
+    bool rollActive = false;
+    bool censorActive = false;
+    double rollStart = 0.0;
+    double rollEnd = 0.0;
+    std::atomic<bool> shadowActive { false };
+    std::atomic<double> shadowPosition { 0.0 };
+    double outputSampleRate = 44100.0;
+    
+    // Deck source windows: one per hot cue, then the main cue and the loop start
+    static constexpr int cueWindowSlot = Track::numHotCues;
+    static constexpr int loopWindowSlot = Track::numHotCues + 1;
     
     // Internal methods
+    void handleAsyncUpdate() override;
     void updateAudioLevels(const juce::AudioSourceChannelInfo& bufferToFill);
-    void applyEQ(juce::AudioBuffer<float>& buffer);
-    void checkLoopBounds();
+    void applyEQ(juce::AudioBuffer<float>& buffer, int startSample, int numSamples);
+    void applyLoopRegion();
+    void applyReverse();
+    void updateSlipState();
+    void updateEffectsTempo();
+    void prepareTrack(double startPosition);
+    void publishTrackInfo();
+    void requestCacheFill();
+    void requestSeekIndex();
+    void advanceToNextTrack(juce::int64 startSample);
+    juce::int64 secondsToSourceSamples(double seconds) const;
     
     JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR(AudioEngine)
 };
\ No newline at end of file
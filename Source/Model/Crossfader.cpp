@@ -0,0 +1,119 @@
+#include "Crossfader.h"
+#include <cmath>
+
+Crossfader::Crossfader()
+{
+    buildTables();
+    deck1Gains.resize(512, 0.0f);
+    deck2Gains.resize(512, 0.0f);
+}
+
+void Crossfader::prepareToPlay(int samplesPerBlockExpected, double sampleRate)
+{
+    juce::ignoreUnused(sampleRate);
+
+    auto capacity = static_cast<size_t>(juce::jmax(1, samplesPerBlockExpected));
+    deck1Gains.assign(capacity, 0.0f);
+    deck2Gains.assign(capacity, 0.0f);
+
+    // Start from the fader's resting place rather than ramping in from the centre
+    currentPosition = targetPosition.load();
+    currentCurve = curve.load();
+}
+
+void Crossfader::setPosition(double newPosition)
+{
+    targetPosition = juce::jlimit(-1.0, 1.0, newPosition);
+}
+
+void Crossfader::setCurve(Curve newCurve)
+{
+    curve = newCurve;
+}
+
+float Crossfader::getGainForPosition(int deckIndex, double position) const
+{
+    const auto& table = curveTables[static_cast<size_t>(curve.load())];
+    double travel = (juce::jlimit(-1.0, 1.0, position) + 1.0) * 0.5;
+
+    return deckIndex == 0 ? lookup(table, 1.0 - travel) : lookup(table, travel);
+}
+
+void Crossfader::processGains(int numSamples)
+{
+    // Larger blocks than announced are split by the caller, so the tables never grow here
+    jassert(static_cast<size_t>(numSamples) <= deck1Gains.size());
+    numSamples = juce::jmin(numSamples, static_cast<int>(deck1Gains.size()));
+
+    if (numSamples <= 0)
+        return;
+
+    double startPosition = currentPosition;
+    double endPosition = targetPosition.load();
+    Curve newCurve = curve.load();
+
+    const auto& fromTable = curveTables[static_cast<size_t>(currentCurve)];
+    const auto& toTable = curveTables[static_cast<size_t>(newCurve)];
+    bool curveChanged = newCurve != currentCurve;
+
+    double step = (endPosition - startPosition) / numSamples;
+
+    for (int i = 0; i < numSamples; ++i)
+    {
+        double position = startPosition + step * (i + 1);
+        double travel = (position + 1.0) * 0.5;
+
+        float gain1 = lookup(toTable, 1.0 - travel);
+        float gain2 = lookup(toTable, travel);
+
+        if (curveChanged)
+        {
+            // Blend from the old curve so switching mid-mix does not click
+            float blend = static_cast<float>(i + 1) / static_cast<float>(numSamples);
+            gain1 = lookup(fromTable, 1.0 - travel) + blend * (gain1 - lookup(fromTable, 1.0 - travel));
+            gain2 = lookup(fromTable, travel) + blend * (gain2 - lookup(fromTable, travel));
+        }
+
+        deck1Gains[static_cast<size_t>(i)] = gain1;
+        deck2Gains[static_cast<size_t>(i)] = gain2;
+    }
+
+    currentPosition = endPosition;
+    currentCurve = newCurve;
+}
+
+const float* Crossfader::getDeckGains(int deckIndex) const
+{
+    return deckIndex == 0 ? deck1Gains.data() : deck2Gains.data();
+}
+
+void Crossfader::buildTables()
+{
+    // Scratch curve reaches full level after this fraction of the travel
+    const double scratchCutWidth = 0.03;
+
+    auto& constantPower = curveTables[static_cast<size_t>(Curve::ConstantPower)];
+    auto& linear = curveTables[static_cast<size_t>(Curve::Linear)];
+    auto& scratchCut = curveTables[static_cast<size_t>(Curve::ScratchCut)];
+
+    for (int i = 0; i <= tableSize; ++i)
+    {
+        double travel = static_cast<double>(i) / tableSize;
+
+        constantPower[static_cast<size_t>(i)] = static_cast<float>(std::sin(travel * juce::MathConstants<double>::halfPi));
+        linear[static_cast<size_t>(i)] = static_cast<float>(travel);
+
+        // Smoothstep over the cut region keeps the edge sharp but click-free
+        double x = juce::jmin(1.0, travel / scratchCutWidth);
+        scratchCut[static_cast<size_t>(i)] = static_cast<float>(x * x * (3.0 - 2.0 * x));
+    }
+}
+
+float Crossfader::lookup(const std::array<float, tableSize + 1>& table, double travel)
+{
+    double index = juce::jlimit(0.0, 1.0, travel) * tableSize;
+    int i = juce::jmin(tableSize - 1, static_cast<int>(index));
+    float frac = static_cast<float>(index - i);
+
+    return table[static_cast<size_t>(i)] + frac * (table[static_cast<size_t>(i) + 1] - table[static_cast<size_t>(i)]);
+}
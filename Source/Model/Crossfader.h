@@ -0,0 +1,57 @@
+#pragma once
+#include <JuceHeader.h>
+#include <array>
+#include <atomic>
+#include <vector>
+
+class Crossfader
+{
+public:
+    enum class Curve
+    {
+        ConstantPower,
+        Linear,
+        ScratchCut
+    };
+
+    Crossfader();
+
+    void prepareToPlay(int samplesPerBlockExpected, double sampleRate);
+
+    // Control (message thread)
+    void setPosition(double newPosition); // -1.0 (deck 1) to 1.0 (deck 2)
+    void setCurve(Curve newCurve);
+    double getPosition() const { return targetPosition.load(); }
+    Curve getCurve() const { return curve.load(); }
+
+    // Gain a deck receives at a given fader position on the current curve
+    float getGainForPosition(int deckIndex, double position) const;
+
+    // Audio thread: computes per-sample gains for both decks, ramping from
+    // where the previous block ended to the latest fader position. At most
+    // the block size given to prepareToPlay.
+    void processGains(int numSamples);
+    const float* getDeckGains(int deckIndex) const;
+
+private:
+    static constexpr int tableSize = 1024;
+    static constexpr int numCurves = 3;
+
+    // Each table holds the gain of the deck the fader moves towards, indexed by
+    // normalised travel (0 = that deck fully cut). The other deck reads it mirrored.
+    std::array<std::array<float, tableSize + 1>, numCurves> curveTables;
+
+    std::atomic<double> targetPosition { 0.0 };
+    std::atomic<Curve> curve { Curve::ConstantPower };
+
+    // Audio thread state
+    double currentPosition = 0.0;
+    Curve currentCurve = Curve::ConstantPower;
+    std::vector<float> deck1Gains;
+    std::vector<float> deck2Gains;
+
+    void buildTables();
+    static float lookup(const std::array<float, tableSize + 1>& table, double travel);
+
+    JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR(Crossfader)
+};
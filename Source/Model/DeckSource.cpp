@@ -0,0 +1,721 @@
+#include "DeckSource.h"
+
+namespace
+{
+    // -60 dBFS; quieter than this at either end of a file counts as silence
+    constexpr float silenceThreshold = 0.001f;
+    constexpr double maxTrimSeconds = 10.0;
+    constexpr int trimBlockSize = 4096;
+
+    bool isAudible(const juce::AudioBuffer<float>& block, int index)
+    {
+        return std::abs(block.getSample(0, index)) > silenceThreshold
+            || std::abs(block.getSample(1, index)) > silenceThreshold;
+    }
+
+    juce::int64 findFirstAudible(juce::AudioFormatReader& reader)
+    {
+        juce::AudioBuffer<float> block(2, trimBlockSize);
+        auto limit = juce::jmin(reader.lengthInSamples, static_cast<juce::int64>(maxTrimSeconds * reader.sampleRate));
+
+        for (juce::int64 start = 0; start < limit; start += trimBlockSize)
+        {
+            int count = static_cast<int>(juce::jmin<juce::int64>(trimBlockSize, limit - start));
+            reader.read(&block, 0, count, start, true, true);
+
+            for (int i = 0; i < count; ++i)
+                if (isAudible(block, i))
+                    return start + i;
+        }
+
+        // Silent for that long is deliberate; leave it be
+        return 0;
+    }
+
+    juce::int64 findAudibleEnd(juce::AudioFormatReader& reader, juce::int64 length)
+    {
+        juce::AudioBuffer<float> block(2, trimBlockSize);
+        auto limit = juce::jmax<juce::int64>(0, length - static_cast<juce::int64>(maxTrimSeconds * reader.sampleRate));
+
+        for (juce::int64 end = length; end > limit; end -= trimBlockSize)
+        {
+            int count = static_cast<int>(juce::jmin<juce::int64>(trimBlockSize, end - limit));
+            reader.read(&block, 0, count, end - count, true, true);
+
+            for (int i = count - 1; i >= 0; --i)
+                if (isAudible(block, i))
+                    return end - count + i + 1;
+        }
+
+        return length;
+    }
+}
+
+DeckSource::DeckSource(juce::AudioFormatManager& fm, juce::TimeSliceThread& readAheadThread)
+    : formatManager(fm), thread(readAheadThread)
+{
+    thread.addTimeSliceClient(this);
+}
+
+DeckSource::~DeckSource()
+{
+    thread.removeTimeSliceClient(this);
+    clearTrack();
+}
+
+bool DeckSource::setTrack(const juce::File& file)
+{
+    clearTrack();
+
+    auto* reader = SeekIndex::createReaderFor(formatManager, file);
+    if (reader == nullptr)
+        return false;
+
+    sourceSampleRate = reader->sampleRate;
+    totalLength = reader->lengthInSamples;
+    windowLength = juce::jmax(1, juce::roundToInt(windowSeconds * sourceSampleRate));
+
+    // About a second of read-ahead; the windows cover the time it takes to refill after a jump
+    auto& stream = getActiveStream();
+    stream.reader = std::make_unique<juce::AudioFormatReaderSource>(reader, true);
+    stream.buffered = std::make_unique<juce::BufferingAudioSource>(stream.reader.get(), thread, false,
+                                                                  juce::jmax(32768, juce::roundToInt(sourceSampleRate)), 2);
+
+    {
+        const juce::ScopedLock rl(readerLock);
+        windowReader.reset(SeekIndex::createReaderFor(formatManager, file));
+        readerGeneration = ++generation;
+
+        // Cache for reverse play, loop wraps and seeks
+        cache.allocate(totalLength);
+        cacheScratch.setSize(2, DecodeCache::chunkSize);
+        cacheValid = true;
+        cacheFilledExternally = false;
+
+        // Windows are sized for the new track up front; the loader swaps freshly decoded buffers in
+        const juce::ScopedLock wl(windowLock);
+        for (auto& window : windows)
+        {
+            window.audio.setSize(2, windowLength);
+            window.start = -1;
+            window.ready = false;
+            window.requestedStart = -1;
+            window.pending = false;
+        }
+    }
+
+    playPosition = 0;
+    pendingSeek = -1;
+    trackEnd = totalLength.load();
+    activeWindow = -1;
+    cacheUntil = -1;
+    loopEnabled = false;
+    reverse = false;
+    wasReversed = false;
+
+    if (prepared)
+        stream.buffered->prepareToPlay(preparedBlockSize, preparedSampleRate);
+
+    return true;
+}
+
+void DeckSource::clearTrack()
+{
+    cancelNextTrack();
+
+    {
+        const juce::ScopedLock rl(readerLock);
+        windowReader.reset();
+        readerGeneration = ++generation;
+        cacheValid = false;
+        cache.release();
+
+        const juce::ScopedLock wl(windowLock);
+        for (auto& window : windows)
+        {
+            window.ready = false;
+            window.pending = false;
+        }
+    }
+
+    auto& stream = getActiveStream();
+    stream.buffered.reset();
+    stream.reader.reset();
+    totalLength = 0;
+    activeWindow = -1;
+    cacheUntil = -1;
+}
+
+void DeckSource::setWindow(int slot, juce::int64 startSample)
+{
+    if (slot < 0 || slot >= numWindows)
+        return;
+
+    auto& window = windows[static_cast<size_t>(slot)];
+    window.requestedStart = startSample < 0 ? -1 : juce::jlimit<juce::int64>(0, juce::jmax<juce::int64>(0, totalLength - 1), startSample);
+    window.pending = true;
+
+    thread.moveToFrontOfQueue(this);
+}
+
+void DeckSource::clearWindow(int slot)
+{
+    setWindow(slot, -1);
+}
+
+bool DeckSource::isWindowReady(int slot) const
+{
+    if (slot < 0 || slot >= numWindows)
+        return false;
+
+    const auto& window = windows[static_cast<size_t>(slot)];
+    return window.ready.load() && !window.pending.load() && window.generation == generation.load();
+}
+
+void DeckSource::queueNextTrack(const juce::File& file, bool trimSilence)
+{
+    cancelNextTrack();
+
+    if (!hasTrack())
+        return;
+
+    const juce::ScopedLock nl(nextLock);
+
+    // Switched over just now; the owner queues again once it hears about it
+    if (nextState.load() == NextState::Handover)
+        return;
+
+    nextFile = file;
+    nextTrim = trimSilence;
+    nextState = NextState::Requested;
+    thread.moveToFrontOfQueue(this);
+}
+
+void DeckSource::cancelNextTrack()
+{
+    // A switch that has already happened is finished off first
+    handleUpdateNowIfNeeded();
+
+    std::unique_ptr<juce::BufferingAudioSource> buffered;
+    std::unique_ptr<juce::AudioFormatReaderSource> source;
+    std::unique_ptr<juce::AudioFormatReader> reader;
+
+    {
+        const juce::ScopedLock nl(nextLock);
+        ++nextRequest;
+
+        auto armed = NextState::Armed;
+        if (nextState.compare_exchange_strong(armed, NextState::Idle))
+        {
+            buffered = std::move(getSpareStream().buffered);
+            source = std::move(getSpareStream().reader);
+            reader = std::move(nextWindowReader);
+            trackEnd = totalLength.load();
+        }
+        else if (nextState.load() != NextState::Handover)
+        {
+            nextState = NextState::Idle;
+        }
+    }
+
+    // Released outside the lock: the read-ahead thread may be waiting on it
+}
+
+void DeckSource::prepareToPlay(int samplesPerBlockExpected, double sampleRate)
+{
+    prepared = true;
+    preparedBlockSize = samplesPerBlockExpected;
+    preparedSampleRate = sampleRate;
+
+    if (auto* stream = getStream())
+        stream->prepareToPlay(samplesPerBlockExpected, sampleRate);
+
+    const juce::ScopedLock nl(nextLock);
+    auto& spare = getSpareStream();
+    if (nextState.load() == NextState::Armed && spare.buffered != nullptr)
+        spare.buffered->prepareToPlay(samplesPerBlockExpected, sampleRate);
+}
+
+void DeckSource::releaseResources()
+{
+    prepared = false;
+
+    if (auto* stream = getStream())
+        stream->releaseResources();
+}
+
+void DeckSource::setLoop(juce::int64 startSample, juce::int64 endSample, bool enabled)
+{
+    loopStart = startSample;
+    loopEnd = endSample;
+    loopEnabled = enabled && endSample > startSample;
+}
+
+void DeckSource::getNextAudioBlock(const juce::AudioSourceChannelInfo& bufferToFill)
+{
+    if (getStream() == nullptr)
+    {
+        bufferToFill.clearActiveBufferRegion();
+        return;
+    }
+
+    applyPendingSeek();
+
+    auto& buffer = *bufferToFill.buffer;
+    int startSample = bufferToFill.startSample;
+    int remaining = bufferToFill.numSamples;
+
+    if (reverse.load())
+    {
+        // Backwards from the cache alone; the stream stays put until we turn round
+        auto position = playPosition.load();
+        if (cacheValid.load())
+            cache.read(buffer, startSample, position, remaining, true);
+        else
+            bufferToFill.clearActiveBufferRegion();
+        playPosition = juce::jmax<juce::int64>(0, position - remaining);
+
+        activeWindow = -1;
+        cacheUntil = -1;
+        wasReversed = true;
+        return;
+    }
+
+    if (wasReversed)
+    {
+        // Forwards again: bridge from RAM while the stream catches up
+        wasReversed = false;
+        seekInternal(playPosition.load());
+    }
+
+    bool looping = loopEnabled.load();
+    auto start = loopStart.load();
+    auto end = loopEnd.load();
+
+    while (remaining > 0)
+    {
+        int count = remaining;
+
+        // Stop on the last sample of this track and carry on into the next one
+        if (nextState.load() == NextState::Armed)
+        {
+            auto endSample = trackEnd.load();
+
+            if (playPosition.load() >= endSample)
+            {
+                performHandover();
+                looping = false;
+                continue;
+            }
+
+            count = static_cast<int>(juce::jmin<juce::int64>(count, endSample - playPosition.load()));
+        }
+
+        if (looping)
+        {
+            if (playPosition.load() >= end)
+                seekInternal(start);
+
+            count = static_cast<int>(juce::jmin<juce::int64>(count, end - playPosition.load()));
+        }
+
+        renderForward(buffer, startSample, count);
+        startSample += count;
+        remaining -= count;
+    }
+}
+
+void DeckSource::renderForward(juce::AudioBuffer<float>& buffer, int startSample, int numSamples)
+{
+    int remaining = numSamples;
+    juce::int64 position = playPosition.load();
+
+    if (activeWindow >= 0)
+    {
+        const juce::ScopedTryLock sl(windowLock);
+
+        if (!sl.isLocked())
+        {
+            // The loader is swapping a window in; keep our place and try again next block
+            for (int channel = 0; channel < buffer.getNumChannels(); ++channel)
+                buffer.clear(channel, startSample, remaining);
+
+            playPosition = position + remaining;
+            return;
+        }
+
+        auto& window = windows[static_cast<size_t>(activeWindow)];
+        juce::int64 offset = position - window.start;
+
+        if (window.ready.load() && window.start >= 0 && offset >= 0 && offset < windowLength)
+        {
+            int count = static_cast<int>(juce::jmin<juce::int64>(remaining, windowLength - offset));
+
+            for (int channel = 0; channel < buffer.getNumChannels(); ++channel)
+                buffer.copyFrom(channel, startSample, window.audio, juce::jmin(channel, 1), static_cast<int>(offset), count);
+
+            startSample += count;
+            remaining -= count;
+            position += count;
+
+            // The read-ahead was pointed at the end of the window when we jumped in
+            if (offset + count >= windowLength)
+                activeWindow = -1;
+        }
+        else
+        {
+            // Window was moved or dropped under us: stream from here instead
+            activeWindow = -1;
+            getStream()->setNextReadPosition(position);
+        }
+    }
+
+    if (remaining > 0 && cacheUntil >= 0)
+    {
+        int count = static_cast<int>(juce::jmin<juce::int64>(remaining, cacheUntil - position));
+
+        if (count > 0 && isCached(position, count))
+        {
+            cache.read(buffer, startSample, position, count, false);
+            startSample += count;
+            remaining -= count;
+            position += count;
+        }
+        else if (count > 0)
+        {
+            getStream()->setNextReadPosition(position);
+        }
+
+        if (count <= 0 || position >= cacheUntil || remaining > 0)
+            cacheUntil = -1;
+    }
+
+    if (remaining > 0)
+    {
+        juce::AudioSourceChannelInfo streamInfo(&buffer, startSample, remaining);
+        getStream()->getNextAudioBlock(streamInfo);
+        position += remaining;
+    }
+
+    playPosition = position;
+}
+
+void DeckSource::setNextReadPosition(juce::int64 newPosition)
+{
+    // Only published here; the audio thread moves the playhead and the read-ahead
+    // together at the start of its next block, so neither runs ahead of the other
+    pendingSeek = juce::jmax<juce::int64>(0, newPosition);
+}
+
+juce::int64 DeckSource::getNextReadPosition() const
+{
+    auto pending = pendingSeek.load();
+    return pending >= 0 ? pending : playPosition.load();
+}
+
+void DeckSource::applyPendingSeek()
+{
+    auto seek = pendingSeek.exchange(-1);
+    if (seek >= 0)
+        seekInternal(seek);
+}
+
+void DeckSource::seekInternal(juce::int64 position)
+{
+    playPosition = position;
+    activeWindow = -1;
+    cacheUntil = -1;
+
+    // Play from a window or the cache while the read-ahead refills from where that runs out
+    juce::int64 streamFrom = position;
+
+    {
+        const juce::ScopedTryLock sl(windowLock);
+        if (sl.isLocked())
+            activeWindow = findWindow(position);
+
+        if (activeWindow >= 0)
+            streamFrom = windows[static_cast<size_t>(activeWindow)].start + windowLength;
+    }
+
+    if (activeWindow < 0 && isCached(position, windowLength / 2))
+    {
+        cacheUntil = position + windowLength / 2;
+        streamFrom = cacheUntil;
+    }
+
+    auto* stream = getStream();
+    if (stream->getNextReadPosition() != streamFrom)
+        stream->setNextReadPosition(streamFrom);
+}
+
+void DeckSource::performHandover()
+{
+    auto armed = NextState::Armed;
+    if (!nextState.compare_exchange_strong(armed, NextState::Handover))
+        return;
+
+    // Only the slot index changes; the outgoing track is freed on the message thread
+    activeStream = 1 - activeStream.load();
+    totalLength = nextLength;
+    trackEnd = nextLength;
+
+    // Windows and cache still hold the old track until the message thread rebuilds them
+    ++generation;
+    cacheValid = false;
+    loopEnabled = false;
+    activeWindow = -1;
+    cacheUntil = -1;
+    playPosition = nextStart;
+
+    triggerAsyncUpdate();
+}
+
+void DeckSource::handleAsyncUpdate()
+{
+    std::unique_ptr<juce::BufferingAudioSource> buffered;
+    std::unique_ptr<juce::AudioFormatReaderSource> source;
+    juce::int64 startSample = 0;
+
+    {
+        const juce::ScopedLock nl(nextLock);
+        if (nextState.load() != NextState::Handover)
+            return;
+
+        // The audio thread has moved on to the other slot, so this one is ours again
+        buffered = std::move(getSpareStream().buffered);
+        source = std::move(getSpareStream().reader);
+        startSample = nextStart;
+
+        const juce::ScopedLock rl(readerLock);
+        windowReader = std::move(nextWindowReader);
+        readerGeneration = generation.load();
+        cache.allocate(totalLength);
+        cacheValid = true;
+        cacheFilledExternally = false;
+
+        const juce::ScopedLock wl(windowLock);
+        for (auto& window : windows)
+        {
+            window.ready = false;
+            window.start = -1;
+            window.pending = false;
+        }
+
+        nextState = NextState::Idle;
+    }
+
+    // The outgoing track's read-ahead unregisters from the thread here, outside the locks
+    buffered.reset();
+    source.reset();
+
+    if (onTrackAdvanced)
+        onTrackAdvanced(startSample);
+}
+
+bool DeckSource::prepareNextTrack()
+{
+    juce::File file;
+    bool trim = false;
+    int request = 0;
+
+    {
+        const juce::ScopedLock nl(nextLock);
+        if (nextState.load() != NextState::Requested)
+            return false;
+
+        file = nextFile;
+        trim = nextTrim;
+        request = nextRequest;
+    }
+
+    std::unique_ptr<juce::AudioFormatReader> reader(SeekIndex::createReaderFor(formatManager, file));
+    std::unique_ptr<juce::AudioFormatReader> loaderReader(SeekIndex::createReaderFor(formatManager, file));
+    bool usable = reader != nullptr && loaderReader != nullptr && reader->lengthInSamples > 0
+               && reader->sampleRate == sourceSampleRate;
+
+    std::unique_ptr<juce::AudioFormatReaderSource> source;
+    std::unique_ptr<juce::BufferingAudioSource> buffered;
+    juce::int64 start = 0, length = 0, end = totalLength.load();
+
+    if (usable)
+    {
+        length = reader->lengthInSamples;
+
+        if (trim)
+        {
+            start = findFirstAudible(*loaderReader);
+
+            // Take the playing track's reader out for the scan, as the window decodes do,
+            // so filling its cache never waits on seconds of decoding
+            std::unique_ptr<juce::AudioFormatReader> playingReader;
+            int readerTrack = 0;
+
+            {
+                const juce::ScopedLock rl(readerLock);
+                playingReader = std::move(windowReader);
+                readerTrack = readerGeneration;
+            }
+
+            if (playingReader != nullptr)
+            {
+                auto audibleEnd = findAudibleEnd(*playingReader, totalLength.load());
+
+                const juce::ScopedLock rl(readerLock);
+
+                // The track changed while we were scanning: its end no longer applies
+                if (readerTrack == readerGeneration && windowReader == nullptr)
+                {
+                    windowReader = std::move(playingReader);
+                    end = audibleEnd;
+                }
+            }
+        }
+
+        // Same read-ahead as the playing track, already filling from the head
+        source = std::make_unique<juce::AudioFormatReaderSource>(reader.release(), true);
+        buffered = std::make_unique<juce::BufferingAudioSource>(source.get(), thread, false,
+                                                                juce::jmax(32768, juce::roundToInt(sourceSampleRate)), 2);
+        buffered->setNextReadPosition(start);
+
+        if (prepared)
+            buffered->prepareToPlay(preparedBlockSize, preparedSampleRate);
+    }
+
+    const juce::ScopedLock nl(nextLock);
+
+    // Cancelled or replaced while we were busy: the locals are dropped on the way out
+    if (request != nextRequest || nextState.load() != NextState::Requested)
+        return true;
+
+    if (!usable)
+    {
+        nextState = NextState::Failed;
+        return true;
+    }
+
+    auto& spare = getSpareStream();
+    spare.reader = std::move(source);
+    spare.buffered = std::move(buffered);
+    nextWindowReader = std::move(loaderReader);
+    nextStart = start;
+    nextLength = length;
+    trackEnd = juce::jmax<juce::int64>(1, end);
+    nextState = NextState::Armed;
+    return true;
+}
+
+bool DeckSource::isCached(juce::int64 start, juce::int64 numSamples) const
+{
+    return cacheValid.load() && cache.isRangeReady(start, numSamples);
+}
+
+int DeckSource::findWindow(juce::int64 position) const
+{
+    // Only use a window with enough of it left for the read-ahead to catch up,
+    // and prefer the one that leaves the most
+    int best = -1;
+    juce::int64 bestStart = 0;
+
+    for (int slot = 0; slot < numWindows; ++slot)
+    {
+        const auto& window = windows[static_cast<size_t>(slot)];
+
+        if (!window.ready.load() || window.start < 0 || window.generation != generation.load())
+            continue;
+
+        if (position >= window.start && position < window.start + windowLength / 2
+            && (best < 0 || window.start < bestStart))
+        {
+            best = slot;
+            bestStart = window.start;
+        }
+    }
+
+    return best;
+}
+
+void DeckSource::fillCache(const juce::AudioBuffer<float>& block, juce::int64 startSample, int numSamples,
+                           int trackGeneration)
+{
+    const juce::ScopedLock rl(readerLock);
+
+    if (cacheValid.load() && trackGeneration == readerGeneration)
+    {
+        updateCacheFocus();
+        cache.store(block, startSample, numSamples);
+    }
+}
+
+void DeckSource::updateCacheFocus()
+{
+    // Rolls are loops too, so whatever is looping stays in RAM
+    bool looping = loopEnabled.load();
+    cache.setFocus(playPosition.load(), looping ? loopStart.load() : -1, looping ? loopEnd.load() : -1);
+}
+
+int DeckSource::useTimeSlice()
+{
+    // A queued next track comes first; its head has to be buffered before this one ends
+    if (prepareNextTrack())
+        return 0;
+
+    // One window per slice, so the read-ahead buffer sharing this thread never starves
+    for (auto& window : windows)
+    {
+        if (!window.pending.exchange(false))
+            continue;
+
+        auto start = window.requestedStart.load();
+
+        if (start < 0)
+        {
+            const juce::ScopedLock wl(windowLock);
+            window.ready = false;
+            window.start = -1;
+            return 0;
+        }
+
+        // Take the reader out for the decode, so a track change never waits on it
+        std::unique_ptr<juce::AudioFormatReader> reader;
+        int readerTrack = 0;
+        int length = 0;
+
+        {
+            const juce::ScopedLock rl(readerLock);
+            reader = std::move(windowReader);
+            readerTrack = readerGeneration;
+            length = windowLength;
+        }
+
+        if (reader == nullptr)
+            return 0;
+
+        juce::AudioBuffer<float> decoded(2, length);
+        reader->read(&decoded, 0, length, start, true, true);
+
+        const juce::ScopedLock rl(readerLock);
+
+        // The track changed while we were decoding: the old reader goes on the way out
+        if (readerTrack != readerGeneration || windowReader != nullptr)
+            return 0;
+
+        windowReader = std::move(reader);
+
+        const juce::ScopedLock wl(windowLock);
+        std::swap(window.audio, decoded);
+        window.start = start;
+        window.generation = readerTrack;
+        window.ready = true;
+        return 0;
+    }
+
+    // Then one cache chunk at a time until everything around the playhead and the loop is in RAM
+    const juce::ScopedLock rl(readerLock);
+    updateCacheFocus();
+
+    if (windowReader != nullptr && cache.decodeNextChunk(*windowReader, cacheScratch, cacheFilledExternally.load()))
+        return 1;
+
+    return 250;
+}
@@ -0,0 +1,164 @@
+#pragma once
+#include <JuceHeader.h>
+#include "DecodeCache.h"
+#include "SeekIndex.h"
+#include <array>
+#include <atomic>
+#include <functional>
+#include <memory>
+
+// Track source for a deck, sitting underneath the transport.
+// Normal playback streams through a read-ahead buffer filled on a background
+// thread. On top of that it keeps a set of short pre-decoded windows (hot cues,
+// the main cue, the loop start) resident in memory. It also keeps a decode cache
+// filled in the background around the playhead, with the loop region pinned. A seek that lands in a window or in a cached
+// region plays from RAM on the very next sample while the read-ahead buffer
+// refills further on, so cue jumps, loop wraps and slip returns never wait on
+// the disk. Reverse playback reads from the cache alone.
+// The track that follows can be queued: it is opened and its head buffered
+// ahead of time, and the audio thread switches to it on the exact sample the
+// current one ends, so auto-play runs from track to track without a gap.
+class DeckSource : public juce::PositionableAudioSource,
+                   private juce::TimeSliceClient,
+                   private juce::AsyncUpdater
+{
+public:
+    static constexpr int numWindows = 10;
+    static constexpr double windowSeconds = 2.0;
+
+    DeckSource(juce::AudioFormatManager& formatManager, juce::TimeSliceThread& readAheadThread);
+    ~DeckSource() override;
+
+    // Message thread. The transport must not be pulling from this source while
+    // the track is swapped (AudioEngine detaches it first).
+    bool setTrack(const juce::File& file);
+    void clearTrack();
+    bool hasTrack() const { return getStream() != nullptr; }
+    double getSourceSampleRate() const { return sourceSampleRate; }
+
+    // Message thread: (re)decode a window starting at startSample, or drop it
+    void setWindow(int slot, juce::int64 startSample);
+    void clearWindow(int slot);
+    bool isWindowReady(int slot) const;
+
+    // Any thread. The loop wraps inside the block, on the exact end sample.
+    void setLoop(juce::int64 startSample, juce::int64 endSample, bool enabled);
+    void setReverse(bool shouldPlayReversed) { reverse = shouldPlayReversed; }
+    bool isReversed() const { return reverse.load(); }
+    bool isFullyCached() const { return cache.isComplete(); }
+
+    // The cache can be filled by a shared read of the file instead
+    // of the loader's own reader. Blocks tagged with an older track generation
+    // are ignored, so a late block from a previous track never lands here.
+    int getTrackGeneration() const { return generation.load(); }
+    void fillCache(const juce::AudioBuffer<float>& block, juce::int64 startSample, int numSamples, int trackGeneration);
+    void setCacheFilledExternally(bool external) { cacheFilledExternally = external; }
+
+    // Message thread: prepare the track to switch to when this one ends. With
+    // trimSilence the switch happens after the last audible sample here and
+    // lands on the first audible sample there. Only tracks at the same sample
+    // rate can be joined; anything else reports failure and is left to the owner.
+    void queueNextTrack(const juce::File& file, bool trimSilence);
+    void cancelNextTrack();
+    bool isNextTrackArmed() const { return nextState.load() == NextState::Armed; }
+    bool hasNextTrackFailed() const { return nextState.load() == NextState::Failed; }
+    std::function<void(juce::int64)> onTrackAdvanced; // message thread; where the new track started
+
+    // PositionableAudioSource
+    void prepareToPlay(int samplesPerBlockExpected, double sampleRate) override;
+    void releaseResources() override;
+    void getNextAudioBlock(const juce::AudioSourceChannelInfo& bufferToFill) override;
+    void setNextReadPosition(juce::int64 newPosition) override;
+    juce::int64 getNextReadPosition() const override;
+    juce::int64 getTotalLength() const override { return totalLength.load(); }
+    bool isLooping() const override { return false; }
+
+private:
+    struct Window
+    {
+        juce::AudioBuffer<float> audio;
+        juce::int64 start = -1;
+        int generation = 0;     // track the audio was decoded from
+        std::atomic<bool> ready { false };
+
+        // Request from the message thread, picked up by the loader
+        std::atomic<juce::int64> requestedStart { -1 };
+        std::atomic<bool> pending { false };
+    };
+
+    juce::AudioFormatManager& formatManager;
+    juce::TimeSliceThread& thread;
+
+    // Streaming path: the playing track and the one queued after it. A gapless
+    // switch only flips activeStream on the audio thread; the slot it leaves is
+    // freed later on the message thread.
+    struct Stream
+    {
+        std::unique_ptr<juce::AudioFormatReaderSource> reader;
+        std::unique_ptr<juce::BufferingAudioSource> buffered;
+    };
+
+    std::array<Stream, 2> streams;
+    std::atomic<int> activeStream { 0 };
+    double sourceSampleRate = 44100.0;
+    std::atomic<juce::int64> totalLength { 0 };
+    int windowLength = 0;
+
+    // RAM paths; the loader decodes through its own reader
+    std::array<Window, numWindows> windows;
+    DecodeCache cache;
+    std::unique_ptr<juce::AudioFormatReader> windowReader;
+    juce::AudioBuffer<float> cacheScratch;
+    juce::CriticalSection windowLock;   // window contents vs the audio thread
+    juce::CriticalSection readerLock;   // windowReader and the cache vs track changes; never held over a window decode or scan
+    std::atomic<bool> cacheValid { false };
+    std::atomic<bool> cacheFilledExternally { false }; // the loader only decodes around the playhead
+    std::atomic<int> generation { 0 };  // bumped on every track change
+    int readerGeneration = 0;           // the track windowReader belongs to
+
+    // Next track, built by the loader and taken over by the audio thread
+    enum class NextState { Idle, Requested, Armed, Handover, Failed };
+    std::atomic<NextState> nextState { NextState::Idle };
+    juce::CriticalSection nextLock;     // requests vs the loader; never taken by the audio thread
+    juce::File nextFile;
+    bool nextTrim = false;
+    int nextRequest = 0;
+    std::unique_ptr<juce::AudioFormatReader> nextWindowReader;
+    juce::int64 nextStart = 0;
+    juce::int64 nextLength = 0;
+    std::atomic<juce::int64> trackEnd { 0 }; // where the switch happens
+
+    // Transport modes
+    std::atomic<juce::int64> loopStart { 0 };
+    std::atomic<juce::int64> loopEnd { 0 };
+    std::atomic<bool> loopEnabled { false };
+    std::atomic<bool> reverse { false };
+
+    // Audio thread state
+    std::atomic<juce::int64> playPosition { 0 };
+    std::atomic<juce::int64> pendingSeek { -1 };
+    int activeWindow = -1;
+    juce::int64 cacheUntil = -1;   // forward reads come from the cache up to here
+    bool wasReversed = false;
+
+    bool prepared = false;
+    int preparedBlockSize = 512;
+    double preparedSampleRate = 44100.0;
+
+    Stream& getActiveStream() { return streams[static_cast<size_t>(activeStream.load())]; }
+    Stream& getSpareStream() { return streams[static_cast<size_t>(1 - activeStream.load())]; }
+    juce::BufferingAudioSource* getStream() const { return streams[static_cast<size_t>(activeStream.load())].buffered.get(); }
+
+    int useTimeSlice() override;
+    void handleAsyncUpdate() override;
+    bool prepareNextTrack();
+    void performHandover();
+    bool isCached(juce::int64 start, juce::int64 numSamples) const;
+    int findWindow(juce::int64 position) const;
+    void updateCacheFocus();
+    void applyPendingSeek();
+    void seekInternal(juce::int64 position);
+    void renderForward(juce::AudioBuffer<float>& buffer, int startSample, int numSamples);
+
+    JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR(DeckSource)
+};
@@ -0,0 +1,290 @@
+#include "DecodeCache.h"
+
+namespace
+{
+    constexpr float toInt16 = 32767.0f;
+    constexpr float fromInt16 = 1.0f / 32767.0f;
+}
+
+DecodeCache::DecodeCache()
+{
+}
+
+bool DecodeCache::allocate(juce::int64 lengthInSamples)
+{
+    release();
+
+    if (lengthInSamples <= 0)
+        return false;
+
+    // The slots are allocated on the first track and reused for every one after
+    if (samples.empty())
+        samples.assign(static_cast<size_t>(numSlots) * chunkSize * 2, 0);
+
+    totalLength = lengthInSamples;
+    numChunks = static_cast<int>((lengthInSamples + chunkSize - 1) / chunkSize);
+
+    chunkSlot = std::make_unique<std::atomic<int>[]>(static_cast<size_t>(numChunks));
+    for (int chunk = 0; chunk < numChunks; ++chunk)
+        chunkSlot[static_cast<size_t>(chunk)] = -1;
+
+    slotChunk.fill(-1);
+    chunksReady = 0;
+    focusPosition = 0;
+    pinStart = -1;
+    pinEnd = -1;
+    return true;
+}
+
+void DecodeCache::release()
+{
+    numChunks = 0;
+    chunksReady = 0;
+    totalLength = 0;
+    chunkSlot.reset();
+    slotChunk.fill(-1);
+}
+
+void DecodeCache::setFocus(juce::int64 playPosition, juce::int64 newPinStart, juce::int64 newPinEnd)
+{
+    focusPosition = playPosition;
+    pinStart = newPinStart;
+    pinEnd = newPinEnd;
+}
+
+bool DecodeCache::decodeNextChunk(juce::AudioFormatReader& reader, juce::AudioBuffer<float>& scratch, bool nearbyOnly)
+{
+    int chunk = findChunkToDecode(nearbyOnly);
+    if (chunk < 0 || scratch.getNumChannels() < 2 || scratch.getNumSamples() < chunkSize)
+        return false;
+
+    juce::int64 start = static_cast<juce::int64>(chunk) * chunkSize;
+    reader.read(&scratch, 0, chunkSize, start, true, true);
+
+    storeChunk(chunk, scratch.getReadPointer(0), scratch.getReadPointer(1), chunkSize);
+    return true;
+}
+
+void DecodeCache::store(const juce::AudioBuffer<float>& block, juce::int64 startSample, int numSamples)
+{
+    if (numChunks == 0 || startSample < 0 || startSample % chunkSize != 0 || block.getNumChannels() == 0)
+        return;
+
+    numSamples = juce::jmin(numSamples, block.getNumSamples());
+    int right = block.getNumChannels() > 1 ? 1 : 0;
+    auto wanted = getWantedRange();
+
+    for (int offset = 0; offset < numSamples; offset += chunkSize)
+    {
+        int chunk = static_cast<int>((startSample + offset) / chunkSize);
+        if (chunk >= numChunks)
+            break;
+
+        // The last chunk of the track may be short; anything else has to be whole
+        int count = juce::jmin(chunkSize, numSamples - offset);
+        if (count < chunkSize && startSample + offset + count < totalLength)
+            break;
+
+        if (wanted.contains(chunk) && !isChunkReady(chunk))
+            storeChunk(chunk, block.getReadPointer(0, offset), block.getReadPointer(right, offset), count);
+    }
+}
+
+void DecodeCache::storeChunk(int chunk, const float* left, const float* right, int numSamples)
+{
+    int slot = takeSlot(getWantedRange());
+    if (slot < 0)
+        return;
+
+    // Interleave and quantise; float -> int16 halves the footprint
+    auto* destination = samples.data() + static_cast<size_t>(slot) * chunkSize * 2;
+
+    for (int i = 0; i < numSamples; ++i)
+    {
+        destination[i * 2] = static_cast<juce::int16>(juce::jlimit(-1.0f, 1.0f, left[i]) * toInt16);
+        destination[i * 2 + 1] = static_cast<juce::int16>(juce::jlimit(-1.0f, 1.0f, right[i]) * toInt16);
+    }
+
+    slotChunk[static_cast<size_t>(slot)] = chunk;
+    chunkSlot[static_cast<size_t>(chunk)].store(slot, std::memory_order_release);
+    ++chunksReady;
+}
+
+int DecodeCache::takeSlot(const WantedRange& wanted)
+{
+    int spare = -1;
+
+    for (int slot = 0; slot < numSlots; ++slot)
+    {
+        int chunk = slotChunk[static_cast<size_t>(slot)];
+
+        if (chunk < 0)
+            return slot;
+
+        if (spare < 0 && !wanted.contains(chunk))
+            spare = slot;
+    }
+
+    if (spare >= 0)
+    {
+        // Hand the slot over: the old chunk stops being readable before its audio is overwritten
+        int chunk = slotChunk[static_cast<size_t>(spare)];
+        chunkSlot[static_cast<size_t>(chunk)].store(-1, std::memory_order_seq_cst);
+        slotChunk[static_cast<size_t>(spare)] = -1;
+        --chunksReady;
+    }
+
+    return spare;
+}
+
+bool DecodeCache::isChunkReady(int chunk) const
+{
+    return chunkSlot[static_cast<size_t>(chunk)].load(std::memory_order_acquire) >= 0;
+}
+
+bool DecodeCache::isRangeReady(juce::int64 start, juce::int64 numSamples) const
+{
+    if (numChunks == 0 || start < 0 || numSamples <= 0)
+        return false;
+
+    juce::int64 end = juce::jmin(totalLength, start + numSamples);
+    if (start >= end)
+        return false;
+
+    for (auto chunk = start / chunkSize; chunk <= (end - 1) / chunkSize; ++chunk)
+    {
+        if (!isChunkReady(static_cast<int>(chunk)))
+            return false;
+    }
+
+    return true;
+}
+
+void DecodeCache::read(juce::AudioBuffer<float>& destination, int destStartSample, juce::int64 sourceStart,
+                       int numSamples, bool reversed) const
+{
+    auto* left = destination.getWritePointer(0, destStartSample);
+    auto* right = destination.getNumChannels() > 1 ? destination.getWritePointer(1, destStartSample) : nullptr;
+    int done = 0;
+
+    while (done < numSamples)
+    {
+        juce::int64 index = reversed ? sourceStart - 1 - done : sourceStart + done;
+
+        if (index < 0 || index >= totalLength)
+        {
+            left[done] = 0.0f;
+            if (right != nullptr)
+                right[done] = 0.0f;
+            ++done;
+            continue;
+        }
+
+        // One run per chunk, checked again once copied in case its slot was handed over meanwhile
+        int chunk = static_cast<int>(index / chunkSize);
+        int offset = static_cast<int>(index - static_cast<juce::int64>(chunk) * chunkSize);
+        int count = reversed ? juce::jmin(numSamples - done, offset + 1)
+                             : static_cast<int>(juce::jmin<juce::int64>(numSamples - done, juce::jmin<juce::int64>(chunkSize - offset, totalLength - index)));
+        int slot = chunkSlot[static_cast<size_t>(chunk)].load(std::memory_order_acquire);
+
+        if (slot >= 0)
+        {
+            const auto* source = samples.data() + (static_cast<size_t>(slot) * chunkSize + static_cast<size_t>(offset)) * 2;
+            int step = reversed ? -2 : 2;
+
+            for (int i = 0; i < count; ++i, source += step)
+            {
+                left[done + i] = source[0] * fromInt16;
+                if (right != nullptr)
+                    right[done + i] = source[1] * fromInt16;
+            }
+
+            std::atomic_thread_fence(std::memory_order_acquire);
+            if (chunkSlot[static_cast<size_t>(chunk)].load(std::memory_order_relaxed) == slot)
+            {
+                done += count;
+                continue;
+            }
+        }
+
+        juce::FloatVectorOperations::clear(left + done, count);
+        if (right != nullptr)
+            juce::FloatVectorOperations::clear(right + done, count);
+        done += count;
+    }
+}
+
+DecodeCache::WantedRange DecodeCache::getWantedRange() const
+{
+    WantedRange range;
+    if (numChunks == 0)
+        return range;
+
+    // A track that fits is kept whole
+    if (numChunks <= numSlots)
+    {
+        range.last = numChunks - 1;
+        range.current = static_cast<int>(juce::jlimit<juce::int64>(0, numChunks - 1, focusPosition.load() / chunkSize));
+        return range;
+    }
+
+    auto start = pinStart.load();
+    auto end = pinEnd.load();
+
+    if (start >= 0 && end > start)
+    {
+        range.pinFirst = static_cast<int>(juce::jmin<juce::int64>(numChunks - 1, start / chunkSize));
+        range.pinLast = juce::jmin(range.pinFirst + numSlots / 2 - 1,
+                                   static_cast<int>(juce::jmin<juce::int64>(numChunks - 1, (end - 1) / chunkSize)));
+    }
+
+    // The rest of the pool: two thirds behind the playhead, a third ahead, shifted at either end of the track
+    int around = numSlots - (range.pinLast - range.pinFirst + 1);
+    int behind = around * 2 / 3;
+
+    range.current = static_cast<int>(juce::jlimit<juce::int64>(0, numChunks - 1, focusPosition.load() / chunkSize));
+    range.first = range.current - behind;
+    range.last = range.current + (around - behind - 1);
+
+    if (range.first < 0)
+    {
+        range.last -= range.first;
+        range.first = 0;
+    }
+    else if (range.last >= numChunks)
+    {
+        range.first = juce::jmax(0, range.first - (range.last - numChunks + 1));
+        range.last = numChunks - 1;
+    }
+
+    return range;
+}
+
+int DecodeCache::findChunkToDecode(bool nearbyOnly) const
+{
+    if (numChunks == 0 || chunksReady.load() == numChunks)
+        return -1;
+
+    auto wanted = getWantedRange();
+
+    // The loop first, so a wrap never lands on silence
+    for (int chunk = wanted.pinFirst; chunk <= wanted.pinLast; ++chunk)
+        if (!isChunkReady(chunk))
+            return chunk;
+
+    // Behind the playhead next (that is what reverse and slip need), then ahead of it
+    int lowest = nearbyOnly ? juce::jmax(wanted.first, wanted.current - 1) : wanted.first;
+
+    for (int chunk = wanted.current; chunk >= lowest; --chunk)
+        if (!isChunkReady(chunk))
+            return chunk;
+
+    if (nearbyOnly)
+        return -1;
+
+    for (int chunk = wanted.current + 1; chunk <= wanted.last; ++chunk)
+        if (!isChunkReady(chunk))
+            return chunk;
+
+    return -1;
+}
@@ -0,0 +1,81 @@
+#pragma once
+#include <JuceHeader.h>
+#include <array>
+#include <atomic>
+#include <memory>
+#include <vector>
+
+// Decoded audio around a deck's playhead, held in RAM as interleaved 16-bit stereo.
+// The track is split into chunks and a fixed pool of slots holds the ones that
+// matter: the loop region is pinned first, then the stretch behind the playhead
+// (what reverse and slip need), then the stretch ahead. Chunks that drift out of
+// that range give their slot to new ones, so memory stays the same whatever the
+// length of the track, and a track short enough to fit is cached whole.
+// Chunks are marked ready one at a time, so the audio thread can read any decoded
+// region (reverse playback, slip snap-backs, loop wraps) without touching the reader.
+class DecodeCache
+{
+public:
+    static constexpr int chunkSize = 65536;
+    static constexpr int numSlots = 64;  // ~95 s at 44.1 kHz, 16 MB
+
+    DecodeCache();
+
+    // Message thread, while nothing is reading
+    bool allocate(juce::int64 lengthInSamples);
+    void release();
+
+    // Whoever fills the cache next: where the playhead is and which region to keep
+    // in RAM regardless (pinStart < 0 for none). Longer pins keep their first half-pool.
+    void setFocus(juce::int64 playPosition, juce::int64 pinStart, juce::int64 pinEnd);
+
+    // Loader thread: decodes the next missing chunk in the wanted range; false when there is none.
+    // With nearbyOnly just the pinned chunks and the ones at the playhead are decoded, the rest is left to store().
+    bool decodeNextChunk(juce::AudioFormatReader& reader, juce::AudioBuffer<float>& scratch, bool nearbyOnly = false);
+
+    // Decoded elsewhere (a shared read of the file): takes whole chunks, starting on a chunk
+    // boundary, and keeps the ones in the wanted range
+    void store(const juce::AudioBuffer<float>& block, juce::int64 startSample, int numSamples);
+
+    // Any thread
+    bool isAllocated() const { return numChunks > 0; }
+    bool isComplete() const { return numChunks > 0 && chunksReady.load() == numChunks; }
+    bool isRangeReady(juce::int64 start, juce::int64 numSamples) const;
+
+    // Audio thread: copies decoded audio, forwards or backwards from sourceStart.
+    // Reversed reads return sourceStart - 1, sourceStart - 2, ... Missing chunks read as
+    // silence, and so does a chunk whose slot is handed over while it is being copied.
+    void read(juce::AudioBuffer<float>& destination, int destStartSample, juce::int64 sourceStart,
+              int numSamples, bool reversed) const;
+
+private:
+    std::vector<juce::int16> samples;                 // numSlots chunks, allocated once
+    std::unique_ptr<std::atomic<int>[]> chunkSlot;    // per chunk: the slot holding it, or -1
+    std::array<int, numSlots> slotChunk {};           // per slot: the chunk in it, or -1; filler side only
+    int numChunks = 0;
+    std::atomic<int> chunksReady { 0 };
+    juce::int64 totalLength = 0;
+
+    std::atomic<juce::int64> focusPosition { 0 };
+    std::atomic<juce::int64> pinStart { -1 };
+    std::atomic<juce::int64> pinEnd { -1 };
+
+    struct WantedRange
+    {
+        int pinFirst = 0, pinLast = -1;
+        int current = 0, first = 0, last = -1;
+
+        bool contains(int chunk) const
+        {
+            return (chunk >= pinFirst && chunk <= pinLast) || (chunk >= first && chunk <= last);
+        }
+    };
+
+    WantedRange getWantedRange() const;
+    bool isChunkReady(int chunk) const;
+    int findChunkToDecode(bool nearbyOnly) const;
+    int takeSlot(const WantedRange& wanted);
+    void storeChunk(int chunk, const float* left, const float* right, int numSamples);
+
+    JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR(DecodeCache)
+};
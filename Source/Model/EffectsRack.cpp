@@ -0,0 +1,318 @@
+#include "EffectsRack.h"
+#include <cmath>
+
+namespace
+{
+    constexpr double maxEchoSeconds = 4.0;
+    constexpr double maxFlangerSeconds = 0.02;
+    constexpr double mixRampSeconds = 0.02;
+}
+
+EffectsRack::EffectsRack()
+{
+}
+
+void EffectsRack::prepareToPlay(int samplesPerBlockExpected, double sampleRate)
+{
+    currentSampleRate = sampleRate;
+    int blockSize = juce::jmax(1, samplesPerBlockExpected);
+
+    juce::dsp::ProcessSpec spec { sampleRate, static_cast<juce::uint32>(blockSize), 2 };
+
+    filter.prepare(spec);
+
+    echoLine.setMaximumDelayInSamples(static_cast<int>(std::ceil(sampleRate * maxEchoSeconds)) + 1);
+    echoLine.prepare(spec);
+
+    flangerLine.setMaximumDelayInSamples(static_cast<int>(std::ceil(sampleRate * maxFlangerSeconds)) + 1);
+    flangerLine.prepare(spec);
+
+    reverb.setSampleRate(sampleRate);
+    filterBlendStep = static_cast<float>(1.0 / juce::jmax(1.0, sampleRate * 0.01));
+
+    wetBuffer.setSize(2, blockSize);
+    mixRamp.assign(static_cast<size_t>(blockSize), 0.0f);
+
+    for (auto& slot : slots)
+    {
+        slot.mixSmoothed.reset(sampleRate, mixRampSeconds);
+        slot.mixSmoothed.setCurrentAndTargetValue(0.0f);
+        slot.active = false;
+    }
+}
+
+void EffectsRack::releaseResources()
+{
+    filter.reset();
+    echoLine.reset();
+    flangerLine.reset();
+    reverb.reset();
+}
+
+void EffectsRack::process(juce::AudioBuffer<float>& buffer, int startSample, int numSamples)
+{
+    if (numSamples <= 0 || buffer.getNumChannels() < 2)
+        return;
+
+    // Longer blocks than announced are taken in pieces, so the scratch never grows here
+    int chunkSize = wetBuffer.getNumSamples();
+
+    for (int offset = 0; offset < numSamples; offset += chunkSize)
+        processChunk(buffer, startSample + offset, juce::jmin(chunkSize, numSamples - offset));
+}
+
+void EffectsRack::processChunk(juce::AudioBuffer<float>& buffer, int startSample, int numSamples)
+{
+    for (int index = 0; index < numEffects; ++index)
+    {
+        auto type = static_cast<EffectType>(index);
+        auto& slot = slots[static_cast<size_t>(index)];
+
+        float target = slot.enabled.load() ? slot.mix.load() : 0.0f;
+        slot.mixSmoothed.setTargetValue(target);
+
+        if (!slot.active)
+        {
+            if (target <= 0.0f)
+                continue;
+
+            // Switching on: flush stale tails so nothing from the last use leaks in
+            resetEffect(type);
+            slot.active = true;
+        }
+        else if (target <= 0.0f && !slot.mixSmoothed.isSmoothing())
+        {
+            slot.active = false;
+            continue;
+        }
+
+        for (int channel = 0; channel < 2; ++channel)
+            wetBuffer.copyFrom(channel, 0, buffer, channel, startSample, numSamples);
+
+        processEffect(type, slot.amount.load(), slot.beats.load(), numSamples);
+
+        for (int i = 0; i < numSamples; ++i)
+            mixRamp[static_cast<size_t>(i)] = slot.mixSmoothed.getNextValue();
+
+        // out = dry + mix * (wet - dry)
+        for (int channel = 0; channel < 2; ++channel)
+        {
+            auto* dry = buffer.getWritePointer(channel, startSample);
+            auto* wet = wetBuffer.getWritePointer(channel);
+
+            juce::FloatVectorOperations::subtract(wet, dry, numSamples);
+            juce::FloatVectorOperations::addWithMultiply(dry, wet, mixRamp.data(), numSamples);
+        }
+    }
+}
+
+void EffectsRack::setEnabled(EffectType type, bool enabled)
+{
+    getSlot(type).enabled = enabled;
+}
+
+bool EffectsRack::isEnabled(EffectType type) const
+{
+    return getSlot(type).enabled.load();
+}
+
+void EffectsRack::setMix(EffectType type, float mix)
+{
+    getSlot(type).mix = juce::jlimit(0.0f, 1.0f, mix);
+}
+
+void EffectsRack::setAmount(EffectType type, float amount)
+{
+    getSlot(type).amount = juce::jlimit(0.0f, 1.0f, amount);
+}
+
+void EffectsRack::setBeats(EffectType type, float beats)
+{
+    getSlot(type).beats = juce::jlimit(1.0f / 16.0f, 32.0f, beats);
+}
+
+void EffectsRack::setTempo(double bpm)
+{
+    tempo = bpm > 0.0 ? bpm : 120.0;
+}
+
+double EffectsRack::getBeatSeconds() const
+{
+    return 60.0 / tempo.load();
+}
+
+void EffectsRack::resetEffect(EffectType type)
+{
+    switch (type)
+    {
+        case EffectType::Filter:
+            filter.reset();
+            filterIsHighPass = getSlot(EffectType::Filter).amount.load() > 0.5f;
+            filter.setType(filterIsHighPass ? juce::dsp::StateVariableTPTFilterType::highpass
+                                            : juce::dsp::StateVariableTPTFilterType::lowpass);
+            filterBlend = 1.0f;
+            break;
+        case EffectType::Echo:
+            echoLine.reset();
+            break;
+        case EffectType::Flanger:
+            flangerLine.reset();
+            flangerPhase = 0.0;
+            break;
+        case EffectType::Reverb:
+            reverb.reset();
+            break;
+        case EffectType::Bitcrusher:
+            crusherHeld[0] = crusherHeld[1] = 0.0f;
+            crusherCounter = 0;
+            break;
+    }
+}
+
+void EffectsRack::processEffect(EffectType type, float amount, float beats, int numSamples)
+{
+    switch (type)
+    {
+        case EffectType::Filter:     processFilter(amount, numSamples); break;
+        case EffectType::Echo:       processEcho(amount, beats, numSamples); break;
+        case EffectType::Flanger:    processFlanger(amount, beats, numSamples); break;
+        case EffectType::Reverb:     processReverb(amount, numSamples); break;
+        case EffectType::Bitcrusher: processBitcrusher(amount, numSamples); break;
+    }
+}
+
+void EffectsRack::setFilterCutoff(bool isHighPass, float depth)
+{
+    double nyquistLimit = currentSampleRate * 0.45;
+    double cutoff = isHighPass ? 20.0 * std::pow(1000.0, static_cast<double>(depth))
+                               : juce::jmin(nyquistLimit, 20000.0 * std::pow(0.001, static_cast<double>(depth)));
+
+    filter.setCutoffFrequency(static_cast<float>(juce::jlimit(20.0, nyquistLimit, cutoff)));
+}
+
+void EffectsRack::processFilter(float amount, int numSamples)
+{
+    // Below the centre sweeps a low-pass down, above it a high-pass up. Crossing the
+    // centre fades the filter out of the wet signal, changes type, then fades it back.
+    bool wantsHighPass = amount > 0.5f;
+    float depth = std::abs(amount - 0.5f) * 2.0f;
+
+    setFilterCutoff(filterIsHighPass, wantsHighPass == filterIsHighPass ? depth : 0.0f);
+    filter.setResonance(0.9f);
+
+    auto* left = wetBuffer.getWritePointer(0);
+    auto* right = wetBuffer.getWritePointer(1);
+
+    for (int i = 0; i < numSamples; ++i)
+    {
+        if (wantsHighPass != filterIsHighPass)
+        {
+            filterBlend = juce::jmax(0.0f, filterBlend - filterBlendStep);
+
+            if (filterBlend <= 0.0f)
+            {
+                filterIsHighPass = wantsHighPass;
+                filter.setType(filterIsHighPass ? juce::dsp::StateVariableTPTFilterType::highpass
+                                                : juce::dsp::StateVariableTPTFilterType::lowpass);
+                filter.reset();
+                setFilterCutoff(filterIsHighPass, depth);
+            }
+        }
+        else if (filterBlend < 1.0f)
+        {
+            filterBlend = juce::jmin(1.0f, filterBlend + filterBlendStep);
+        }
+
+        float inLeft = left[i];
+        float inRight = right[i];
+        left[i] = inLeft + filterBlend * (filter.processSample(0, inLeft) - inLeft);
+        right[i] = inRight + filterBlend * (filter.processSample(1, inRight) - inRight);
+    }
+}
+
+void EffectsRack::processEcho(float amount, float beats, int numSamples)
+{
+    double maxDelay = currentSampleRate * maxEchoSeconds;
+    float delaySamples = static_cast<float>(juce::jlimit(1.0, maxDelay, beats * getBeatSeconds() * currentSampleRate));
+    float feedback = amount * 0.85f;
+
+    for (int channel = 0; channel < 2; ++channel)
+    {
+        auto* data = wetBuffer.getWritePointer(channel);
+        for (int i = 0; i < numSamples; ++i)
+        {
+            float delayed = echoLine.popSample(channel, delaySamples);
+            float output = data[i] + feedback * delayed;
+            echoLine.pushSample(channel, output);
+            data[i] = output;
+        }
+    }
+}
+
+void EffectsRack::processFlanger(float amount, float beats, int numSamples)
+{
+    // One LFO sweep per `beats`, delay swinging between 1 and 7 ms
+    double periodSamples = juce::jmax(1.0, beats * getBeatSeconds() * currentSampleRate);
+    double phaseIncrement = 1.0 / periodSamples;
+    float minDelay = static_cast<float>(currentSampleRate * 0.001);
+    float sweep = static_cast<float>(currentSampleRate * 0.006);
+    float feedback = amount * 0.7f;
+    double startPhase = flangerPhase;
+
+    for (int channel = 0; channel < 2; ++channel)
+    {
+        auto* data = wetBuffer.getWritePointer(channel);
+        double phase = startPhase;
+
+        for (int i = 0; i < numSamples; ++i)
+        {
+            float lfo = 0.5f + 0.5f * static_cast<float>(std::sin(phase * juce::MathConstants<double>::twoPi));
+            float delayed = flangerLine.popSample(channel, minDelay + sweep * lfo);
+            flangerLine.pushSample(channel, data[i] + feedback * delayed);
+            data[i] = 0.5f * (data[i] + delayed);
+
+            phase += phaseIncrement;
+            if (phase >= 1.0)
+                phase -= 1.0;
+        }
+
+        flangerPhase = phase;
+    }
+}
+
+void EffectsRack::processReverb(float amount, int numSamples)
+{
+    juce::Reverb::Parameters parameters;
+    parameters.roomSize = 0.3f + 0.7f * amount;
+    parameters.damping = 0.5f;
+    parameters.wetLevel = 1.0f;
+    parameters.dryLevel = 0.0f;
+    parameters.width = 1.0f;
+    reverb.setParameters(parameters);
+
+    reverb.processStereo(wetBuffer.getWritePointer(0), wetBuffer.getWritePointer(1), numSamples);
+}
+
+void EffectsRack::processBitcrusher(float amount, int numSamples)
+{
+    // Amount trades bit depth (16 down to 3 bits) and sample rate (1x down to 1/16)
+    float levels = std::pow(2.0f, 16.0f - 13.0f * amount);
+    int holdSamples = 1 + static_cast<int>(15.0f * amount);
+    auto* left = wetBuffer.getWritePointer(0);
+    auto* right = wetBuffer.getWritePointer(1);
+
+    for (int i = 0; i < numSamples; ++i)
+    {
+        if (crusherCounter == 0)
+        {
+            crusherHeld[0] = std::round(left[i] * levels) / levels;
+            crusherHeld[1] = std::round(right[i] * levels) / levels;
+        }
+
+        if (++crusherCounter >= holdSamples)
+            crusherCounter = 0;
+
+        left[i] = crusherHeld[0];
+        right[i] = crusherHeld[1];
+    }
+}
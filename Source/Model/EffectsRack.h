@@ -0,0 +1,89 @@
+#pragma once
+#include <JuceHeader.h>
+#include <array>
+#include <atomic>
+#include <vector>
+
+// Fixed rack of deck effects. Every effect owns its buffers and delay lines,
+// all sized in prepareToPlay, so switching slots on and off mid-set never
+// allocates. A slot that is off and has finished fading out is skipped entirely.
+class EffectsRack
+{
+public:
+    enum class EffectType
+    {
+        Filter,
+        Echo,
+        Flanger,
+        Reverb,
+        Bitcrusher
+    };
+
+    static constexpr int numEffects = 5;
+
+    EffectsRack();
+
+    void prepareToPlay(int samplesPerBlockExpected, double sampleRate);
+    void releaseResources();
+
+    // Audio thread: processes the stereo region in place, in pieces no longer
+    // than the block size given to prepareToPlay
+    void process(juce::AudioBuffer<float>& buffer, int startSample, int numSamples);
+
+    // Control (any thread)
+    void setEnabled(EffectType type, bool enabled);
+    bool isEnabled(EffectType type) const;
+    void setMix(EffectType type, float mix);         // 0.0 dry to 1.0 wet
+    void setAmount(EffectType type, float amount);   // 0.0 to 1.0, meaning depends on the effect
+    void setBeats(EffectType type, float beats);     // echo time / flanger period in beats
+    void setTempo(double bpm);                       // tempo the beat-synced effects follow
+
+private:
+    struct Slot
+    {
+        std::atomic<bool> enabled { false };
+        std::atomic<float> mix { 0.5f };
+        std::atomic<float> amount { 0.5f };
+        std::atomic<float> beats { 0.75f };
+
+        // Audio thread state
+        juce::SmoothedValue<float> mixSmoothed;
+        bool active = false;
+    };
+
+    std::array<Slot, numEffects> slots;
+    std::atomic<double> tempo { 120.0 };
+    double currentSampleRate = 44100.0;
+
+    // Shared scratch: wet signal and per-sample mix ramp
+    juce::AudioBuffer<float> wetBuffer;
+    std::vector<float> mixRamp;
+
+    // Effect state
+    juce::dsp::StateVariableTPTFilter<float> filter;
+    juce::dsp::DelayLine<float, juce::dsp::DelayLineInterpolationTypes::Linear> echoLine;
+    juce::dsp::DelayLine<float, juce::dsp::DelayLineInterpolationTypes::Linear> flangerLine;
+    juce::Reverb reverb;
+    double flangerPhase = 0.0;
+    bool filterIsHighPass = false;
+    float filterBlend = 1.0f;       // how much of the filter reaches the wet signal; 0 while changing type
+    float filterBlendStep = 0.001f;
+    float crusherHeld[2] = { 0.0f, 0.0f };
+    int crusherCounter = 0;
+
+    Slot& getSlot(EffectType type) { return slots[static_cast<size_t>(type)]; }
+    const Slot& getSlot(EffectType type) const { return slots[static_cast<size_t>(type)]; }
+    double getBeatSeconds() const;
+
+    void processChunk(juce::AudioBuffer<float>& buffer, int startSample, int numSamples);
+    void resetEffect(EffectType type);
+    void setFilterCutoff(bool isHighPass, float depth);
+    void processEffect(EffectType type, float amount, float beats, int numSamples);
+    void processFilter(float amount, int numSamples);
+    void processEcho(float amount, float beats, int numSamples);
+    void processFlanger(float amount, float beats, int numSamples);
+    void processReverb(float amount, int numSamples);
+    void processBitcrusher(float amount, int numSamples);
+
+    JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR(EffectsRack)
+};
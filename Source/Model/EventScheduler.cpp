@@ -0,0 +1,130 @@
+#include "EventScheduler.h"
+#include <cmath>
+
+EventScheduler::EventScheduler()
+{
+}
+
+void EventScheduler::prepareToPlay(int /*samplesPerBlockExpected*/, double sampleRate)
+{
+    currentSampleRate = sampleRate;
+    blockStartSample = 0;
+    blockLength = 0;
+    numPending = 0;
+    previousBlockTimeMs = juce::Time::getMillisecondCounterHiRes();
+}
+
+bool EventScheduler::post(Action action, int deckIndex, int parameter, Grid grid)
+{
+    Event event;
+    event.action = action;
+    event.deckIndex = deckIndex;
+    event.parameter = parameter;
+    event.grid = grid;
+    event.requestTimeMs = juce::Time::getMillisecondCounterHiRes();
+
+    int start1, size1, start2, size2;
+    fifo.prepareToWrite(1, start1, size1, start2, size2);
+
+    if (size1 + size2 < 1)
+        return false;
+
+    incoming[static_cast<size_t>(size1 > 0 ? start1 : start2)] = event;
+    fifo.finishedWrite(1);
+    return true;
+}
+
+void EventScheduler::beginBlock(int numSamples, const BeatClock& clock)
+{
+    double blockTimeMs = juce::Time::getMillisecondCounterHiRes();
+    blockLength = numSamples;
+
+    int start1, size1, start2, size2;
+    fifo.prepareToRead(fifo.getNumReady(), start1, size1, start2, size2);
+
+    for (int i = 0; i < size1; ++i)
+    {
+        auto event = incoming[static_cast<size_t>(start1 + i)];
+        event.dueSample = resolveDueSample(event, blockTimeMs, clock);
+        insertPending(event);
+    }
+
+    for (int i = 0; i < size2; ++i)
+    {
+        auto event = incoming[static_cast<size_t>(start2 + i)];
+        event.dueSample = resolveDueSample(event, blockTimeMs, clock);
+        insertPending(event);
+    }
+
+    fifo.finishedRead(size1 + size2);
+
+    previousBlockTimeMs = blockTimeMs;
+    lastBlockTimeMs = blockTimeMs;
+}
+
+bool EventScheduler::getNextEvent(int& offsetInBlock, Event& event)
+{
+    if (numPending == 0 || pending[0].dueSample >= blockStartSample + blockLength)
+        return false;
+
+    event = pending[0];
+    offsetInBlock = static_cast<int>(juce::jlimit<juce::int64>(0, blockLength, event.dueSample - blockStartSample));
+
+    for (int i = 1; i < numPending; ++i)
+        pending[static_cast<size_t>(i - 1)] = pending[static_cast<size_t>(i)];
+    --numPending;
+
+    return true;
+}
+
+void EventScheduler::endBlock()
+{
+    blockStartSample += blockLength;
+}
+
+juce::int64 EventScheduler::resolveDueSample(const Event& event, double blockTimeMs, const BeatClock& clock) const
+{
+    // Where in the previous callback period the event arrived, replayed at the same offset in this block
+    double elapsedMs = juce::jlimit(0.0, juce::jmax(0.0, blockTimeMs - previousBlockTimeMs), event.requestTimeMs - previousBlockTimeMs);
+    double offset = juce::jlimit(0.0, static_cast<double>(juce::jmax(0, blockLength - 1)), elapsedMs * currentSampleRate / 1000.0);
+
+    if (event.grid == Grid::None || !clock.running || clock.samplesPerBeat <= 0.0)
+        return blockStartSample + static_cast<juce::int64>(offset);
+
+    // First beat at or after the event, then on to the bar line if asked
+    double beatTime = clock.samplesToNextBeat;
+    juce::int64 beatIndex = clock.nextBeatIndex;
+
+    if (beatTime < offset)
+    {
+        auto beatsToSkip = static_cast<juce::int64>(std::ceil((offset - beatTime) / clock.samplesPerBeat));
+        beatTime += static_cast<double>(beatsToSkip) * clock.samplesPerBeat;
+        beatIndex += beatsToSkip;
+    }
+
+    if (event.grid == Grid::Bar)
+    {
+        auto beatsToBar = (beatsPerBar - (beatIndex % beatsPerBar)) % beatsPerBar;
+        beatTime += static_cast<double>(beatsToBar) * clock.samplesPerBeat;
+    }
+
+    return blockStartSample + static_cast<juce::int64>(std::round(beatTime));
+}
+
+void EventScheduler::insertPending(const Event& event)
+{
+    // The queue is bounded by the FIFO size; if it is somehow full the latest event is dropped
+    if (numPending >= capacity)
+        return;
+
+    // Insert after any event due at the same sample, so posting order is kept
+    int index = numPending;
+    while (index > 0 && pending[static_cast<size_t>(index - 1)].dueSample > event.dueSample)
+    {
+        pending[static_cast<size_t>(index)] = pending[static_cast<size_t>(index - 1)];
+        --index;
+    }
+
+    pending[static_cast<size_t>(index)] = event;
+    ++numPending;
+}
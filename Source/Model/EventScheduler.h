@@ -0,0 +1,95 @@
+#pragma once
+#include <JuceHeader.h>
+#include <array>
+#include <atomic>
+
+// Hands transport actions from the UI to the audio thread with sample accuracy.
+// Each event is stamped with the wall-clock time it was posted. The audio
+// thread places it at the same offset one block later, so the latency is fixed
+// and does not jitter with callback timing. It can optionally be pushed on to
+// the next beat or bar of the master deck. The controller renders each block in
+// segments split at the returned offsets.
+class EventScheduler
+{
+public:
+    enum class Action
+    {
+        Play,
+        Pause,
+        Stop,
+        Cue,
+        HotCue,
+        ToggleLoop,
+        Sync,
+        Reverse,    // parameter: 1 on, 0 off
+        LoopRoll,   // parameter: roll length in 1/16 beats, 0 releases
+        Censor,     // parameter: 1 held, 0 released
+        SamplerPad, // parameter: pad to trigger
+        SamplerRelease
+    };
+
+    enum class Grid
+    {
+        None,
+        Beat,
+        Bar
+    };
+
+    struct Event
+    {
+        Action action = Action::Play;
+        int deckIndex = 0;
+        int parameter = 0;
+        Grid grid = Grid::None;
+        double requestTimeMs = 0.0;
+        juce::int64 dueSample = 0;
+    };
+
+    // Where the master deck's beats fall, measured from the start of the block
+    struct BeatClock
+    {
+        bool running = false;
+        double samplesToNextBeat = 0.0;
+        double samplesPerBeat = 0.0;
+        juce::int64 nextBeatIndex = 0; // beats since the grid origin; bars start on multiples of 4
+    };
+
+    static constexpr int capacity = 128;
+    static constexpr int beatsPerBar = 4;
+
+    EventScheduler();
+
+    void prepareToPlay(int samplesPerBlockExpected, double sampleRate);
+
+    // Message thread (single producer). Returns false if the queue is full.
+    bool post(Action action, int deckIndex, int parameter = 0, Grid grid = Grid::None);
+
+    // Audio thread, once per callback, in this order:
+    // beginBlock, then getNextEvent until it returns false, then endBlock
+    void beginBlock(int numSamples, const BeatClock& clock);
+    bool getNextEvent(int& offsetInBlock, Event& event);
+    void endBlock();
+
+    // Wall-clock time of the last audio callback, for callers deciding whether the device is running
+    double getLastBlockTimeMs() const { return lastBlockTimeMs.load(); }
+
+private:
+    // Message thread -> audio thread
+    juce::AbstractFifo fifo { capacity };
+    std::array<Event, capacity> incoming;
+
+    // Audio thread: resolved events sorted by due sample
+    std::array<Event, capacity> pending;
+    int numPending = 0;
+
+    double currentSampleRate = 44100.0;
+    juce::int64 blockStartSample = 0;
+    int blockLength = 0;
+    double previousBlockTimeMs = 0.0;
+    std::atomic<double> lastBlockTimeMs { 0.0 };
+
+    juce::int64 resolveDueSample(const Event& event, double blockTimeMs, const BeatClock& clock) const;
+    void insertPending(const Event& event);
+
+    JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR(EventScheduler)
+};
@@ -0,0 +1,202 @@
+#include "FacetIndex.h"
+#include <algorithm>
+
+bool FacetIndex::Selection::isEmpty() const
+{
+    return std::all_of(picked.begin(), picked.end(), [](const std::vector<Value>& values) { return values.empty(); });
+}
+
+void FacetIndex::add(DocId id, const Track& track)
+{
+    remove(id);
+
+    for (int f = 0; f < numFacets; ++f)
+    {
+        auto facet = static_cast<Facet>(f);
+        auto value = getValue(facet, track);
+        auto& byId = values[static_cast<size_t>(f)];
+
+        if (byId.size() <= id)
+            byId.resize(id + 1, noValue);
+
+        byId[id] = value;
+        postings[static_cast<size_t>(f)][value].add(id);
+    }
+
+    all.add(id);
+}
+
+void FacetIndex::remove(DocId id)
+{
+    if (!all.contains(id))
+        return;
+
+    for (size_t f = 0; f < static_cast<size_t>(numFacets); ++f)
+    {
+        auto& value = values[f][id];
+        auto found = postings[f].find(value);
+
+        if (found != postings[f].end())
+        {
+            found->second.remove(id);
+
+            if (found->second.isEmpty())
+                postings[f].erase(found);
+        }
+
+        value = noValue;
+    }
+
+    all.remove(id);
+}
+
+void FacetIndex::clear()
+{
+    for (auto& facetPostings : postings)
+        facetPostings.clear();
+
+    for (auto& byId : values)
+        byId.clear();
+
+    all.clear();
+}
+
+IdBitmap FacetIndex::getMatches(const Selection& selection) const
+{
+    std::vector<IdBitmap> picks;
+
+    for (int f = 0; f < numFacets; ++f)
+    {
+        auto facet = static_cast<Facet>(f);
+
+        if (!selection[facet].empty())
+            picks.push_back(getMatches(facet, selection[facet]));
+    }
+
+    if (picks.empty())
+        return all;
+
+    // Smallest first, so every intersection after it has the least to do
+    std::sort(picks.begin(), picks.end(), [](const IdBitmap& a, const IdBitmap& b) { return a.size() < b.size(); });
+
+    auto matches = std::move(picks.front());
+
+    for (size_t i = 1; i < picks.size() && !matches.isEmpty(); ++i)
+        matches.intersectWith(picks[i]);
+
+    return matches;
+}
+
+const IdBitmap& FacetIndex::getMatches(Facet facet, Value value) const
+{
+    static const IdBitmap none;
+
+    const auto& facetPostings = postings[static_cast<size_t>(facet)];
+    auto found = facetPostings.find(value);
+    return found != facetPostings.end() ? found->second : none;
+}
+
+std::vector<FacetIndex::Value> FacetIndex::getValues(Facet facet) const
+{
+    const auto& facetPostings = postings[static_cast<size_t>(facet)];
+    std::vector<Value> facetValues;
+    facetValues.reserve(facetPostings.size());
+
+    for (const auto& posting : facetPostings)
+        facetValues.push_back(posting.first);
+
+    return facetValues;
+}
+
+IdBitmap FacetIndex::getMatches(Facet facet, const std::vector<Value>& picked) const
+{
+    IdBitmap matches;
+
+    for (auto value : picked)
+        matches.unionWith(getMatches(facet, value));
+
+    return matches;
+}
+
+std::vector<FacetIndex::Count> FacetIndex::getCounts(Facet facet, const Selection& selection) const
+{
+    const auto& facetPostings = postings[static_cast<size_t>(facet)];
+    std::vector<Count> counts;
+    counts.reserve(facetPostings.size());
+
+    auto others = selection;
+    others[facet].clear();
+
+    if (others.isEmpty())
+    {
+        // Nothing else picked: every value's set already knows its size
+        for (const auto& posting : facetPostings)
+            counts.push_back({ posting.first, posting.second.size() });
+    }
+    else
+    {
+        auto matches = getMatches(others);
+
+        // A facet with few values intersects each with the matches; one with
+        // many (artists, albums) tallies the matching tracks' values instead
+        if (facetPostings.size() * 64 < static_cast<size_t>(matches.size()))
+        {
+            for (const auto& posting : facetPostings)
+            {
+                if (auto numTracks = IdBitmap::countIntersection(posting.second, matches))
+                    counts.push_back({ posting.first, numTracks });
+            }
+        }
+        else
+        {
+            const auto& byId = values[static_cast<size_t>(facet)];
+            std::unordered_map<Value, int> tally;
+
+            matches.forEach([&byId, &tally](DocId id) { ++tally[byId[id]]; });
+
+            for (const auto& entry : tally)
+                counts.push_back({ entry.first, entry.second });
+        }
+    }
+
+    // BPM reads best in tempo order; everything else puts the biggest first
+    if (facet == Facet::BPM)
+        std::sort(counts.begin(), counts.end(), [](const Count& a, const Count& b) { return a.value < b.value; });
+    else
+        std::sort(counts.begin(), counts.end(), [](const Count& a, const Count& b) {
+            return a.numTracks != b.numTracks ? a.numTracks > b.numTracks : a.value < b.value;
+        });
+
+    return counts;
+}
+
+FacetIndex::Value FacetIndex::getValue(Facet facet, const Track& track)
+{
+    auto& interner = StringInterner::getShared();
+
+    switch (facet)
+    {
+        case Facet::Genre:  return interner.getGroup(track.getGenreId());
+        case Facet::Artist: return interner.getGroup(track.getArtistId());
+        case Facet::Album:  return interner.getGroup(track.getAlbumId());
+        case Facet::BPM:    return getBPMBucket(track.getBPM());
+        case Facet::Key:    return interner.getGroup(track.getKeyId());
+    }
+
+    return 0;
+}
+
+juce::String FacetIndex::getLabel(Facet facet, Value value)
+{
+    if (facet == Facet::BPM)
+    {
+        if (value == 0)
+            return "No BPM";
+
+        auto lowest = static_cast<int>(value - 1) * bpmBucketSize;
+        return juce::String(lowest) + "-" + juce::String(lowest + bpmBucketSize - 1) + " BPM";
+    }
+
+    const auto& text = StringInterner::getShared().get(value);
+    return text.isNotEmpty() ? text : juce::String("Unknown");
+}
@@ -0,0 +1,79 @@
+#pragma once
+#include <JuceHeader.h>
+#include "Track.h"
+#include "IdBitmap.h"
+#include <array>
+#include <unordered_map>
+#include <vector>
+
+// Crate-browser facets over a track list: genre, artist, album, BPM in
+// steps of bpmBucketSize, and key. Every value of every facet keeps the
+// set of tracks that have it, updated as tracks are added and removed, so
+// its count is always at hand and a combination of picks is a few set
+// intersections rather than a pass over the list. Text values ignore case.
+// Tracks are known by the same ids as in the SearchIndex.
+class FacetIndex
+{
+public:
+    using DocId = IdBitmap::Id;
+    using Value = juce::uint32;
+
+    enum class Facet
+    {
+        Genre,
+        Artist,
+        Album,
+        BPM,
+        Key
+    };
+
+    static constexpr int numFacets = 5;
+    static constexpr int bpmBucketSize = 5;
+
+    // Tracks match a facet when they have any of the values picked in it, and
+    // the selection when they match every facet with something picked
+    struct Selection
+    {
+        std::array<std::vector<Value>, numFacets> picked;
+
+        std::vector<Value>& operator[](Facet facet) { return picked[static_cast<size_t>(facet)]; }
+        const std::vector<Value>& operator[](Facet facet) const { return picked[static_cast<size_t>(facet)]; }
+        bool isEmpty() const;
+    };
+
+    struct Count
+    {
+        Value value = 0;
+        int numTracks = 0;
+    };
+
+    FacetIndex() = default;
+
+    void add(DocId id, const Track& track); // replaces whatever the id held before
+    void remove(DocId id);
+    void clear();
+
+    IdBitmap getMatches(const Selection& selection) const;
+    const IdBitmap& getMatches(Facet facet, Value value) const;
+    std::vector<Value> getValues(Facet facet) const; // those some track has, in no particular order
+
+    // Tracks each value of the facet would match, given what is picked in the
+    // other facets. Picks in this facet are left out, so the alternatives to
+    // them still show how many tracks they would bring in.
+    std::vector<Count> getCounts(Facet facet, const Selection& selection) const;
+
+    static Value getValue(Facet facet, const Track& track);
+    static Value getBPMBucket(int bpm) { return bpm > 0 ? static_cast<Value>(bpm / bpmBucketSize + 1) : 0; }
+    static juce::String getLabel(Facet facet, Value value);
+
+private:
+    static constexpr Value noValue = 0xffffffff; // ids not in use
+
+    std::array<std::unordered_map<Value, IdBitmap>, numFacets> postings;
+    std::array<std::vector<Value>, numFacets> values; // by id
+    IdBitmap all;
+
+    IdBitmap getMatches(Facet facet, const std::vector<Value>& picked) const;
+
+    JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR(FacetIndex)
+};
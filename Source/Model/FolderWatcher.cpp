@@ -0,0 +1,269 @@
+#include "FolderWatcher.h"
+
+#if JUCE_LINUX
+ #include <poll.h>
+ #include <sys/inotify.h>
+ #include <unistd.h>
+
+namespace
+{
+    // A file counts once it has been written and closed, never when it is first created
+    constexpr juce::uint32 watchMask = IN_CLOSE_WRITE | IN_MOVED_TO | IN_MOVED_FROM | IN_CREATE | IN_DELETE
+                                     | IN_ONLYDIR | IN_DONT_FOLLOW;
+}
+#endif
+
+bool FolderWatcher::Changes::wasRemoved(const juce::File& file) const
+{
+    // The file itself or any folder above it
+    for (auto path = file; !path.isRoot(); path = path.getParentDirectory())
+    {
+        if (removedPaths.count(path.getFullPathName()) > 0)
+            return true;
+    }
+
+    return false;
+}
+
+FolderWatcher::FolderWatcher()
+    : juce::Thread("Folder Watcher")
+{
+   #if JUCE_LINUX
+    inotifyFd = inotify_init1(IN_NONBLOCK | IN_CLOEXEC);
+   #endif
+}
+
+FolderWatcher::~FolderWatcher()
+{
+    stopTimer();
+    stopThread(2000);
+
+   #if JUCE_LINUX
+    if (inotifyFd >= 0)
+        close(inotifyFd);
+   #endif
+}
+
+void FolderWatcher::addFolder(const juce::File& directory)
+{
+    if (!isAvailable() || !directory.isDirectory() || isWatching(directory))
+        return;
+
+    {
+        const juce::ScopedLock sl(lock);
+        folders.add(directory);
+        foldersToWatch.add(directory);
+    }
+
+    if (!isThreadRunning())
+        startThread();
+
+    if (!isTimerRunning())
+        startTimer(quietPeriodMs / 3);
+}
+
+bool FolderWatcher::isWatching(const juce::File& directory) const
+{
+    const juce::ScopedLock sl(lock);
+
+    for (const auto& folder : folders)
+    {
+        if (directory == folder || directory.isAChildOf(folder))
+            return true;
+    }
+
+    return false;
+}
+
+juce::Array<juce::File> FolderWatcher::getFolders() const
+{
+    const juce::ScopedLock sl(lock);
+    return folders;
+}
+
+void FolderWatcher::run()
+{
+   #if JUCE_LINUX
+    alignas(inotify_event) char buffer[16384];
+
+    while (!threadShouldExit())
+    {
+        juce::Array<juce::File> newFolders;
+
+        {
+            const juce::ScopedLock sl(lock);
+            newFolders.swapWith(foldersToWatch);
+        }
+
+        for (const auto& folder : newFolders)
+            watchTree(folder);
+
+        // Woken now and then to pick up new folders and notice we're asked to stop
+        pollfd descriptor { inotifyFd, POLLIN, 0 };
+        if (poll(&descriptor, 1, pollIntervalMs) <= 0)
+            continue;
+
+        auto length = read(inotifyFd, buffer, sizeof(buffer));
+
+        for (ssize_t offset = 0; offset < length;)
+        {
+            const auto* event = reinterpret_cast<const inotify_event*>(buffer + offset);
+            handleEvent(event->wd, event->mask, event->len > 0 ? juce::String::fromUTF8(event->name) : juce::String());
+            offset += static_cast<ssize_t>(sizeof(inotify_event) + event->len);
+        }
+    }
+   #endif
+}
+
+void FolderWatcher::handleEvent(int watch, juce::uint32 mask, const juce::String& name)
+{
+   #if JUCE_LINUX
+    if ((mask & IN_Q_OVERFLOW) != 0)
+    {
+        // Events were dropped; look over every folder again. Listed files are
+        // only read if their size or date no longer matches the library
+        // database, and listed files that are gone get pruned.
+        for (const auto& folder : getFolders())
+            addPending(folder, Change::DirectoryAdded);
+
+        return;
+    }
+
+    auto found = watches.find(watch);
+    if (found == watches.end())
+        return;
+
+    if ((mask & IN_IGNORED) != 0)
+    {
+        watchedPaths.erase(found->second.getFullPathName());
+        watches.erase(found);
+        return;
+    }
+
+    if (name.isEmpty())
+        return;
+
+    auto file = found->second.getChildFile(name);
+    bool isDirectory = (mask & IN_ISDIR) != 0;
+    bool wanted = isDirectory || fileFilter == nullptr || fileFilter(file);
+
+    if ((mask & (IN_DELETE | IN_MOVED_FROM)) != 0)
+    {
+        // A watch follows its directory when it moves, so folders moved out are dropped
+        if (isDirectory)
+            unwatchTree(file);
+
+        if (wanted)
+            addPending(file, Change::Removed);
+    }
+    else if (isDirectory && (mask & (IN_CREATE | IN_MOVED_TO)) != 0)
+    {
+        // Files can land in it before the watch is up; the scan of the folder catches those
+        watchTree(file);
+        addPending(file, Change::DirectoryAdded);
+    }
+    else if (!isDirectory && wanted && (mask & (IN_CLOSE_WRITE | IN_MOVED_TO)) != 0)
+    {
+        addPending(file, Change::Modified);
+    }
+   #else
+    juce::ignoreUnused(watch, mask, name);
+   #endif
+}
+
+void FolderWatcher::watchTree(const juce::File& directory)
+{
+   #if JUCE_LINUX
+    auto path = directory.getFullPathName();
+    if (watchedPaths.count(path) > 0 || threadShouldExit())
+        return;
+
+    // Fails mostly at the per-user watch limit; that folder is then simply not followed
+    int watch = inotify_add_watch(inotifyFd, path.toRawUTF8(), watchMask);
+    if (watch < 0)
+        return;
+
+    watches[watch] = directory;
+    watchedPaths[path] = watch;
+
+    // Linked folders are left alone, as one could lead back up the tree
+    for (const auto& child : directory.findChildFiles(juce::File::findDirectories | juce::File::ignoreHiddenFiles, false))
+    {
+        if (!child.isSymbolicLink())
+            watchTree(child);
+    }
+   #else
+    juce::ignoreUnused(directory);
+   #endif
+}
+
+void FolderWatcher::unwatchTree(const juce::File& directory)
+{
+   #if JUCE_LINUX
+    auto path = directory.getFullPathName();
+    auto childPrefix = path + juce::File::getSeparatorString();
+
+    // Everything starting with the path sorts together; siblings like "path-2" are skipped
+    for (auto it = watchedPaths.lower_bound(path); it != watchedPaths.end() && it->first.startsWith(path);)
+    {
+        if (it->first == path || it->first.startsWith(childPrefix))
+        {
+            inotify_rm_watch(inotifyFd, it->second);
+            watches.erase(it->second);
+            it = watchedPaths.erase(it);
+        }
+        else
+        {
+            ++it;
+        }
+    }
+   #else
+    juce::ignoreUnused(directory);
+   #endif
+}
+
+void FolderWatcher::addPending(const juce::File& file, Change change)
+{
+    const juce::ScopedLock sl(lock);
+
+    auto now = juce::Time::getMillisecondCounter();
+    if (pending.empty())
+        firstEventTime = now;
+
+    lastEventTime = now;
+    pending[file.getFullPathName()] = change;
+}
+
+void FolderWatcher::timerCallback()
+{
+    std::map<juce::String, Change> changes;
+
+    {
+        const juce::ScopedLock sl(lock);
+
+        if (pending.empty())
+            return;
+
+        auto now = juce::Time::getMillisecondCounter();
+        if (now - lastEventTime < static_cast<juce::uint32>(quietPeriodMs)
+            && now - firstEventTime < static_cast<juce::uint32>(maxDelayMs))
+            return;
+
+        changes.swap(pending);
+    }
+
+    Changes batch;
+
+    for (const auto& [path, change] : changes)
+    {
+        switch (change)
+        {
+            case Change::Modified:       batch.changedFiles.add(juce::File(path)); break;
+            case Change::DirectoryAdded: batch.addedDirectories.add(juce::File(path)); break;
+            case Change::Removed:        batch.removedPaths.insert(path); break;
+        }
+    }
+
+    if (onChanges)
+        onChanges(batch);
+}
@@ -0,0 +1,74 @@
+#pragma once
+#include <JuceHeader.h>
+#include <functional>
+#include <map>
+#include <set>
+
+// Follows music folders so the library keeps up with files being added,
+// rewritten, moved or deleted, without walking the tree again. Uses inotify
+// on Linux, with one watch per directory since inotify doesn't recurse; new
+// subfolders are picked up as they appear. Events are read on a background
+// thread and merged per path, so a burst of writes to one file counts once,
+// then handed over on the message thread after the folders have been quiet
+// for a moment. On other platforms folders are accepted but never reported.
+class FolderWatcher : private juce::Thread, private juce::Timer
+{
+public:
+    static constexpr int quietPeriodMs = 750;
+    static constexpr int maxDelayMs = 5000;  // a long copy still shows up as it goes
+    static constexpr int pollIntervalMs = 200;
+
+    struct Changes
+    {
+        juce::Array<juce::File> changedFiles;      // new, or rewritten in place
+        juce::Array<juce::File> addedDirectories;  // created or moved in; everything in them is new
+        std::set<juce::String> removedPaths;       // files, or directories with all they held
+
+        bool wasRemoved(const juce::File& file) const;
+    };
+
+    FolderWatcher();
+    ~FolderWatcher() override;
+
+    // Message thread. Subfolders are watched too.
+    void addFolder(const juce::File& directory);
+    bool isWatching(const juce::File& directory) const;
+    juce::Array<juce::File> getFolders() const;
+    bool isAvailable() const { return inotifyFd >= 0; }
+
+    // Called on the watcher thread to pick the files worth reporting
+    std::function<bool(const juce::File&)> fileFilter;
+
+    // Message thread
+    std::function<void(const Changes&)> onChanges;
+
+private:
+    enum class Change
+    {
+        Modified,
+        DirectoryAdded,
+        Removed
+    };
+
+    int inotifyFd = -1;
+
+    mutable juce::CriticalSection lock;
+    juce::Array<juce::File> folders;
+    juce::Array<juce::File> foldersToWatch;  // added, not yet picked up by the thread
+    std::map<juce::String, Change> pending;  // the last event for a path wins
+    juce::uint32 firstEventTime = 0;
+    juce::uint32 lastEventTime = 0;
+
+    // Watcher thread only
+    std::map<int, juce::File> watches;  // watch descriptor -> directory
+    std::map<juce::String, int> watchedPaths;
+
+    void run() override;
+    void timerCallback() override;
+    void watchTree(const juce::File& directory);
+    void unwatchTree(const juce::File& directory);
+    void handleEvent(int watch, juce::uint32 mask, const juce::String& name);
+    void addPending(const juce::File& file, Change change);
+
+    JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR(FolderWatcher)
+};
@@ -0,0 +1,203 @@
+#include "HeadphoneOutput.h"
+#include <cmath>
+
+HeadphoneOutput::HeadphoneOutput()
+{
+}
+
+HeadphoneOutput::~HeadphoneOutput()
+{
+    close();
+}
+
+bool HeadphoneOutput::open(const juce::String& outputDeviceName)
+{
+    close();
+
+    juce::AudioDeviceManager::AudioDeviceSetup setup;
+    setup.outputDeviceName = outputDeviceName;
+
+    auto error = deviceManager.initialise(0, 2, nullptr, false, outputDeviceName, &setup);
+    if (error.isNotEmpty() || deviceManager.getCurrentAudioDevice() == nullptr)
+    {
+        deviceManager.closeAudioDevice();
+        return false;
+    }
+
+    currentDeviceName = outputDeviceName;
+    deviceOpen = true;
+    deviceManager.addAudioCallback(this);
+    return true;
+}
+
+void HeadphoneOutput::close()
+{
+    if (!deviceOpen)
+        return;
+
+    deviceManager.removeAudioCallback(this);
+    deviceManager.closeAudioDevice();
+    deviceOpen = false;
+    running = false;
+    currentDeviceName = {};
+}
+
+juce::StringArray HeadphoneOutput::getAvailableDeviceNames()
+{
+    juce::StringArray names;
+
+    for (auto* type : deviceManager.getAvailableDeviceTypes())
+    {
+        type->scanForDevices();
+        names.addArray(type->getDeviceNames(false));
+    }
+
+    names.removeDuplicates(false);
+    return names;
+}
+
+void HeadphoneOutput::prepare(int samplesPerBlockExpected, double masterSampleRate)
+{
+    const juce::ScopedLock sl(bufferLock);
+
+    prepared = false;
+    masterRate = masterSampleRate;
+
+    // Half the FIFO is kept filled as the working point for drift compensation
+    int capacity = juce::nextPowerOfTwo(juce::jmax(2048, samplesPerBlockExpected * 4));
+    fifo.setTotalSize(capacity);
+    fifo.reset();
+    fifoBuffer.setSize(2, capacity);
+    fifoBuffer.clear();
+
+    resizeScratch();
+    prepared = true;
+}
+
+void HeadphoneOutput::push(const float* left, const float* right, int numSamples)
+{
+    if (!isActive())
+        return;
+
+    int start1, size1, start2, size2;
+    fifo.prepareToWrite(numSamples, start1, size1, start2, size2);
+
+    // If the headphone device has stalled the FIFO fills up and new audio is dropped
+    if (size1 > 0)
+    {
+        fifoBuffer.copyFrom(0, start1, left, size1);
+        fifoBuffer.copyFrom(1, start1, right, size1);
+    }
+
+    if (size2 > 0)
+    {
+        fifoBuffer.copyFrom(0, start2, left + size1, size2);
+        fifoBuffer.copyFrom(1, start2, right + size1, size2);
+    }
+
+    fifo.finishedWrite(size1 + size2);
+}
+
+void HeadphoneOutput::audioDeviceIOCallbackWithContext(const float* const* inputChannelData,
+                                                       int numInputChannels,
+                                                       float* const* outputChannelData,
+                                                       int numOutputChannels,
+                                                       int numSamples,
+                                                       const juce::AudioIODeviceCallbackContext& context)
+{
+    juce::ignoreUnused(inputChannelData, numInputChannels, context);
+
+    for (int channel = 0; channel < numOutputChannels; ++channel)
+    {
+        if (outputChannelData[channel] != nullptr)
+            juce::FloatVectorOperations::clear(outputChannelData[channel], numSamples);
+    }
+
+    const juce::ScopedTryLock sl(bufferLock);
+    if (!sl.isLocked() || !prepared.load() || numOutputChannels == 0)
+        return;
+
+    int ready = fifo.getNumReady();
+    int target = fifo.getTotalSize() / 2;
+
+    // Let the FIFO fill to its working point before playing, and after any underrun
+    if (!primed)
+    {
+        if (ready < target)
+            return;
+
+        primed = true;
+    }
+
+    // Consume slightly faster when the FIFO runs full and slower when it drains
+    double fillError = static_cast<double>(ready - target) / static_cast<double>(target);
+    double desiredCorrection = 1.0 + juce::jlimit(-0.005, 0.005, fillError * 0.01);
+    driftCorrection += 0.01 * (desiredCorrection - driftCorrection);
+
+    double ratio = (masterRate / deviceRate) * driftCorrection;
+    int needed = static_cast<int>(std::ceil(numSamples * ratio)) + 2;
+
+    if (needed > scratchBuffer.getNumSamples() || readInput(needed) < needed)
+    {
+        primed = false;
+        interpolators[0].reset();
+        interpolators[1].reset();
+        return;
+    }
+
+    int consumed = 0;
+    for (int channel = 0; channel < 2; ++channel)
+    {
+        float* destination = channel < numOutputChannels ? outputChannelData[channel] : nullptr;
+
+        if (destination != nullptr)
+            consumed = interpolators[channel].process(ratio, scratchBuffer.getReadPointer(channel), destination, numSamples);
+    }
+
+    fifo.finishedRead(juce::jmin(consumed, needed));
+}
+
+void HeadphoneOutput::audioDeviceAboutToStart(juce::AudioIODevice* device)
+{
+    const juce::ScopedLock sl(bufferLock);
+
+    deviceRate = device->getCurrentSampleRate();
+    deviceBlockSize = device->getCurrentBufferSizeSamples();
+    driftCorrection = 1.0;
+    primed = false;
+    interpolators[0].reset();
+    interpolators[1].reset();
+
+    resizeScratch();
+    running = true;
+}
+
+void HeadphoneOutput::audioDeviceStopped()
+{
+    running = false;
+}
+
+void HeadphoneOutput::resizeScratch()
+{
+    // Enough input for one device block at the worst-case ratio plus drift headroom
+    double maxRatio = (masterRate / juce::jmax(1.0, deviceRate)) * 1.01;
+    int size = static_cast<int>(std::ceil(juce::jmax(1, deviceBlockSize) * maxRatio)) + 16;
+    scratchBuffer.setSize(2, size);
+}
+
+int HeadphoneOutput::readInput(int numSamplesNeeded)
+{
+    // Peek without consuming; the interpolator reports how much it actually used
+    int start1, size1, start2, size2;
+    fifo.prepareToRead(numSamplesNeeded, start1, size1, start2, size2);
+
+    for (int channel = 0; channel < 2; ++channel)
+    {
+        if (size1 > 0)
+            scratchBuffer.copyFrom(channel, 0, fifoBuffer, channel, start1, size1);
+        if (size2 > 0)
+            scratchBuffer.copyFrom(channel, size1, fifoBuffer, channel, start2, size2);
+    }
+
+    return size1 + size2;
+}
@@ -0,0 +1,67 @@
+#pragma once
+#include <JuceHeader.h>
+#include <atomic>
+
+// Sends the cue bus to a second audio device (e.g. a USB headphone dongle).
+// The main audio callback pushes samples at the master rate; the headphone
+// device pulls them at its own rate through a resampler whose ratio is trimmed
+// by the FIFO fill level, so clock drift between the two devices is absorbed.
+class HeadphoneOutput : public juce::AudioIODeviceCallback
+{
+public:
+    HeadphoneOutput();
+    ~HeadphoneOutput() override;
+
+    // Message thread
+    bool open(const juce::String& outputDeviceName);
+    void close();
+    bool isOpen() const { return deviceOpen; }
+    juce::String getDeviceName() const { return currentDeviceName; }
+    juce::StringArray getAvailableDeviceNames(); // outputs of every device type
+
+    // Called from the master prepareToPlay
+    void prepare(int samplesPerBlockExpected, double masterSampleRate);
+
+    // Master audio thread
+    bool isActive() const { return running.load() && prepared.load(); }
+    void push(const float* left, const float* right, int numSamples);
+
+    // AudioIODeviceCallback
+    void audioDeviceIOCallbackWithContext(const float* const* inputChannelData,
+                                          int numInputChannels,
+                                          float* const* outputChannelData,
+                                          int numOutputChannels,
+                                          int numSamples,
+                                          const juce::AudioIODeviceCallbackContext& context) override;
+    void audioDeviceAboutToStart(juce::AudioIODevice* device) override;
+    void audioDeviceStopped() override;
+
+private:
+    juce::AudioDeviceManager deviceManager;
+    juce::String currentDeviceName;
+    bool deviceOpen = false;
+
+    // Guards buffer resizing against the headphone device callback
+    juce::CriticalSection bufferLock;
+
+    // Master -> headphone FIFO
+    juce::AbstractFifo fifo { 1 };
+    juce::AudioBuffer<float> fifoBuffer;
+
+    // Headphone device side
+    juce::AudioBuffer<float> scratchBuffer;
+    juce::LagrangeInterpolator interpolators[2];
+    double masterRate = 44100.0;
+    double deviceRate = 44100.0;
+    int deviceBlockSize = 512;
+    double driftCorrection = 1.0;
+    bool primed = false;
+
+    std::atomic<bool> prepared { false };
+    std::atomic<bool> running { false };
+
+    void resizeScratch();
+    int readInput(int numSamplesNeeded);
+
+    JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR(HeadphoneOutput)
+};
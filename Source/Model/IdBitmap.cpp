@@ -0,0 +1,341 @@
+#include "IdBitmap.h"
+#include <algorithm>
+#include <iterator>
+
+void IdBitmap::add(Id id)
+{
+    auto key = static_cast<juce::uint16>(id >> 16);
+    auto low = static_cast<juce::uint16>(id & 0xffff);
+    auto* block = findBlock(key);
+
+    if (block == nullptr)
+    {
+        auto position = std::lower_bound(blocks.begin(), blocks.end(), key,
+                                         [](const Block& b, juce::uint16 k) { return b.key < k; });
+        block = &*blocks.insert(position, Block());
+        block->key = key;
+    }
+
+    if (block->isBitset())
+    {
+        auto& word = block->bits[low / 64];
+        auto bit = juce::uint64 { 1 } << (low % 64);
+
+        if ((word & bit) != 0)
+            return;
+
+        word |= bit;
+    }
+    else
+    {
+        auto position = std::lower_bound(block->list.begin(), block->list.end(), low);
+
+        if (position != block->list.end() && *position == low)
+            return;
+
+        block->list.insert(position, low);
+    }
+
+    ++block->size;
+    ++numIds;
+
+    if (!block->isBitset() && block->size > maxListSize)
+        block->toBitset();
+}
+
+void IdBitmap::remove(Id id)
+{
+    auto key = static_cast<juce::uint16>(id >> 16);
+    auto low = static_cast<juce::uint16>(id & 0xffff);
+    auto* block = findBlock(key);
+
+    if (block == nullptr || !block->contains(low))
+        return;
+
+    if (block->isBitset())
+        block->bits[low / 64] &= ~(juce::uint64 { 1 } << (low % 64));
+    else
+        block->list.erase(std::lower_bound(block->list.begin(), block->list.end(), low));
+
+    --block->size;
+    --numIds;
+
+    // Back to a list only well below the limit, so ids coming and going near it don't flip the block each time
+    if (block->size == 0)
+        blocks.erase(blocks.begin() + (block - blocks.data()));
+    else if (block->isBitset() && block->size < maxListSize / 2)
+        block->toList();
+}
+
+bool IdBitmap::contains(Id id) const
+{
+    const auto* block = findBlock(static_cast<juce::uint16>(id >> 16));
+    return block != nullptr && block->contains(static_cast<juce::uint16>(id & 0xffff));
+}
+
+void IdBitmap::clear()
+{
+    blocks.clear();
+    numIds = 0;
+}
+
+void IdBitmap::intersectWith(const IdBitmap& other)
+{
+    std::vector<Block> kept;
+    numIds = 0;
+
+    auto a = blocks.begin();
+    auto b = other.blocks.begin();
+
+    while (a != blocks.end() && b != other.blocks.end())
+    {
+        if (a->key < b->key)
+        {
+            ++a;
+        }
+        else if (b->key < a->key)
+        {
+            ++b;
+        }
+        else
+        {
+            auto block = intersect(*a, *b);
+
+            if (block.size > 0)
+            {
+                numIds += block.size;
+                kept.push_back(std::move(block));
+            }
+
+            ++a;
+            ++b;
+        }
+    }
+
+    blocks = std::move(kept);
+}
+
+void IdBitmap::unionWith(const IdBitmap& other)
+{
+    std::vector<Block> merged;
+    merged.reserve(blocks.size() + other.blocks.size());
+    numIds = 0;
+
+    auto a = blocks.begin();
+    auto b = other.blocks.begin();
+
+    while (a != blocks.end() || b != other.blocks.end())
+    {
+        if (b == other.blocks.end() || (a != blocks.end() && a->key < b->key))
+        {
+            merged.push_back(std::move(*a++));
+        }
+        else if (a == blocks.end() || b->key < a->key)
+        {
+            merged.push_back(*b++);
+        }
+        else
+        {
+            unite(*a, *b);
+            merged.push_back(std::move(*a++));
+            ++b;
+        }
+
+        numIds += merged.back().size;
+    }
+
+    blocks = std::move(merged);
+}
+
+int IdBitmap::countIntersection(const IdBitmap& a, const IdBitmap& b)
+{
+    int count = 0;
+    auto blockA = a.blocks.begin();
+    auto blockB = b.blocks.begin();
+
+    while (blockA != a.blocks.end() && blockB != b.blocks.end())
+    {
+        if (blockA->key < blockB->key)
+            ++blockA;
+        else if (blockB->key < blockA->key)
+            ++blockB;
+        else
+            count += countIntersection(*blockA++, *blockB++);
+    }
+
+    return count;
+}
+
+std::vector<IdBitmap::Id> IdBitmap::toVector() const
+{
+    std::vector<Id> ids;
+    ids.reserve(static_cast<size_t>(numIds));
+    forEach([&ids](Id id) { ids.push_back(id); });
+    return ids;
+}
+
+bool IdBitmap::Block::contains(juce::uint16 low) const
+{
+    if (isBitset())
+        return (bits[low / 64] & (juce::uint64 { 1 } << (low % 64))) != 0;
+
+    return std::binary_search(list.begin(), list.end(), low);
+}
+
+void IdBitmap::Block::toBitset()
+{
+    bits.assign(wordsPerBitset, 0);
+
+    for (auto low : list)
+        bits[low / 64] |= juce::uint64 { 1 } << (low % 64);
+
+    list.clear();
+    list.shrink_to_fit();
+}
+
+void IdBitmap::Block::toList()
+{
+    list.clear();
+    list.reserve(static_cast<size_t>(size));
+
+    for (size_t word = 0; word < bits.size(); ++word)
+    {
+        for (auto wordBits = bits[word]; wordBits != 0; wordBits &= wordBits - 1)
+            list.push_back(static_cast<juce::uint16>(word * 64 + static_cast<size_t>(countTrailingZeros(wordBits))));
+    }
+
+    bits.clear();
+    bits.shrink_to_fit();
+}
+
+IdBitmap::Block* IdBitmap::findBlock(juce::uint16 key)
+{
+    return const_cast<Block*>(static_cast<const IdBitmap*>(this)->findBlock(key));
+}
+
+const IdBitmap::Block* IdBitmap::findBlock(juce::uint16 key) const
+{
+    auto found = std::lower_bound(blocks.begin(), blocks.end(), key,
+                                  [](const Block& block, juce::uint16 k) { return block.key < k; });
+
+    return found != blocks.end() && found->key == key ? &*found : nullptr;
+}
+
+IdBitmap::Block IdBitmap::intersect(const Block& a, const Block& b)
+{
+    Block result;
+    result.key = a.key;
+
+    if (a.isBitset() && b.isBitset())
+    {
+        result.bits.resize(wordsPerBitset);
+
+        for (size_t word = 0; word < wordsPerBitset; ++word)
+        {
+            result.bits[word] = a.bits[word] & b.bits[word];
+            result.size += juce::countNumberOfBits(result.bits[word]);
+        }
+
+        if (result.size <= maxListSize)
+            result.toList();
+    }
+    else if (a.isBitset() || b.isBitset())
+    {
+        // Each listed id is looked up in the bitset
+        const auto& listed = a.isBitset() ? b : a;
+        const auto& bitset = a.isBitset() ? a : b;
+
+        for (auto low : listed.list)
+        {
+            if (bitset.contains(low))
+                result.list.push_back(low);
+        }
+
+        result.size = static_cast<int>(result.list.size());
+    }
+    else
+    {
+        std::set_intersection(a.list.begin(), a.list.end(), b.list.begin(), b.list.end(),
+                              std::back_inserter(result.list));
+        result.size = static_cast<int>(result.list.size());
+    }
+
+    return result;
+}
+
+int IdBitmap::countIntersection(const Block& a, const Block& b)
+{
+    int count = 0;
+
+    if (a.isBitset() && b.isBitset())
+    {
+        for (size_t word = 0; word < wordsPerBitset; ++word)
+            count += juce::countNumberOfBits(a.bits[word] & b.bits[word]);
+    }
+    else if (a.isBitset() || b.isBitset())
+    {
+        const auto& listed = a.isBitset() ? b : a;
+        const auto& bitset = a.isBitset() ? a : b;
+
+        for (auto low : listed.list)
+            count += bitset.contains(low) ? 1 : 0;
+    }
+    else
+    {
+        auto x = a.list.begin();
+        auto y = b.list.begin();
+
+        while (x != a.list.end() && y != b.list.end())
+        {
+            if (*x < *y)
+                ++x;
+            else if (*y < *x)
+                ++y;
+            else
+            {
+                ++count;
+                ++x;
+                ++y;
+            }
+        }
+    }
+
+    return count;
+}
+
+void IdBitmap::unite(Block& block, const Block& other)
+{
+    if (!block.isBitset() && !other.isBitset())
+    {
+        std::vector<juce::uint16> merged;
+        merged.reserve(block.list.size() + other.list.size());
+        std::set_union(block.list.begin(), block.list.end(), other.list.begin(), other.list.end(),
+                       std::back_inserter(merged));
+
+        block.list = std::move(merged);
+        block.size = static_cast<int>(block.list.size());
+
+        if (block.size > maxListSize)
+            block.toBitset();
+
+        return;
+    }
+
+    if (!block.isBitset())
+        block.toBitset();
+
+    if (other.isBitset())
+    {
+        for (size_t word = 0; word < wordsPerBitset; ++word)
+            block.bits[word] |= other.bits[word];
+    }
+    else
+    {
+        for (auto low : other.list)
+            block.bits[low / 64] |= juce::uint64 { 1 } << (low % 64);
+    }
+
+    block.size = 0;
+    for (auto word : block.bits)
+        block.size += juce::countNumberOfBits(word);
+}
@@ -0,0 +1,80 @@
+#pragma once
+#include <JuceHeader.h>
+#include <vector>
+
+// A set of track ids, compressed the way roaring bitmaps are. Ids are split
+// into blocks of 65536 by their top 16 bits; a block holding few ids keeps
+// them as a sorted list of their low halves, a crowded one as a bitset of
+// 8 KB. Either way a value with a handful of tracks costs a few bytes per
+// track and one with half the library costs a bit per track, and two sets
+// intersect block by block with the cheapest method the pair allows.
+class IdBitmap
+{
+public:
+    using Id = juce::uint32;
+
+    IdBitmap() = default;
+
+    void add(Id id);
+    void remove(Id id);
+    bool contains(Id id) const;
+    void clear();
+    int size() const { return numIds; }
+    bool isEmpty() const { return numIds == 0; }
+
+    void intersectWith(const IdBitmap& other);
+    void unionWith(const IdBitmap& other);
+    static int countIntersection(const IdBitmap& a, const IdBitmap& b);
+
+    std::vector<Id> toVector() const; // ascending
+
+    template <typename Function>
+    void forEach(Function&& function) const
+    {
+        for (const auto& block : blocks)
+        {
+            Id base = static_cast<Id>(block.key) << 16;
+
+            if (block.isBitset())
+            {
+                for (size_t word = 0; word < block.bits.size(); ++word)
+                {
+                    for (auto bits = block.bits[word]; bits != 0; bits &= bits - 1)
+                        function(base | static_cast<Id>(word * 64 + static_cast<size_t>(countTrailingZeros(bits))));
+                }
+            }
+            else
+            {
+                for (auto low : block.list)
+                    function(base | low);
+            }
+        }
+    }
+
+private:
+    static constexpr int maxListSize = 4096; // a list this long takes as much room as a bitset
+    static constexpr size_t wordsPerBitset = 65536 / 64;
+
+    struct Block
+    {
+        juce::uint16 key = 0;
+        int size = 0;
+        std::vector<juce::uint16> list;  // sorted; used while small
+        std::vector<juce::uint64> bits;  // used once crowded
+
+        bool isBitset() const { return !bits.empty(); }
+        bool contains(juce::uint16 low) const;
+        void toBitset();
+        void toList();
+    };
+
+    std::vector<Block> blocks; // by key
+    int numIds = 0;
+
+    Block* findBlock(juce::uint16 key);
+    const Block* findBlock(juce::uint16 key) const;
+    static Block intersect(const Block& a, const Block& b);
+    static int countIntersection(const Block& a, const Block& b);
+    static void unite(Block& block, const Block& other);
+    static int countTrailingZeros(juce::uint64 bits) { return juce::countNumberOfBits((bits & (~bits + 1)) - 1); }
+};
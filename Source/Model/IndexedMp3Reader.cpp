@@ -0,0 +1,144 @@
+#include "IndexedMp3Reader.h"
+
+namespace
+{
+    // Layer III side info begins with main_data_begin: how many bytes back, in the
+    // frames before, this frame's audio data starts. Zero for the other layers.
+    int readMainDataBegin(juce::InputStream& stream, juce::int64 position)
+    {
+        juce::uint8 bytes[8];
+        SeekIndex::FrameHeader header;
+
+        if (!stream.setPosition(position) || stream.read(bytes, 8) != 8 || !SeekIndex::parseFrameHeader(bytes, header))
+            return -1;
+
+        if (header.layer != 3)
+            return 0;
+
+        // A CRC follows the header when the protection bit is clear; MPEG-1 uses 9 bits, MPEG-2 and 2.5 use 8
+        int at = (bytes[1] & 0x01) == 0 ? 6 : 4;
+        bool mpeg1 = ((bytes[1] >> 3) & 0x03) == 0x03;
+        return mpeg1 ? (bytes[at] << 1) | (bytes[at + 1] >> 7) : bytes[at];
+    }
+}
+
+IndexedMp3Reader::IndexedMp3Reader(const juce::File& audioFile, std::shared_ptr<const SeekIndex> seekIndex,
+                                   juce::AudioFormat& mp3Format)
+    : juce::AudioFormatReader(nullptr, mp3Format.getFormatName()),
+      file(audioFile), index(std::move(seekIndex)), format(mp3Format)
+{
+    sampleRate = index->getSampleRate();
+    numChannels = static_cast<unsigned int>(index->getNumChannels());
+    lengthInSamples = index->getLengthInSamples();
+    bitsPerSample = 32;
+    usesFloatingPointData = true;
+
+    skipBuffer.setSize(static_cast<int>(numChannels), index->getSamplesPerFrame());
+}
+
+IndexedMp3Reader::~IndexedMp3Reader()
+{
+}
+
+bool IndexedMp3Reader::readSamples(int* const* destChannels, int numDestChannels, int startOffsetInDestBuffer,
+                                   juce::int64 startSampleInFile, int numSamples)
+{
+    clearSamplesBeyondAvailableLength(destChannels, numDestChannels, startOffsetInDestBuffer,
+                                      startSampleInFile, numSamples, lengthInSamples);
+
+    if (numSamples <= 0)
+        return true;
+
+    // A short hop forward is cheaper to decode through than to reopen
+    juce::int64 hopLimit = static_cast<juce::int64>(index->getSamplesPerFrame()) * (SeekIndex::prerollFrames + 1);
+    bool canSkip = decoder != nullptr && startSampleInFile >= decoderPosition
+                && startSampleInFile - decoderPosition <= hopLimit;
+
+    if (startSampleInFile != decoderPosition)
+    {
+        bool positioned = canSkip ? skipTo(startSampleInFile) : openAt(startSampleInFile);
+        if (!positioned)
+            return false;
+    }
+
+    if (!decoder->readSamples(destChannels, numDestChannels, startOffsetInDestBuffer,
+                              decoderPosition - decoderStart, numSamples))
+    {
+        decoderPosition = -1;
+        return false;
+    }
+
+    decoderPosition += numSamples;
+    return true;
+}
+
+int IndexedMp3Reader::findStartFrame(int targetFrame) const
+{
+    // Back past the pre-roll, then over enough audio data to fill the reservoir the
+    // first pre-roll frame borrows from. Each frame's header, CRC and side info take
+    // up to 38 bytes that aren't audio data.
+    int frame = juce::jmax(0, targetFrame - SeekIndex::prerollFrames);
+    int reservoirBytes = 0;
+
+    while (frame > 0 && reservoirBytes < SeekIndex::maxReservoirBytes)
+    {
+        --frame;
+        auto frameBytes = index->getFrameOffset(frame + 1) - index->getFrameOffset(frame);
+        reservoirBytes += static_cast<int>(juce::jmax<juce::int64>(0, frameBytes - 38));
+    }
+
+    return frame;
+}
+
+bool IndexedMp3Reader::openAt(juce::int64 sample)
+{
+    decoder.reset();
+    decoderPosition = -1;
+
+    int startFrame = findStartFrame(index->getFrameForSample(sample));
+
+    auto stream = file.createInputStream();
+    if (stream == nullptr || !stream->openedOk())
+        return false;
+
+    // With nothing before it to borrow from, the first frame decodes to no output at all
+    // if its data starts in the reservoir, and the decoder's count begins one frame later
+    int mainDataBegin = readMainDataBegin(*stream, index->getFrameOffset(startFrame));
+    if (mainDataBegin < 0)
+        return false;
+
+    int firstOutputFrame = startFrame + (mainDataBegin > 0 ? 1 : 0);
+
+    // The decoder sees a stream starting on a frame header and counts samples from there
+    auto* region = new juce::SubregionStream(stream.release(), index->getFrameOffset(startFrame), -1, true);
+    decoder.reset(format.createReaderFor(region, true));
+    if (decoder == nullptr)
+        return false;
+
+    decoderStart = static_cast<juce::int64>(firstOutputFrame) * index->getSamplesPerFrame();
+    decoderPosition = decoderStart;
+
+    if (decoderStart > sample)
+        return false;
+
+    return skipTo(sample);
+}
+
+bool IndexedMp3Reader::skipTo(juce::int64 sample)
+{
+    while (decoderPosition < sample)
+    {
+        int count = static_cast<int>(juce::jmin<juce::int64>(skipBuffer.getNumSamples(), sample - decoderPosition));
+
+        if (!decoder->readSamples(reinterpret_cast<int* const*>(skipBuffer.getArrayOfWritePointers()),
+                                  skipBuffer.getNumChannels(), 0, decoderPosition - decoderStart, count))
+        {
+            decoderPosition = -1;
+            return false;
+        }
+
+        decoderPosition += count;
+    }
+
+    return true;
+}
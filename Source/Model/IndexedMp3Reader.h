@@ -0,0 +1,37 @@
+#pragma once
+#include <JuceHeader.h>
+#include "SeekIndex.h"
+#include <memory>
+
+// MP3 reader that seeks through a SeekIndex. Sequential reads go straight to
+// JUCE's decoder. A jump reopens the file at the frame holding the target, less
+// SeekIndex::prerollFrames and however many frames the bit reservoir can reach
+// back over, and decodes and drops the pre-roll. The decoder gives nothing for
+// a first frame whose data starts in the reservoir, so that frame is left out
+// of the count. Any seek costs a few frame decodes and lands on the exact
+// sample, wherever in a VBR file it is. Length, rate and channels come from the index.
+class IndexedMp3Reader : public juce::AudioFormatReader
+{
+public:
+    IndexedMp3Reader(const juce::File& file, std::shared_ptr<const SeekIndex> index, juce::AudioFormat& mp3Format);
+    ~IndexedMp3Reader() override;
+
+    bool readSamples(int* const* destChannels, int numDestChannels, int startOffsetInDestBuffer,
+                     juce::int64 startSampleInFile, int numSamples) override;
+
+private:
+    juce::File file;
+    std::shared_ptr<const SeekIndex> index;
+    juce::AudioFormat& format;
+
+    std::unique_ptr<juce::AudioFormatReader> decoder;
+    juce::int64 decoderStart = 0;       // file sample at the decoder's first output
+    juce::int64 decoderPosition = -1;   // file sample its next read returns
+    juce::AudioBuffer<float> skipBuffer;
+
+    int findStartFrame(int targetFrame) const;
+    bool openAt(juce::int64 sample);
+    bool skipTo(juce::int64 sample);
+
+    JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR(IndexedMp3Reader)
+};
@@ -0,0 +1,363 @@
+#include "JobScheduler.h"
+#include "SeekIndex.h"
+#include <algorithm>
+#include <tuple>
+
+#if ! JUCE_WINDOWS
+ #include <sys/stat.h>
+#endif
+
+JobScheduler::Worker::Worker(JobScheduler& owner)
+    : juce::Thread("Job Worker"), scheduler(owner)
+{
+}
+
+void JobScheduler::Worker::run()
+{
+    while (!threadShouldExit())
+    {
+        auto task = scheduler.takeNextTask();
+
+        if (task == nullptr)
+        {
+            scheduler.workAvailable.wait(200);
+            continue;
+        }
+
+        if (!task->cancelled.load())
+        {
+            if (task->job)
+            {
+                const juce::ScopedLock cl(task->callbackLock);
+                task->job(task->cancelled);
+            }
+            else
+            {
+                scheduler.runDecode(*task);
+            }
+        }
+
+        scheduler.finishTask(task);
+    }
+}
+
+JobScheduler::JobScheduler(juce::AudioFormatManager& fm, int numThreads, int maxPerDisk)
+    : formatManager(fm), maxJobsPerDisk(juce::jmax(1, maxPerDisk))
+{
+    for (int i = 0; i < juce::jmax(1, numThreads); ++i)
+        workers.add(new Worker(*this))->startThread();
+}
+
+JobScheduler::~JobScheduler()
+{
+    for (auto* worker : workers)
+        worker->signalThreadShouldExit();
+
+    {
+        const juce::ScopedLock sl(lock);
+        queued.clear();
+
+        for (auto& task : running)
+            task->cancelled = true;
+    }
+
+    for (auto* worker : workers)
+    {
+        workAvailable.signal();
+        worker->stopThread(4000);
+    }
+}
+
+int JobScheduler::addJob(const juce::File& file, Priority priority, const juce::String& group, Job job)
+{
+    auto task = std::make_shared<Task>();
+    task->file = file;
+    task->disk = getDiskFor(file);
+    task->priority = priority;
+    task->group = group;
+    task->job = std::move(job);
+
+    int id = 0;
+
+    {
+        const juce::ScopedLock sl(lock);
+        id = task->id = nextId++;
+        task->order = nextOrder++;
+        queued.push_back(task);
+    }
+
+    workAvailable.signal();
+    return id;
+}
+
+int JobScheduler::addDecode(const juce::File& file, Priority priority, const juce::String& group, DecodeConsumer callbacks)
+{
+    auto consumer = std::make_shared<Consumer>();
+    consumer->group = group;
+    consumer->callbacks = std::move(callbacks);
+
+    auto disk = getDiskFor(file);
+    int id = 0;
+
+    {
+        const juce::ScopedLock sl(lock);
+        id = consumer->id = nextId++;
+
+        // Ride along on a read of the same file if there is one, at the higher of the two priorities
+        for (auto* tasks : { &queued, &running })
+        {
+            for (auto& task : *tasks)
+            {
+                if (task->job || task->file != file || !task->acceptsConsumers || task->cancelled.load())
+                    continue;
+
+                consumer->joinedAt = task->readPosition;
+                task->consumers.push_back(consumer);
+                task->priority = std::min(task->priority, priority);
+                return id;
+            }
+        }
+
+        auto task = std::make_shared<Task>();
+        task->id = nextId++;
+        task->order = nextOrder++;
+        task->file = file;
+        task->disk = disk;
+        task->priority = priority;
+        task->consumers.push_back(consumer);
+        queued.push_back(task);
+    }
+
+    workAvailable.signal();
+    return id;
+}
+
+void JobScheduler::cancel(int id)
+{
+    cancelMatching([id](int itemId, const juce::String&) { return itemId == id; });
+}
+
+void JobScheduler::cancelGroup(const juce::String& group)
+{
+    cancelMatching([&group](int, const juce::String& itemGroup) { return itemGroup == group; });
+}
+
+int JobScheduler::getNumPendingJobs() const
+{
+    const juce::ScopedLock sl(lock);
+    return static_cast<int>(queued.size() + running.size());
+}
+
+std::shared_ptr<JobScheduler::Task> JobScheduler::takeNextTask()
+{
+    const juce::ScopedLock sl(lock);
+
+    auto best = queued.end();
+
+    for (auto it = queued.begin(); it != queued.end(); ++it)
+    {
+        // A disk at its limit waits; work on other disks carries on
+        if (jobsPerDisk[(*it)->disk] >= maxJobsPerDisk)
+            continue;
+
+        if (best == queued.end()
+            || std::tie((*it)->priority, (*it)->order) < std::tie((*best)->priority, (*best)->order))
+            best = it;
+    }
+
+    if (best == queued.end())
+        return nullptr;
+
+    auto task = *best;
+    queued.erase(best);
+    task->running = true;
+    running.push_back(task);
+    ++jobsPerDisk[task->disk];
+    return task;
+}
+
+void JobScheduler::finishTask(const std::shared_ptr<Task>& task)
+{
+    {
+        const juce::ScopedLock sl(lock);
+        running.erase(std::remove(running.begin(), running.end(), task), running.end());
+
+        if (--jobsPerDisk[task->disk] <= 0)
+            jobsPerDisk.erase(task->disk);
+    }
+
+    // A disk slot has come free
+    workAvailable.signal();
+}
+
+std::vector<std::shared_ptr<JobScheduler::Consumer>> JobScheduler::getActiveConsumers(Task& task)
+{
+    const juce::ScopedLock sl(lock);
+
+    std::vector<std::shared_ptr<Consumer>> active;
+    for (auto& consumer : task.consumers)
+    {
+        if (consumer->active)
+            active.push_back(consumer);
+    }
+
+    return active;
+}
+
+void JobScheduler::runDecode(Task& task)
+{
+    std::unique_ptr<juce::AudioFormatReader> reader(SeekIndex::createReaderFor(formatManager, task.file));
+
+    if (reader == nullptr || reader->lengthInSamples <= 0)
+    {
+        const juce::ScopedLock cl(task.callbackLock);
+        for (auto& consumer : getActiveConsumers(task))
+            if (consumer->callbacks.onFinished)
+                consumer->callbacks.onFinished(false);
+        return;
+    }
+
+    auto length = reader->lengthInSamples;
+    int numChannels = reader->numChannels > 1 ? 2 : 1;
+    juce::AudioBuffer<float> block(numChannels, decodeBlockSize);
+
+    // One pass over the file, then a second from the start for anyone who joined part way
+    juce::int64 position = 0;
+    juce::int64 end = length;
+    bool secondPass = false;
+
+    while (!task.cancelled.load())
+    {
+        if (position >= end)
+        {
+            if (secondPass)
+                break;
+
+            const juce::ScopedLock sl(lock);
+            task.acceptsConsumers = false;
+            end = 0;
+
+            for (auto& consumer : task.consumers)
+                if (consumer->active)
+                    end = juce::jmax(end, consumer->joinedAt);
+
+            if (end <= 0)
+                break;
+
+            secondPass = true;
+            position = 0;
+        }
+
+        int count = static_cast<int>(juce::jmin<juce::int64>(decodeBlockSize, end - position));
+        reader->read(&block, 0, count, position, true, numChannels > 1);
+
+        const juce::ScopedLock cl(task.callbackLock);
+        std::vector<std::shared_ptr<Consumer>> consumers;
+
+        {
+            // Anyone joining from here on starts after this block
+            const juce::ScopedLock sl(lock);
+
+            if (!secondPass)
+                task.readPosition = position + count;
+
+            for (auto& consumer : task.consumers)
+                if (consumer->active)
+                    consumers.push_back(consumer);
+
+            // Everyone has gone: stop reading
+            if (consumers.empty())
+                task.cancelled = true;
+        }
+
+        for (auto& consumer : consumers)
+        {
+            if (secondPass && position >= consumer->joinedAt)
+                continue;
+
+            if (!consumer->started)
+            {
+                consumer->started = true;
+                if (consumer->callbacks.onStart)
+                    consumer->callbacks.onStart(reader->sampleRate, numChannels, length);
+            }
+
+            if (consumer->callbacks.onBlock)
+                consumer->callbacks.onBlock(block, position, count);
+        }
+
+        position += count;
+    }
+
+    const juce::ScopedLock cl(task.callbackLock);
+    bool completed = !task.cancelled.load();
+
+    for (auto& consumer : getActiveConsumers(task))
+        if (consumer->callbacks.onFinished)
+            consumer->callbacks.onFinished(completed);
+}
+
+void JobScheduler::cancelMatching(const std::function<bool(int id, const juce::String& group)>& matches)
+{
+    std::vector<std::shared_ptr<Task>> affected;
+
+    {
+        const juce::ScopedLock sl(lock);
+
+        // True when nothing is left for the task to do
+        auto dropFrom = [&](const std::shared_ptr<Task>& task)
+        {
+            if (task->job)
+            {
+                bool matched = matches(task->id, task->group);
+                if (matched && task->running)
+                    affected.push_back(task);
+
+                return matched;
+            }
+
+            bool touched = false, remaining = false;
+
+            for (auto& consumer : task->consumers)
+            {
+                if (consumer->active && matches(consumer->id, consumer->group))
+                {
+                    consumer->active = false;
+                    touched = true;
+                }
+
+                remaining = remaining || consumer->active;
+            }
+
+            if (touched && task->running)
+                affected.push_back(task);
+
+            return !remaining;
+        };
+
+        queued.erase(std::remove_if(queued.begin(), queued.end(), dropFrom), queued.end());
+
+        for (auto& task : running)
+            if (dropFrom(task))
+                task->cancelled = true;
+    }
+
+    // Wait out a job or delivery already in progress, so nothing is called after we return
+    for (auto& task : affected)
+    {
+        const juce::ScopedLock cl(task->callbackLock);
+    }
+}
+
+juce::String JobScheduler::getDiskFor(const juce::File& file)
+{
+   #if JUCE_WINDOWS
+    return file.getFullPathName().upToFirstOccurrenceOf("\\", false, false).toUpperCase();
+   #else
+    struct stat info;
+    if (stat(file.getFullPathName().toRawUTF8(), &info) == 0)
+        return juce::String::toHexString(static_cast<juce::int64>(info.st_dev));
+
+    return {};
+   #endif
+}
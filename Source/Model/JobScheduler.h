@@ -0,0 +1,112 @@
+#pragma once
+#include <JuceHeader.h>
+#include <atomic>
+#include <functional>
+#include <map>
+#include <memory>
+#include <vector>
+
+// One place for background decoding and file IO. Jobs run in priority order
+// (deck loads, then visible waveforms, then library analysis) on a small pool
+// of worker threads. A cap on how many run against the same disk at once keeps
+// one drive's seeks from queuing up behind each other. Every job belongs to a
+// group; cancelling the group drops its queued work and stops what is running,
+// which is how a new deck load supersedes the previous one. Decodes of the same
+// file are merged, so the file is read once and every block goes to each
+// consumer that asked for it.
+class JobScheduler
+{
+public:
+    enum class Priority
+    {
+        DeckLoad,
+        VisibleWaveform,
+        Analysis
+    };
+
+    // Called on a worker thread. A consumer that joins a read already under
+    // way gets the rest of the file first and then the part it missed.
+    struct DecodeConsumer
+    {
+        std::function<void(double sampleRate, int numChannels, juce::int64 lengthInSamples)> onStart;
+        std::function<void(const juce::AudioBuffer<float>& block, juce::int64 startSample, int numSamples)> onBlock;
+        std::function<void(bool completed)> onFinished;
+    };
+
+    using Job = std::function<void(const std::atomic<bool>& shouldStop)>;
+
+    static constexpr int decodeBlockSize = 65536;
+
+    JobScheduler(juce::AudioFormatManager& formatManager, int numThreads = 3, int maxJobsPerDisk = 2);
+    ~JobScheduler();
+
+    // Any thread; the id can be passed to cancel()
+    int addJob(const juce::File& file, Priority priority, const juce::String& group, Job job);
+    int addDecode(const juce::File& file, Priority priority, const juce::String& group, DecodeConsumer consumer);
+
+    // Queued work is dropped and running work told to stop. Once these return,
+    // no cancelled job or decode callback is running or will run.
+    void cancel(int id);
+    void cancelGroup(const juce::String& group);
+    int getNumPendingJobs() const;
+
+private:
+    struct Consumer
+    {
+        int id = 0;
+        juce::String group;
+        DecodeConsumer callbacks;
+        juce::int64 joinedAt = 0;   // read position when it joined
+        bool active = true;
+        bool started = false;
+    };
+
+    struct Task
+    {
+        int id = 0;
+        Priority priority = Priority::Analysis;
+        juce::uint64 order = 0;
+        juce::File file;
+        juce::String disk;
+        juce::String group;
+        Job job;                                            // empty for a shared decode
+        std::vector<std::shared_ptr<Consumer>> consumers;
+        std::atomic<bool> cancelled { false };
+        bool running = false;
+        bool acceptsConsumers = true;
+        juce::int64 readPosition = 0;
+        juce::CriticalSection callbackLock;                 // held while the job or its consumers run
+    };
+
+    class Worker : public juce::Thread
+    {
+    public:
+        explicit Worker(JobScheduler& owner);
+        void run() override;
+
+    private:
+        JobScheduler& scheduler;
+    };
+
+    juce::AudioFormatManager& formatManager;
+    const int maxJobsPerDisk;
+
+    mutable juce::CriticalSection lock;
+    juce::WaitableEvent workAvailable;
+    std::vector<std::shared_ptr<Task>> queued;
+    std::vector<std::shared_ptr<Task>> running;
+    std::map<juce::String, int> jobsPerDisk;
+    int nextId = 1;
+    juce::uint64 nextOrder = 0;
+
+    juce::OwnedArray<Worker> workers;
+
+    std::shared_ptr<Task> takeNextTask();
+    void finishTask(const std::shared_ptr<Task>& task);
+    void runDecode(Task& task);
+    std::vector<std::shared_ptr<Consumer>> getActiveConsumers(Task& task);
+    void cancelMatching(const std::function<bool(int id, const juce::String& group)>& matches);
+    static juce::String getDiskFor(const juce::File& file);
+
+    JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR(JobScheduler)
+};
@@ -0,0 +1,395 @@
+#include "LibraryDatabase.h"
+#include <algorithm>
+#include <iterator>
+
+namespace
+{
+    constexpr int databaseMagic = 0x424c4a44; // "DJLB"
+    constexpr int databaseVersion = 6; // 2 adds the watched folders, 3 play counts, 4 musical keys, 5 dates added, 6 smart playlists
+}
+
+LibraryDatabase::LibraryDatabase()
+    : LibraryDatabase(getDefaultFile())
+{
+}
+
+LibraryDatabase::LibraryDatabase(const juce::File& file)
+    : databaseFile(file)
+{
+}
+
+LibraryDatabase::~LibraryDatabase()
+{
+}
+
+bool LibraryDatabase::load()
+{
+    if (!databaseFile.existsAsFile())
+        return false;
+
+    // Mapped and read front to back in one go; the pages are dropped with the mapping
+    juce::MemoryMappedFile mapped(databaseFile, juce::MemoryMappedFile::readOnly);
+    if (mapped.getData() == nullptr || mapped.getSize() < 12)
+        return false;
+
+    juce::MemoryInputStream in(mapped.getData(), mapped.getSize(), false);
+
+    if (in.readInt() != databaseMagic)
+        return false;
+
+    int version = in.readInt();
+    if (version < 1 || version > databaseVersion)
+        return false;
+
+    int count = in.readInt();
+    if (count < 0)
+        return false;
+
+    std::vector<Entry> loaded;
+    std::unordered_map<juce::String, size_t> index;
+    loaded.reserve(static_cast<size_t>(count));
+    index.reserve(static_cast<size_t>(count));
+
+    for (int i = 0; i < count; ++i)
+    {
+        // A short file is a damaged one; start over rather than load part of it
+        Entry entry;
+        if (in.isExhausted() || !readEntry(in, entry, version))
+            return false;
+
+        index[entry.track.getFilePath()] = loaded.size();
+        loaded.push_back(std::move(entry));
+    }
+
+    juce::Array<juce::File> loadedFolders;
+
+    if (version >= 2)
+    {
+        int numFolders = in.readInt();
+        for (int i = 0; i < numFolders && !in.isExhausted(); ++i)
+            loadedFolders.add(juce::File(in.readString()));
+    }
+
+    juce::StringArray loadedSmartPlaylists;
+
+    if (version >= 6)
+    {
+        int numSmartPlaylists = in.readInt();
+        for (int i = 0; i < numSmartPlaylists && !in.isExhausted(); ++i)
+            loadedSmartPlaylists.add(in.readString());
+    }
+
+    const juce::ScopedLock sl(lock);
+    entries = std::move(loaded);
+    entryIndex = std::move(index);
+    folders = std::move(loadedFolders);
+    smartPlaylists = std::move(loadedSmartPlaylists);
+    changed = false;
+    return true;
+}
+
+bool LibraryDatabase::save()
+{
+    juce::MemoryOutputStream out;
+
+    {
+        const juce::ScopedLock sl(lock);
+
+        out.writeInt(databaseMagic);
+        out.writeInt(databaseVersion);
+        out.writeInt(static_cast<int>(entries.size()));
+
+        for (const auto& entry : entries)
+            writeEntry(out, entry);
+
+        out.writeInt(folders.size());
+        for (const auto& folder : folders)
+            out.writeString(folder.getFullPathName());
+
+        out.writeInt(smartPlaylists.size());
+        for (const auto& definition : smartPlaylists)
+            out.writeString(definition);
+
+        changed = false;
+    }
+
+    // Written to a temporary file and moved over, so a crash never leaves half a library
+    if (!databaseFile.getParentDirectory().createDirectory()
+        || !databaseFile.replaceWithData(out.getData(), out.getDataSize()))
+    {
+        changed = true;
+        return false;
+    }
+
+    return true;
+}
+
+bool LibraryDatabase::lookup(const juce::File& file, Track& track) const
+{
+    auto fileSize = file.getSize();
+    auto modificationTime = file.getLastModificationTime().toMilliseconds();
+
+    const juce::ScopedLock sl(lock);
+
+    auto found = entryIndex.find(file.getFullPathName());
+    if (found == entryIndex.end())
+        return false;
+
+    const auto& entry = entries[found->second];
+    if (entry.fileSize != fileSize || entry.modificationTime != modificationTime)
+        return false;
+
+    track = entry.track;
+    return true;
+}
+
+Track LibraryDatabase::getTrack(const juce::File& file)
+{
+    Track track;
+
+    if (lookup(file, track))
+        return track;
+
+    track = Track(file);
+
+    {
+        // A rewritten file has usually just been retagged; what was set up in the app still applies
+        const juce::ScopedLock sl(lock);
+
+        auto found = entryIndex.find(file.getFullPathName());
+        if (found != entryIndex.end())
+        {
+            const auto& stored = entries[found->second].track;
+
+            if (track.getBPM() <= 0)
+                track.setBPM(stored.getBPM());
+
+            track.setPlayCount(stored.getPlayCount());
+            track.setDateAdded(stored.getDateAdded());
+
+            track.setBeatGridOffset(stored.getBeatGridOffset());
+
+            for (int cue = 0; cue < Track::numHotCues; ++cue)
+            {
+                if (stored.hasHotCue(cue))
+                    track.setHotCue(cue, stored.getHotCue(cue));
+            }
+        }
+        else
+        {
+            track.setDateAdded(juce::Time::currentTimeMillis());
+        }
+    }
+
+    store(track);
+    return track;
+}
+
+void LibraryDatabase::store(const Track& track)
+{
+    Entry entry;
+    entry.track = track;
+    entry.fileSize = track.getFile().getSize();
+    entry.modificationTime = track.getFile().getLastModificationTime().toMilliseconds();
+
+    const juce::ScopedLock sl(lock);
+
+    auto found = entryIndex.find(track.getFilePath());
+
+    if (found != entryIndex.end())
+    {
+        entries[found->second] = std::move(entry);
+    }
+    else
+    {
+        entryIndex[track.getFilePath()] = entries.size();
+        entries.push_back(std::move(entry));
+    }
+
+    changed = true;
+}
+
+void LibraryDatabase::updateAnalysis(const Track& track)
+{
+    const juce::ScopedLock sl(lock);
+
+    auto found = entryIndex.find(track.getFilePath());
+    if (found == entryIndex.end())
+        return;
+
+    auto& stored = entries[found->second].track;
+    stored.setBPM(track.getBPM());
+    stored.setBeatGridOffset(track.getBeatGridOffset());
+
+    for (int cue = 0; cue < Track::numHotCues; ++cue)
+    {
+        if (track.hasHotCue(cue))
+            stored.setHotCue(cue, track.getHotCue(cue));
+        else
+            stored.clearHotCue(cue);
+    }
+
+    changed = true;
+}
+
+int LibraryDatabase::recordPlay(const juce::File& file)
+{
+    const juce::ScopedLock sl(lock);
+
+    auto found = entryIndex.find(file.getFullPathName());
+    if (found == entryIndex.end())
+        return 0;
+
+    auto& stored = entries[found->second].track;
+    stored.setPlayCount(stored.getPlayCount() + 1);
+    changed = true;
+    return stored.getPlayCount();
+}
+
+int LibraryDatabase::removeTracks(const std::function<bool(const juce::File&)>& isGone)
+{
+    const juce::ScopedLock sl(lock);
+
+    auto firstRemoved = std::remove_if(entries.begin(), entries.end(), [&isGone](const Entry& entry) {
+        return isGone(entry.track.getFile());
+    });
+
+    auto numRemoved = static_cast<int>(std::distance(firstRemoved, entries.end()));
+    if (numRemoved == 0)
+        return 0;
+
+    entries.erase(firstRemoved, entries.end());
+
+    // Positions after the first removal have all moved
+    entryIndex.clear();
+    for (size_t i = 0; i < entries.size(); ++i)
+        entryIndex[entries[i].track.getFilePath()] = i;
+
+    changed = true;
+    return numRemoved;
+}
+
+int LibraryDatabase::getNumTracks() const
+{
+    const juce::ScopedLock sl(lock);
+    return static_cast<int>(entries.size());
+}
+
+std::vector<Track> LibraryDatabase::getAllTracks() const
+{
+    const juce::ScopedLock sl(lock);
+
+    std::vector<Track> tracks;
+    tracks.reserve(entries.size());
+
+    for (const auto& entry : entries)
+        tracks.push_back(entry.track);
+
+    return tracks;
+}
+
+void LibraryDatabase::addFolder(const juce::File& directory)
+{
+    const juce::ScopedLock sl(lock);
+
+    for (const auto& folder : folders)
+    {
+        if (directory == folder || directory.isAChildOf(folder))
+            return;
+    }
+
+    folders.add(directory);
+    changed = true;
+}
+
+juce::Array<juce::File> LibraryDatabase::getFolders() const
+{
+    const juce::ScopedLock sl(lock);
+    return folders;
+}
+
+void LibraryDatabase::setSmartPlaylists(const juce::StringArray& definitions)
+{
+    const juce::ScopedLock sl(lock);
+
+    if (definitions != smartPlaylists)
+    {
+        smartPlaylists = definitions;
+        changed = true;
+    }
+}
+
+juce::StringArray LibraryDatabase::getSmartPlaylists() const
+{
+    const juce::ScopedLock sl(lock);
+    return smartPlaylists;
+}
+
+juce::File LibraryDatabase::getDefaultFile()
+{
+    return juce::File::getSpecialLocation(juce::File::userApplicationDataDirectory)
+        .getChildFile(ProjectInfo::projectName)
+        .getChildFile("Library.djlib");
+}
+
+void LibraryDatabase::writeEntry(juce::OutputStream& out, const Entry& entry) const
+{
+    const auto& track = entry.track;
+
+    out.writeString(track.getFilePath());
+    out.writeInt64(entry.fileSize);
+    out.writeInt64(entry.modificationTime);
+    out.writeString(track.getTitle());
+    out.writeString(track.getArtist());
+    out.writeString(track.getAlbum());
+    out.writeString(track.getGenre());
+    out.writeDouble(track.getDuration());
+    out.writeInt(track.getBPM());
+    out.writeDouble(track.getBeatGridOffset());
+
+    out.writeInt(track.getPlayCount());
+    out.writeString(track.getKey());
+    out.writeInt64(track.getDateAdded());
+
+    out.writeInt(Track::numHotCues);
+    for (int cue = 0; cue < Track::numHotCues; ++cue)
+        out.writeDouble(track.getHotCue(cue));
+}
+
+bool LibraryDatabase::readEntry(juce::InputStream& in, Entry& entry, int version) const
+{
+    // Tags come from the database, not the file
+    Track track(juce::File(in.readString()), false);
+
+    entry.fileSize = in.readInt64();
+    entry.modificationTime = in.readInt64();
+    track.setTitle(in.readString());
+    track.setArtist(in.readString());
+    track.setAlbum(in.readString());
+    track.setGenre(in.readString());
+    track.setDuration(in.readDouble());
+    track.setBPM(in.readInt());
+    track.setBeatGridOffset(in.readDouble());
+
+    if (version >= 3)
+        track.setPlayCount(in.readInt());
+    if (version >= 4)
+        track.setKey(in.readString());
+
+    // Libraries from before dates were kept go by when each file was last written
+    track.setDateAdded(version >= 5 ? in.readInt64() : entry.modificationTime);
+
+    int numHotCues = in.readInt();
+    if (numHotCues < 0 || numHotCues > 64)
+        return false;
+
+    for (int cue = 0; cue < numHotCues; ++cue)
+    {
+        auto position = in.readDouble();
+        if (position >= 0.0)
+            track.setHotCue(cue, position);
+    }
+
+    entry.track = std::move(track);
+    return true;
+}
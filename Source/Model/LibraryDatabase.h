@@ -0,0 +1,68 @@
+#pragma once
+#include <JuceHeader.h>
+#include "Track.h"
+#include <atomic>
+#include <functional>
+#include <unordered_map>
+#include <vector>
+
+// Every track the app has seen, with its tags and analysis (BPM, beat grid,
+// hot cues), kept on disk between sessions. The whole file is memory-mapped
+// and read in one pass at startup. Each entry remembers the size and date of
+// the audio file it was read from, so a rescan only opens files that changed.
+class LibraryDatabase
+{
+public:
+    LibraryDatabase();
+    explicit LibraryDatabase(const juce::File& databaseFile);
+    ~LibraryDatabase();
+
+    // Message thread
+    bool load();
+    bool save();
+    bool saveIfChanged() { return !changed || save(); }
+
+    // Any thread. lookup() is false when the file is unknown or has changed since;
+    // getTrack() falls back to reading the file and stores what it read, keeping
+    // the cues, beat grid and date added of an older entry for the same file.
+    // Files new to the library are dated when they are first read.
+    bool lookup(const juce::File& file, Track& track) const;
+    Track getTrack(const juce::File& file);
+    void store(const Track& track);
+    void updateAnalysis(const Track& track); // edits made in the app; the file itself is unchanged
+    int recordPlay(const juce::File& file);  // the file's new play count, or 0 if it isn't in the library
+    int removeTracks(const std::function<bool(const juce::File&)>& isGone);
+    int getNumTracks() const;
+    std::vector<Track> getAllTracks() const;
+
+    // Music folders the library follows for changes
+    void addFolder(const juce::File& directory);
+    juce::Array<juce::File> getFolders() const;
+
+    // Smart playlist definitions, as SmartPlaylist::toString() writes them
+    void setSmartPlaylists(const juce::StringArray& definitions);
+    juce::StringArray getSmartPlaylists() const;
+
+    static juce::File getDefaultFile();
+
+private:
+    struct Entry
+    {
+        Track track;
+        juce::int64 fileSize = 0;
+        juce::int64 modificationTime = 0;
+    };
+
+    const juce::File databaseFile;
+    mutable juce::CriticalSection lock;
+    std::vector<Entry> entries;                           // in the order they were added
+    std::unordered_map<juce::String, size_t> entryIndex;  // full path -> entry
+    juce::Array<juce::File> folders;
+    juce::StringArray smartPlaylists;
+    std::atomic<bool> changed { false };
+
+    void writeEntry(juce::OutputStream& out, const Entry& entry) const;
+    bool readEntry(juce::InputStream& in, Entry& entry, int version) const;
+
+    JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR(LibraryDatabase)
+};
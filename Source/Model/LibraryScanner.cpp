@@ -0,0 +1,310 @@
+#include "LibraryScanner.h"
+#include "SeekIndex.h"
+#include <iterator>
+
+LibraryScanner::LibraryScanner(JobScheduler& scheduler, LibraryDatabase& libraryDatabase)
+    : jobScheduler(scheduler), database(libraryDatabase)
+{
+}
+
+LibraryScanner::~LibraryScanner()
+{
+    stop();
+}
+
+void LibraryScanner::scanDirectory(const juce::File& directory, const std::set<juce::String>& alreadyListed)
+{
+    if (!directory.isDirectory())
+        return;
+
+    queueDirectory(start(alreadyListed), directory);
+}
+
+void LibraryScanner::scanFiles(const juce::Array<juce::File>& files, const std::set<juce::String>& alreadyListed)
+{
+    juce::Array<juce::File> wanted;
+    std::set<juce::String> gone;
+
+    for (const auto& file : files)
+    {
+        if (!file.existsAsFile())
+        {
+            if (alreadyListed.count(file.getFullPathName()) > 0)
+                gone.insert(file.getFullPathName());
+        }
+        else if (fileFilter == nullptr || fileFilter(file))
+        {
+            wanted.add(file);
+        }
+    }
+
+    auto jobGeneration = start(alreadyListed);
+
+    {
+        const juce::ScopedLock sl(scanLock);
+        missing.insert(gone.begin(), gone.end());
+    }
+
+    queueFiles(jobGeneration, wanted);
+}
+
+void LibraryScanner::cancel()
+{
+    if (stop() && onScanFinished)
+        onScanFinished(false);
+}
+
+int LibraryScanner::start(const std::set<juce::String>& alreadyListed)
+{
+    const juce::ScopedLock sl(scanLock);
+
+    // A scan started while another runs joins it; otherwise the counts start over
+    if (!isTimerRunning())
+    {
+        numFound = 0;
+        numScanned = 0;
+        visitedDirectories.clear();
+        startTimer(deliveryIntervalMs);
+    }
+
+    listed = alreadyListed;
+    return generation;
+}
+
+bool LibraryScanner::stop()
+{
+    {
+        const juce::ScopedLock sl(scanLock);
+        ++generation;
+        outstandingJobs = 0;
+        inFlight.clear();
+        visitedDirectories.clear();
+        scanned.clear();
+        changed.clear();
+        missing.clear();
+    }
+
+    // Nothing new can be queued for the old generation, so this leaves the group empty
+    jobScheduler.cancelGroup(jobGroup);
+
+    bool wasScanning = isTimerRunning();
+    stopTimer();
+    return wasScanning;
+}
+
+void LibraryScanner::addScanJob(int jobGeneration, const juce::File& file, JobScheduler::Job work)
+{
+    const juce::ScopedLock sl(scanLock);
+
+    if (jobGeneration != generation)
+        return;
+
+    ++outstandingJobs;
+    jobScheduler.addJob(file, JobScheduler::Priority::Analysis, jobGroup,
+                        [this, jobGeneration, work = std::move(work)](const std::atomic<bool>& shouldStop) {
+                            work(shouldStop);
+                            finishJob(jobGeneration);
+                        });
+}
+
+void LibraryScanner::finishJob(int jobGeneration)
+{
+    const juce::ScopedLock sl(scanLock);
+
+    if (jobGeneration == generation)
+        --outstandingJobs;
+}
+
+void LibraryScanner::queueDirectory(int jobGeneration, const juce::File& directory)
+{
+    auto resolved = directory.isSymbolicLink() ? directory.getLinkedTarget() : directory;
+
+    {
+        const juce::ScopedLock sl(scanLock);
+        if (jobGeneration != generation || !visitedDirectories.insert(resolved.getFullPathName()).second)
+            return;
+    }
+
+    addScanJob(jobGeneration, resolved, [this, jobGeneration, resolved](const std::atomic<bool>& shouldStop) {
+        listDirectory(jobGeneration, resolved, shouldStop);
+    });
+}
+
+void LibraryScanner::queueFiles(int jobGeneration, const juce::Array<juce::File>& files)
+{
+    const juce::ScopedLock sl(scanLock);
+
+    if (jobGeneration != generation)
+        return;
+
+    juce::Array<juce::File> group;
+
+    for (const auto& file : files)
+    {
+        auto path = file.getFullPathName();
+        if (!inFlight.insert(path).second)
+            continue;
+
+        ++numFound;
+        group.add(file);
+
+        if (group.size() == filesPerJob)
+        {
+            addScanJob(jobGeneration, group[0], [this, jobGeneration, group](const std::atomic<bool>& shouldStop) {
+                readTracks(jobGeneration, group, shouldStop);
+            });
+            group = {};
+        }
+    }
+
+    if (!group.isEmpty())
+    {
+        addScanJob(jobGeneration, group[0], [this, jobGeneration, group](const std::atomic<bool>& shouldStop) {
+            readTracks(jobGeneration, group, shouldStop);
+        });
+    }
+}
+
+void LibraryScanner::findMissing(int jobGeneration, const juce::File& directory, const juce::Array<juce::File>& children)
+{
+    std::set<juce::String> present;
+    for (const auto& child : children)
+        present.insert(child.getFullPathName());
+
+    const auto separator = juce::File::getSeparatorString();
+    auto prefix = directory.getFullPathName();
+    if (!prefix.endsWith(separator))
+        prefix += separator;
+
+    const juce::ScopedLock sl(scanLock);
+
+    if (jobGeneration != generation)
+        return;
+
+    // Listed paths under this folder sit together in the set. Files deeper down are
+    // checked by their own folder's job, unless the folder holding them is gone too.
+    for (auto it = listed.lower_bound(prefix); it != listed.end() && it->startsWith(prefix); ++it)
+    {
+        auto child = prefix + it->substring(prefix.length()).upToFirstOccurrenceOf(separator, false, false);
+
+        if (present.count(child) == 0 && !juce::File(*it).existsAsFile())
+            missing.insert(*it);
+    }
+}
+
+void LibraryScanner::listDirectory(int jobGeneration, const juce::File& directory, const std::atomic<bool>& shouldStop)
+{
+    // One level per job; subfolders become jobs of their own
+    auto children = directory.findChildFiles(juce::File::findFilesAndDirectories | juce::File::ignoreHiddenFiles, false);
+    juce::Array<juce::File> files;
+
+    for (const auto& child : children)
+    {
+        if (shouldStop.load())
+            return;
+
+        if (child.isDirectory())
+            queueDirectory(jobGeneration, child);
+        else if (fileFilter == nullptr || fileFilter(child))
+            files.add(child);
+    }
+
+    findMissing(jobGeneration, directory, children);
+    queueFiles(jobGeneration, files);
+}
+
+void LibraryScanner::readTracks(int jobGeneration, const juce::Array<juce::File>& files, const std::atomic<bool>& shouldStop)
+{
+    std::vector<Track> tracks, rewritten;
+    juce::StringArray unchanged;
+    tracks.reserve(static_cast<size_t>(files.size()));
+
+    for (const auto& file : files)
+    {
+        if (shouldStop.load())
+            return;
+
+        bool isListed = false;
+
+        {
+            const juce::ScopedLock sl(scanLock);
+            isListed = listed.count(file.getFullPathName()) > 0;
+        }
+
+        // A listed file is left alone while its size and date match what the database holds
+        Track stored;
+        if (isListed && database.lookup(file, stored))
+        {
+            unchanged.add(file.getFullPathName());
+            continue;
+        }
+
+        if (isListed)
+            rewritten.push_back(database.getTrack(file));
+        else
+            tracks.push_back(database.getTrack(file));
+
+        // MP3 seek indexes are built now, in the background, rather than when a deck first loads the file
+        if (SeekIndex::needsIndex(file))
+        {
+            jobScheduler.addJob(file, JobScheduler::Priority::Analysis, jobGroup, [file](const std::atomic<bool>& indexShouldStop) {
+                SeekIndex::buildIndexFor(file, indexShouldStop);
+            });
+        }
+    }
+
+    const juce::ScopedLock sl(scanLock);
+
+    if (jobGeneration != generation)
+        return;
+
+    scanned.insert(scanned.end(), std::make_move_iterator(tracks.begin()), std::make_move_iterator(tracks.end()));
+    changed.insert(changed.end(), std::make_move_iterator(rewritten.begin()), std::make_move_iterator(rewritten.end()));
+
+    for (const auto& path : unchanged)
+        inFlight.erase(path);
+
+    numScanned += files.size();
+}
+
+void LibraryScanner::timerCallback()
+{
+    std::vector<Track> batch, changedBatch;
+    std::set<juce::String> gone;
+    bool finished = false;
+
+    {
+        const juce::ScopedLock sl(scanLock);
+        batch.swap(scanned);
+        changedBatch.swap(changed);
+        gone.swap(missing);
+
+        for (const auto& track : batch)
+            inFlight.erase(track.getFilePath());
+
+        for (const auto& track : changedBatch)
+            inFlight.erase(track.getFilePath());
+
+        finished = outstandingJobs == 0;
+    }
+
+    if (!gone.empty() && onFilesMissing)
+        onFilesMissing(gone);
+
+    if (!changedBatch.empty() && onTracksChanged)
+        onTracksChanged(std::move(changedBatch));
+
+    if (!batch.empty() && onTracksScanned)
+        onTracksScanned(std::move(batch));
+
+    if (onProgress)
+        onProgress(numScanned.load(), numFound.load());
+
+    if (finished)
+    {
+        stopTimer();
+
+        if (onScanFinished)
+            onScanFinished(true);
+    }
+}
@@ -0,0 +1,81 @@
+#pragma once
+#include <JuceHeader.h>
+#include "Track.h"
+#include "JobScheduler.h"
+#include "LibraryDatabase.h"
+#include <atomic>
+#include <functional>
+#include <set>
+#include <vector>
+
+// Imports folders and files into a playlist without blocking the UI. Each
+// directory is listed by its own job on the shared scheduler, so folders on
+// different drives are walked side by side, and metadata is read on the pool
+// in small groups of files; files the library database already holds, at the
+// same size and date, come from there without being opened. Finished tracks are collected and handed over on
+// the message thread a few times a second, one batch per hand-over. Files the
+// owner already lists are only read again when their size or date has moved,
+// and listed files that a scanned folder no longer holds are reported, so
+// scanning a folder again brings the list up to date.
+class LibraryScanner : private juce::Timer
+{
+public:
+    static constexpr int filesPerJob = 16;
+    static constexpr int deliveryIntervalMs = 100;
+
+    LibraryScanner(JobScheduler& jobScheduler, LibraryDatabase& database);
+    ~LibraryScanner() override;
+
+    // Message thread. alreadyListed holds the full paths the owner already has.
+    void scanDirectory(const juce::File& directory, const std::set<juce::String>& alreadyListed);
+    void scanFiles(const juce::Array<juce::File>& files, const std::set<juce::String>& alreadyListed);
+    void cancel();
+
+    bool isScanning() const { return isTimerRunning(); }
+    int getNumFound() const { return numFound.load(); }
+    int getNumScanned() const { return numScanned.load(); }
+
+    // Called on worker threads to pick the files worth reading
+    std::function<bool(const juce::File&)> fileFilter;
+
+    // Message thread
+    std::function<void(std::vector<Track>&&)> onTracksScanned;  // not listed before
+    std::function<void(std::vector<Track>&&)> onTracksChanged;  // listed, rewritten since
+    std::function<void(const std::set<juce::String>&)> onFilesMissing;  // listed, gone from disk
+    std::function<void(int scanned, int found)> onProgress;
+    std::function<void(bool completed)> onScanFinished;
+
+private:
+    JobScheduler& jobScheduler;
+    LibraryDatabase& database;
+    const juce::String jobGroup { juce::Uuid().toString() };
+
+    // Shared with the jobs; the generation moves on when a scan is cancelled,
+    // and work from an older generation is dropped
+    juce::CriticalSection scanLock;
+    int generation = 0;
+    int outstandingJobs = 0;
+    std::set<juce::String> listed;              // already in the owner's list
+    std::set<juce::String> inFlight;            // queued or read, not yet handed over
+    std::set<juce::String> visitedDirectories;  // resolved paths, so linked folders can't loop
+    std::vector<Track> scanned;
+    std::vector<Track> changed;
+    std::set<juce::String> missing;
+
+    std::atomic<int> numFound { 0 };
+    std::atomic<int> numScanned { 0 };
+
+    int start(const std::set<juce::String>& alreadyListed);
+    bool stop();
+    void addScanJob(int jobGeneration, const juce::File& file, JobScheduler::Job work);
+    void finishJob(int jobGeneration);
+    void queueDirectory(int jobGeneration, const juce::File& directory);
+    void queueFiles(int jobGeneration, const juce::Array<juce::File>& files);
+    void findMissing(int jobGeneration, const juce::File& directory, const juce::Array<juce::File>& children);
+    void listDirectory(int jobGeneration, const juce::File& directory, const std::atomic<bool>& shouldStop);
+    void readTracks(int jobGeneration, const juce::Array<juce::File>& files, const std::atomic<bool>& shouldStop);
+
+    void timerCallback() override;
+
+    JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR(LibraryScanner)
+};
@@ -0,0 +1,178 @@
+#include "MasterFilter.h"
+#include <cmath>
+
+namespace
+{
+    // Knob travel treated as the centre detent, and the travel over which the
+    // filtered signal fades in past it
+    constexpr float detentWidth = 0.02f;
+    constexpr float fadeInWidth = 0.08f;
+
+    constexpr double minCutoff = 20.0;
+    constexpr double maxCutoff = 20000.0;
+    constexpr double knobSmoothingSeconds = 0.05;
+    constexpr int segmentSize = 32;
+}
+
+MasterFilter::MasterFilter()
+{
+    prepareToPlay(512, 44100.0);
+}
+
+void MasterFilter::prepareToPlay(int /*samplesPerBlockExpected*/, double sampleRate)
+{
+    currentSampleRate = sampleRate;
+    position.reset(sampleRate, knobSmoothingSeconds);
+    position.setCurrentAndTargetValue(targetPosition.load());
+    reset();
+}
+
+void MasterFilter::reset()
+{
+    s1[0] = s1[1] = 0.0f;
+    s2[0] = s2[1] = 0.0f;
+
+    float knob = position.getCurrentValue();
+    currentIsHighPass = knob > 0.0f;
+    currentG = getCoefficientForPosition(knob);
+    currentWet = getWetForPosition(knob);
+}
+
+void MasterFilter::setPosition(float newPosition)
+{
+    targetPosition = juce::jlimit(-1.0f, 1.0f, newPosition);
+}
+
+void MasterFilter::setResonance(float newResonance)
+{
+    resonance = juce::jlimit(0.0f, 1.0f, newResonance);
+}
+
+void MasterFilter::process(juce::AudioBuffer<float>& buffer, int startSample, int numSamples)
+{
+    float target = targetPosition.load();
+    position.setTargetValue(target);
+
+    // Centre detent: nothing to do once the knob has settled there
+    if (!active)
+    {
+        if (std::abs(target) <= detentWidth && !position.isSmoothing())
+            return;
+
+        active = true;
+        reset();
+    }
+
+    if (numSamples <= 0 || buffer.getNumChannels() == 0)
+        return;
+
+    auto* left = buffer.getWritePointer(0, startSample);
+    auto* right = buffer.getNumChannels() > 1 ? buffer.getWritePointer(1, startSample) : nullptr;
+
+    for (int offset = 0; offset < numSamples; offset += segmentSize)
+    {
+        processSegment(left + offset, right != nullptr ? right + offset : nullptr,
+                       juce::jmin(segmentSize, numSamples - offset));
+    }
+
+    // Settled back on the detent: drop out until the knob moves again
+    if (std::abs(position.getCurrentValue()) <= detentWidth && !position.isSmoothing())
+        active = false;
+}
+
+void MasterFilter::processSegment(float* left, float* right, int numSamples)
+{
+    position.skip(numSamples);
+    float knob = position.getCurrentValue();
+    bool isHighPass = knob > 0.0f;
+    float endG = getCoefficientForPosition(knob);
+    float endWet = getWetForPosition(knob);
+
+    // Crossing the centre swaps the response. The old one fades all the way out
+    // first; once its wet level is zero the new one starts from the end of its travel.
+    if (isHighPass != currentIsHighPass)
+    {
+        if (currentWet > 0.0f)
+        {
+            isHighPass = currentIsHighPass;
+            endG = currentG;
+            endWet = 0.0f;
+        }
+        else
+        {
+            currentIsHighPass = isHighPass;
+            currentG = getCoefficientForPosition(isHighPass ? detentWidth : -detentWidth);
+            s1[0] = s1[1] = 0.0f;
+            s2[0] = s2[1] = 0.0f;
+        }
+    }
+
+    float gStep = (endG - currentG) / static_cast<float>(numSamples);
+    float wetStep = (endWet - currentWet) / static_cast<float>(numSamples);
+
+    // Resonance 0..1 maps to a Q of roughly 0.5..5
+    float k = 2.0f - 1.8f * resonance.load();
+
+    float g = currentG;
+    float wet = currentWet;
+    float l1 = s1[0], l2 = s2[0];
+    float r1 = s1[1], r2 = s2[1];
+
+    // Both channels share the coefficients, so they run side by side in one pass
+    for (int i = 0; i < numSamples; ++i)
+    {
+        g += gStep;
+        wet += wetStep;
+
+        float a1 = 1.0f / (1.0f + g * (g + k));
+        float a2 = g * a1;
+        float a3 = g * a2;
+
+        {
+            float x = left[i];
+            float v3 = x - l2;
+            float v1 = a1 * l1 + a2 * v3;
+            float v2 = l2 + a2 * l1 + a3 * v3;
+            l1 = 2.0f * v1 - l1;
+            l2 = 2.0f * v2 - l2;
+
+            float filtered = isHighPass ? x - k * v1 - v2 : v2;
+            left[i] = x + wet * (filtered - x);
+        }
+
+        if (right != nullptr)
+        {
+            float x = right[i];
+            float v3 = x - r2;
+            float v1 = a1 * r1 + a2 * v3;
+            float v2 = r2 + a2 * r1 + a3 * v3;
+            r1 = 2.0f * v1 - r1;
+            r2 = 2.0f * v2 - r2;
+
+            float filtered = isHighPass ? x - k * v1 - v2 : v2;
+            right[i] = x + wet * (filtered - x);
+        }
+    }
+
+    s1[0] = l1; s2[0] = l2;
+    s1[1] = r1; s2[1] = r2;
+    currentG = endG;
+    currentWet = endWet;
+}
+
+float MasterFilter::getCoefficientForPosition(float knob) const
+{
+    // Exponential sweep so the knob feels even across the octaves
+    double depth = juce::jlimit(0.0, 1.0, (std::abs(knob) - detentWidth) / (1.0 - detentWidth));
+    double range = maxCutoff / minCutoff;
+    double cutoff = knob > 0.0f ? minCutoff * std::pow(range, depth)
+                                : maxCutoff / std::pow(range, depth);
+
+    cutoff = juce::jmin(cutoff, currentSampleRate * 0.45);
+    return static_cast<float>(std::tan(juce::MathConstants<double>::pi * cutoff / currentSampleRate));
+}
+
+float MasterFilter::getWetForPosition(float knob)
+{
+    return juce::jlimit(0.0f, 1.0f, (std::abs(knob) - detentWidth) / fadeInWidth);
+}
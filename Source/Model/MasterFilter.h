@@ -0,0 +1,49 @@
+#pragma once
+#include <JuceHeader.h>
+#include <atomic>
+
+// One-knob DJ filter for the master bus. Left of centre sweeps a low-pass
+// down, right of centre sweeps a high-pass up. The knob is smoothed and the
+// state-variable filter coefficient is interpolated per sample, so fast sweeps
+// do not zipper. Around the centre detent the filter is not run at all.
+// Blocks are worked through in short segments, and a sweep across the centre
+// fades the old response out completely before the other one takes over.
+class MasterFilter
+{
+public:
+    MasterFilter();
+
+    void prepareToPlay(int samplesPerBlockExpected, double sampleRate);
+    void reset();
+
+    // Audio thread: processes the first two channels of the region in place
+    void process(juce::AudioBuffer<float>& buffer, int startSample, int numSamples);
+
+    // Control (any thread)
+    void setPosition(float newPosition);      // -1.0 low-pass, 0.0 bypass, 1.0 high-pass
+    float getPosition() const { return targetPosition.load(); }
+    void setResonance(float newResonance);    // 0.0 gentle to 1.0 peaky
+
+private:
+    std::atomic<float> targetPosition { 0.0f };
+    std::atomic<float> resonance { 0.3f };
+
+    double currentSampleRate = 44100.0;
+    juce::SmoothedValue<float> position;
+
+    // Per-block endpoints, interpolated across the samples in between
+    float currentG = 0.0f;
+    float currentWet = 0.0f;
+    bool currentIsHighPass = false;
+    bool active = false;
+
+    // TPT state-variable integrator state, per channel
+    float s1[2] = { 0.0f, 0.0f };
+    float s2[2] = { 0.0f, 0.0f };
+
+    void processSegment(float* left, float* right, int numSamples);
+    float getCoefficientForPosition(float knob) const;
+    static float getWetForPosition(float knob);
+
+    JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR(MasterFilter)
+};
@@ -0,0 +1,337 @@
+#include "MasterLimiter.h"
+#include <cmath>
+
+MasterLimiter::MasterLimiter()
+{
+    designInterpolator();
+    prepareToPlay(512, 44100.0);
+}
+
+void MasterLimiter::prepareToPlay(int samplesPerBlockExpected, double sampleRate)
+{
+    currentSampleRate = sampleRate;
+
+    // 1.5 ms of lookahead is enough for the attack to stay inaudible on transients
+    lookaheadSamples = juce::jmax(1, juce::roundToInt(sampleRate * 0.0015));
+    latencySamples = lookaheadSamples + truePeakDelay;
+
+    int blockSize = juce::jmax(1, samplesPerBlockExpected);
+    delayBuffer.setSize(2, latencySamples + 1);
+    primeBuffer.setSize(2, latencySamples);
+    peakBuffer.assign(static_cast<size_t>(blockSize), 0.0f);
+    gainBuffer.assign(static_cast<size_t>(blockSize), 1.0f);
+    minValues.assign(static_cast<size_t>(lookaheadSamples + 2), 1.0f);
+    minIndices.assign(static_cast<size_t>(lookaheadSamples + 2), 0);
+    boxHistory.assign(static_cast<size_t>(lookaheadSamples), 1.0f);
+
+    // Switching in or out fades over 10 ms
+    mixStep = static_cast<float>(1.0 / juce::jmax(1.0, sampleRate * 0.01));
+    limitedMix = enabled.load() ? 1.0f : 0.0f;
+
+    reset();
+}
+
+void MasterLimiter::reset()
+{
+    delayBuffer.clear();
+    delayWritePosition = 0;
+    resetDetector();
+}
+
+void MasterLimiter::resetDetector()
+{
+    for (auto& channelHistory : peakHistory)
+        std::fill(std::begin(channelHistory), std::end(channelHistory), 0.0f);
+    historyPosition = 0;
+
+    minFront = 0;
+    minSize = 0;
+    sampleCounter = 0;
+
+    releaseEnvelope = 1.0f;
+    std::fill(boxHistory.begin(), boxHistory.end(), 1.0f);
+    boxPosition = 0;
+    boxSum = static_cast<double>(boxHistory.size());
+
+    gainReductionDb = 0.0f;
+}
+
+void MasterLimiter::setCeiling(double ceilingDb)
+{
+    ceilingGain = juce::Decibels::decibelsToGain(static_cast<float>(juce::jlimit(-12.0, 0.0, ceilingDb)));
+}
+
+void MasterLimiter::setRelease(double newReleaseMs)
+{
+    releaseMs = juce::jlimit(1.0, 1000.0, newReleaseMs);
+}
+
+void MasterLimiter::process(juce::AudioBuffer<float>& buffer, int startSample, int numSamples)
+{
+    if (numSamples <= 0 || buffer.getNumChannels() == 0)
+        return;
+
+    bool isOn = enabled.load();
+    auto* left = buffer.getWritePointer(0, startSample);
+    auto* right = buffer.getNumChannels() > 1 ? buffer.getWritePointer(1, startSample) : left;
+    int chunkSize = static_cast<int>(peakBuffer.size());
+
+    for (int offset = 0; offset < numSamples; offset += chunkSize)
+        processChunk(left + offset, right + offset, juce::jmin(chunkSize, numSamples - offset), isOn);
+}
+
+void MasterLimiter::processChunk(float* left, float* right, int numSamples, bool isOn)
+{
+    // Fully bypassed: only the delay, so the latency (and the cue bus alignment) stays put
+    if (!isOn && limitedMix <= 0.0f)
+    {
+        delayOnly(left, right, numSamples);
+        gainReductionDb = 0.0f;
+        return;
+    }
+
+    // Switched back in: the detector catches up on what is waiting in the delay line
+    if (isOn && limitedMix <= 0.0f)
+        primeDetector();
+
+    detectPeaks(left, right, numSamples);
+    computeGains(numSamples);
+
+    // Delay the audio by the lookahead and apply the gain curve
+    int delaySize = delayBuffer.getNumSamples();
+    auto* delayLeft = delayBuffer.getWritePointer(0);
+    auto* delayRight = delayBuffer.getWritePointer(1);
+    bool isStereo = right != left;
+    bool wasLimiting = limitedMix > 0.0f;
+    float targetMix = isOn ? 1.0f : 0.0f;
+    float minGain = 1.0f;
+
+    for (int i = 0; i < numSamples; ++i)
+    {
+        if (limitedMix != targetMix)
+            limitedMix = isOn ? juce::jmin(1.0f, limitedMix + mixStep) : juce::jmax(0.0f, limitedMix - mixStep);
+
+        float inLeft = left[i];
+        float inRight = right[i];
+
+        int readPosition = delayWritePosition + 1;
+        if (readPosition >= delaySize)
+            readPosition -= delaySize;
+
+        float gain = 1.0f + limitedMix * (gainBuffer[static_cast<size_t>(i)] - 1.0f);
+        left[i] = delayLeft[readPosition] * gain;
+        if (isStereo)
+            right[i] = delayRight[readPosition] * gain;
+
+        delayLeft[delayWritePosition] = inLeft;
+        delayRight[delayWritePosition] = inRight;
+        delayWritePosition = readPosition;
+
+        minGain = juce::jmin(minGain, gain);
+    }
+
+    if (!wasLimiting && limitedMix <= 0.0f)
+    {
+        gainReductionDb = 0.0f;
+        return;
+    }
+
+    // Safety net for anything the estimator missed
+    float ceiling = ceilingGain.load();
+    juce::FloatVectorOperations::clip(left, left, -ceiling, ceiling, numSamples);
+    if (isStereo)
+        juce::FloatVectorOperations::clip(right, right, -ceiling, ceiling, numSamples);
+
+    gainReductionDb = juce::Decibels::gainToDecibels(minGain);
+}
+
+void MasterLimiter::delayOnly(float* left, float* right, int numSamples)
+{
+    int delaySize = delayBuffer.getNumSamples();
+    auto* delayLeft = delayBuffer.getWritePointer(0);
+    auto* delayRight = delayBuffer.getWritePointer(1);
+    bool isStereo = right != left;
+
+    for (int i = 0; i < numSamples; ++i)
+    {
+        float inLeft = left[i];
+        float inRight = right[i];
+
+        int readPosition = delayWritePosition + 1;
+        if (readPosition >= delaySize)
+            readPosition -= delaySize;
+
+        left[i] = delayLeft[readPosition];
+        if (isStereo)
+            right[i] = delayRight[readPosition];
+
+        delayLeft[delayWritePosition] = inLeft;
+        delayRight[delayWritePosition] = inRight;
+        delayWritePosition = readPosition;
+    }
+}
+
+void MasterLimiter::primeDetector()
+{
+    // The delay line holds the last latencySamples of input, oldest just after the
+    // write position; that covers the peak filter's history and the lookahead window
+    resetDetector();
+
+    int delaySize = delayBuffer.getNumSamples();
+    for (int channel = 0; channel < 2; ++channel)
+    {
+        auto* delayed = delayBuffer.getReadPointer(channel);
+        auto* ordered = primeBuffer.getWritePointer(channel);
+        int position = delayWritePosition;
+
+        for (int i = 0; i < latencySamples; ++i)
+        {
+            if (++position >= delaySize)
+                position = 0;
+            ordered[i] = delayed[position];
+        }
+    }
+
+    // The gains themselves belong to audio that already went out dry
+    int chunkSize = static_cast<int>(peakBuffer.size());
+    for (int offset = 0; offset < latencySamples; offset += chunkSize)
+    {
+        int length = juce::jmin(chunkSize, latencySamples - offset);
+        detectPeaks(primeBuffer.getReadPointer(0, offset), primeBuffer.getReadPointer(1, offset), length);
+        computeGains(length);
+    }
+}
+
+void MasterLimiter::designInterpolator()
+{
+    // Hann-windowed sinc lowpass at the original Nyquist, split into polyphase branches.
+    // Phase 0 is the original sample itself, so only the three in-between phases are kept.
+    const int numTaps = oversampling * tapsPerPhase;
+    const double centre = (numTaps - 1) * 0.5;
+
+    for (int phase = 1; phase < oversampling; ++phase)
+    {
+        for (int tap = 0; tap < tapsPerPhase; ++tap)
+        {
+            int n = tap * oversampling + phase;
+            double x = (n - centre) / oversampling;
+            double sinc = std::abs(x) < 1.0e-9 ? 1.0 : std::sin(juce::MathConstants<double>::pi * x) / (juce::MathConstants<double>::pi * x);
+            double window = 0.5 - 0.5 * std::cos(juce::MathConstants<double>::twoPi * n / (numTaps - 1));
+            phaseCoefficients[phase - 1][tap] = static_cast<float>(sinc * window);
+        }
+    }
+}
+
+void MasterLimiter::detectPeaks(const float* left, const float* right, int numSamples)
+{
+    // peakBuffer[i] describes the signal truePeakDelay samples before input i,
+    // which is where the interpolated points sit
+    for (int i = 0; i < numSamples; ++i)
+    {
+        peakHistory[0][historyPosition] = left[i];
+        peakHistory[1][historyPosition] = right[i];
+
+        int centreIndex = historyPosition - truePeakDelay;
+        if (centreIndex < 0)
+            centreIndex += tapsPerPhase;
+
+        float peak = juce::jmax(std::abs(peakHistory[0][centreIndex]), std::abs(peakHistory[1][centreIndex]));
+
+        for (int phase = 0; phase < oversampling - 1; ++phase)
+        {
+            const float* coefficients = phaseCoefficients[phase];
+            float sumLeft = 0.0f;
+            float sumRight = 0.0f;
+            int index = historyPosition;
+
+            for (int tap = 0; tap < tapsPerPhase; ++tap)
+            {
+                sumLeft += coefficients[tap] * peakHistory[0][index];
+                sumRight += coefficients[tap] * peakHistory[1][index];
+
+                if (--index < 0)
+                    index = tapsPerPhase - 1;
+            }
+
+            peak = juce::jmax(peak, std::abs(sumLeft), std::abs(sumRight));
+        }
+
+        peakBuffer[static_cast<size_t>(i)] = peak;
+
+        if (++historyPosition >= tapsPerPhase)
+            historyPosition = 0;
+    }
+}
+
+void MasterLimiter::computeGains(int numSamples)
+{
+    float ceiling = ceilingGain.load();
+    float* peaks = peakBuffer.data();
+    float* gains = gainBuffer.data();
+
+    // Gain computer: straight-line arithmetic over the block so it vectorises
+    for (int i = 0; i < numSamples; ++i)
+        gains[i] = juce::jmin(1.0f, ceiling / juce::jmax(peaks[i], 1.0e-9f));
+
+    float releaseCoefficient = static_cast<float>(1.0 - std::exp(-1000.0 / (releaseMs.load() * currentSampleRate)));
+    int boxLength = static_cast<int>(boxHistory.size());
+    double boxScale = 1.0 / boxLength;
+
+    for (int i = 0; i < numSamples; ++i)
+    {
+        float held = slidingMinimum(gains[i]);
+
+        // Instant attack into the box smoother, exponential release out of it
+        if (held < releaseEnvelope)
+            releaseEnvelope = held;
+        else
+            releaseEnvelope += (held - releaseEnvelope) * releaseCoefficient;
+
+        boxSum += releaseEnvelope - boxHistory[static_cast<size_t>(boxPosition)];
+        boxHistory[static_cast<size_t>(boxPosition)] = releaseEnvelope;
+        if (++boxPosition >= boxLength)
+            boxPosition = 0;
+
+        gains[i] = static_cast<float>(boxSum * boxScale);
+    }
+
+    // Re-sum occasionally so floating point error in the running sum cannot build up
+    if ((sampleCounter & 0xffff) < numSamples)
+    {
+        boxSum = 0.0;
+        for (auto value : boxHistory)
+            boxSum += value;
+    }
+}
+
+float MasterLimiter::slidingMinimum(float value)
+{
+    // One more than the box length, so every box position that overlaps a
+    // peak's output time already holds that peak's gain
+    int capacity = static_cast<int>(minValues.size());
+    int windowSize = lookaheadSamples + 1;
+
+    // Drop values that can never be the minimum again
+    while (minSize > 0)
+    {
+        int back = (minFront + minSize - 1) % capacity;
+        if (minValues[static_cast<size_t>(back)] < value)
+            break;
+        --minSize;
+    }
+
+    int insert = (minFront + minSize) % capacity;
+    minValues[static_cast<size_t>(insert)] = value;
+    minIndices[static_cast<size_t>(insert)] = sampleCounter;
+    ++minSize;
+
+    // Expire values that have left the window
+    while (minIndices[static_cast<size_t>(minFront)] <= sampleCounter - windowSize)
+    {
+        minFront = (minFront + 1) % capacity;
+        --minSize;
+    }
+
+    ++sampleCounter;
+    return minValues[static_cast<size_t>(minFront)];
+}
@@ -0,0 +1,91 @@
+#pragma once
+#include <JuceHeader.h>
+#include <atomic>
+#include <vector>
+
+// Lookahead brickwall limiter for the master bus.
+// Peaks are detected on a 4x oversampled estimate so inter-sample overs are
+// caught, the required gain is held over the lookahead window with a sliding
+// minimum and then box-smoothed so the gain reaches its target exactly when
+// the delayed peak arrives. Bypassing crossfades to the delayed dry signal,
+// after which only the delay line runs; switching back in primes the
+// detector from the audio already in the delay line. Either way the limiter
+// neither drops audio nor jumps in time.
+class MasterLimiter
+{
+public:
+    MasterLimiter();
+
+    void prepareToPlay(int samplesPerBlockExpected, double sampleRate);
+    void reset();
+
+    // Processes the first two channels of the region in place. While
+    // bypassed the audio is only delayed, by the same latency.
+    void process(juce::AudioBuffer<float>& buffer, int startSample, int numSamples);
+
+    // Control (message thread)
+    void setEnabled(bool shouldBeEnabled) { enabled = shouldBeEnabled; }
+    bool isEnabled() const { return enabled.load(); }
+    void setCeiling(double ceilingDb); // -12.0 to 0.0 dBTP
+    void setRelease(double releaseMs);
+
+    // Added delay in samples, the same whether enabled or bypassed
+    int getLatencySamples() const { return latencySamples; }
+
+    // Deepest gain reduction of the last processed block, in dB (<= 0)
+    float getGainReductionDb() const { return gainReductionDb.load(); }
+
+private:
+    static constexpr int oversampling = 4;
+    static constexpr int tapsPerPhase = 12;
+    static constexpr int truePeakDelay = tapsPerPhase / 2;
+
+    std::atomic<bool> enabled { true };
+    std::atomic<float> ceilingGain { 0.891f }; // -1 dBTP
+    std::atomic<double> releaseMs { 80.0 };
+    std::atomic<float> gainReductionDb { 0.0f };
+
+    double currentSampleRate = 44100.0;
+    int lookaheadSamples = 64;
+    int latencySamples = 64 + truePeakDelay;
+    float limitedMix = 1.0f; // 0 = bypassed, 1 = limiting; ramps when switched
+    float mixStep = 0.001f;
+
+    // Polyphase interpolation filter for inter-sample peaks
+    float phaseCoefficients[oversampling - 1][tapsPerPhase];
+    float peakHistory[2][tapsPerPhase];
+    int historyPosition = 0;
+
+    // Audio delay line
+    juce::AudioBuffer<float> delayBuffer;
+    int delayWritePosition = 0;
+    juce::AudioBuffer<float> primeBuffer; // the delay line in time order, for priming
+
+    // Per-block work buffers; longer blocks are processed in pieces this size
+    std::vector<float> peakBuffer;
+    std::vector<float> gainBuffer;
+
+    // Sliding minimum over the lookahead window
+    std::vector<float> minValues;
+    std::vector<juce::int64> minIndices;
+    int minFront = 0;
+    int minSize = 0;
+    juce::int64 sampleCounter = 0;
+
+    // Release envelope and box smoother
+    float releaseEnvelope = 1.0f;
+    std::vector<float> boxHistory;
+    int boxPosition = 0;
+    double boxSum = 0.0;
+
+    void designInterpolator();
+    void processChunk(float* left, float* right, int numSamples, bool isOn);
+    void delayOnly(float* left, float* right, int numSamples);
+    void resetDetector();
+    void primeDetector();
+    void detectPeaks(const float* left, const float* right, int numSamples);
+    void computeGains(int numSamples);
+    float slidingMinimum(float value);
+
+    JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR(MasterLimiter)
+};
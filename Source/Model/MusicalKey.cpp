@@ -0,0 +1,88 @@
+#include "MusicalKey.h"
+#include <cstdlib>
+
+namespace
+{
+    // Majors sit a fifth apart round the wheel with C at 8; a minor shares its relative major's number
+    int getCamelotNumber(int pitchClass, bool isMajor)
+    {
+        auto majorPitch = isMajor ? pitchClass : (pitchClass + 3) % 12;
+        return (majorPitch * 7 % 12 + 7) % 12 + 1;
+    }
+}
+
+MusicalKey::Camelot MusicalKey::parse(const juce::String& text)
+{
+    auto key = text.trim().toLowerCase().removeCharacters(" ");
+    Camelot camelot;
+
+    if (key.isEmpty())
+        return camelot;
+
+    // Camelot or Open Key: a number and a letter
+    if (juce::CharacterFunctions::isDigit(key[0]))
+    {
+        auto number = key.getIntValue();
+        auto letter = key.getLastCharacter();
+
+        if (number < 1 || number > 12 || !key.dropLastCharacters(1).containsOnly("0123456789"))
+            return camelot;
+
+        if (letter == 'a' || letter == 'b')
+        {
+            camelot.number = number;
+            camelot.isMajor = letter == 'b';
+        }
+        else if (letter == 'm' || letter == 'd')
+        {
+            // Open Key starts its wheel at C major = 1d, which Camelot calls 8B
+            camelot.number = (number + 6) % 12 + 1;
+            camelot.isMajor = letter == 'd';
+        }
+
+        return camelot;
+    }
+
+    static const int naturalPitches[] = { 9, 11, 0, 2, 4, 5, 7 }; // a to g
+
+    auto root = key[0];
+    if (root < 'a' || root > 'g')
+        return camelot;
+
+    auto pitchClass = naturalPitches[root - 'a'];
+    auto rest = key.substring(1);
+
+    if (rest[0] == '#' || rest[0] == 0x266f) // sharp sign
+    {
+        pitchClass = (pitchClass + 1) % 12;
+        rest = rest.substring(1);
+    }
+    else if (rest[0] == 'b' || rest[0] == 0x266d) // flat sign
+    {
+        pitchClass = (pitchClass + 11) % 12;
+        rest = rest.substring(1);
+    }
+
+    bool isMinor = rest == "m" || rest == "min" || rest == "minor";
+    bool isMajor = rest.isEmpty() || rest == "maj" || rest == "major";
+
+    if (isMinor || isMajor)
+    {
+        camelot.number = getCamelotNumber(pitchClass, isMajor);
+        camelot.isMajor = isMajor;
+    }
+
+    return camelot;
+}
+
+bool MusicalKey::areCompatible(Camelot a, Camelot b)
+{
+    if (!a.isValid() || !b.isValid())
+        return false;
+
+    if (a.isMajor != b.isMajor)
+        return a.number == b.number;
+
+    auto steps = std::abs(a.number - b.number);
+    return steps == 0 || steps == 1 || steps == 11;
+}
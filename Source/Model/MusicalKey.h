@@ -0,0 +1,24 @@
+#pragma once
+#include <JuceHeader.h>
+
+// Musical keys as places on the Camelot wheel, where neighbouring keys mix
+// well. Reads the ways keys are usually tagged: Camelot ("8A"), Open Key
+// ("1m") and note names ("Am", "A minor", "F#", "Bbmaj").
+class MusicalKey
+{
+public:
+    // 1-12 with A for minor keys, B for major ones; 0 when the text isn't a key
+    struct Camelot
+    {
+        int number = 0;
+        bool isMajor = false;
+
+        bool isValid() const { return number > 0; }
+        juce::String toString() const { return isValid() ? juce::String(number) + (isMajor ? "B" : "A") : juce::String(); }
+    };
+
+    static Camelot parse(const juce::String& text);
+
+    // The same key, a step either way round the wheel, or its relative major or minor
+    static bool areCompatible(Camelot a, Camelot b);
+};
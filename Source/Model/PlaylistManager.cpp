@@ -1,9 +1,48 @@
 #include "PlaylistManager.h"
 #include <algorithm>
+#include <map>
+#include <numeric>
 #include <random>
 
-PlaylistManager::PlaylistManager()
+PlaylistManager::PlaylistManager(JobScheduler& jobScheduler, LibraryDatabase& libraryDatabase)
+    : database(libraryDatabase), scanner(jobScheduler, libraryDatabase)
 {
+    scanner.fileFilter = [](const juce::File& file) { return isAudioFile(file); };
+    
+    scanner.onTracksScanned = [this](std::vector<Track>&& scannedTracks) {
+        addTracks(scannedTracks);
+    };
+    
+    scanner.onTracksChanged = [this](std::vector<Track>&& changedTracks) {
+        replaceChangedTracks(std::move(changedTracks));
+    };
+    
+    scanner.onFilesMissing = [this](const std::set<juce::String>& missingPaths) {
+        removeTracksWhere([&missingPaths](const juce::File& file) { return missingPaths.count(file.getFullPathName()) > 0; });
+    };
+    
+    scanner.onProgress = [this](int scanned, int found) {
+        if (onImportProgress)
+            onImportProgress(scanned, found);
+    };
+    
+    scanner.onScanFinished = [this](bool completed) {
+        database.saveIfChanged();
+        
+        if (onImportFinished)
+            onImportFinished(completed);
+    };
+    
+    watcher.fileFilter = [](const juce::File& file) { return isAudioFile(file); };
+    
+    watcher.onChanges = [this](const FolderWatcher::Changes& changes) {
+        applyFolderChanges(changes);
+    };
+    
+    smartPlaylists.onMembersChanged = [this](int index) {
+        if (onSmartPlaylistChanged)
+            onSmartPlaylistChanged(index);
+    };
 }
 
 PlaylistManager::~PlaylistManager()
@@ -14,23 +53,22 @@ void PlaylistManager::addTrack(const Track& track)
 {
     if (track.isValid())
     {
-        tracks.push_back(track);
-        int index = static_cast<int>(tracks.size() - 1);
-        
-        if (onTrackAdded)
-            onTrackAdded(index);
-        
+        appendTrack(track);
         notifyPlaylistChanged();
     }
 }
 
 void PlaylistManager::addTracks(const std::vector<Track>& newTracks)
 {
-    for (const auto& track : newTracks)
     {
-        if (track.isValid())
+        const juce::ScopedLock sl(trackLock);
+        
+        for (const auto& track : newTracks)
         {
-            tracks.push_back(track);
+            if (track.isValid())
+            {
+                appendTrack(track);
+            }
         }
     }
     notifyPlaylistChanged();
@@ -38,68 +76,155 @@ void PlaylistManager::addTracks(const std::vector<Track>& newTracks)
 
 void PlaylistManager::removeTrack(int index)
 {
-    if (index >= 0 && index < static_cast<int>(tracks.size()))
+    if (index >= 0 && index < tracks.size())
     {
-        tracks.erase(tracks.begin() + index);
-        
-        if (onTrackRemoved)
-            onTrackRemoved(index);
+        {
+            const juce::ScopedLock sl(trackLock);
+            searchIndex.remove(trackIds[static_cast<size_t>(index)]);
+            facetIndex.remove(trackIds[static_cast<size_t>(index)]);
+            smartPlaylists.trackRemoved(trackIds[static_cast<size_t>(index)]);
+            tracks.remove(index);
+            trackIds.erase(trackIds.begin() + index);
+            positionsValid = false;
+        }
         
+        recordChange(Change::Type::Removed, juce::Range<int>::withStartAndLength(index, 1));
         notifyPlaylistChanged();
     }
 }
 
-void PlaylistManager::clearPlaylist()
+void PlaylistManager::updateHotCues(const Track& track)
 {
-    tracks.clear();
+    bool changed = false;
     
-    if (onPlaylistCleared)
-        onPlaylistCleared();
+    {
+        const juce::ScopedLock sl(trackLock);
+        const auto& files = tracks.getFiles();
+        
+        for (int i = 0; i < tracks.size(); ++i)
+        {
+            if (files[static_cast<size_t>(i)] == track.getFile())
+            {
+                tracks.setAnalysis(i, track);
+                recordChange(Change::Type::Updated, juce::Range<int>::withStartAndLength(i, 1));
+                changed = true;
+            }
+        }
+    }
     
-    notifyPlaylistChanged();
+    database.updateAnalysis(track);
+    
+    if (changed)
+        notifyPlaylistChanged();
 }
 
-void PlaylistManager::loadTracksFromDirectory(const juce::File& directory)
+void PlaylistManager::updatePlayCount(const juce::File& file, int playCount)
 {
-    if (!directory.isDirectory())
-        return;
-    
-    auto files = directory.findChildFiles(juce::File::findFiles, true);
+    bool changed = false;
     
-    for (const auto& file : files)
     {
-        if (isAudioFile(file))
+        const juce::ScopedLock sl(trackLock);
+        const auto& files = tracks.getFiles();
+        
+        for (int i = 0; i < tracks.size(); ++i)
         {
-            addTrack(Track(file));
+            if (files[static_cast<size_t>(i)] == file)
+            {
+                tracks.setPlayCount(i, playCount);
+                searchIndex.setPlayCount(trackIds[static_cast<size_t>(i)], playCount);
+                smartPlaylists.trackChanged(trackIds[static_cast<size_t>(i)], tracks.getTrack(i));
+                recordChange(Change::Type::Updated, juce::Range<int>::withStartAndLength(i, 1));
+                changed = true;
+            }
         }
     }
+    
+    // Views show the new count, and smart playlists on play count are filtered again
+    if (changed)
+        notifyPlaylistChanged();
 }
 
-void PlaylistManager::loadTracksFromFiles(const juce::Array<juce::File>& files)
+void PlaylistManager::clearPlaylist()
 {
-    for (const auto& file : files)
     {
-        if (isAudioFile(file))
-        {
-            addTrack(Track(file));
-        }
+        const juce::ScopedLock sl(trackLock);
+        
+        if (tracks.size() > 0)
+            recordChange(Change::Type::Removed, { 0, tracks.size() });
+        
+        tracks.clear();
+        trackIds.clear();
+        searchIndex.clear();
+        facetIndex.clear();
+        smartPlaylists.clearTracks();
+        nextTrackId = 0;
+        positionsValid = false;
+    }
+    
+    notifyPlaylistChanged();
+}
+
+void PlaylistManager::beginChanges()
+{
+    ++batchDepth;
+}
+
+void PlaylistManager::commitChanges()
+{
+    jassert(batchDepth > 0);
+    
+    if (batchDepth > 0 && --batchDepth == 0)
+        notifyPlaylistChanged();
+}
+
+void PlaylistManager::loadTracksFromDirectory(const juce::File& directory)
+{
+    scanner.scanDirectory(directory, getListedPaths());
+    
+    if (directory.isDirectory())
+    {
+        watcher.addFolder(directory);
+        database.addFolder(directory);
     }
 }
 
+void PlaylistManager::loadTracksFromFiles(const juce::Array<juce::File>& files)
+{
+    scanner.scanFiles(files, getListedPaths());
+}
+
+void PlaylistManager::cancelImport()
+{
+    scanner.cancel();
+}
+
 void PlaylistManager::savePlaylist(const juce::File& file)
 {
     juce::XmlElement playlist("Playlist");
     
-    for (const auto& track : tracks)
+    for (int i = 0; i < tracks.size(); ++i)
     {
+        auto track = tracks.getTrack(i);
         auto* trackElement = new juce::XmlElement("Track");
         trackElement->setAttribute("file", track.getFilePath());
         trackElement->setAttribute("title", track.getTitle());
         trackElement->setAttribute("artist", track.getArtist());
         trackElement->setAttribute("album", track.getAlbum());
         trackElement->setAttribute("genre", track.getGenre());
+        trackElement->setAttribute("key", track.getKey());
         trackElement->setAttribute("duration", track.getDuration());
         trackElement->setAttribute("bpm", track.getBPM());
+        trackElement->setAttribute("beatGridOffset", track.getBeatGridOffset());
+        
+        for (int cue = 0; cue < Track::numHotCues; ++cue)
+        {
+            if (track.hasHotCue(cue))
+            {
+                auto* cueElement = trackElement->createNewChildElement("HotCue");
+                cueElement->setAttribute("index", cue);
+                cueElement->setAttribute("position", track.getHotCue(cue));
+            }
+        }
         
         playlist.addChildElement(trackElement);
     }
@@ -113,6 +238,7 @@ void PlaylistManager::loadPlaylist(const juce::File& file)
     if (xml == nullptr)
         return;
     
+    const ScopedChanges changes(*this);
     clearPlaylist();
     
     for (auto* trackElement : xml->getChildWithTagNameIterator("Track"))
@@ -120,7 +246,7 @@ void PlaylistManager::loadPlaylist(const juce::File& file)
         juce::File trackFile(trackElement->getStringAttribute("file"));
         if (trackFile.exists())
         {
-            Track track(trackFile);
+            Track track = database.getTrack(trackFile);
             
             // Override with saved metadata if available
             if (trackElement->hasAttribute("title"))
@@ -131,126 +257,203 @@ void PlaylistManager::loadPlaylist(const juce::File& file)
                 track.setAlbum(trackElement->getStringAttribute("album"));
             if (trackElement->hasAttribute("genre"))
                 track.setGenre(trackElement->getStringAttribute("genre"));
+            if (trackElement->hasAttribute("key"))
+                track.setKey(trackElement->getStringAttribute("key"));
             if (trackElement->hasAttribute("bpm"))
                 track.setBPM(trackElement->getIntAttribute("bpm"));
+            if (trackElement->hasAttribute("beatGridOffset"))
+                track.setBeatGridOffset(trackElement->getDoubleAttribute("beatGridOffset"));
+            
+            for (auto* cueElement : trackElement->getChildWithTagNameIterator("HotCue"))
+                track.setHotCue(cueElement->getIntAttribute("index", -1), cueElement->getDoubleAttribute("position"));
             
             addTrack(track);
         }
     }
 }
 
-const Track* PlaylistManager::getTrack(int index) const
+void PlaylistManager::loadLibrary()
+{
+    addTracks(database.getAllTracks());
+    
+    for (const auto& folder : database.getFolders())
+        watcher.addFolder(folder);
+    
+    holdsLibrary = true;
+    
+    for (const auto& definition : database.getSmartPlaylists())
+        fillSmartPlaylist(smartPlaylists.addPlaylist(SmartPlaylist::fromString(definition)));
+}
+
+std::optional<Track> PlaylistManager::getTrack(int index) const
 {
-    if (index >= 0 && index < static_cast<int>(tracks.size()))
-        return &tracks[index];
-    return nullptr;
+    if (index >= 0 && index < tracks.size())
+        return tracks.getTrack(index);
+    return std::nullopt;
 }
 
-Track* PlaylistManager::getTrack(int index)
+int PlaylistManager::indexOf(const juce::File& file) const
 {
-    if (index >= 0 && index < static_cast<int>(tracks.size()))
-        return &tracks[index];
-    return nullptr;
+    const auto& files = tracks.getFiles();
+    auto found = std::find(files.begin(), files.end(), file);
+    return found != files.end() ? static_cast<int>(found - files.begin()) : -1;
 }
 
 std::vector<int> PlaylistManager::searchTracks(const juce::String& query) const
+{
+    const juce::ScopedLock sl(trackLock);
+    return getPositions(searchIndex.rank(query, searchIndex.search(query)));
+}
+
+std::vector<int> PlaylistManager::searchTracks(const juce::String& query, const std::vector<SortKey>& order, bool ascending,
+                                               const FacetIndex::Selection& facets, SearchState& state,
+                                               const std::atomic<bool>& shouldStop) const
 {
     std::vector<int> results;
-    juce::String lowerQuery = query.toLowerCase();
+    std::vector<SortValues> columns;
     
-    for (int i = 0; i < static_cast<int>(tracks.size()); ++i)
     {
-        const auto& track = tracks[i];
-        if (track.getTitle().toLowerCase().contains(lowerQuery) ||
-            track.getArtist().toLowerCase().contains(lowerQuery) ||
-            track.getAlbum().toLowerCase().contains(lowerQuery) ||
-            track.getFileName().toLowerCase().contains(lowerQuery))
+        // Only matching and copying happen under the lock; the sort runs after it
+        // is released, so changes to the playlist don't wait for it
+        const juce::ScopedLock sl(trackLock);
+        
+        if (state.valid && state.indexVersion == searchIndex.getVersion() && SearchIndex::canRefine(state.query, query))
+            state.matches = searchIndex.refine(state.matches, query);
+        else
+            state.matches = searchIndex.search(query);
+        
+        state.query = query;
+        state.indexVersion = searchIndex.getVersion();
+        state.valid = true;
+        
+        if (shouldStop.load())
+            return {};
+        
+        // With no column to sort by, the best matches come first
+        bool ranked = order.empty() && query.isNotEmpty();
+        auto matches = ranked ? searchIndex.rank(query, state.matches) : state.matches;
+        
+        // Facet picks narrow what was found; the state keeps the matches whole for the next query to refine
+        if (!facets.isEmpty())
         {
-            results.push_back(i);
+            auto allowed = facetIndex.getMatches(facets);
+            matches.erase(std::remove_if(matches.begin(), matches.end(), [&allowed](SearchIndex::DocId id) {
+                return !allowed.contains(id);
+            }), matches.end());
+        }
+        
+        results = getPositions(matches);
+        
+        if (!ranked)
+        {
+            std::sort(results.begin(), results.end());
+            
+            for (const auto& key : order)
+                columns.push_back(copySortValues(results, key));
         }
     }
     
+    if (!columns.empty())
+        sortByValues(results, columns);
+    else if (!ascending)
+        std::reverse(results.begin(), results.end());
+    
     return results;
 }
 
-std::vector<int> PlaylistManager::filterByGenre(const juce::String& genre) const
+std::vector<int> PlaylistManager::getPositions(const std::vector<SearchIndex::DocId>& ids) const
 {
-    std::vector<int> results;
-    
-    for (int i = 0; i < static_cast<int>(tracks.size()); ++i)
+    if (!positionsValid)
     {
-        if (tracks[i].getGenre().equalsIgnoreCase(genre))
-        {
-            results.push_back(i);
-        }
+        positionsById.assign(nextTrackId, -1);
+        
+        for (size_t i = 0; i < trackIds.size(); ++i)
+            positionsById[trackIds[i]] = static_cast<int>(i);
+        
+        positionsValid = true;
     }
     
-    return results;
+    std::vector<int> positions;
+    positions.reserve(ids.size());
+    
+    for (auto id : ids)
+        positions.push_back(positionsById[id]);
+    
+    return positions;
+}
+
+std::vector<int> PlaylistManager::filterByGenre(const juce::String& genre) const
+{
+    return filterByFacet(FacetIndex::Facet::Genre, genre);
 }
 
 std::vector<int> PlaylistManager::filterByArtist(const juce::String& artist) const
 {
-    std::vector<int> results;
-    
-    for (int i = 0; i < static_cast<int>(tracks.size()); ++i)
-    {
-        if (tracks[i].getArtist().equalsIgnoreCase(artist))
-        {
-            results.push_back(i);
-        }
-    }
-    
-    return results;
+    return filterByFacet(FacetIndex::Facet::Artist, artist);
 }
 
 std::vector<int> PlaylistManager::filterByBPMRange(int minBPM, int maxBPM) const
 {
-    std::vector<int> results;
+    if (minBPM > maxBPM)
+        return {};
+    
+    const juce::ScopedLock sl(trackLock);
+    
+    // The BPM buckets in use that the range touches give the candidates; only
+    // those are checked exactly. Going through the buckets that exist keeps a
+    // wide range as cheap as a narrow one.
+    FacetIndex::Selection selection;
+    auto& buckets = selection[FacetIndex::Facet::BPM];
+    auto firstBucket = FacetIndex::getBPMBucket(juce::jmax(1, minBPM));
+    auto lastBucket = FacetIndex::getBPMBucket(maxBPM);
     
-    for (int i = 0; i < static_cast<int>(tracks.size()); ++i)
+    for (auto bucket : facetIndex.getValues(FacetIndex::Facet::BPM))
     {
-        int bpm = tracks[i].getBPM();
-        if (bpm >= minBPM && bpm <= maxBPM)
-        {
-            results.push_back(i);
-        }
+        bool inRange = bucket == 0 ? minBPM <= 0 && maxBPM >= 0
+                                   : bucket >= firstBucket && bucket <= lastBucket;
+        if (inRange)
+            buckets.push_back(bucket);
     }
     
+    if (buckets.empty())
+        return {};
+    
+    auto results = getPositions(facetIndex.getMatches(selection));
+    const auto& bpms = tracks.getBPMs();
+    
+    results.erase(std::remove_if(results.begin(), results.end(), [&bpms, minBPM, maxBPM](int position) {
+        auto bpm = bpms[static_cast<size_t>(position)];
+        return bpm < minBPM || bpm > maxBPM;
+    }), results.end());
+    
     return results;
 }
 
+std::vector<int> PlaylistManager::filterByFacets(const FacetIndex::Selection& selection) const
+{
+    const juce::ScopedLock sl(trackLock);
+    return getPositions(facetIndex.getMatches(selection));
+}
+
+std::vector<FacetIndex::Count> PlaylistManager::getFacetCounts(FacetIndex::Facet facet, const FacetIndex::Selection& selection) const
+{
+    const juce::ScopedLock sl(trackLock);
+    return facetIndex.getCounts(facet, selection);
+}
+
 void PlaylistManager::sortTracks(SortCriteria criteria, bool ascending)
 {
-    std::sort(tracks.begin(), tracks.end(), [criteria, ascending](const Track& a, const Track& b)
-    {
-        bool result = false;
-        
-        switch (criteria)
-        {
-            case SortCriteria::Title:
-                result = a.getTitle().compareIgnoreCase(b.getTitle()) < 0;
-                break;
-            case SortCriteria::Artist:
-                result = a.getArtist().compareIgnoreCase(b.getArtist()) < 0;
-                break;
-            case SortCriteria::Album:
-                result = a.getAlbum().compareIgnoreCase(b.getAlbum()) < 0;
-                break;
-            case SortCriteria::Duration:
-                result = a.getDuration() < b.getDuration();
-                break;
-            case SortCriteria::BPM:
-                result = a.getBPM() < b.getBPM();
-                break;
-            case SortCriteria::DateAdded:
-                // For now, maintain current order for date added
-                result = false;
-                break;
-        }
-        
-        return ascending ? result : !result;
-    });
+    sortTracks({ { criteria, ascending } });
+}
+
+void PlaylistManager::sortTracks(const std::vector<SortKey>& keys)
+{
+    // Entries are sorted as positions, then every column is moved into place in one pass
+    std::vector<int> positions(static_cast<size_t>(tracks.size()));
+    std::iota(positions.begin(), positions.end(), 0);
+    sortPositions(positions, keys);
     
+    applyOrder(std::vector<size_t>(positions.begin(), positions.end()));
     notifyPlaylistChanged();
 }
 
@@ -258,90 +461,516 @@ void PlaylistManager::shufflePlaylist()
 {
     std::random_device rd;
     std::mt19937 g(rd());
-    std::shuffle(tracks.begin(), tracks.end(), g);
+    std::vector<size_t> order(static_cast<size_t>(tracks.size()));
+    std::iota(order.begin(), order.end(), size_t { 0 });
+    std::shuffle(order.begin(), order.end(), g);
+    applyOrder(order);
     notifyPlaylistChanged();
 }
 
 void PlaylistManager::moveTrack(int fromIndex, int toIndex)
 {
-    if (fromIndex >= 0 && fromIndex < static_cast<int>(tracks.size()) &&
-        toIndex >= 0 && toIndex < static_cast<int>(tracks.size()) &&
+    if (fromIndex >= 0 && fromIndex < tracks.size() &&
+        toIndex >= 0 && toIndex < tracks.size() &&
         fromIndex != toIndex)
     {
-        Track track = tracks[fromIndex];
-        tracks.erase(tracks.begin() + fromIndex);
-        tracks.insert(tracks.begin() + toIndex, track);
+        {
+            const juce::ScopedLock sl(trackLock);
+            tracks.move(fromIndex, toIndex);
+            recordChange(Change::Type::Moved, juce::Range<int>::withStartAndLength(fromIndex, 1), toIndex);
+            
+            auto id = trackIds[static_cast<size_t>(fromIndex)];
+            trackIds.erase(trackIds.begin() + fromIndex);
+            trackIds.insert(trackIds.begin() + toIndex, id);
+            positionsValid = false;
+        }
+        
         notifyPlaylistChanged();
     }
 }
 
 double PlaylistManager::getTotalDuration() const
 {
-    double total = 0.0;
-    for (const auto& track : tracks)
-    {
-        total += track.getDuration();
-    }
-    return total;
+    const auto& durations = tracks.getDurations();
+    return std::accumulate(durations.begin(), durations.end(), 0.0);
 }
 
 int PlaylistManager::getAverageBPM() const
 {
-    if (tracks.empty())
-        return 0;
-    
-    int total = 0;
+    juce::int64 total = 0;
     int count = 0;
     
-    for (const auto& track : tracks)
+    for (auto bpm : tracks.getBPMs())
     {
-        if (track.getBPM() > 0)
+        if (bpm > 0)
         {
-            total += track.getBPM();
+            total += bpm;
             count++;
         }
     }
     
-    return count > 0 ? total / count : 0;
+    return count > 0 ? static_cast<int>(total / count) : 0;
+}
+
+int PlaylistManager::addSmartPlaylist(const SmartPlaylist& playlist)
+{
+    auto index = smartPlaylists.addPlaylist(playlist);
+    fillSmartPlaylist(index);
+    storeSmartPlaylists();
+    return index;
+}
+
+void PlaylistManager::setSmartPlaylist(int index, const SmartPlaylist& playlist)
+{
+    if (index >= 0 && index < smartPlaylists.getNumPlaylists())
+    {
+        smartPlaylists.setPlaylist(index, playlist);
+        fillSmartPlaylist(index);
+        storeSmartPlaylists();
+    }
+}
+
+void PlaylistManager::removeSmartPlaylist(int index)
+{
+    if (index >= 0 && index < smartPlaylists.getNumPlaylists())
+    {
+        smartPlaylists.removePlaylist(index);
+        storeSmartPlaylists();
+    }
+}
+
+std::vector<int> PlaylistManager::getSmartPlaylistTracks(int index) const
+{
+    if (index < 0 || index >= smartPlaylists.getNumPlaylists())
+        return {};
+    
+    const juce::ScopedLock sl(trackLock);
+    return getPositions(smartPlaylists.getMembers(index));
+}
+
+void PlaylistManager::keepSmartPlaylistTracks(int index, std::vector<int>& positions) const
+{
+    if (index < 0 || index >= smartPlaylists.getNumPlaylists())
+        return;
+    
+    const auto& members = smartPlaylists.getMembers(index);
+    
+    positions.erase(std::remove_if(positions.begin(), positions.end(), [this, &members](int position) {
+        return position < 0 || position >= static_cast<int>(trackIds.size())
+            || !members.contains(trackIds[static_cast<size_t>(position)]);
+    }), positions.end());
 }
 
 juce::StringArray PlaylistManager::getUniqueGenres() const
 {
-    juce::StringArray genres;
+    return getUniqueValues(tracks.getGenres());
+}
+
+juce::StringArray PlaylistManager::getUniqueArtists() const
+{
+    return getUniqueValues(tracks.getArtists());
+}
+
+bool PlaylistManager::isAudioFile(const juce::File& file)
+{
+    return file.hasFileExtension(".mp3;.wav;.flac;.aac;.m4a;.ogg;.wma");
+}
+
+std::set<juce::String> PlaylistManager::getListedPaths() const
+{
+    std::set<juce::String> paths;
+    
+    for (const auto& file : tracks.getFiles())
+        paths.insert(file.getFullPathName());
+    
+    return paths;
+}
+
+void PlaylistManager::appendTrack(const Track& track)
+{
+    const juce::ScopedLock sl(trackLock);
+    
+    auto id = nextTrackId++;
+    tracks.add(track);
+    trackIds.push_back(id);
+    recordChange(Change::Type::Added, juce::Range<int>::withStartAndLength(tracks.size() - 1, 1));
+    searchIndex.add(id, track);
+    facetIndex.add(id, track);
+    smartPlaylists.trackChanged(id, track);
+    positionsValid = false;
+}
+
+void PlaylistManager::applyOrder(const std::vector<size_t>& order)
+{
+    const juce::ScopedLock sl(trackLock);
+    
+    std::vector<SearchIndex::DocId> orderedIds;
+    orderedIds.reserve(order.size());
+    
+    for (auto index : order)
+        orderedIds.push_back(trackIds[index]);
+    
+    tracks.reorder(order);
+    trackIds = std::move(orderedIds);
+    positionsValid = false;
+    recordChange(Change::Type::Reordered, { 0, tracks.size() });
+}
+
+void PlaylistManager::sortPositions(std::vector<int>& positions, const std::vector<SortKey>& keys) const
+{
+    // Stable, so sorting by each key in turn, least significant first, leaves
+    // ties to the keys after it and entries equal on all of them in playlist
+    // order. Descending swaps the arguments rather than negating the result,
+    // which would no longer be an ordering.
+    for (auto key = keys.rbegin(); key != keys.rend(); ++key)
+        sortPositions(positions, key->criteria, key->ascending);
+}
+
+void PlaylistManager::sortPositions(std::vector<int>& positions, SortCriteria criteria, bool ascending) const
+{
+    auto sortBy = [&positions, ascending](auto less) {
+        std::stable_sort(positions.begin(), positions.end(), [&less, ascending](int a, int b) {
+            return ascending ? less(static_cast<size_t>(a), static_cast<size_t>(b))
+                             : less(static_cast<size_t>(b), static_cast<size_t>(a));
+        });
+    };
+    
+    auto byColumn = [](const auto& column) {
+        return [&column](size_t a, size_t b) { return column[a] < column[b]; };
+    };
+    
+    // Text columns compare ids through each value's place in sorted order,
+    // worked out once per distinct value instead of once per comparison
+    auto byValue = [](const std::vector<TrackStore::Id>& ids, std::vector<int> ranks) {
+        return [&ids, ranks = std::move(ranks)](size_t a, size_t b) { return ranks[ids[a]] < ranks[ids[b]]; };
+    };
+    
+    switch (criteria)
+    {
+        case SortCriteria::Title:
+            sortBy(byColumn(tracks.getTitleSortKeys()));
+            break;
+        case SortCriteria::Artist:
+            sortBy(byValue(tracks.getArtistIds(), tracks.getArtists().getSortRanks()));
+            break;
+        case SortCriteria::Album:
+            sortBy(byValue(tracks.getAlbumIds(), tracks.getAlbums().getSortRanks()));
+            break;
+        case SortCriteria::Genre:
+            sortBy(byValue(tracks.getGenreIds(), tracks.getGenres().getSortRanks()));
+            break;
+        case SortCriteria::Duration:
+            sortBy(byColumn(tracks.getDurations()));
+            break;
+        case SortCriteria::BPM:
+            sortBy(byColumn(tracks.getBPMs()));
+            break;
+        case SortCriteria::DateAdded:
+            sortBy(byColumn(tracks.getDatesAdded()));
+            break;
+    }
+}
+
+PlaylistManager::SortValues PlaylistManager::copySortValues(const std::vector<int>& positions, const SortKey& key) const
+{
+    SortValues values;
+    values.ascending = key.ascending;
+    
+    auto copyColumn = [&positions, &values](const auto& column) {
+        values.numbers.reserve(positions.size());
+        for (auto position : positions)
+            values.numbers.push_back(static_cast<double>(column[static_cast<size_t>(position)]));
+    };
+    
+    auto copyRanks = [&positions, &values](const std::vector<TrackStore::Id>& ids, const std::vector<int>& ranks) {
+        values.numbers.reserve(positions.size());
+        for (auto position : positions)
+            values.numbers.push_back(ranks[ids[static_cast<size_t>(position)]]);
+    };
+    
+    switch (key.criteria)
+    {
+        case SortCriteria::Title:
+            values.text.reserve(positions.size());
+            for (auto position : positions)
+                values.text.push_back(tracks.getTitleSortKeys()[static_cast<size_t>(position)]);
+            break;
+        case SortCriteria::Artist:
+            copyRanks(tracks.getArtistIds(), tracks.getArtists().getSortRanks());
+            break;
+        case SortCriteria::Album:
+            copyRanks(tracks.getAlbumIds(), tracks.getAlbums().getSortRanks());
+            break;
+        case SortCriteria::Genre:
+            copyRanks(tracks.getGenreIds(), tracks.getGenres().getSortRanks());
+            break;
+        case SortCriteria::Duration:
+            copyColumn(tracks.getDurations());
+            break;
+        case SortCriteria::BPM:
+            copyColumn(tracks.getBPMs());
+            break;
+        case SortCriteria::DateAdded:
+            copyColumn(tracks.getDatesAdded());
+            break;
+    }
+    
+    return values;
+}
+
+void PlaylistManager::sortByValues(std::vector<int>& positions, const std::vector<SortValues>& columns)
+{
+    // Values line up with positions, so their indices are sorted and the positions follow.
+    // As in sortPositions, the least significant key goes first and stability does the rest.
+    std::vector<size_t> order(positions.size());
+    std::iota(order.begin(), order.end(), size_t { 0 });
+    
+    for (auto values = columns.rbegin(); values != columns.rend(); ++values)
+    {
+        auto sortBy = [&order, ascending = values->ascending](const auto& column) {
+            std::stable_sort(order.begin(), order.end(), [&column, ascending](size_t a, size_t b) {
+                return ascending ? column[a] < column[b] : column[b] < column[a];
+            });
+        };
+        
+        if (!values->text.empty())
+            sortBy(values->text);
+        else
+            sortBy(values->numbers);
+    }
+    
+    std::vector<int> sorted;
+    sorted.reserve(positions.size());
+    
+    for (auto index : order)
+        sorted.push_back(positions[index]);
+    
+    positions.swap(sorted);
+}
+
+std::vector<int> PlaylistManager::filterByFacet(FacetIndex::Facet facet, const juce::String& value) const
+{
+    auto& interner = StringInterner::getShared();
+    auto spellings = interner.findIgnoringCase(value);
+    
+    if (spellings.empty())
+        return {};
+    
+    const juce::ScopedLock sl(trackLock);
+    return getPositions(facetIndex.getMatches(facet, interner.getGroup(spellings.front())));
+}
+
+std::vector<int> PlaylistManager::getPositions(const IdBitmap& ids) const
+{
+    auto positions = getPositions(ids.toVector());
+    std::sort(positions.begin(), positions.end());
+    return positions;
+}
+
+juce::StringArray PlaylistManager::getUniqueValues(const TrackStore::ValueCounts& counts) const
+{
+    // One entry per value in use, whatever its case
+    auto& interner = StringInterner::getShared();
+    std::set<StringInterner::Id> groups;
+    juce::StringArray values;
     
-    for (const auto& track : tracks)
+    for (auto id : counts.getValues())
     {
-        if (!genres.contains(track.getGenre(), true))
+        if (groups.insert(interner.getGroup(id)).second)
+            values.add(interner.get(id));
+    }
+    
+    return values;
+}
+
+void PlaylistManager::replaceChangedTracks(std::vector<Track>&& changedTracks)
+{
+    std::map<juce::String, Track> byPath;
+    
+    for (auto& track : changedTracks)
+        byPath[track.getFilePath()] = std::move(track);
+    
+    bool replaced = false;
+    
+    {
+        // Files read again after a change replace their entries where they stand
+        const juce::ScopedLock sl(trackLock);
+        const auto& files = tracks.getFiles();
+        
+        for (int i = 0; i < tracks.size(); ++i)
         {
-            genres.add(track.getGenre());
+            auto found = byPath.find(files[static_cast<size_t>(i)].getFullPathName());
+            if (found == byPath.end())
+                continue;
+            
+            const auto& track = found->second;
+            tracks.set(i, track);
+            recordChange(Change::Type::Updated, juce::Range<int>::withStartAndLength(i, 1));
+            searchIndex.add(trackIds[static_cast<size_t>(i)], track);
+            facetIndex.add(trackIds[static_cast<size_t>(i)], track);
+            smartPlaylists.trackChanged(trackIds[static_cast<size_t>(i)], track);
+            replaced = true;
         }
     }
     
-    return genres;
+    if (replaced)
+        notifyPlaylistChanged();
 }
 
-juce::StringArray PlaylistManager::getUniqueArtists() const
+void PlaylistManager::removeTracksWhere(const std::function<bool(const juce::File&)>& isGone)
 {
-    juce::StringArray artists;
+    database.removeTracks(isGone);
+    
+    const juce::ScopedLock sl(trackLock);
+    const auto& files = tracks.getFiles();
+    std::vector<bool> gone(files.size());
+    size_t kept = 0;
     
-    for (const auto& track : tracks)
+    for (size_t i = 0; i < files.size(); ++i)
     {
-        if (!artists.contains(track.getArtist(), true))
+        if (isGone(files[i]))
         {
-            artists.add(track.getArtist());
+            gone[i] = true;
+            searchIndex.remove(trackIds[i]);
+            facetIndex.remove(trackIds[i]);
+            smartPlaylists.trackRemoved(trackIds[i]);
+            continue;
         }
+        
+        trackIds[kept++] = trackIds[i];
     }
     
-    return artists;
+    if (kept != files.size())
+    {
+        // From the back, so each range's positions still hold when it is applied
+        for (auto i = static_cast<int>(gone.size()) - 1; i >= 0; --i)
+        {
+            if (gone[static_cast<size_t>(i)])
+                recordChange(Change::Type::Removed, juce::Range<int>::withStartAndLength(i, 1));
+        }
+        
+        tracks.removeIf(gone);
+        trackIds.resize(kept);
+        positionsValid = false;
+        notifyPlaylistChanged();
+    }
 }
 
-bool PlaylistManager::isAudioFile(const juce::File& file) const
+void PlaylistManager::applyFolderChanges(const FolderWatcher::Changes& changes)
 {
-    return file.hasFileExtension(".mp3;.wav;.flac;.aac;.m4a;.ogg;.wma");
+    if (!changes.removedPaths.empty())
+        removeTracksWhere([&changes](const juce::File& file) { return changes.wasRemoved(file); });
+    
+    // Only the affected files and folders are read; the rest of the tree is left alone.
+    // Listed files among them are read again if their size or date has moved.
+    for (const auto& directory : changes.addedDirectories)
+        scanner.scanDirectory(directory, getListedPaths());
+    
+    if (!changes.changedFiles.isEmpty())
+        scanner.scanFiles(changes.changedFiles, getListedPaths());
+}
+
+void PlaylistManager::fillSmartPlaylist(int index)
+{
+    const juce::ScopedLock sl(trackLock);
+    
+    // A playlist that wants a genre only has that genre's tracks to go through
+    StringInterner::Id genre = StringInterner::emptyId;
+    std::vector<int> candidates;
+    
+    if (smartPlaylists.getPlaylist(index).getGenre(genre))
+    {
+        candidates = getPositions(facetIndex.getMatches(FacetIndex::Facet::Genre, genre));
+    }
+    else
+    {
+        candidates.resize(static_cast<size_t>(tracks.size()));
+        std::iota(candidates.begin(), candidates.end(), 0);
+    }
+    
+    for (auto position : candidates)
+        smartPlaylists.check(index, trackIds[static_cast<size_t>(position)], tracks.getTrack(position));
+}
+
+void PlaylistManager::storeSmartPlaylists()
+{
+    if (!holdsLibrary)
+        return;
+    
+    juce::StringArray definitions;
+    
+    for (int i = 0; i < smartPlaylists.getNumPlaylists(); ++i)
+        definitions.add(smartPlaylists.getPlaylist(i).toString());
+    
+    // Written with the rest of the database, after a scan or on the way out, not on every edit
+    database.setSmartPlaylists(definitions);
+}
+
+void PlaylistManager::recordChange(Change::Type type, juce::Range<int> range, int destination)
+{
+    if (!pendingChanges.empty())
+    {
+        auto& last = pendingChanges.back();
+        
+        if (last.type == type)
+        {
+            switch (type)
+            {
+                case Change::Type::Added:
+                    if (range.getStart() == last.range.getEnd())
+                    {
+                        last.range = last.range.withEnd(range.getEnd());
+                        return;
+                    }
+                    break;
+                    
+                case Change::Type::Removed:
+                    // The next ones along, or the ones just before
+                    if (range.getStart() == last.range.getStart())
+                    {
+                        last.range = last.range.withEnd(last.range.getEnd() + range.getLength());
+                        return;
+                    }
+                    
+                    if (range.getEnd() == last.range.getStart())
+                    {
+                        last.range = last.range.withStart(range.getStart());
+                        return;
+                    }
+                    break;
+                    
+                case Change::Type::Updated:
+                    if (range.getStart() <= last.range.getEnd() && last.range.getStart() <= range.getEnd())
+                    {
+                        last.range = last.range.getUnionWith(range);
+                        return;
+                    }
+                    break;
+                    
+                case Change::Type::Reordered:
+                    return;
+                    
+                case Change::Type::Moved:
+                    break;
+            }
+        }
+    }
+    
+    pendingChanges.push_back({ type, range, destination });
 }
 
 void PlaylistManager::notifyPlaylistChanged()
 {
+    if (batchDepth > 0 || pendingChanges.empty())
+        return;
+    
+    // Listeners may change the list again, which starts a fresh set
+    auto changes = std::move(pendingChanges);
+    pendingChanges.clear();
+    
+    if (onTracksChanged)
+        onTracksChanged(changes);
+    
     if (onPlaylistChanged)
         onPlaylistChanged();
 }
\ No newline at end of file
@@ -1,38 +1,82 @@
 #pragma once
 #include <JuceHeader.h>
 #include "Track.h"
+#include "LibraryScanner.h"
+#include "FolderWatcher.h"
+#include "SearchIndex.h"
+#include "TrackStore.h"
+#include "FacetIndex.h"
+#include "SmartPlaylists.h"
+#include <atomic>
 #include <vector>
 #include <functional>
+#include <optional>
+#include <set>
 
 class PlaylistManager
 {
 public:
-    PlaylistManager();
+    PlaylistManager(JobScheduler& jobScheduler, LibraryDatabase& database);
     ~PlaylistManager();
     
     // Track management
     void addTrack(const Track& track);
     void addTracks(const std::vector<Track>& tracks);
     void removeTrack(int index);
+    void updateHotCues(const Track& track); // copies cues and beat grid to every entry for the same file
+    void updatePlayCount(const juce::File& file, int playCount);
     void clearPlaylist();
     
-    // File operations
+    // Changes made between beginChanges and commitChanges reach listeners as
+    // one notification when the outermost commit comes. Calls may nest.
+    void beginChanges();
+    void commitChanges();
+    
+    struct ScopedChanges
+    {
+        explicit ScopedChanges(PlaylistManager& m) : manager(m) { manager.beginChanges(); }
+        ~ScopedChanges() { manager.commitChanges(); }
+        
+        PlaylistManager& manager;
+        
+        JUCE_DECLARE_NON_COPYABLE(ScopedChanges)
+    };
+    
+    // One step of what a batch did to the list, so a view can patch the rows it
+    // shows rather than build them again. Positions are as they stood just
+    // before the step. Neighbouring steps of a kind are merged, so adding ten
+    // thousand tracks in a row is a single step.
+    struct Change
+    {
+        enum class Type
+        {
+            Added,
+            Removed,
+            Moved,     // to destination, the range's first position afterwards
+            Updated,   // same tracks, new details
+            Reordered  // sorted or shuffled: any track may be anywhere
+        };
+        
+        Type type;
+        juce::Range<int> range;
+        int destination = 0;
+    };
+    
+    // File operations. Imports run in the background and add tracks in batches;
+    // files already in the playlist are skipped. Imported folders stay watched,
+    // so files added, rewritten or deleted there later show up on their own.
     void loadTracksFromDirectory(const juce::File& directory);
     void loadTracksFromFiles(const juce::Array<juce::File>& files);
+    void cancelImport();
+    bool isImporting() const { return scanner.isScanning(); }
     void savePlaylist(const juce::File& file);
     void loadPlaylist(const juce::File& file);
+    void loadLibrary(); // every track in the library database, following its folders
     
-    // Getters
-    int getNumTracks() const { return static_cast<int>(tracks.size()); }
-    const Track* getTrack(int index) const;
-    Track* getTrack(int index);
-    const std::vector<Track>& getAllTracks() const { return tracks; }
-    
-    // Search and filter
-    std::vector<int> searchTracks(const juce::String& query) const;
-    std::vector<int> filterByGenre(const juce::String& genre) const;
-    std::vector<int> filterByArtist(const juce::String& artist) const;
-    std::vector<int> filterByBPMRange(int minBPM, int maxBPM) const;
+    // Getters. Tracks are kept column by column, so getTrack builds a copy.
+    int getNumTracks() const { return tracks.size(); }
+    std::optional<Track> getTrack(int index) const;
+    int indexOf(const juce::File& file) const; // first entry for the file, or -1
     
     // Sorting
     enum class SortCriteria
@@ -40,17 +84,69 @@ public:
         Title,
         Artist,
         Album,
+        Genre,
         Duration,
         BPM,
         DateAdded
     };
     
+    struct SortKey
+    {
+        SortCriteria criteria;
+        bool ascending = true;
+    };
+    
+    // Stable: the first key decides, later ones break its ties, and entries
+    // equal on every key keep their order. Text sorts ignoring case.
     void sortTracks(SortCriteria criteria, bool ascending = true);
+    void sortTracks(const std::vector<SortKey>& keys);
+    
+    // Search and filter. Searches go through an index kept up to date as tracks
+    // are added, changed and removed, so a query doesn't visit every track.
+    // Results are ranked best first and forgive a typo or two in longer words.
+    std::vector<int> searchTracks(const juce::String& query) const;
+    
+    // What a search leaves for the next one, so a longer query can narrow it down
+    struct SearchState
+    {
+        juce::String query;
+        std::vector<SearchIndex::DocId> matches;
+        juce::uint32 indexVersion = 0;
+        bool valid = false;
+    };
+    
+    // Any thread. Matching positions sorted by the keys in order, or ranked best first
+    // (reversed unless ascending) when it's empty; equal tracks keep playlist order.
+    // Only tracks the facet picks allow are kept. Gives up with nothing once shouldStop
+    // is set. Changes to the playlist wait while the matches are found, not while they are sorted.
+    std::vector<int> searchTracks(const juce::String& query, const std::vector<SortKey>& order, bool ascending,
+                                  const FacetIndex::Selection& facets, SearchState& state,
+                                  const std::atomic<bool>& shouldStop) const;
+    std::vector<int> filterByGenre(const juce::String& genre) const;
+    std::vector<int> filterByArtist(const juce::String& artist) const;
+    std::vector<int> filterByBPMRange(int minBPM, int maxBPM) const;
+    
+    // Faceted browsing. Each value of each facet keeps its set of tracks, so
+    // counts are at hand and combining picks intersects a few sets; see FacetIndex.
+    std::vector<int> filterByFacets(const FacetIndex::Selection& selection) const; // positions, in playlist order
+    std::vector<FacetIndex::Count> getFacetCounts(FacetIndex::Facet facet, const FacetIndex::Selection& selection) const;
     
     // Playlist operations
     void shufflePlaylist();
     void moveTrack(int fromIndex, int toIndex);
     
+    // Smart playlists over this list's tracks, kept up to date as tracks come,
+    // change and go. The library's own list keeps them in the library database,
+    // which writes them out along with everything else.
+    int addSmartPlaylist(const SmartPlaylist& playlist);
+    void setSmartPlaylist(int index, const SmartPlaylist& playlist);
+    void removeSmartPlaylist(int index);
+    int getNumSmartPlaylists() const { return smartPlaylists.getNumPlaylists(); }
+    const SmartPlaylist& getSmartPlaylist(int index) const { return smartPlaylists.getPlaylist(index); }
+    std::vector<int> getSmartPlaylistTracks(int index) const; // positions, in playlist order
+    int getSmartPlaylistSize(int index) const { return smartPlaylists.getMembers(index).size(); }
+    void keepSmartPlaylistTracks(int index, std::vector<int>& positions) const; // message thread; keeps the order
+    
     // Statistics
     double getTotalDuration() const;
     int getAverageBPM() const;
@@ -58,17 +154,58 @@ public:
     juce::StringArray getUniqueArtists() const;
     
     // Callbacks
-    std::function<void(int)> onTrackAdded;
-    std::function<void(int)> onTrackRemoved;
-    std::function<void()> onPlaylistCleared;
-    std::function<void()> onPlaylistChanged;
+    std::function<void(const std::vector<Change>& changes)> onTracksChanged;
+    std::function<void()> onPlaylistChanged; // after onTracksChanged, once per batch
+    std::function<void(int scanned, int found)> onImportProgress;
+    std::function<void(bool completed)> onImportFinished;
+    std::function<void(int smartPlaylistIndex)> onSmartPlaylistChanged;
     
 private:
-    std::vector<Track> tracks;
+    mutable juce::CriticalSection trackLock; // held by searches and by changes to the tracks or index
+    TrackStore tracks;
+    std::vector<SearchIndex::DocId> trackIds; // one per track, following it through sorts and moves
+    SearchIndex::DocId nextTrackId = 0;
+    SearchIndex searchIndex;
+    FacetIndex facetIndex; // same ids as the search index
+    SmartPlaylists smartPlaylists;
+    bool holdsLibrary = false; // loaded from the library database, so its smart playlists are saved there
+    mutable std::vector<int> positionsById;   // rebuilt on the next search after a change
+    mutable bool positionsValid = false;
+    LibraryDatabase& database;
+    LibraryScanner scanner;
+    FolderWatcher watcher;
+    std::vector<Change> pendingChanges; // since the last notification
+    int batchDepth = 0;
     
     // Helper methods
-    bool isAudioFile(const juce::File& file) const;
-    void notifyPlaylistChanged();
+    void appendTrack(const Track& track);
+    void applyOrder(const std::vector<size_t>& order);
+    void sortPositions(std::vector<int>& positions, const std::vector<SortKey>& keys) const;
+    void sortPositions(std::vector<int>& positions, SortCriteria criteria, bool ascending) const;
+    
+    // One column's values for a set of positions, copied out so they can be sorted without the lock
+    struct SortValues
+    {
+        std::vector<std::string> text;  // title sort keys
+        std::vector<double> numbers;    // everything else; text columns as ranks
+        bool ascending = true;
+    };
+    
+    SortValues copySortValues(const std::vector<int>& positions, const SortKey& key) const;
+    static void sortByValues(std::vector<int>& positions, const std::vector<SortValues>& columns);
+    std::vector<int> filterByFacet(FacetIndex::Facet facet, const juce::String& value) const;
+    juce::StringArray getUniqueValues(const TrackStore::ValueCounts& counts) const;
+    std::vector<int> getPositions(const std::vector<SearchIndex::DocId>& ids) const;
+    std::vector<int> getPositions(const IdBitmap& ids) const; // in playlist order
+    void replaceChangedTracks(std::vector<Track>&& changedTracks);
+    void removeTracksWhere(const std::function<bool(const juce::File&)>& isGone);
+    void applyFolderChanges(const FolderWatcher::Changes& changes);
+    static bool isAudioFile(const juce::File& file);
+    std::set<juce::String> getListedPaths() const;
+    void fillSmartPlaylist(int index);
+    void storeSmartPlaylists();
+    void recordChange(Change::Type type, juce::Range<int> range, int destination = 0);
+    void notifyPlaylistChanged(); // held back until the batch, if any, is committed
     
     JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR(PlaylistManager)
 };
\ No newline at end of file
@@ -0,0 +1,108 @@
+#include "PlaylistSearch.h"
+
+PlaylistSearch::PlaylistSearch(PlaylistManager& playlistToSearch)
+    : juce::Thread("Playlist Search"), playlist(playlistToSearch)
+{
+    startThread();
+}
+
+PlaylistSearch::~PlaylistSearch()
+{
+    cancelPendingUpdate();
+    superseded = true;
+    signalThreadShouldExit();
+    notify();
+    stopThread(2000);
+}
+
+void PlaylistSearch::search(const juce::String& query, const std::vector<PlaylistManager::SortKey>& order, bool ascending,
+                            const FacetIndex::Selection& facets)
+{
+    {
+        const juce::ScopedLock sl(lock);
+        pendingQuery = query;
+        pendingOrder = order;
+        pendingAscending = ascending;
+        pendingFacets = facets;
+        hasPendingQuery = true;
+        ++generation;
+
+        // Under the lock, or the worker could take this query first and then see it as superseded
+        superseded = true;
+    }
+
+    notify();
+}
+
+bool PlaylistSearch::isSearching() const
+{
+    const juce::ScopedLock sl(lock);
+    return deliveredGeneration != generation;
+}
+
+void PlaylistSearch::run()
+{
+    while (!threadShouldExit())
+    {
+        juce::String query;
+        std::vector<PlaylistManager::SortKey> order;
+        bool ascending = true;
+        FacetIndex::Selection facets;
+        int searchGeneration = 0;
+        bool haveQuery = false;
+
+        {
+            const juce::ScopedLock sl(lock);
+
+            if (hasPendingQuery)
+            {
+                query = pendingQuery;
+                order = pendingOrder;
+                ascending = pendingAscending;
+                facets = pendingFacets;
+                searchGeneration = generation;
+                hasPendingQuery = false;
+                haveQuery = true;
+                superseded = false;
+            }
+        }
+
+        if (!haveQuery)
+        {
+            wait(-1);
+            continue;
+        }
+
+        auto found = playlist.searchTracks(query, order, ascending, facets, state, superseded);
+
+        const juce::ScopedLock sl(lock);
+
+        // A search that gave up has nothing worth showing, even when no newer query came
+        if (searchGeneration == generation && !superseded.load())
+        {
+            results = std::move(found);
+            resultsGeneration = searchGeneration;
+            triggerAsyncUpdate();
+        }
+    }
+}
+
+void PlaylistSearch::handleAsyncUpdate()
+{
+    std::vector<int> delivered;
+
+    {
+        const juce::ScopedLock sl(lock);
+
+        // A newer query is on its way; these would only flash up and vanish
+        if (resultsGeneration != generation)
+            return;
+
+        delivered.swap(results);
+        deliveredGeneration = resultsGeneration;
+        resultsGeneration = -1;
+    }
+
+    if (onResults)
+        onResults(std::move(delivered));
+}
@@ -0,0 +1,46 @@
+#pragma once
+#include <JuceHeader.h>
+#include "PlaylistManager.h"
+#include <atomic>
+#include <functional>
+#include <vector>
+
+// Search-as-you-type for one playlist, run off the message thread. Only the
+// newest query matters: one made while another runs takes its place, the
+// running one gives up at its next check, and only the newest results are
+// delivered, each set whole. A query that extends the one before it narrows
+// those matches rather than searching the index again.
+class PlaylistSearch : private juce::Thread, private juce::AsyncUpdater
+{
+public:
+    explicit PlaylistSearch(PlaylistManager& playlist);
+    ~PlaylistSearch() override;
+
+    // Message thread
+    void search(const juce::String& query, const std::vector<PlaylistManager::SortKey>& order = {}, bool ascending = true,
+                const FacetIndex::Selection& facets = {});
+    std::function<void(std::vector<int>&& trackIndices)> onResults;
+    bool isSearching() const; // a query's results have yet to be delivered
+
+private:
+    PlaylistManager& playlist;
+
+    mutable juce::CriticalSection lock;
+    juce::String pendingQuery;
+    std::vector<PlaylistManager::SortKey> pendingOrder;
+    bool pendingAscending = true;
+    FacetIndex::Selection pendingFacets;
+    bool hasPendingQuery = false;
+    int generation = 0;
+    int resultsGeneration = -1;
+    int deliveredGeneration = 0;
+    std::vector<int> results;
+    std::atomic<bool> superseded { false };
+
+    PlaylistManager::SearchState state; // search thread only
+
+    void run() override;
+    void handleAsyncUpdate() override;
+
+    JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR(PlaylistSearch)
+};
@@ -0,0 +1,336 @@
+#include "Sampler.h"
+
+Sampler::Sampler()
+{
+}
+
+void Sampler::prepareToPlay(int /*samplesPerBlockExpected*/, double sampleRate)
+{
+    const juce::ScopedLock sl(padLock);
+
+    outputSampleRate = sampleRate;
+
+    // ~2 ms fades keep starts, chokes and steals free of clicks
+    envelopeStep = 1.0f / juce::jmax(1.0f, static_cast<float>(sampleRate * 0.002));
+
+    for (auto& voice : voices)
+    {
+        if (voice.pad >= 0)
+            finishVoice(voice);
+        voice.pendingPad = -1;
+    }
+}
+
+bool Sampler::loadPad(int pad, const juce::File& file, juce::AudioFormatManager& formatManager)
+{
+    if (!isPadIndex(pad))
+        return false;
+
+    std::unique_ptr<juce::AudioFormatReader> reader(formatManager.createReaderFor(file));
+    if (reader == nullptr || reader->lengthInSamples <= 0)
+        return false;
+
+    // Decode the whole sample now so playing it never has to
+    int length = static_cast<int>(juce::jmin<juce::int64>(reader->lengthInSamples,
+                                                          static_cast<juce::int64>(maxSampleSeconds * reader->sampleRate)));
+    juce::AudioBuffer<float> audio(2, length + 1);
+    reader->read(&audio, 0, length, 0, true, true);
+    audio.clear(length, 1);
+
+    const juce::ScopedLock sl(padLock);
+
+    auto& target = pads[static_cast<size_t>(pad)];
+
+    for (auto& voice : voices)
+    {
+        if (voice.pad == pad)
+            finishVoice(voice);
+        if (voice.pendingPad == pad)
+            voice.pendingPad = -1;
+    }
+
+    std::swap(target.audio, audio);
+    target.sampleRate = reader->sampleRate;
+    target.length = length;
+    target.loaded = true;
+    return true;
+}
+
+void Sampler::clearPad(int pad)
+{
+    if (!isPadIndex(pad))
+        return;
+
+    juce::AudioBuffer<float> released;
+
+    {
+        const juce::ScopedLock sl(padLock);
+
+        for (auto& voice : voices)
+        {
+            if (voice.pad == pad)
+                finishVoice(voice);
+            if (voice.pendingPad == pad)
+                voice.pendingPad = -1;
+        }
+
+        auto& target = pads[static_cast<size_t>(pad)];
+        target.loaded = false;
+        target.length = 0;
+        std::swap(target.audio, released);
+    }
+
+    // The old audio is freed here, outside the lock
+}
+
+bool Sampler::isPadLoaded(int pad) const
+{
+    return isPadIndex(pad) && pads[static_cast<size_t>(pad)].loaded.load();
+}
+
+bool Sampler::isPadPlaying(int pad) const
+{
+    return isPadIndex(pad) && pads[static_cast<size_t>(pad)].voicesPlaying.load() > 0;
+}
+
+void Sampler::setPadGain(int pad, float gain)
+{
+    if (isPadIndex(pad))
+        pads[static_cast<size_t>(pad)].gain = juce::jlimit(0.0f, 2.0f, gain);
+}
+
+void Sampler::setPadLooping(int pad, bool looping)
+{
+    if (isPadIndex(pad))
+        pads[static_cast<size_t>(pad)].looping = looping;
+}
+
+void Sampler::setPadTempo(int pad, double bpm)
+{
+    if (isPadIndex(pad))
+        pads[static_cast<size_t>(pad)].tempo = juce::jmax(0.0, bpm);
+}
+
+void Sampler::triggerPad(int pad)
+{
+    queueTrigger(pad, false);
+}
+
+void Sampler::releasePad(int pad)
+{
+    queueTrigger(pad, true);
+}
+
+void Sampler::queueTrigger(int pad, bool release)
+{
+    if (!isPadIndex(pad))
+        return;
+
+    int start1, size1, start2, size2;
+    triggerFifo.prepareToWrite(1, start1, size1, start2, size2);
+
+    // Only full after dozens of hits inside one block
+    if (size1 + size2 < 1)
+        return;
+
+    auto& trigger = triggers[static_cast<size_t>(size1 > 0 ? start1 : start2)];
+    trigger.pad = pad;
+    trigger.release = release;
+    triggerFifo.finishedWrite(1);
+}
+
+void Sampler::applyTriggers()
+{
+    while (triggerFifo.getNumReady() > 0)
+    {
+        int start1, size1, start2, size2;
+        triggerFifo.prepareToRead(1, start1, size1, start2, size2);
+        auto trigger = triggers[static_cast<size_t>(size1 > 0 ? start1 : start2)];
+
+        if (trigger.release)
+            stopPad(trigger.pad);
+        else if (!startPad(trigger.pad))
+            return; // every voice is already handing over to another pad; try again next block
+
+        triggerFifo.finishedRead(1);
+    }
+}
+
+bool Sampler::startPad(int pad)
+{
+    if (!pads[static_cast<size_t>(pad)].loaded.load())
+        return true;
+
+    bool wasPlaying = false;
+
+    // Retriggering chokes the pad's previous voice
+    for (auto& voice : voices)
+    {
+        if (voice.pad == pad && !voice.releasing)
+        {
+            voice.releasing = true;
+            wasPlaying = true;
+        }
+    }
+
+    // A running loop is toggled off instead
+    if (wasPlaying && pads[static_cast<size_t>(pad)].looping.load())
+        return true;
+
+    for (auto& voice : voices)
+    {
+        if (voice.pad < 0 && voice.pendingPad < 0)
+        {
+            startVoice(voice, pad);
+            return true;
+        }
+    }
+
+    // Pool is full: fade the oldest voice out and start on that slot when it is silent.
+    // A voice already handing over to another pad keeps that claim.
+    Voice* oldest = nullptr;
+    for (auto& voice : voices)
+    {
+        if (voice.pendingPad < 0 && (oldest == nullptr || voice.startOrder < oldest->startOrder))
+            oldest = &voice;
+    }
+
+    if (oldest == nullptr)
+        return false;
+
+    oldest->releasing = true;
+    oldest->pendingPad = pad;
+    oldest->startOrder = ++triggerCounter;
+    return true;
+}
+
+void Sampler::stopPad(int pad)
+{
+    for (auto& voice : voices)
+    {
+        if (voice.pad == pad)
+            voice.releasing = true;
+        if (voice.pendingPad == pad)
+            voice.pendingPad = -1;
+    }
+}
+
+void Sampler::render(juce::AudioBuffer<float>& buffer, int startSample, int numSamples)
+{
+    for (int channel = 0; channel < buffer.getNumChannels(); ++channel)
+        buffer.clear(channel, startSample, numSamples);
+
+    if (numSamples <= 0 || buffer.getNumChannels() < 2)
+        return;
+
+    // A pad is being swapped in; the voices and queued triggers pick up again next block
+    const juce::ScopedTryLock sl(padLock);
+    if (!sl.isLocked())
+        return;
+
+    applyTriggers();
+
+    auto* left = buffer.getWritePointer(0, startSample);
+    auto* right = buffer.getWritePointer(1, startSample);
+
+    for (auto& voice : voices)
+    {
+        if (voice.pad >= 0)
+            renderVoice(voice, left, right, numSamples);
+    }
+}
+
+void Sampler::startVoice(Voice& voice, int pad)
+{
+    voice.pad = pad;
+    voice.pendingPad = -1;
+    voice.position = 0.0;
+    voice.envelope = 0.0f;
+    voice.releasing = false;
+    voice.startOrder = ++triggerCounter;
+    ++pads[static_cast<size_t>(pad)].voicesPlaying;
+}
+
+void Sampler::finishVoice(Voice& voice)
+{
+    if (voice.pad >= 0)
+        --pads[static_cast<size_t>(voice.pad)].voicesPlaying;
+
+    voice.pad = -1;
+    voice.releasing = false;
+}
+
+void Sampler::handOverVoice(Voice& voice, float* left, float* right, int numSamples)
+{
+    int next = voice.pendingPad;
+    finishVoice(voice);
+
+    // A stolen voice hands straight over to the pad that claimed it, whether it
+    // faded out or ran off the end of its sample first
+    if (next >= 0 && pads[static_cast<size_t>(next)].loaded.load())
+    {
+        startVoice(voice, next);
+        renderVoice(voice, left, right, numSamples);
+    }
+    else
+    {
+        voice.pendingPad = -1;
+    }
+}
+
+void Sampler::renderVoice(Voice& voice, float* left, float* right, int numSamples)
+{
+    auto& pad = pads[static_cast<size_t>(voice.pad)];
+    bool looping = pad.looping.load();
+    float gain = pad.gain.load();
+    int length = pad.length;
+
+    // Loops with a tempo are stretched to the master deck by playback rate
+    double increment = pad.sampleRate / outputSampleRate;
+    double loopTempo = pad.tempo.load();
+    double tempo = masterTempo.load();
+    if (looping && loopTempo > 0.0 && tempo > 0.0)
+        increment *= tempo / loopTempo;
+
+    auto* sourceLeft = pad.audio.getReadPointer(0);
+    auto* sourceRight = pad.audio.getReadPointer(1);
+
+    for (int i = 0; i < numSamples; ++i)
+    {
+        if (voice.position >= length)
+        {
+            if (!looping || length == 0)
+            {
+                handOverVoice(voice, left + i, right + i, numSamples - i);
+                return;
+            }
+
+            voice.position -= length;
+        }
+
+        if (voice.releasing)
+        {
+            voice.envelope -= envelopeStep;
+            if (voice.envelope <= 0.0f)
+            {
+                handOverVoice(voice, left + i, right + i, numSamples - i);
+                return;
+            }
+        }
+        else if (voice.envelope < 1.0f)
+        {
+            voice.envelope = juce::jmin(1.0f, voice.envelope + envelopeStep);
+        }
+
+        // The extra sample after the end (silence) keeps the interpolation in range
+        int index = static_cast<int>(voice.position);
+        float fraction = static_cast<float>(voice.position - index);
+        int nextIndex = (looping && index + 1 >= length) ? 0 : index + 1;
+        float level = gain * voice.envelope;
+
+        left[i] += level * (sourceLeft[index] + fraction * (sourceLeft[nextIndex] - sourceLeft[index]));
+        right[i] += level * (sourceRight[index] + fraction * (sourceRight[nextIndex] - sourceRight[index]));
+
+        voice.position += increment;
+    }
+}
@@ -0,0 +1,96 @@
+#pragma once
+#include <JuceHeader.h>
+#include <array>
+#include <atomic>
+
+// 16-pad sampler played alongside the decks. Each pad is decoded completely
+// into RAM when it is loaded. Playback comes from a fixed pool of voices, so
+// triggering a pad only claims a voice and never allocates or touches the disk.
+// When every voice is busy the oldest is faded out quickly and handed over.
+// Looping pads with a tempo follow the master deck's tempo.
+class Sampler
+{
+public:
+    static constexpr int numPads = 16;
+    static constexpr int numVoices = 16;
+    static constexpr double maxSampleSeconds = 60.0;
+
+    Sampler();
+
+    void prepareToPlay(int samplesPerBlockExpected, double sampleRate);
+
+    // Message thread
+    bool loadPad(int pad, const juce::File& file, juce::AudioFormatManager& formatManager);
+    void clearPad(int pad);
+    bool isPadLoaded(int pad) const;
+    bool isPadPlaying(int pad) const;
+    void setPadGain(int pad, float gain);
+    void setPadLooping(int pad, bool looping);
+    void setPadTempo(int pad, double bpm); // 0 plays the loop at its own speed
+
+    // Any thread
+    void setMasterTempo(double bpm) { masterTempo = bpm; }
+
+    // Audio thread (or whichever single thread schedules pads). Triggers are queued
+    // and applied at the start of the next render, so none is lost while a pad is
+    // being swapped in or every voice is already handing over.
+    void triggerPad(int pad);  // one-shots retrigger, running loops stop
+    void releasePad(int pad);
+
+    // Audio thread
+    void render(juce::AudioBuffer<float>& buffer, int startSample, int numSamples); // overwrites the region
+
+private:
+    struct Pad
+    {
+        juce::AudioBuffer<float> audio;
+        double sampleRate = 44100.0;
+        int length = 0;
+        std::atomic<bool> loaded { false };
+        std::atomic<float> gain { 1.0f };
+        std::atomic<bool> looping { false };
+        std::atomic<double> tempo { 0.0 };
+        std::atomic<int> voicesPlaying { 0 };
+    };
+
+    struct Voice
+    {
+        int pad = -1;
+        int pendingPad = -1;    // pad to start once a steal fade has finished
+        double position = 0.0;
+        float envelope = 0.0f;
+        bool releasing = false;
+        juce::uint64 startOrder = 0;
+    };
+
+    struct Trigger
+    {
+        int pad = -1;
+        bool release = false;
+    };
+
+    static constexpr int triggerCapacity = 64;
+
+    std::array<Pad, numPads> pads;
+    std::array<Voice, numVoices> voices;
+    juce::AbstractFifo triggerFifo { triggerCapacity };
+    std::array<Trigger, triggerCapacity> triggers;
+    juce::CriticalSection padLock; // pad audio swaps vs the audio thread
+
+    double outputSampleRate = 44100.0;
+    float envelopeStep = 1.0f / 96.0f;
+    juce::uint64 triggerCounter = 0;
+    std::atomic<double> masterTempo { 0.0 };
+
+    static bool isPadIndex(int pad) { return pad >= 0 && pad < numPads; }
+    void queueTrigger(int pad, bool release);
+    void applyTriggers();
+    bool startPad(int pad);
+    void stopPad(int pad);
+    void startVoice(Voice& voice, int pad);
+    void finishVoice(Voice& voice);
+    void handOverVoice(Voice& voice, float* left, float* right, int numSamples);
+    void renderVoice(Voice& voice, float* left, float* right, int numSamples);
+
+    JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR(Sampler)
+};
@@ -0,0 +1,615 @@
+#include "SearchIndex.h"
+#include <algorithm>
+#include <cctype>
+#include <cmath>
+
+namespace
+{
+    constexpr float prefixQuality = 0.9f;
+    constexpr float substringQuality = 0.7f;
+    constexpr float fuzzyPrefixQuality = 0.5f;
+    constexpr float popularityWeight = 0.1f;
+    constexpr int maxPrefixExpansions = 512;
+    constexpr size_t maxOrderedResults = 1000;
+
+    // Longer words are allowed more mistakes; short ones have to be typed right
+    int getMaxEdits(size_t length)
+    {
+        return length < 4 ? 0 : (length < 8 ? 1 : 2);
+    }
+}
+
+void SearchIndex::add(DocId id, const Track& track)
+{
+    remove(id);
+
+    auto document = makeDocument(track);
+
+    for (auto trigram : getTrigrams(document))
+        insertPosting(trigrams[trigram], id);
+
+    for (const auto& token : getTokens(document))
+    {
+        auto [found, isNew] = tokens.try_emplace(token);
+        insertPosting(found->second.postings, id);
+
+        if (isNew)
+            addToken(*found);
+    }
+
+    if (documents.size() <= id)
+    {
+        documents.resize(static_cast<size_t>(id) + 1);
+        playCounts.resize(static_cast<size_t>(id) + 1);
+    }
+
+    documents[id] = std::move(document);
+    playCounts[id] = track.getPlayCount();
+    ++numDocuments;
+    ++version;
+}
+
+void SearchIndex::remove(DocId id)
+{
+    if (id >= documents.size() || documents[id].empty())
+        return;
+
+    const auto& document = documents[id];
+
+    for (auto trigram : getTrigrams(document))
+    {
+        auto found = trigrams.find(trigram);
+        if (found != trigrams.end() && erasePosting(found->second, id))
+            trigrams.erase(found);
+    }
+
+    for (const auto& token : getTokens(document))
+    {
+        auto found = tokens.find(token);
+        if (found != tokens.end() && erasePosting(found->second.postings, id))
+        {
+            removeToken(*found);
+            tokens.erase(found);
+        }
+    }
+
+    documents[id].clear();
+    --numDocuments;
+    ++version;
+}
+
+void SearchIndex::clear()
+{
+    documents.clear();
+    playCounts.clear();
+    trigrams.clear();
+    tokens.clear();
+    tokensByNumber.clear();
+    freeNumbers.clear();
+    tokenBigrams.clear();
+    numDocuments = 0;
+    ++version;
+}
+
+void SearchIndex::setPlayCount(DocId id, int playCount)
+{
+    // Only the ranking changes, so the version stays
+    if (id < playCounts.size())
+        playCounts[id] = playCount;
+}
+
+std::vector<SearchIndex::DocId> SearchIndex::search(const juce::String& query) const
+{
+    auto folded = fold(query);
+
+    if (folded.empty())
+        return searchAll(folded);
+
+    if (folded.size() >= 3)
+        return searchTrigrams(folded);
+
+    return searchPrefix(folded);
+}
+
+bool SearchIndex::canRefine(const juce::String& previousQuery, const juce::String& query)
+{
+    // Shorter queries match word starts, which a longer query doesn't have to share
+    auto previous = fold(previousQuery);
+    return previous.size() >= 3 && fold(query).find(previous) != std::string::npos;
+}
+
+std::vector<SearchIndex::DocId> SearchIndex::refine(const std::vector<DocId>& previousResults, const juce::String& query) const
+{
+    auto folded = fold(query);
+    std::vector<DocId> results;
+
+    for (auto id : previousResults)
+    {
+        if (id < documents.size() && documents[id].find(folded) != std::string::npos)
+            results.push_back(id);
+    }
+
+    return results;
+}
+
+std::vector<SearchIndex::DocId> SearchIndex::rank(const juce::String& query, const std::vector<DocId>& substringMatches) const
+{
+    auto folded = fold(query);
+    auto words = splitWords(folded);
+
+    if (words.empty())
+        return substringMatches;
+
+    // The last word is still being typed unless the query ends in a space or punctuation
+    bool lastWordFinished = !isTokenByte(static_cast<unsigned char>(folded.back()));
+
+    std::vector<std::vector<TokenMatch>> wordMatches;
+
+    for (size_t i = 0; i < words.size(); ++i)
+    {
+        auto matches = findWord(words[i], i + 1 == words.size() && !lastWordFinished);
+
+        if (matches.empty())
+        {
+            wordMatches.clear();
+            break;
+        }
+
+        wordMatches.push_back(std::move(matches));
+    }
+
+    // Rarest words first, so the tracks still in the running are few from the outset
+    auto getCost = [](const std::vector<TokenMatch>& matches) {
+        size_t cost = 0;
+        for (const auto& match : matches)
+            cost += match.postings->size();
+        return cost;
+    };
+
+    std::sort(wordMatches.begin(), wordMatches.end(), [&getCost](const auto& a, const auto& b) {
+        return getCost(a) < getCost(b);
+    });
+
+    auto& scores = scratch.scores;
+    auto& bestForWord = scratch.bestForWord;
+    auto& wordsMatched = scratch.wordsMatched;
+
+    if (scores.size() < documents.size())
+    {
+        scores.resize(documents.size(), 0.0f);
+        bestForWord.resize(documents.size(), 0.0f);
+        wordsMatched.resize(documents.size(), 0);
+    }
+
+    // Later words only keep tracks the first one found, so those and the
+    // substring matches are all the entries that need zeroing afterwards
+    std::vector<DocId> candidates, touched;
+
+    for (size_t word = 0; word < wordMatches.size(); ++word)
+    {
+        candidates.clear();
+
+        // A track counts once per word, with its best matching word
+        for (const auto& match : wordMatches[word])
+        {
+            for (auto id : *match.postings)
+            {
+                if (wordsMatched[id] != word)
+                    continue;
+
+                if (bestForWord[id] == 0.0f)
+                    candidates.push_back(id);
+
+                bestForWord[id] = std::max(bestForWord[id], match.quality);
+            }
+        }
+
+        for (auto id : candidates)
+        {
+            scores[id] += bestForWord[id];
+            bestForWord[id] = 0.0f;
+            wordsMatched[id] = static_cast<juce::uint32>(word + 1);
+        }
+
+        if (word == 0)
+            touched = candidates;
+
+        if (candidates.empty())
+            break;
+    }
+
+    // An exact run of the whole query is a good match even inside a longer word
+    auto substringScore = substringQuality * static_cast<float>(words.size());
+
+    for (auto id : substringMatches)
+    {
+        if (!wordMatches.empty() && wordsMatched[id] == wordMatches.size())
+        {
+            scores[id] = std::max(scores[id], substringScore);
+        }
+        else
+        {
+            scores[id] = substringScore;
+            candidates.push_back(id);
+        }
+    }
+
+    std::vector<std::pair<float, DocId>> ranked;
+    ranked.reserve(candidates.size());
+
+    for (auto id : candidates)
+        ranked.emplace_back(scores[id] * (1.0f + popularityWeight * std::log1p(static_cast<float>(playCounts[id]))), id);
+
+    for (auto id : touched)
+    {
+        scores[id] = 0.0f;
+        wordsMatched[id] = 0;
+    }
+
+    for (auto id : substringMatches)
+        scores[id] = 0.0f;
+
+    // Only the head of a long list is put in order; nobody scrolls past it to
+    // compare scores, and a full sort would cost more than a frame
+    auto isBetter = [](const auto& a, const auto& b) {
+        return a.first != b.first ? a.first > b.first : a.second < b.second;
+    };
+
+    auto head = ranked.begin() + static_cast<std::ptrdiff_t>(std::min(ranked.size(), maxOrderedResults));
+    std::nth_element(ranked.begin(), head, ranked.end(), isBetter);
+    std::sort(ranked.begin(), head, isBetter);
+
+    std::vector<DocId> results;
+    results.reserve(ranked.size());
+
+    for (const auto& entry : ranked)
+        results.push_back(entry.second);
+
+    return results;
+}
+
+std::vector<SearchIndex::TokenMatch> SearchIndex::findWord(const std::string& word, bool isPrefix) const
+{
+    std::vector<TokenMatch> matches;
+
+    auto exact = tokens.find(word);
+    if (exact != tokens.end())
+        matches.push_back({ &exact->second.postings, 1.0f });
+
+    if (isPrefix)
+    {
+        int expansions = 0;
+
+        for (auto it = tokens.upper_bound(word);
+             it != tokens.end() && it->first.compare(0, word.size(), word) == 0 && expansions < maxPrefixExpansions;
+             ++it, ++expansions)
+        {
+            matches.push_back({ &it->second.postings, prefixQuality });
+        }
+    }
+
+    int maxEdits = getMaxEdits(word.size());
+    if (maxEdits == 0)
+        return matches;
+
+    // Each mistake spoils at most three bigrams (two swapped letters do), so a near
+    // miss still shares the rest. Bigrams rather than trigrams, as a short word has
+    // too few trigrams left after one mistake.
+    auto wordBigrams = getWordBigrams(word);
+    int needed = static_cast<int>(wordBigrams.size()) - 3 * maxEdits;
+    if (needed < 1)
+        return matches;
+
+    // Counted per token number; tokens too short or too long to be within reach are skipped
+    auto& shared = scratch.sharedBigrams;
+    if (shared.size() < tokensByNumber.size())
+        shared.resize(tokensByNumber.size(), 0);
+
+    std::vector<juce::uint32> touched;
+
+    for (auto bigram : wordBigrams)
+    {
+        auto found = tokenBigrams.find(bigram);
+        if (found == tokenBigrams.end())
+            continue;
+
+        for (auto number : found->second)
+        {
+            auto length = static_cast<int>(tokensByNumber[number]->first.size());
+            auto difference = length - static_cast<int>(word.size());
+
+            if (difference < -maxEdits || (difference > maxEdits && !isPrefix))
+                continue;
+
+            if (shared[number] == 0)
+                touched.push_back(number);
+
+            if (shared[number] < 255)
+                ++shared[number];
+        }
+    }
+
+    for (auto number : touched)
+    {
+        const auto& [token, entry] = *tokensByNumber[number];
+        bool alreadyMatched = token == word || (isPrefix && token.compare(0, word.size(), word) == 0);
+        auto numShared = shared[number];
+        shared[number] = 0;
+
+        if (numShared < needed || alreadyMatched)
+            continue;
+
+        int distance = getEditDistance(word, token, maxEdits);
+
+        if (distance <= maxEdits)
+        {
+            matches.push_back({ &entry.postings, 0.8f - 0.15f * static_cast<float>(distance - 1) });
+        }
+        else if (isPrefix && token.size() > word.size()
+                 && getEditDistance(word, token.substr(0, word.size()), maxEdits) <= maxEdits)
+        {
+            matches.push_back({ &entry.postings, fuzzyPrefixQuality });
+        }
+    }
+
+    return matches;
+}
+
+void SearchIndex::addToken(TokenMap::value_type& token)
+{
+    juce::uint32 number;
+
+    if (!freeNumbers.empty())
+    {
+        number = freeNumbers.back();
+        freeNumbers.pop_back();
+        tokensByNumber[number] = &token;
+    }
+    else
+    {
+        number = static_cast<juce::uint32>(tokensByNumber.size());
+        tokensByNumber.push_back(&token);
+    }
+
+    token.second.number = number;
+
+    for (auto bigram : getWordBigrams(token.first))
+        tokenBigrams[bigram].push_back(number);
+}
+
+void SearchIndex::removeToken(const TokenMap::value_type& token)
+{
+    auto number = token.second.number;
+
+    for (auto bigram : getWordBigrams(token.first))
+    {
+        auto found = tokenBigrams.find(bigram);
+        if (found == tokenBigrams.end())
+            continue;
+
+        auto& list = found->second;
+        list.erase(std::remove(list.begin(), list.end(), number), list.end());
+
+        if (list.empty())
+            tokenBigrams.erase(found);
+    }
+
+    tokensByNumber[number] = nullptr;
+    freeNumbers.push_back(number);
+}
+
+std::vector<SearchIndex::DocId> SearchIndex::searchTrigrams(const std::string& query) const
+{
+    std::vector<const std::vector<DocId>*> lists;
+
+    for (auto trigram : getTrigrams(query))
+    {
+        auto found = trigrams.find(trigram);
+        if (found == trigrams.end())
+            return {};
+
+        lists.push_back(&found->second);
+    }
+
+    // Start from the rarest trigram so the candidate list is short from the outset
+    std::sort(lists.begin(), lists.end(), [](const auto* a, const auto* b) { return a->size() < b->size(); });
+
+    std::vector<DocId> candidates = *lists.front();
+
+    for (size_t i = 1; i < lists.size() && !candidates.empty(); ++i)
+    {
+        const auto& postings = *lists[i];
+        candidates.erase(std::remove_if(candidates.begin(), candidates.end(), [&postings](DocId id) {
+            return !std::binary_search(postings.begin(), postings.end(), id);
+        }), candidates.end());
+    }
+
+    // Holding every trigram doesn't mean holding them in a row; one trigram on its own does
+    if (query.size() > 3)
+    {
+        candidates.erase(std::remove_if(candidates.begin(), candidates.end(), [this, &query](DocId id) {
+            return documents[id].find(query) == std::string::npos;
+        }), candidates.end());
+    }
+
+    return candidates;
+}
+
+std::vector<SearchIndex::DocId> SearchIndex::searchPrefix(const std::string& query) const
+{
+    // One or two bytes: too short for a trigram, so match the start of a word
+    if (!isTokenByte(static_cast<unsigned char>(query.front())) || !isTokenByte(static_cast<unsigned char>(query.back())))
+        return searchAll(query);
+
+    // Many words can share a short prefix; their postings are gathered and merged,
+    // so the cost follows the matches rather than the size of the library
+    std::vector<DocId> results;
+
+    for (auto it = tokens.lower_bound(query); it != tokens.end() && it->first.compare(0, query.size(), query) == 0; ++it)
+        results.insert(results.end(), it->second.postings.begin(), it->second.postings.end());
+
+    std::sort(results.begin(), results.end());
+    results.erase(std::unique(results.begin(), results.end()), results.end());
+    return results;
+}
+
+std::vector<SearchIndex::DocId> SearchIndex::searchAll(const std::string& query) const
+{
+    // Only for short queries made of punctuation, which no posting list covers
+    std::vector<DocId> results;
+
+    for (size_t id = 0; id < documents.size(); ++id)
+    {
+        if (!documents[id].empty() && documents[id].find(query) != std::string::npos)
+            results.push_back(static_cast<DocId>(id));
+    }
+
+    return results;
+}
+
+std::string SearchIndex::fold(const juce::String& text)
+{
+    auto folded = text.toLowerCase().toStdString();
+
+    // Fields are joined by the separator, so a query must never contain it
+    std::replace(folded.begin(), folded.end(), fieldSeparator, ' ');
+    return folded;
+}
+
+std::string SearchIndex::makeDocument(const Track& track)
+{
+    return fold(track.getTitle()) + fieldSeparator
+         + fold(track.getArtist()) + fieldSeparator
+         + fold(track.getAlbum()) + fieldSeparator
+         + fold(track.getFileName());
+}
+
+std::vector<juce::uint32> SearchIndex::getTrigrams(const std::string& text)
+{
+    std::vector<juce::uint32> result;
+
+    for (size_t i = 0; i + 2 < text.size(); ++i)
+    {
+        auto a = static_cast<unsigned char>(text[i]);
+        auto b = static_cast<unsigned char>(text[i + 1]);
+        auto c = static_cast<unsigned char>(text[i + 2]);
+
+        // Runs never cross from one field into the next
+        if (a == fieldSeparator || b == fieldSeparator || c == fieldSeparator)
+            continue;
+
+        result.push_back((static_cast<juce::uint32>(a) << 16) | (static_cast<juce::uint32>(b) << 8) | c);
+    }
+
+    std::sort(result.begin(), result.end());
+    result.erase(std::unique(result.begin(), result.end()), result.end());
+    return result;
+}
+
+std::vector<std::string> SearchIndex::getTokens(const std::string& text)
+{
+    auto result = splitWords(text);
+    std::sort(result.begin(), result.end());
+    result.erase(std::unique(result.begin(), result.end()), result.end());
+    return result;
+}
+
+std::vector<std::string> SearchIndex::splitWords(const std::string& text)
+{
+    std::vector<std::string> result;
+    size_t start = 0;
+
+    for (size_t i = 0; i <= text.size(); ++i)
+    {
+        if (i < text.size() && isTokenByte(static_cast<unsigned char>(text[i])))
+            continue;
+
+        if (i > start)
+            result.push_back(text.substr(start, i - start));
+
+        start = i + 1;
+    }
+
+    return result;
+}
+
+std::vector<juce::uint32> SearchIndex::getWordBigrams(const std::string& word)
+{
+    // Padded so the first and last letters count as much as the middle ones
+    auto padded = '\x01' + word + '\x02';
+    std::vector<juce::uint32> result;
+
+    for (size_t i = 0; i + 1 < padded.size(); ++i)
+        result.push_back((static_cast<juce::uint32>(static_cast<unsigned char>(padded[i])) << 8) | static_cast<unsigned char>(padded[i + 1]));
+
+    std::sort(result.begin(), result.end());
+    result.erase(std::unique(result.begin(), result.end()), result.end());
+    return result;
+}
+
+int SearchIndex::getEditDistance(const std::string& a, const std::string& b, int maxEdits)
+{
+    // Swapped neighbours count as one mistake, as they're the usual slip when typing fast.
+    // Gives up with maxEdits + 1 once the distance can't stay within maxEdits.
+    if (std::abs(static_cast<int>(a.size()) - static_cast<int>(b.size())) > maxEdits)
+        return maxEdits + 1;
+
+    std::vector<int> beforePrevious(b.size() + 1), previous(b.size() + 1), current(b.size() + 1);
+
+    for (size_t j = 0; j <= b.size(); ++j)
+        previous[j] = static_cast<int>(j);
+
+    for (size_t i = 1; i <= a.size(); ++i)
+    {
+        current[0] = static_cast<int>(i);
+        int rowMinimum = current[0];
+
+        for (size_t j = 1; j <= b.size(); ++j)
+        {
+            int cost = a[i - 1] == b[j - 1] ? 0 : 1;
+            current[j] = std::min({ previous[j] + 1, current[j - 1] + 1, previous[j - 1] + cost });
+
+            if (i > 1 && j > 1 && a[i - 1] == b[j - 2] && a[i - 2] == b[j - 1])
+                current[j] = std::min(current[j], beforePrevious[j - 2] + 1);
+
+            rowMinimum = std::min(rowMinimum, current[j]);
+        }
+
+        if (rowMinimum > maxEdits)
+            return maxEdits + 1;
+
+        std::swap(beforePrevious, previous);
+        std::swap(previous, current);
+    }
+
+    return std::min(previous[b.size()], maxEdits + 1);
+}
+
+bool SearchIndex::isTokenByte(unsigned char byte)
+{
+    // Anything outside ASCII is part of a word; the text is UTF-8
+    return byte >= 0x80 || std::isalnum(byte) != 0;
+}
+
+void SearchIndex::insertPosting(std::vector<DocId>& postings, DocId id)
+{
+    // Ids are mostly handed out in rising order, so this is nearly always an append
+    if (postings.empty() || postings.back() < id)
+    {
+        postings.push_back(id);
+        return;
+    }
+
+    auto position = std::lower_bound(postings.begin(), postings.end(), id);
+    if (position == postings.end() || *position != id)
+        postings.insert(position, id);
+}
+
+bool SearchIndex::erasePosting(std::vector<DocId>& postings, DocId id)
+{
+    auto position = std::lower_bound(postings.begin(), postings.end(), id);
+    if (position != postings.end() && *position == id)
+        postings.erase(position);
+
+    return postings.empty();
+}
@@ -0,0 +1,114 @@
+#pragma once
+#include <JuceHeader.h>
+#include "Track.h"
+#include <map>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+// Inverted index over the searchable fields of a track list: title, artist,
+// album and file name, case-folded. Every three-byte run of a field points at
+// the tracks containing it, so a query of three or more bytes only has to
+// check the tracks that hold all of its trigrams. Shorter queries match the
+// start of a word through the token list, kept sorted so a prefix is one
+// range. Words are themselves indexed by their letter pairs, which is how a
+// mistyped word finds the words it could have meant without going through
+// them all. Tracks are known by ids the owner hands out, which stay put while
+// the list is sorted or reordered; adding, updating and removing a track
+// only touches that track's postings.
+class SearchIndex
+{
+public:
+    using DocId = juce::uint32;
+
+    SearchIndex() = default;
+
+    void add(DocId id, const Track& track);  // replaces whatever the id held before
+    void remove(DocId id);
+    void clear();
+    void setPlayCount(DocId id, int playCount);
+    int getNumDocuments() const { return numDocuments; }
+    juce::uint32 getVersion() const { return version; } // moves on with every change
+
+    // Ids in ascending order of tracks where the query appears in one field.
+    // Queries under three bytes match the start of a word instead; an empty
+    // query matches everything.
+    std::vector<DocId> search(const juce::String& query) const;
+
+    // A query containing an earlier one of three bytes or more can only match
+    // fewer tracks, so its results are found by filtering the earlier ones.
+    // Only valid while the version is the one the earlier search saw.
+    static bool canRefine(const juce::String& previousQuery, const juce::String& query);
+    std::vector<DocId> refine(const std::vector<DocId>& previousResults, const juce::String& query) const;
+
+    // Best matches first. Every word of the query has to be close to a word of
+    // the track: the same, its start (for the word still being typed), or a
+    // few typing mistakes away. substringMatches, the results of search() or
+    // refine() for the same query, are mixed in so nothing they found is lost.
+    // Often-played tracks are lifted above equally good matches.
+    // Ranking reuses working space kept in the index, so rankings on one index
+    // must not overlap; the owner's lock around its searches sees to that.
+    std::vector<DocId> rank(const juce::String& query, const std::vector<DocId>& substringMatches) const;
+
+private:
+    static constexpr char fieldSeparator = '\n';
+
+    // Folded fields joined by the separator; empty when the id isn't in use
+    std::vector<std::string> documents;
+    std::vector<int> playCounts;
+    int numDocuments = 0;
+    juce::uint32 version = 0;
+
+    // Postings are sorted ids
+    std::unordered_map<juce::uint32, std::vector<DocId>> trigrams;
+    struct Token
+    {
+        std::vector<DocId> postings;
+        juce::uint32 number = 0; // its place in tokensByNumber
+    };
+
+    using TokenMap = std::map<std::string, Token>;
+
+    TokenMap tokens;
+    std::vector<const TokenMap::value_type*> tokensByNumber; // numbers of removed tokens are reused
+    std::vector<juce::uint32> freeNumbers;
+    std::unordered_map<juce::uint32, std::vector<juce::uint32>> tokenBigrams; // token numbers, padded at both ends
+
+    // Per track and per token, grown to fit and left zeroed between rankings,
+    // so a keystroke only pays for the entries it touches
+    struct Scratch
+    {
+        std::vector<float> scores;
+        std::vector<float> bestForWord;
+        std::vector<juce::uint32> wordsMatched;
+        std::vector<juce::uint8> sharedBigrams;
+    };
+
+    mutable Scratch scratch;
+
+    struct TokenMatch
+    {
+        const std::vector<DocId>* postings = nullptr;
+        float quality = 0.0f;
+    };
+
+    static std::string fold(const juce::String& text);
+    static std::string makeDocument(const Track& track);
+    static std::vector<juce::uint32> getTrigrams(const std::string& text);
+    static std::vector<std::string> getTokens(const std::string& text);
+    static std::vector<std::string> splitWords(const std::string& text);
+    static std::vector<juce::uint32> getWordBigrams(const std::string& word);
+    static int getEditDistance(const std::string& a, const std::string& b, int maxEdits);
+    static bool isTokenByte(unsigned char byte);
+    static void insertPosting(std::vector<DocId>& postings, DocId id);
+    static bool erasePosting(std::vector<DocId>& postings, DocId id);
+
+    std::vector<DocId> searchTrigrams(const std::string& query) const;
+    std::vector<DocId> searchPrefix(const std::string& query) const;
+    std::vector<DocId> searchAll(const std::string& query) const;
+    std::vector<TokenMatch> findWord(const std::string& word, bool isPrefix) const;
+    void addToken(TokenMap::value_type& token);
+    void removeToken(const TokenMap::value_type& token);
+
+    JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR(SearchIndex)
+};
@@ -0,0 +1,338 @@
+#include "SeekIndex.h"
+#include "IndexedMp3Reader.h"
+#include <algorithm>
+#include <cstring>
+#include <limits>
+
+namespace
+{
+    constexpr int indexMagic = 0x49534a44; // "DJSI"
+    constexpr int indexVersion = 1;
+    constexpr int maxCachedIndexes = 4;
+
+    bool readHeaderAt(juce::InputStream& stream, juce::int64 position, SeekIndex::FrameHeader& header)
+    {
+        juce::uint8 bytes[4];
+        return stream.setPosition(position) && stream.read(bytes, 4) == 4 && SeekIndex::parseFrameHeader(bytes, header);
+    }
+
+    bool matches(const SeekIndex::FrameHeader& a, const SeekIndex::FrameHeader& b)
+    {
+        return a.sampleRate == b.sampleRate && a.samples == b.samples && a.layer == b.layer;
+    }
+
+    // Encoder info frames (Xing / Info / VBRI) look like audio frames but hold none
+    bool isInfoFrame(juce::InputStream& stream, juce::int64 position, const SeekIndex::FrameHeader& header)
+    {
+        char tag[4];
+
+        if (header.layer == 3 && stream.setPosition(position + 4 + header.sideInfoSize) && stream.read(tag, 4) == 4
+            && (std::memcmp(tag, "Xing", 4) == 0 || std::memcmp(tag, "Info", 4) == 0))
+            return true;
+
+        return stream.setPosition(position + 36) && stream.read(tag, 4) == 4 && std::memcmp(tag, "VBRI", 4) == 0;
+    }
+
+    juce::int64 skipId3v2(juce::InputStream& stream)
+    {
+        juce::uint8 tag[10];
+        if (!stream.setPosition(0) || stream.read(tag, 10) < 10 || std::memcmp(tag, "ID3", 3) != 0)
+            return 0;
+
+        juce::int64 size = (tag[6] & 0x7f) << 21 | (tag[7] & 0x7f) << 14 | (tag[8] & 0x7f) << 7 | (tag[9] & 0x7f);
+        bool hasFooter = (tag[5] & 0x10) != 0;
+        return 10 + size + (hasFooter ? 10 : 0);
+    }
+
+    // Past junk between frames: a sync word only counts if another frame follows it
+    juce::int64 findNextFrame(juce::InputStream& stream, juce::int64 from, juce::int64 length, const SeekIndex::FrameHeader* reference)
+    {
+        SeekIndex::FrameHeader candidate, following;
+
+        for (auto position = from; position + 4 <= length; ++position)
+        {
+            if (!readHeaderAt(stream, position, candidate) || (reference != nullptr && !matches(candidate, *reference)))
+                continue;
+
+            auto next = position + candidate.length;
+            if (next == length || (readHeaderAt(stream, next, following) && matches(candidate, following)))
+                return position;
+        }
+
+        return -1;
+    }
+}
+
+bool SeekIndex::parseFrameHeader(const juce::uint8* bytes, FrameHeader& header)
+{
+    static const int bitrates[2][3][15] = {
+        { { 0, 32, 64, 96, 128, 160, 192, 224, 256, 288, 320, 352, 384, 416, 448 },
+          { 0, 32, 48, 56, 64, 80, 96, 112, 128, 160, 192, 224, 256, 320, 384 },
+          { 0, 32, 40, 48, 56, 64, 80, 96, 112, 128, 160, 192, 224, 256, 320 } },
+        { { 0, 32, 48, 56, 64, 80, 96, 112, 128, 144, 160, 176, 192, 224, 256 },
+          { 0, 8, 16, 24, 32, 40, 48, 56, 64, 80, 96, 112, 128, 144, 160 },
+          { 0, 8, 16, 24, 32, 40, 48, 56, 64, 80, 96, 112, 128, 144, 160 } }
+    };
+    static const int sampleRates[3] = { 44100, 48000, 32000 };
+
+    if (bytes[0] != 0xff || (bytes[1] & 0xe0) != 0xe0)
+        return false;
+
+    int version = (bytes[1] >> 3) & 3; // 0 = MPEG 2.5, 2 = MPEG 2, 3 = MPEG 1
+    int layer = 4 - ((bytes[1] >> 1) & 3);
+    int bitrateIndex = bytes[2] >> 4;
+    int rateIndex = (bytes[2] >> 2) & 3;
+    int padding = (bytes[2] >> 1) & 1;
+
+    // Free-format frames have no length in the header; those files keep the plain reader
+    if (version == 1 || layer == 4 || bitrateIndex == 0 || bitrateIndex == 15 || rateIndex == 3)
+        return false;
+
+    bool mpeg1 = version == 3;
+    bool mono = (bytes[3] >> 6) == 3;
+    int kbps = bitrates[mpeg1 ? 0 : 1][layer - 1][bitrateIndex];
+
+    header.layer = layer;
+    header.kbps = kbps;
+    header.sampleRate = sampleRates[rateIndex] >> (mpeg1 ? 0 : (version == 2 ? 1 : 2));
+    header.channels = mono ? 1 : 2;
+    header.sideInfoSize = mpeg1 ? (mono ? 17 : 32) : (mono ? 9 : 17);
+
+    if (layer == 1)
+    {
+        header.samples = 384;
+        header.length = (12000 * kbps / header.sampleRate + padding) * 4;
+    }
+    else
+    {
+        header.samples = (layer == 3 && !mpeg1) ? 576 : 1152;
+        header.length = header.samples / 8 * 1000 * kbps / header.sampleRate + padding;
+    }
+
+    return header.length > 4;
+}
+
+SeekIndex::SeekIndex()
+{
+}
+
+bool SeekIndex::build(const juce::File& audioFile, const std::atomic<bool>& shouldStop)
+{
+    frameOffsets.clear();
+
+    auto fileStream = audioFile.createInputStream();
+    if (fileStream == nullptr || !fileStream->openedOk())
+        return false;
+
+    juce::BufferedInputStream stream(fileStream.release(), 65536, true);
+    auto length = stream.getTotalLength();
+
+    // Offsets are stored as 32 bits
+    if (length <= 0 || length > static_cast<juce::int64>(std::numeric_limits<juce::uint32>::max()))
+        return false;
+
+    FrameHeader first, header;
+    auto position = findNextFrame(stream, skipId3v2(stream), length, nullptr);
+
+    // Walk header to header; only the 4 header bytes of each frame are read
+    while (position >= 0 && position + 4 <= length)
+    {
+        // A cancelled job (a newer deck load, or shutdown) is waited on, so stop promptly
+        if ((frameOffsets.size() & 1023) == 0 && shouldStop.load())
+            return false;
+
+        if (!readHeaderAt(stream, position, header) || (!frameOffsets.empty() && !matches(header, first)))
+        {
+            position = findNextFrame(stream, position + 1, length, frameOffsets.empty() ? nullptr : &first);
+            continue;
+        }
+
+        // A truncated last frame decodes to nothing useful
+        if (position + header.length > length)
+            break;
+
+        if (frameOffsets.empty())
+        {
+            if (isInfoFrame(stream, position, header))
+            {
+                position += header.length;
+                continue;
+            }
+
+            first = header;
+        }
+
+        frameOffsets.push_back(static_cast<juce::uint32>(position));
+        position += header.length;
+    }
+
+    if (frameOffsets.empty())
+        return false;
+
+    fileSize = audioFile.getSize();
+    modificationTime = audioFile.getLastModificationTime().toMilliseconds();
+    samplesPerFrame = first.samples;
+    sampleRate = first.sampleRate;
+    numChannels = first.channels;
+    return true;
+}
+
+bool SeekIndex::load(const juce::File& indexFile, const juce::File& audioFile)
+{
+    frameOffsets.clear();
+
+    juce::MemoryBlock data;
+    if (!indexFile.loadFileAsData(data))
+        return false;
+
+    juce::MemoryInputStream in(data, false);
+
+    if (in.readInt() != indexMagic || in.readInt() != indexVersion)
+        return false;
+
+    // Stale once the audio file has changed
+    fileSize = in.readInt64();
+    modificationTime = in.readInt64();
+    if (fileSize != audioFile.getSize() || modificationTime != audioFile.getLastModificationTime().toMilliseconds())
+        return false;
+
+    sampleRate = in.readDouble();
+    numChannels = in.readInt();
+    samplesPerFrame = in.readInt();
+    int numFrames = in.readInt();
+
+    if (numFrames <= 0 || samplesPerFrame <= 0 || numChannels <= 0 || sampleRate <= 0.0
+        || in.getNumBytesRemaining() < static_cast<juce::int64>(numFrames) * 4)
+        return false;
+
+    frameOffsets.resize(static_cast<size_t>(numFrames));
+    for (auto& offset : frameOffsets)
+        offset = static_cast<juce::uint32>(in.readInt());
+
+    return true;
+}
+
+bool SeekIndex::save(const juce::File& indexFile) const
+{
+    if (!isValid() || !indexFile.getParentDirectory().createDirectory())
+        return false;
+
+    juce::MemoryOutputStream out;
+    out.writeInt(indexMagic);
+    out.writeInt(indexVersion);
+    out.writeInt64(fileSize);
+    out.writeInt64(modificationTime);
+    out.writeDouble(sampleRate);
+    out.writeInt(numChannels);
+    out.writeInt(samplesPerFrame);
+    out.writeInt(getNumFrames());
+
+    for (auto offset : frameOffsets)
+        out.writeInt(static_cast<int>(offset));
+
+    // Written to a temporary file and moved over, so a reader never sees half an index
+    return indexFile.replaceWithData(out.getData(), out.getDataSize());
+}
+
+juce::int64 SeekIndex::getFrameOffset(int frame) const
+{
+    if (frameOffsets.empty())
+        return 0;
+
+    return frameOffsets[static_cast<size_t>(juce::jlimit(0, getNumFrames() - 1, frame))];
+}
+
+int SeekIndex::getFrameForSample(juce::int64 sample) const
+{
+    return static_cast<int>(juce::jlimit<juce::int64>(0, juce::jmax(0, getNumFrames() - 1), sample / samplesPerFrame));
+}
+
+juce::AudioFormatReader* SeekIndex::createReaderFor(juce::AudioFormatManager& formatManager, const juce::File& file)
+{
+    auto* format = formatManager.findFormatForFileExtension(file.getFileExtension());
+
+    if (format != nullptr)
+    {
+        if (auto index = getIndexFor(file))
+            return new IndexedMp3Reader(file, index, *format);
+    }
+
+    return formatManager.createReaderFor(file);
+}
+
+std::shared_ptr<const SeekIndex> SeekIndex::getIndexFor(const juce::File& audioFile)
+{
+    return findIndex(audioFile, nullptr);
+}
+
+bool SeekIndex::needsIndex(const juce::File& audioFile)
+{
+    if (!audioFile.hasFileExtension(".mp3"))
+        return false;
+
+    // Checked without taking a place among the recent indexes the decks are using
+    SeekIndex index;
+    return !index.load(getIndexFileFor(audioFile), audioFile);
+}
+
+bool SeekIndex::buildIndexFor(const juce::File& audioFile, const std::atomic<bool>& shouldStop)
+{
+    return findIndex(audioFile, &shouldStop) != nullptr;
+}
+
+std::shared_ptr<const SeekIndex> SeekIndex::findIndex(const juce::File& audioFile, const std::atomic<bool>* buildUnlessStopped)
+{
+    // AAC/M4A stay on the platform decoders, which seek through the container's own sample tables
+    if (!audioFile.hasFileExtension(".mp3"))
+        return nullptr;
+
+    // Each deck opens a track several times (stream, loader, analysis); keep the last few around
+    static juce::CriticalSection cacheLock;
+    static std::vector<std::pair<juce::String, std::shared_ptr<const SeekIndex>>> recent;
+
+    auto path = audioFile.getFullPathName();
+
+    {
+        const juce::ScopedLock sl(cacheLock);
+
+        for (auto& entry : recent)
+        {
+            if (entry.first == path && entry.second->fileSize == audioFile.getSize()
+                && entry.second->modificationTime == audioFile.getLastModificationTime().toMilliseconds())
+                return entry.second;
+        }
+    }
+
+    auto index = std::make_shared<SeekIndex>();
+    auto indexFile = getIndexFileFor(audioFile);
+
+    if (!index->load(indexFile, audioFile))
+    {
+        if (buildUnlessStopped == nullptr || !index->build(audioFile, *buildUnlessStopped))
+            return nullptr;
+
+        index->save(indexFile);
+    }
+
+    const juce::ScopedLock sl(cacheLock);
+
+    recent.erase(std::remove_if(recent.begin(), recent.end(),
+                                [&path](const auto& entry) { return entry.first == path; }),
+                 recent.end());
+    recent.insert(recent.begin(), { path, index });
+
+    if (recent.size() > static_cast<size_t>(maxCachedIndexes))
+        recent.pop_back();
+
+    return index;
+}
+
+juce::File SeekIndex::getIndexFileFor(const juce::File& audioFile)
+{
+    auto name = juce::String::toHexString(audioFile.getFullPathName().hashCode64()) + ".seekindex";
+
+    return juce::File::getSpecialLocation(juce::File::userApplicationDataDirectory)
+        .getChildFile(ProjectInfo::projectName)
+        .getChildFile("SeekIndex")
+        .getChildFile(name);
+}
@@ -0,0 +1,71 @@
+#pragma once
+#include <JuceHeader.h>
+#include <atomic>
+#include <memory>
+#include <vector>
+
+// Frame table for an MP3 file: the byte offset of every audio frame, so the
+// decoded sample position of any frame is just frame * samplesPerFrame.
+// It is built once by walking the frame headers (no decoding) and saved in
+// the app data folder, keyed by path and checked against size and date.
+// Building reads the whole file, so it only happens on background jobs (library
+// import, or a deck load that finds none); until then readers fall back to the
+// plain decoder. Readers made through createReaderFor() seek by opening the
+// file at the right frame instead of letting the decoder scan forward to it.
+class SeekIndex
+{
+public:
+    // Frames decoded and thrown away before the target to prime the overlap-add.
+    // Readers start further back still, as far as the bit reservoir can reach.
+    static constexpr int prerollFrames = 1;
+    static constexpr int maxReservoirBytes = 511;
+
+    // MPEG audio frame header, as much of it as walking and timing a file needs
+    struct FrameHeader
+    {
+        int length = 0;         // bytes, header included
+        int samples = 0;
+        int sampleRate = 0;
+        int channels = 0;
+        int sideInfoSize = 0;
+        int layer = 0;
+        int kbps = 0;
+    };
+
+    static bool parseFrameHeader(const juce::uint8* bytes, FrameHeader& header);
+
+    SeekIndex();
+
+    bool build(const juce::File& audioFile, const std::atomic<bool>& shouldStop); // gives up once shouldStop is set
+    bool load(const juce::File& indexFile, const juce::File& audioFile);
+    bool save(const juce::File& indexFile) const;
+
+    bool isValid() const { return !frameOffsets.empty(); }
+    int getNumFrames() const { return static_cast<int>(frameOffsets.size()); }
+    int getSamplesPerFrame() const { return samplesPerFrame; }
+    double getSampleRate() const { return sampleRate; }
+    int getNumChannels() const { return numChannels; }
+    juce::int64 getLengthInSamples() const { return static_cast<juce::int64>(getNumFrames()) * samplesPerFrame; }
+    juce::int64 getFrameOffset(int frame) const;
+    int getFrameForSample(juce::int64 sample) const;
+
+    // Indexed reader for MP3s that have an index; every other file comes straight
+    // from the format manager
+    static juce::AudioFormatReader* createReaderFor(juce::AudioFormatManager& formatManager, const juce::File& file);
+    static std::shared_ptr<const SeekIndex> getIndexFor(const juce::File& audioFile); // nullptr unless an indexed MP3
+    static bool needsIndex(const juce::File& audioFile);
+    static bool buildIndexFor(const juce::File& audioFile, const std::atomic<bool>& shouldStop); // background threads only; loads, or builds and saves
+    static juce::File getIndexFileFor(const juce::File& audioFile);
+
+private:
+    std::vector<juce::uint32> frameOffsets;
+    juce::int64 fileSize = 0;
+    juce::int64 modificationTime = 0;
+    int samplesPerFrame = 1152;
+    double sampleRate = 44100.0;
+    int numChannels = 2;
+
+    static std::shared_ptr<const SeekIndex> findIndex(const juce::File& audioFile, const std::atomic<bool>* buildUnlessStopped);
+
+    JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR(SeekIndex)
+};
@@ -0,0 +1,193 @@
+#include "SmartPlaylist.h"
+#include <algorithm>
+
+namespace
+{
+    const char* const fieldNames[] = { "title", "artist", "album", "genre", "key", "bpm", "playCount", "dateAdded" };
+    const char* const testNames[] = { "is", "contains", "between", "compatibleWith", "withinLastDays" };
+
+    constexpr juce::int64 millisecondsPerDay = 24 * 60 * 60 * 1000;
+
+    template <size_t size>
+    int findName(const char* const (&names)[size], const juce::String& name)
+    {
+        for (size_t i = 0; i < size; ++i)
+        {
+            if (name == names[i])
+                return static_cast<int>(i);
+        }
+
+        return -1;
+    }
+}
+
+SmartPlaylist::SmartPlaylist(const juce::String& playlistName, std::vector<Rule> playlistRules)
+    : name(playlistName), rules(std::move(playlistRules))
+{
+    auto& interner = StringInterner::getShared();
+
+    for (const auto& rule : rules)
+    {
+        CompiledRule compiledRule;
+        compiledRule.rule = rule;
+
+        if (rule.test == Rule::Test::Is && rule.field != Rule::Field::Title)
+            compiledRule.group = interner.getGroup(interner.intern(rule.text));
+        else if (rule.test == Rule::Test::CompatibleWith)
+            compiledRule.key = MusicalKey::parse(rule.text);
+
+        compiled.push_back(compiledRule);
+    }
+}
+
+bool SmartPlaylist::matches(const Track& track, juce::int64 now) const
+{
+    return std::all_of(compiled.begin(), compiled.end(), [&track, now](const CompiledRule& compiledRule) {
+        return matches(compiledRule, track, now);
+    });
+}
+
+bool SmartPlaylist::getGenre(StringInterner::Id& genreGroup) const
+{
+    for (const auto& compiledRule : compiled)
+    {
+        if (compiledRule.rule.field == Rule::Field::Genre && compiledRule.rule.test == Rule::Test::Is)
+        {
+            genreGroup = compiledRule.group;
+            return true;
+        }
+    }
+
+    return false;
+}
+
+juce::int64 SmartPlaylist::getMaxAge() const
+{
+    juce::int64 maxAge = -1;
+
+    for (const auto& rule : rules)
+    {
+        if (rule.test == Rule::Test::WithinLastDays)
+        {
+            auto age = static_cast<juce::int64>(rule.low * millisecondsPerDay);
+            maxAge = maxAge < 0 ? age : juce::jmin(maxAge, age);
+        }
+    }
+
+    return maxAge;
+}
+
+juce::String SmartPlaylist::toString() const
+{
+    juce::XmlElement playlist("SmartPlaylist");
+    playlist.setAttribute("name", name);
+
+    for (const auto& rule : rules)
+    {
+        auto* ruleElement = playlist.createNewChildElement("Rule");
+        ruleElement->setAttribute("field", juce::String(fieldNames[static_cast<size_t>(rule.field)]));
+        ruleElement->setAttribute("test", juce::String(testNames[static_cast<size_t>(rule.test)]));
+        ruleElement->setAttribute("text", rule.text);
+        ruleElement->setAttribute("low", rule.low);
+        ruleElement->setAttribute("high", rule.high);
+    }
+
+    return playlist.toString();
+}
+
+SmartPlaylist SmartPlaylist::fromString(const juce::String& text)
+{
+    auto xml = juce::XmlDocument::parse(text);
+    if (xml == nullptr || !xml->hasTagName("SmartPlaylist"))
+        return {};
+
+    std::vector<Rule> rules;
+
+    for (auto* ruleElement : xml->getChildWithTagNameIterator("Rule"))
+    {
+        auto field = findName(fieldNames, ruleElement->getStringAttribute("field"));
+        auto test = findName(testNames, ruleElement->getStringAttribute("test"));
+
+        // A rule this version can't read would match everything; the playlist is dropped instead
+        if (field < 0 || test < 0)
+            return {};
+
+        Rule rule;
+        rule.field = static_cast<Rule::Field>(field);
+        rule.test = static_cast<Rule::Test>(test);
+        rule.text = ruleElement->getStringAttribute("text");
+        rule.low = ruleElement->getDoubleAttribute("low");
+        rule.high = ruleElement->getDoubleAttribute("high");
+        rules.push_back(rule);
+    }
+
+    return SmartPlaylist(xml->getStringAttribute("name"), std::move(rules));
+}
+
+bool SmartPlaylist::matches(const CompiledRule& compiledRule, const Track& track, juce::int64 now)
+{
+    const auto& rule = compiledRule.rule;
+
+    switch (rule.test)
+    {
+        case Rule::Test::Is:
+            if (rule.field == Rule::Field::Title)
+                return track.getTitle().equalsIgnoreCase(rule.text);
+            if (rule.field == Rule::Field::BPM || rule.field == Rule::Field::PlayCount)
+                return getNumber(rule.field, track) == rule.low;
+            return StringInterner::getShared().getGroup(getTextId(rule.field, track)) == compiledRule.group;
+
+        case Rule::Test::Contains:
+            return getText(rule.field, track).containsIgnoreCase(rule.text);
+
+        case Rule::Test::Between:
+        {
+            auto value = getNumber(rule.field, track);
+            return value >= rule.low && value <= rule.high;
+        }
+
+        case Rule::Test::CompatibleWith:
+            return MusicalKey::areCompatible(MusicalKey::parse(track.getKey()), compiledRule.key);
+
+        case Rule::Test::WithinLastDays:
+            return track.getDateAdded() > 0
+                && now - track.getDateAdded() <= static_cast<juce::int64>(rule.low * millisecondsPerDay);
+    }
+
+    return false;
+}
+
+juce::String SmartPlaylist::getText(Rule::Field field, const Track& track)
+{
+    switch (field)
+    {
+        case Rule::Field::Title:  return track.getTitle();
+        case Rule::Field::Artist: return track.getArtist();
+        case Rule::Field::Album:  return track.getAlbum();
+        case Rule::Field::Genre:  return track.getGenre();
+        case Rule::Field::Key:    return track.getKey();
+        default:                  return {};
+    }
+}
+
+StringInterner::Id SmartPlaylist::getTextId(Rule::Field field, const Track& track)
+{
+    switch (field)
+    {
+        case Rule::Field::Artist: return track.getArtistId();
+        case Rule::Field::Album:  return track.getAlbumId();
+        case Rule::Field::Genre:  return track.getGenreId();
+        case Rule::Field::Key:    return track.getKeyId();
+        default:                  return StringInterner::emptyId;
+    }
+}
+
+double SmartPlaylist::getNumber(Rule::Field field, const Track& track)
+{
+    switch (field)
+    {
+        case Rule::Field::BPM:       return track.getBPM();
+        case Rule::Field::PlayCount: return track.getPlayCount();
+        default:                     return 0.0;
+    }
+}
@@ -0,0 +1,76 @@
+#pragma once
+#include <JuceHeader.h>
+#include "Track.h"
+#include "MusicalKey.h"
+#include "StringInterner.h"
+#include <vector>
+
+// A saved set of rules a track has to meet every one of, such as
+// genre is Techno, BPM between 124 and 128, key compatible with 8A and
+// added in the last 30 days. Which tracks meet them is kept by SmartPlaylists.
+class SmartPlaylist
+{
+public:
+    struct Rule
+    {
+        enum class Field
+        {
+            Title,
+            Artist,
+            Album,
+            Genre,
+            Key,
+            BPM,
+            PlayCount,
+            DateAdded
+        };
+
+        enum class Test
+        {
+            Is,             // text, ignoring case
+            Contains,       // text, ignoring case
+            Between,        // numbers, both ends included
+            CompatibleWith, // keys, on the Camelot wheel
+            WithinLastDays  // dates
+        };
+
+        Field field = Field::Genre;
+        Test test = Test::Is;
+        juce::String text;
+        double low = 0.0;
+        double high = 0.0;
+    };
+
+    SmartPlaylist() = default;
+    SmartPlaylist(const juce::String& name, std::vector<Rule> rules);
+
+    const juce::String& getName() const { return name; }
+    const std::vector<Rule>& getRules() const { return rules; }
+
+    bool matches(const Track& track, juce::int64 now) const;
+
+    // When the rules want a genre, tracks of other genres never match
+    bool getGenre(StringInterner::Id& genreGroup) const;
+    juce::int64 getMaxAge() const; // milliseconds after being added a track stops matching, or -1 if it never does
+
+    juce::String toString() const; // XML, for the library database
+    static SmartPlaylist fromString(const juce::String& text);
+
+private:
+    // Rules with what they compare against worked out once
+    struct CompiledRule
+    {
+        Rule rule;
+        StringInterner::Id group = StringInterner::emptyId;
+        MusicalKey::Camelot key;
+    };
+
+    juce::String name;
+    std::vector<Rule> rules;
+    std::vector<CompiledRule> compiled;
+
+    static bool matches(const CompiledRule& compiledRule, const Track& track, juce::int64 now);
+    static juce::String getText(Rule::Field field, const Track& track);
+    static StringInterner::Id getTextId(Rule::Field field, const Track& track);
+    static double getNumber(Rule::Field field, const Track& track);
+};
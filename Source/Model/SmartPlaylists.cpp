@@ -0,0 +1,202 @@
+#include "SmartPlaylists.h"
+
+SmartPlaylists::~SmartPlaylists()
+{
+    cancelPendingUpdate();
+    stopTimer();
+}
+
+int SmartPlaylists::addPlaylist(const SmartPlaylist& playlist)
+{
+    auto entry = std::make_unique<Entry>();
+    entry->playlist = playlist;
+    entry->maxAge = playlist.getMaxAge();
+    playlists.push_back(std::move(entry));
+
+    rebuildDispatch();
+    markChanged(*playlists.back());
+    return getNumPlaylists() - 1;
+}
+
+void SmartPlaylists::setPlaylist(int index, const SmartPlaylist& playlist)
+{
+    auto& entry = *playlists[static_cast<size_t>(index)];
+    entry.playlist = playlist;
+    entry.maxAge = playlist.getMaxAge();
+    entry.members.clear();
+
+    rebuildDispatch();
+    markChanged(entry);
+}
+
+void SmartPlaylists::removePlaylist(int index)
+{
+    playlists.erase(playlists.begin() + index);
+    rebuildDispatch();
+}
+
+void SmartPlaylists::check(int index, DocId id, const Track& track)
+{
+    remember(id, track);
+    check(*playlists[static_cast<size_t>(index)], id, track, juce::Time::currentTimeMillis());
+}
+
+void SmartPlaylists::trackChanged(DocId id, const Track& track)
+{
+    auto now = juce::Time::currentTimeMillis();
+    auto previousGenre = id < genres.size() ? genres[id] : unknownGenre;
+    auto genre = remember(id, track);
+
+    // Playlists wanting the old genre may have to let it go, those wanting the new one take it in
+    for (auto index : getCandidates(genre, previousGenre))
+        check(*playlists[index], id, track, now);
+}
+
+void SmartPlaylists::trackRemoved(DocId id)
+{
+    if (id >= genres.size() || genres[id] == unknownGenre)
+        return;
+
+    for (auto index : getCandidates(genres[id], unknownGenre))
+    {
+        auto& entry = *playlists[index];
+
+        if (entry.members.contains(id))
+        {
+            entry.members.remove(id);
+            markChanged(entry);
+        }
+    }
+
+    genres[id] = unknownGenre;
+}
+
+void SmartPlaylists::clearTracks()
+{
+    for (auto& entry : playlists)
+    {
+        if (!entry->members.isEmpty())
+        {
+            entry->members.clear();
+            markChanged(*entry);
+        }
+    }
+
+    genres.clear();
+    datesAdded.clear();
+}
+
+void SmartPlaylists::rebuildDispatch()
+{
+    playlistsByGenre.clear();
+    playlistsForAnyGenre.clear();
+    bool anyAge = false;
+
+    for (size_t index = 0; index < playlists.size(); ++index)
+    {
+        StringInterner::Id genre = StringInterner::emptyId;
+
+        if (playlists[index]->playlist.getGenre(genre))
+            playlistsByGenre[genre].push_back(index);
+        else
+            playlistsForAnyGenre.push_back(index);
+
+        anyAge = anyAge || playlists[index]->maxAge >= 0;
+    }
+
+    if (anyAge && !isTimerRunning())
+        startTimer(ageCheckIntervalMs);
+    else if (!anyAge)
+        stopTimer();
+}
+
+StringInterner::Id SmartPlaylists::remember(DocId id, const Track& track)
+{
+    if (genres.size() <= id)
+    {
+        genres.resize(id + 1, unknownGenre);
+        datesAdded.resize(id + 1, 0);
+    }
+
+    genres[id] = StringInterner::getShared().getGroup(track.getGenreId());
+    datesAdded[id] = track.getDateAdded();
+    return genres[id];
+}
+
+void SmartPlaylists::check(Entry& entry, DocId id, const Track& track, juce::int64 now)
+{
+    bool matches = entry.playlist.matches(track, now);
+
+    if (matches == entry.members.contains(id))
+        return;
+
+    if (matches)
+        entry.members.add(id);
+    else
+        entry.members.remove(id);
+
+    markChanged(entry);
+}
+
+std::vector<size_t> SmartPlaylists::getCandidates(StringInterner::Id genre, StringInterner::Id previousGenre) const
+{
+    auto candidates = playlistsForAnyGenre;
+
+    for (auto wanted : { genre, previousGenre })
+    {
+        auto found = playlistsByGenre.find(wanted);
+
+        if (found != playlistsByGenre.end())
+            candidates.insert(candidates.end(), found->second.begin(), found->second.end());
+
+        if (previousGenre == genre)
+            break;
+    }
+
+    return candidates;
+}
+
+void SmartPlaylists::markChanged(Entry& entry)
+{
+    entry.changed = true;
+    triggerAsyncUpdate();
+}
+
+void SmartPlaylists::timerCallback()
+{
+    auto now = juce::Time::currentTimeMillis();
+
+    // Time only ever takes tracks out, so only members need looking at
+    for (auto& entry : playlists)
+    {
+        if (entry->maxAge < 0)
+            continue;
+
+        std::vector<DocId> expired;
+
+        entry->members.forEach([this, &entry, &expired, now](DocId id) {
+            if (now - datesAdded[id] > entry->maxAge)
+                expired.push_back(id);
+        });
+
+        for (auto id : expired)
+            entry->members.remove(id);
+
+        if (!expired.empty())
+            markChanged(*entry);
+    }
+}
+
+void SmartPlaylists::handleAsyncUpdate()
+{
+    for (size_t index = 0; index < playlists.size(); ++index)
+    {
+        if (!playlists[index]->changed)
+            continue;
+
+        playlists[index]->changed = false;
+
+        if (onMembersChanged)
+            onMembersChanged(static_cast<int>(index));
+    }
+}
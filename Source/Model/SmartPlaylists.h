@@ -0,0 +1,72 @@
+#pragma once
+#include <JuceHeader.h>
+#include "SmartPlaylist.h"
+#include "IdBitmap.h"
+#include <memory>
+#include <unordered_map>
+#include <vector>
+
+// The smart playlists of one track list and which of its tracks each holds.
+// The owner reports every track it adds, changes or removes, and only the
+// playlists that track could be in are checked: a playlist that wants a
+// genre is filed under it, so a change to a house track never looks at the
+// techno playlists. Playlists with a "within the last days" rule are also
+// gone over now and then, as their oldest tracks age out. Listeners hear of
+// each changed playlist once, after a batch of changes. Message thread only.
+class SmartPlaylists : private juce::Timer, private juce::AsyncUpdater
+{
+public:
+    using DocId = IdBitmap::Id;
+
+    SmartPlaylists() = default;
+    ~SmartPlaylists() override;
+
+    int getNumPlaylists() const { return static_cast<int>(playlists.size()); }
+    const SmartPlaylist& getPlaylist(int index) const { return playlists[static_cast<size_t>(index)]->playlist; }
+    const IdBitmap& getMembers(int index) const { return playlists[static_cast<size_t>(index)]->members; }
+
+    // A new or changed playlist starts out empty; the owner fills it by
+    // checking each of its tracks that could match
+    int addPlaylist(const SmartPlaylist& playlist);
+    void setPlaylist(int index, const SmartPlaylist& playlist);
+    void removePlaylist(int index);
+    void check(int index, DocId id, const Track& track);
+
+    void trackChanged(DocId id, const Track& track); // added or changed
+    void trackRemoved(DocId id);
+    void clearTracks();
+
+    std::function<void(int index)> onMembersChanged;
+
+private:
+    static constexpr int ageCheckIntervalMs = 60 * 1000;
+    static constexpr StringInterner::Id unknownGenre = 0xffffffff;
+
+    struct Entry
+    {
+        SmartPlaylist playlist;
+        IdBitmap members;
+        juce::int64 maxAge = -1;
+        bool changed = false;
+    };
+
+    std::vector<std::unique_ptr<Entry>> playlists;
+
+    // Playlists by the genre they want; the rest have to see every track
+    std::unordered_map<StringInterner::Id, std::vector<size_t>> playlistsByGenre;
+    std::vector<size_t> playlistsForAnyGenre;
+
+    // What each track was filed under when it was last seen, by id
+    std::vector<StringInterner::Id> genres;
+    std::vector<juce::int64> datesAdded;
+
+    void rebuildDispatch();
+    StringInterner::Id remember(DocId id, const Track& track); // the genre it is filed under
+    void check(Entry& entry, DocId id, const Track& track, juce::int64 now);
+    std::vector<size_t> getCandidates(StringInterner::Id genre, StringInterner::Id previousGenre) const;
+    void markChanged(Entry& entry);
+    void timerCallback() override;
+    void handleAsyncUpdate() override;
+
+    JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR(SmartPlaylists)
+};
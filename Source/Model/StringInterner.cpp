@@ -0,0 +1,72 @@
+#include "StringInterner.h"
+
+StringInterner::StringInterner()
+{
+    intern({});
+}
+
+StringInterner& StringInterner::getShared()
+{
+    static StringInterner interner;
+    return interner;
+}
+
+StringInterner::Id StringInterner::intern(const juce::String& value)
+{
+    const juce::ScopedLock sl(lock);
+
+    auto found = ids.find(value);
+    if (found != ids.end())
+        return found->second;
+
+    auto id = static_cast<Id>(values.size());
+    values.push_back(value);
+    sortKeys.push_back(makeSortKey(value));
+    ids.emplace(value, id);
+
+    auto& sameIgnoringCase = spellings[value.toLowerCase()];
+    groups.push_back(sameIgnoringCase.empty() ? id : sameIgnoringCase.front());
+    sameIgnoringCase.push_back(id);
+
+    return id;
+}
+
+const juce::String& StringInterner::get(Id id) const
+{
+    const juce::ScopedLock sl(lock);
+    jassert(id < values.size());
+    return values[id];
+}
+
+const std::string& StringInterner::getSortKey(Id id) const
+{
+    const juce::ScopedLock sl(lock);
+    jassert(id < sortKeys.size());
+    return sortKeys[id];
+}
+
+std::string StringInterner::makeSortKey(const juce::String& value)
+{
+    // UTF-8 keeps code point order, so bytes compare like the lower-cased characters
+    return value.toLowerCase().toStdString();
+}
+
+int StringInterner::size() const
+{
+    const juce::ScopedLock sl(lock);
+    return static_cast<int>(values.size());
+}
+
+StringInterner::Id StringInterner::getGroup(Id id) const
+{
+    const juce::ScopedLock sl(lock);
+    return groups[id];
+}
+
+std::vector<StringInterner::Id> StringInterner::findIgnoringCase(const juce::String& value) const
+{
+    const juce::ScopedLock sl(lock);
+
+    auto found = spellings.find(value.toLowerCase());
+    return found != spellings.end() ? found->second : std::vector<Id>();
+}
@@ -0,0 +1,45 @@
+#pragma once
+#include <JuceHeader.h>
+#include <deque>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+// One copy of every artist, album, genre and key string in the program, each
+// known by a small id. Tracks hold the ids, so a library where a few thousand
+// names repeat across tens of thousands of tracks stores each name once, and
+// two values are the same exactly when their ids are. Ids are never taken
+// back, and the string behind an id never moves. Safe from any thread.
+class StringInterner
+{
+public:
+    using Id = juce::uint32;
+    static constexpr Id emptyId = 0; // the empty string
+
+    StringInterner();
+
+    static StringInterner& getShared();
+
+    Id intern(const juce::String& value);
+    const juce::String& get(Id id) const;
+    const std::string& getSortKey(Id id) const;
+    int size() const;
+
+    // Sort keys order values ignoring case when compared byte by byte, so a
+    // sort compares them without converting anything
+    static std::string makeSortKey(const juce::String& value);
+
+    // Values that differ only in case share a group, named by the first of them seen
+    Id getGroup(Id id) const;
+    std::vector<Id> findIgnoringCase(const juce::String& value) const; // every spelling of it seen so far
+
+private:
+    mutable juce::CriticalSection lock;
+    std::deque<juce::String> values; // a deque, so references to values stay put as it grows
+    std::deque<std::string> sortKeys;
+    std::vector<Id> groups; // by id
+    std::unordered_map<juce::String, Id> ids;
+    std::unordered_map<juce::String, std::vector<Id>> spellings; // by lower-case value, first seen first
+
+    JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR(StringInterner)
+};
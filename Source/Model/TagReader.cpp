@@ -0,0 +1,752 @@
+#include "TagReader.h"
+#include "SeekIndex.h"
+#include <cstring>
+#include <vector>
+
+namespace
+{
+    constexpr int maxTextBytes = 65536;       // bigger frames are pictures or lyrics, never read
+    constexpr int maxCommentBytes = 1 << 20;  // Vorbis comments can carry artwork too
+    constexpr int oggTailBytes = 65536;
+
+    //==============================================================================
+    juce::String readLatin1(const juce::uint8* data, int size)
+    {
+        juce::String text;
+
+        for (int i = 0; i < size && data[i] != 0; ++i)
+            text += static_cast<juce::juce_wchar>(data[i]);
+
+        return text;
+    }
+
+    juce::String readUtf8(const juce::uint8* data, int size)
+    {
+        int length = 0;
+        while (length < size && data[length] != 0)
+            ++length;
+
+        return juce::String::fromUTF8(reinterpret_cast<const char*>(data), length);
+    }
+
+    juce::String readUtf16(const juce::uint8* data, int size, bool bigEndian)
+    {
+        if (size >= 2 && ((data[0] == 0xff && data[1] == 0xfe) || (data[0] == 0xfe && data[1] == 0xff)))
+        {
+            bigEndian = data[0] == 0xfe;
+            data += 2;
+            size -= 2;
+        }
+
+        auto unitAt = [data, bigEndian](int i) {
+            return bigEndian ? (data[i] << 8 | data[i + 1]) : (data[i + 1] << 8 | data[i]);
+        };
+
+        juce::String text;
+
+        for (int i = 0; i + 1 < size; i += 2)
+        {
+            auto unit = unitAt(i);
+            if (unit == 0)
+                break;
+
+            auto character = static_cast<juce::juce_wchar>(unit);
+
+            // Surrogate pair
+            if (unit >= 0xd800 && unit < 0xdc00 && i + 3 < size)
+            {
+                auto low = unitAt(i + 2);
+
+                if (low >= 0xdc00 && low < 0xe000)
+                {
+                    character = static_cast<juce::juce_wchar>(0x10000 + ((unit - 0xd800) << 10) + (low - 0xdc00));
+                    i += 2;
+                }
+            }
+
+            text += character;
+        }
+
+        return text;
+    }
+
+    // Tags list the same field more than once; the first one found is kept
+    void setField(TagReader::Info& info, const juce::String& key, const juce::String& value)
+    {
+        if (value.isEmpty())
+            return;
+
+        if (key == "title" && info.title.isEmpty())
+            info.title = value;
+        else if (key == "artist" && info.artist.isEmpty())
+            info.artist = value;
+        else if (key == "album" && info.album.isEmpty())
+            info.album = value;
+        else if (key == "genre" && info.genre.isEmpty())
+            info.genre = value;
+        else if (key == "bpm" && info.bpm <= 0)
+            info.bpm = juce::roundToInt(value.getDoubleValue());
+        else if ((key == "key" || key == "initialkey") && info.key.isEmpty())
+            info.key = value;
+    }
+
+    //==============================================================================
+    // ID3
+    juce::int64 readSyncsafe(const juce::uint8* bytes)
+    {
+        return (bytes[0] & 0x7f) << 21 | (bytes[1] & 0x7f) << 14 | (bytes[2] & 0x7f) << 7 | (bytes[3] & 0x7f);
+    }
+
+    void removeUnsynchronisation(juce::MemoryBlock& data)
+    {
+        auto* bytes = static_cast<juce::uint8*>(data.getData());
+        size_t length = 0;
+
+        for (size_t i = 0; i < data.getSize(); ++i)
+        {
+            bytes[length++] = bytes[i];
+
+            if (bytes[i] == 0xff && i + 1 < data.getSize() && bytes[i + 1] == 0)
+                ++i;
+        }
+
+        data.setSize(length);
+    }
+
+    const char* getId3Key(const juce::uint8* id, int idLength)
+    {
+        static const char* const frames[][3] = {
+            { "TIT2", "TT2", "title" },
+            { "TPE1", "TP1", "artist" },
+            { "TALB", "TAL", "album" },
+            { "TCON", "TCO", "genre" },
+            { "TBPM", "TBP", "bpm" },
+            { "TKEY", "TKE", "key" }
+        };
+
+        for (const auto& frame : frames)
+        {
+            if (std::memcmp(id, frame[idLength == 4 ? 0 : 1], static_cast<size_t>(idLength)) == 0)
+                return frame[2];
+        }
+
+        return nullptr;
+    }
+
+    // Encoding byte, then the text; of several values only the first is kept
+    juce::String readId3Text(const juce::uint8* data, int size)
+    {
+        if (size < 2)
+            return {};
+
+        switch (data[0])
+        {
+            case 0:  return readLatin1(data + 1, size - 1).trim();
+            case 1:  return readUtf16(data + 1, size - 1, false).trim();
+            case 2:  return readUtf16(data + 1, size - 1, true).trim();
+            default: return readUtf8(data + 1, size - 1).trim();
+        }
+    }
+
+    // ID3 genres may read "(17)", "(17)Rock" or "17"; the text wins when there is one
+    juce::String cleanGenre(const juce::String& genre)
+    {
+        if (genre.startsWithChar('(') && genre.containsChar(')'))
+        {
+            auto name = genre.fromFirstOccurrenceOf(")", false, false).trim();
+            if (name.isNotEmpty())
+                return name;
+        }
+
+        return genre;
+    }
+
+    void readId3Frames(juce::InputStream& in, juce::int64 end, int version, TagReader::Info& info)
+    {
+        int idLength = version == 2 ? 3 : 4;
+        int headerSize = version == 2 ? 6 : 10;
+        juce::uint8 header[10];
+        juce::MemoryBlock data;
+
+        while (in.getPosition() + headerSize <= end && in.read(header, headerSize) == headerSize)
+        {
+            // Padding
+            if (header[0] == 0)
+                break;
+
+            juce::int64 size = version == 2 ? (header[3] << 16 | header[4] << 8 | header[5])
+                             : version == 4 ? readSyncsafe(header + 4)
+                                            : static_cast<juce::int64>(juce::ByteOrder::bigEndianInt(header + 4));
+            auto next = in.getPosition() + size;
+
+            if (size <= 0 || next > end)
+                break;
+
+            int format = version == 2 ? 0 : header[9];
+            bool packed = version == 3 ? (format & 0xc0) != 0 : (format & 0x0c) != 0; // compressed or encrypted
+            auto* key = getId3Key(header, idLength);
+
+            if (key != nullptr && !packed && size <= maxTextBytes)
+            {
+                // v2.4 frames can carry a data length and their own unsynchronisation
+                if (version == 4 && (format & 0x01) != 0)
+                {
+                    in.skipNextBytes(4);
+                    size -= 4;
+                }
+
+                data.setSize(static_cast<size_t>(juce::jmax<juce::int64>(0, size)));
+                if (in.read(data.getData(), static_cast<int>(data.getSize())) != static_cast<int>(data.getSize()))
+                    break;
+
+                if (version == 4 && (format & 0x02) != 0)
+                    removeUnsynchronisation(data);
+
+                auto text = readId3Text(static_cast<const juce::uint8*>(data.getData()), static_cast<int>(data.getSize()));
+                setField(info, key, std::strcmp(key, "genre") == 0 ? cleanGenre(text) : text);
+            }
+
+            if (!in.setPosition(next))
+                break;
+        }
+    }
+
+    void readId3Tag(juce::InputStream& in, int version, int flags, juce::int64 size, TagReader::Info& info)
+    {
+        if ((flags & 0x80) != 0 && version < 4)
+        {
+            // Whole-tag unsynchronisation moves the frame boundaries; undo it in memory first
+            if (size > maxCommentBytes)
+                return;
+
+            juce::MemoryBlock tag(static_cast<size_t>(size));
+            if (in.read(tag.getData(), static_cast<int>(size)) != static_cast<int>(size))
+                return;
+
+            removeUnsynchronisation(tag);
+            juce::MemoryInputStream frames(tag, false);
+
+            if (version == 3 && (flags & 0x40) != 0)
+                frames.skipNextBytes(4 + frames.readIntBigEndian());
+
+            readId3Frames(frames, static_cast<juce::int64>(tag.getSize()), version, info);
+            return;
+        }
+
+        auto end = in.getPosition() + size;
+
+        if (version >= 3 && (flags & 0x40) != 0)
+        {
+            juce::uint8 extended[4];
+            if (in.read(extended, 4) != 4)
+                return;
+
+            // v2.4 counts the size field itself, v2.3 doesn't
+            in.skipNextBytes(version == 4 ? readSyncsafe(extended) - 4
+                                          : static_cast<juce::int64>(juce::ByteOrder::bigEndianInt(extended)));
+        }
+
+        readId3Frames(in, end, version, info);
+    }
+
+    // Reads an ID3v2 tag at the stream's position, if there is one, and leaves the stream after it
+    juce::int64 readId3v2(juce::InputStream& in, TagReader::Info& info)
+    {
+        auto start = in.getPosition();
+        juce::uint8 header[10];
+
+        if (in.read(header, 10) != 10 || std::memcmp(header, "ID3", 3) != 0 || header[3] < 2 || header[3] > 4)
+        {
+            in.setPosition(start);
+            return start;
+        }
+
+        auto size = readSyncsafe(header + 6);
+        auto end = start + 10 + size + ((header[5] & 0x10) != 0 ? 10 : 0);
+
+        readId3Tag(in, header[3], header[5], size, info);
+        in.setPosition(end);
+        return end;
+    }
+
+    bool readId3v1(juce::InputStream& in, juce::int64 fileLength, TagReader::Info& info)
+    {
+        juce::uint8 tag[128];
+
+        if (fileLength < 128 || !in.setPosition(fileLength - 128) || in.read(tag, 128) != 128
+            || std::memcmp(tag, "TAG", 3) != 0)
+            return false;
+
+        setField(info, "title", readLatin1(tag + 3, 30).trim());
+        setField(info, "artist", readLatin1(tag + 33, 30).trim());
+        setField(info, "album", readLatin1(tag + 63, 30).trim());
+        return true;
+    }
+
+    //==============================================================================
+    bool readMp3(juce::InputStream& in, juce::int64 fileLength, TagReader::Info& info)
+    {
+        auto audioStart = readId3v2(in, info);
+        bool hasId3v1 = readId3v1(in, fileLength, info);
+
+        // The first frame: its Xing/Info or VBRI header, when there is one, holds the frame count
+        juce::uint8 bytes[4096];
+        if (!in.setPosition(audioStart))
+            return false;
+
+        int count = in.read(bytes, sizeof(bytes));
+        SeekIndex::FrameHeader header;
+        int frame = 0;
+
+        while (frame + 4 <= count && !SeekIndex::parseFrameHeader(bytes + frame, header))
+            ++frame;
+
+        if (frame + 4 > count)
+            return false;
+
+        juce::int64 numFrames = 0;
+        int xing = frame + 4 + header.sideInfoSize;
+        int vbri = frame + 36;
+
+        if (xing + 12 <= count && (std::memcmp(bytes + xing, "Xing", 4) == 0 || std::memcmp(bytes + xing, "Info", 4) == 0)
+            && (juce::ByteOrder::bigEndianInt(bytes + xing + 4) & 1) != 0)
+            numFrames = juce::ByteOrder::bigEndianInt(bytes + xing + 8);
+        else if (vbri + 18 <= count && std::memcmp(bytes + vbri, "VBRI", 4) == 0)
+            numFrames = juce::ByteOrder::bigEndianInt(bytes + vbri + 14);
+
+        if (numFrames > 0)
+        {
+            info.duration = static_cast<double>(numFrames * header.samples) / header.sampleRate;
+        }
+        else
+        {
+            // Constant bitrate: the audio bytes tell the length
+            auto audioBytes = fileLength - (audioStart + frame) - (hasId3v1 ? 128 : 0);
+            info.duration = static_cast<double>(audioBytes) * 8.0 / (header.kbps * 1000.0);
+        }
+
+        return true;
+    }
+
+    //==============================================================================
+    void readVorbisComments(const juce::uint8* data, int size, TagReader::Info& info)
+    {
+        int position = 0;
+
+        auto readLength = [&]() -> juce::int64 {
+            if (position + 4 > size)
+                return -1;
+
+            auto value = juce::ByteOrder::littleEndianInt(data + position);
+            position += 4;
+            return value;
+        };
+
+        auto vendorLength = readLength();
+        if (vendorLength < 0 || vendorLength > size - position)
+            return;
+
+        position += static_cast<int>(vendorLength);
+        auto numComments = readLength();
+
+        for (juce::int64 i = 0; i < numComments; ++i)
+        {
+            auto length = readLength();
+            if (length < 0 || length > size - position)
+                return;
+
+            auto comment = juce::String::fromUTF8(reinterpret_cast<const char*>(data + position), static_cast<int>(length));
+            position += static_cast<int>(length);
+
+            setField(info, comment.upToFirstOccurrenceOf("=", false, false).toLowerCase(),
+                     comment.fromFirstOccurrenceOf("=", false, false).trim());
+        }
+    }
+
+    bool readFlac(juce::InputStream& in, TagReader::Info& info)
+    {
+        // Some taggers put an ID3v2 tag in front
+        readId3v2(in, info);
+
+        char magic[4];
+        if (in.read(magic, 4) != 4 || std::memcmp(magic, "fLaC", 4) != 0)
+            return false;
+
+        juce::MemoryBlock data;
+        bool last = false;
+
+        while (!last)
+        {
+            juce::uint8 header[4];
+            if (in.read(header, 4) != 4)
+                break;
+
+            last = (header[0] & 0x80) != 0;
+            int type = header[0] & 0x7f;
+            int size = header[1] << 16 | header[2] << 8 | header[3];
+            auto next = in.getPosition() + size;
+
+            // Stream info and comments; pictures, seek tables and padding are skipped
+            if ((type == 0 && size >= 18) || (type == 4 && size <= maxCommentBytes))
+            {
+                data.setSize(static_cast<size_t>(size));
+                if (in.read(data.getData(), size) != size)
+                    break;
+
+                auto* bytes = static_cast<const juce::uint8*>(data.getData());
+
+                if (type == 0)
+                {
+                    int sampleRate = bytes[10] << 12 | bytes[11] << 4 | bytes[12] >> 4;
+                    auto totalSamples = static_cast<juce::int64>(bytes[13] & 0x0f) << 32 | juce::ByteOrder::bigEndianInt(bytes + 14);
+
+                    if (sampleRate > 0)
+                        info.duration = static_cast<double>(totalSamples) / sampleRate;
+                }
+                else
+                {
+                    readVorbisComments(bytes, size, info);
+                }
+            }
+
+            if (!in.setPosition(next))
+                break;
+        }
+
+        return true;
+    }
+
+    bool readOgg(juce::InputStream& in, juce::int64 fileLength, TagReader::Info& info)
+    {
+        // The identification and comment packets, joined up across page boundaries
+        std::vector<juce::MemoryBlock> packets;
+        juce::MemoryBlock packet;
+        juce::uint8 header[27];
+        juce::uint8 lacing[255];
+
+        while (packets.size() < 2 && in.read(header, 27) == 27 && std::memcmp(header, "OggS", 4) == 0)
+        {
+            int numSegments = header[26];
+            if (in.read(lacing, numSegments) != numSegments)
+                break;
+
+            for (int segment = 0; segment < numSegments && packets.size() < 2; ++segment)
+            {
+                auto offset = packet.getSize();
+                packet.setSize(offset + lacing[segment]);
+
+                if (in.read(static_cast<char*>(packet.getData()) + offset, lacing[segment]) != lacing[segment])
+                    return false;
+
+                if (lacing[segment] < 255)
+                {
+                    packets.push_back(std::move(packet));
+                    packet = {};
+                }
+            }
+
+            if (packet.getSize() > static_cast<size_t>(maxCommentBytes))
+                break;
+        }
+
+        if (packets.empty() || packets[0].getSize() < 30 || std::memcmp(packets[0].getData(), "\x01vorbis", 7) != 0)
+            return false;
+
+        auto sampleRate = juce::ByteOrder::littleEndianInt(static_cast<const char*>(packets[0].getData()) + 12);
+
+        if (packets.size() > 1 && packets[1].getSize() > 7 && std::memcmp(packets[1].getData(), "\x03vorbis", 7) == 0)
+            readVorbisComments(static_cast<const juce::uint8*>(packets[1].getData()) + 7,
+                               static_cast<int>(packets[1].getSize()) - 7, info);
+
+        // The length is the granule position of the last page
+        auto tailStart = juce::jmax<juce::int64>(0, fileLength - oggTailBytes);
+        juce::MemoryBlock tail(static_cast<size_t>(fileLength - tailStart));
+
+        if (sampleRate > 0 && in.setPosition(tailStart)
+            && in.read(tail.getData(), static_cast<int>(tail.getSize())) == static_cast<int>(tail.getSize()))
+        {
+            auto* bytes = static_cast<const juce::uint8*>(tail.getData());
+
+            for (auto i = static_cast<int>(tail.getSize()) - 14; i >= 0; --i)
+            {
+                if (std::memcmp(bytes + i, "OggS", 4) == 0)
+                {
+                    auto granule = static_cast<juce::int64>(juce::ByteOrder::littleEndianInt64(bytes + i + 6));
+                    if (granule > 0)
+                        info.duration = static_cast<double>(granule) / sampleRate;
+                    break;
+                }
+            }
+        }
+
+        return true;
+    }
+
+    //==============================================================================
+    // MP4
+    struct Atom
+    {
+        char type[4] {};
+        juce::int64 body = 0;
+        juce::int64 end = 0;
+
+        bool is(const char* name) const { return std::memcmp(type, name, 4) == 0; }
+    };
+
+    bool readAtom(juce::InputStream& in, juce::int64 limit, Atom& atom)
+    {
+        auto start = in.getPosition();
+        juce::uint8 header[8];
+
+        if (start + 8 > limit || in.read(header, 8) != 8)
+            return false;
+
+        juce::int64 size = juce::ByteOrder::bigEndianInt(header);
+        std::memcpy(atom.type, header + 4, 4);
+
+        if (size == 1)
+        {
+            juce::uint8 largeSize[8];
+            if (in.read(largeSize, 8) != 8)
+                return false;
+
+            size = static_cast<juce::int64>(juce::ByteOrder::bigEndianInt64(largeSize));
+        }
+        else if (size == 0)
+        {
+            size = limit - start;
+        }
+
+        atom.body = in.getPosition();
+        atom.end = start + size;
+        return atom.end >= atom.body && atom.end <= limit;
+    }
+
+    // Visits the atoms in [from, to); whatever the callback reads, the walk carries on after each one
+    template <typename Callback>
+    void forEachAtom(juce::InputStream& in, juce::int64 from, juce::int64 to, Callback&& visit)
+    {
+        Atom atom;
+
+        if (!in.setPosition(from))
+            return;
+
+        while (readAtom(in, to, atom))
+        {
+            visit(atom);
+
+            if (!in.setPosition(atom.end))
+                break;
+        }
+    }
+
+    void readMovieHeader(juce::InputStream& in, TagReader::Info& info)
+    {
+        juce::uint8 bytes[32];
+        int count = in.read(bytes, sizeof(bytes));
+        bool wide = count > 0 && bytes[0] == 1;
+
+        if (count < (wide ? 32 : 20))
+            return;
+
+        auto timescale = juce::ByteOrder::bigEndianInt(bytes + (wide ? 20 : 12));
+        auto length = wide ? static_cast<juce::int64>(juce::ByteOrder::bigEndianInt64(bytes + 24))
+                           : static_cast<juce::int64>(juce::ByteOrder::bigEndianInt(bytes + 16));
+
+        if (timescale > 0)
+            info.duration = static_cast<double>(length) / timescale;
+    }
+
+    const char* getMp4Key(const Atom& item)
+    {
+        if (item.is("\xa9" "nam")) return "title";
+        if (item.is("\xa9" "ART")) return "artist";
+        if (item.is("\xa9" "alb")) return "album";
+        if (item.is("\xa9" "gen")) return "genre";
+        if (item.is("tmpo"))       return "bpm";
+        return nullptr;
+    }
+
+    void readMp4Metadata(juce::InputStream& in, const Atom& meta, TagReader::Info& info)
+    {
+        // Usually a full box (version and flags first); the QuickTime flavour goes straight to its children
+        juce::uint8 peek[8];
+        if (in.read(peek, 8) != 8)
+            return;
+
+        auto childrenStart = std::memcmp(peek + 4, "hdlr", 4) == 0 ? meta.body : meta.body + 4;
+        juce::MemoryBlock value;
+
+        forEachAtom(in, childrenStart, meta.end, [&](const Atom& list) {
+            if (!list.is("ilst"))
+                return;
+
+            forEachAtom(in, list.body, list.end, [&](const Atom& item) {
+                auto* key = getMp4Key(item);
+                if (key == nullptr)
+                    return;
+
+                forEachAtom(in, item.body, item.end, [&](const Atom& data) {
+                    // Type and locale, then the value
+                    auto size = data.end - data.body;
+                    if (!data.is("data") || size <= 8 || size > maxTextBytes)
+                        return;
+
+                    value.setSize(static_cast<size_t>(size));
+                    if (in.read(value.getData(), static_cast<int>(size)) != static_cast<int>(size))
+                        return;
+
+                    auto* bytes = static_cast<const juce::uint8*>(value.getData()) + 8;
+                    int length = static_cast<int>(size) - 8;
+
+                    if (std::strcmp(key, "bpm") == 0)
+                        setField(info, key, length >= 2 ? juce::String(bytes[0] << 8 | bytes[1]) : juce::String());
+                    else
+                        setField(info, key, readUtf8(bytes, length).trim());
+                });
+            });
+        });
+    }
+
+    bool readMp4(juce::InputStream& in, juce::int64 fileLength, TagReader::Info& info)
+    {
+        bool hasMovie = false;
+
+        // Top-level atoms are stepped over, so the audio data is never touched wherever moov sits
+        forEachAtom(in, 0, fileLength, [&](const Atom& top) {
+            if (!top.is("moov"))
+                return;
+
+            hasMovie = true;
+
+            forEachAtom(in, top.body, top.end, [&](const Atom& child) {
+                if (child.is("mvhd"))
+                {
+                    readMovieHeader(in, info);
+                }
+                else if (child.is("meta"))
+                {
+                    readMp4Metadata(in, child, info);
+                }
+                else if (child.is("udta"))
+                {
+                    forEachAtom(in, child.body, child.end, [&](const Atom& userData) {
+                        if (userData.is("meta"))
+                            readMp4Metadata(in, userData, info);
+                    });
+                }
+            });
+        });
+
+        return hasMovie;
+    }
+
+    //==============================================================================
+    void readRiffInfo(juce::InputStream& in, juce::int64 end, TagReader::Info& info)
+    {
+        static const char* const fields[][2] = {
+            { "INAM", "title" },
+            { "IART", "artist" },
+            { "IPRD", "album" },
+            { "IGNR", "genre" }
+        };
+
+        juce::uint8 header[8];
+        juce::MemoryBlock text;
+
+        while (in.getPosition() + 8 <= end && in.read(header, 8) == 8)
+        {
+            juce::int64 size = juce::ByteOrder::littleEndianInt(header + 4);
+            auto next = in.getPosition() + size + (size & 1);
+
+            for (const auto& field : fields)
+            {
+                if (std::memcmp(header, field[0], 4) != 0 || size > maxTextBytes)
+                    continue;
+
+                text.setSize(static_cast<size_t>(size));
+                if (in.read(text.getData(), static_cast<int>(size)) == static_cast<int>(size))
+                    setField(info, field[1], readUtf8(static_cast<const juce::uint8*>(text.getData()), static_cast<int>(size)).trim());
+            }
+
+            if (next > end || !in.setPosition(next))
+                break;
+        }
+    }
+
+    bool readWav(juce::InputStream& in, juce::int64 fileLength, TagReader::Info& info)
+    {
+        juce::uint8 header[12];
+        if (in.read(header, 12) != 12 || std::memcmp(header, "RIFF", 4) != 0 || std::memcmp(header + 8, "WAVE", 4) != 0)
+            return false;
+
+        juce::int64 bytesPerSecond = 0;
+        juce::int64 dataSize = 0;
+        juce::uint8 chunk[8];
+
+        // Chunks in any order; the data chunk is stepped over, tags often follow it
+        while (in.read(chunk, 8) == 8)
+        {
+            juce::int64 size = juce::ByteOrder::littleEndianInt(chunk + 4);
+            auto body = in.getPosition();
+            auto next = body + size + (size & 1);
+
+            if (std::memcmp(chunk, "fmt ", 4) == 0 && size >= 16)
+            {
+                juce::uint8 format[16];
+                if (in.read(format, 16) == 16)
+                    bytesPerSecond = juce::ByteOrder::littleEndianInt(format + 8);
+            }
+            else if (std::memcmp(chunk, "data", 4) == 0)
+            {
+                dataSize = juce::jmin(size, fileLength - body);
+            }
+            else if (std::memcmp(chunk, "LIST", 4) == 0 && size >= 4)
+            {
+                char listType[4];
+                if (in.read(listType, 4) == 4 && std::memcmp(listType, "INFO", 4) == 0)
+                    readRiffInfo(in, body + size, info);
+            }
+            else if (std::memcmp(chunk, "id3 ", 4) == 0 || std::memcmp(chunk, "ID3 ", 4) == 0)
+            {
+                readId3v2(in, info);
+            }
+
+            if (next >= fileLength || !in.setPosition(next))
+                break;
+        }
+
+        if (bytesPerSecond > 0 && dataSize > 0)
+            info.duration = static_cast<double>(dataSize) / bytesPerSecond;
+
+        return bytesPerSecond > 0;
+    }
+}
+
+bool TagReader::read(const juce::File& file, Info& info)
+{
+    juce::FileInputStream stream(file);
+    if (!stream.openedOk())
+        return false;
+
+    // The reads are small and close together; one buffer fill covers most of them
+    juce::BufferedInputStream in(stream, 8192);
+    auto length = in.getTotalLength();
+
+    if (file.hasFileExtension(".mp3"))
+        return readMp3(in, length, info);
+
+    if (file.hasFileExtension(".flac"))
+        return readFlac(in, info);
+
+    if (file.hasFileExtension(".ogg"))
+        return readOgg(in, length, info);
+
+    if (file.hasFileExtension(".m4a;.mp4"))
+        return readMp4(in, length, info);
+
+    if (file.hasFileExtension(".wav"))
+        return readWav(in, length, info);
+
+    return false;
+}
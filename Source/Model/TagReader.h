@@ -0,0 +1,26 @@
+#pragma once
+#include <JuceHeader.h>
+
+// Tags and length read straight from a file's headers, without a decoder.
+// Knows ID3v2/ID3v1 plus the first frame's Xing/VBRI header for MP3, FLAC
+// metadata blocks, Ogg Vorbis comment headers, MP4 atoms and WAV chunks.
+// Only tag and header bytes are read; artwork and audio are skipped over,
+// so a file costs a handful of small reads near its start (and its end for
+// Ogg, where the length lives in the last page).
+class TagReader
+{
+public:
+    struct Info
+    {
+        juce::String title;
+        juce::String artist;
+        juce::String album;
+        juce::String genre;
+        juce::String key;
+        int bpm = 0;
+        double duration = 0.0; // seconds; 0 when the headers don't give it
+    };
+
+    // False for formats it doesn't know or files it can't make sense of
+    static bool read(const juce::File& file, Info& info);
+};
@@ -1,8 +1,25 @@
 #include "Track.h"
+#include "TagReader.h"
 
-Track::Track(const juce::File& audioFile) : file(audioFile)
+namespace
 {
-    if (file.exists())
+    // One registry for every thread that reads tracks, instead of one per track
+    juce::AudioFormatManager& getFormatRegistry()
+    {
+        struct Registry
+        {
+            Registry() { formatManager.registerBasicFormats(); }
+            juce::AudioFormatManager formatManager;
+        };
+        
+        static Registry registry;
+        return registry.formatManager;
+    }
+}
+
+Track::Track(const juce::File& audioFile, bool readMetadata) : file(audioFile)
+{
+    if (readMetadata && file.exists())
     {
         extractMetadata();
     }
@@ -12,33 +29,48 @@ void Track::extractMetadata()
 {
     // Set default values from filename if metadata extraction fails
     title = file.getFileNameWithoutExtension();
-    artist = "Unknown Artist";
-    album = "Unknown Album";
-    genre = "Unknown";
+    setArtist("Unknown Artist");
+    setAlbum("Unknown Album");
+    setGenre("Unknown");
     
-    // Try to extract metadata using JUCE's audio format manager
-    juce::AudioFormatManager formatManager;
-    formatManager.registerBasicFormats();
+    // Tags and length straight from the file headers, which is all an import needs
+    TagReader::Info info;
+    bool readHeaders = TagReader::read(file, info);
     
-    auto* reader = formatManager.createReaderFor(file);
-    if (reader != nullptr)
+    // Formats the tag reader doesn't know (or headers it can't make sense of) go through a decoder
+    if (!readHeaders || info.duration <= 0.0)
     {
-        duration = reader->lengthInSamples / reader->sampleRate;
+        std::unique_ptr<juce::AudioFormatReader> reader(getFormatRegistry().createReaderFor(file));
         
-        // Extract metadata if available
-        auto metadata = reader->metadataValues;
-        
-        if (metadata.containsKey("title") && metadata["title"].isNotEmpty())
-            title = metadata["title"];
-        if (metadata.containsKey("artist") && metadata["artist"].isNotEmpty())
-            artist = metadata["artist"];
-        if (metadata.containsKey("album") && metadata["album"].isNotEmpty())
-            album = metadata["album"];
-        if (metadata.containsKey("genre") && metadata["genre"].isNotEmpty())
-            genre = metadata["genre"];
-        
-        delete reader;
+        if (reader != nullptr && reader->sampleRate > 0.0)
+        {
+            info.duration = reader->lengthInSamples / reader->sampleRate;
+            
+            if (info.title.isEmpty())
+                info.title = reader->metadataValues["title"];
+            if (info.artist.isEmpty())
+                info.artist = reader->metadataValues["artist"];
+            if (info.album.isEmpty())
+                info.album = reader->metadataValues["album"];
+            if (info.genre.isEmpty())
+                info.genre = reader->metadataValues["genre"];
+        }
     }
+    
+    duration = info.duration;
+    
+    if (info.title.isNotEmpty())
+        title = info.title;
+    if (info.artist.isNotEmpty())
+        setArtist(info.artist);
+    if (info.album.isNotEmpty())
+        setAlbum(info.album);
+    if (info.genre.isNotEmpty())
+        setGenre(info.genre);
+    if (info.bpm > 0)
+        bpm = info.bpm;
+    
+    setKey(info.key);
 }
 
 juce::String Track::getFormattedDuration() const
@@ -1,30 +1,58 @@
 #pragma once
 #include <JuceHeader.h>
+#include "StringInterner.h"
+#include <array>
 
 class Track
 {
 public:
+    static constexpr int numHotCues = 8;
+    
     Track() = default;
-    Track(const juce::File& file);
+    Track(const juce::File& file, bool readMetadata = true);
     
     // Getters
     const juce::String& getTitle() const { return title; }
-    const juce::String& getArtist() const { return artist; }
-    const juce::String& getAlbum() const { return album; }
-    const juce::String& getGenre() const { return genre; }
+    const juce::String& getArtist() const { return StringInterner::getShared().get(artist); }
+    const juce::String& getAlbum() const { return StringInterner::getShared().get(album); }
+    const juce::String& getGenre() const { return StringInterner::getShared().get(genre); }
+    const juce::String& getKey() const { return StringInterner::getShared().get(key); } // musical key as tagged, e.g. "Am" or "8A"
+    
+    // Repeated values are interned; equal ids mean equal strings
+    StringInterner::Id getArtistId() const { return artist; }
+    StringInterner::Id getAlbumId() const { return album; }
+    StringInterner::Id getGenreId() const { return genre; }
+    StringInterner::Id getKeyId() const { return key; }
     double getDuration() const { return duration; }
     int getBPM() const { return bpm; }
+    int getPlayCount() const { return playCount; } // times loaded onto a deck
+    juce::int64 getDateAdded() const { return dateAdded; } // milliseconds since 1970; 0 if unknown
     const juce::File& getFile() const { return file; }
     juce::String getFilePath() const { return file.getFullPathName(); }
     juce::String getFileName() const { return file.getFileNameWithoutExtension(); }	
     
+    // Hot cues, in seconds; unset cues read as -1
+    double getHotCue(int index) const { return isHotCueIndex(index) ? hotCues[static_cast<size_t>(index)] : -1.0; }
+    bool hasHotCue(int index) const { return getHotCue(index) >= 0.0; }
+    double getBeatGridOffset() const { return beatGridOffset; }
+    
     // Setters
     void setTitle(const juce::String& newTitle) { title = newTitle; }
-    void setArtist(const juce::String& newArtist) { artist = newArtist; }
-    void setAlbum(const juce::String& newAlbum) { album = newAlbum; }
-    void setGenre(const juce::String& newGenre) { genre = newGenre; }
+    void setArtist(const juce::String& newArtist) { artist = StringInterner::getShared().intern(newArtist); }
+    void setAlbum(const juce::String& newAlbum) { album = StringInterner::getShared().intern(newAlbum); }
+    void setGenre(const juce::String& newGenre) { genre = StringInterner::getShared().intern(newGenre); }
+    void setKey(const juce::String& newKey) { key = StringInterner::getShared().intern(newKey); }
+    void setArtistId(StringInterner::Id id) { artist = id; }
+    void setAlbumId(StringInterner::Id id) { album = id; }
+    void setGenreId(StringInterner::Id id) { genre = id; }
+    void setKeyId(StringInterner::Id id) { key = id; }
     void setDuration(double newDuration) { duration = newDuration; }
     void setBPM(int newBPM) { bpm = newBPM; }
+    void setPlayCount(int newPlayCount) { playCount = juce::jmax(0, newPlayCount); }
+    void setDateAdded(juce::int64 newDateAdded) { dateAdded = newDateAdded; }
+    void setHotCue(int index, double position) { if (isHotCueIndex(index)) hotCues[static_cast<size_t>(index)] = juce::jmax(0.0, position); }
+    void clearHotCue(int index) { if (isHotCueIndex(index)) hotCues[static_cast<size_t>(index)] = -1.0; }
+    void setBeatGridOffset(double newOffset) { beatGridOffset = juce::jmax(0.0, newOffset); }
     
     // Utility methods
     bool isValid() const { return file.exists() && file.hasFileExtension(".mp3;.wav;.flac;.aac;.m4a"); }
@@ -33,11 +61,17 @@ public:
 private:
     juce::File file;
     juce::String title;
-    juce::String artist;
-    juce::String album;
-    juce::String genre;
+    StringInterner::Id artist = StringInterner::emptyId;
+    StringInterner::Id album = StringInterner::emptyId;
+    StringInterner::Id genre = StringInterner::emptyId;
+    StringInterner::Id key = StringInterner::emptyId;
     double duration = 0.0;
     int bpm = 0;
+    int playCount = 0;
+    juce::int64 dateAdded = 0;
+    double beatGridOffset = 0.0; // time of the first downbeat
+    std::array<double, numHotCues> hotCues { -1.0, -1.0, -1.0, -1.0, -1.0, -1.0, -1.0, -1.0 };
     
+    static bool isHotCueIndex(int index) { return index >= 0 && index < numHotCues; }
     void extractMetadata();
 };
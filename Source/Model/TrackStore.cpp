@@ -0,0 +1,273 @@
+#include "TrackStore.h"
+#include <algorithm>
+#include <type_traits>
+
+void TrackStore::ValueCounts::add(Id id)
+{
+    if (id >= counts.size())
+        counts.resize(id + 1);
+
+    ++counts[id];
+}
+
+void TrackStore::ValueCounts::remove(Id id)
+{
+    jassert(contains(id));
+    --counts[id];
+}
+
+void TrackStore::ValueCounts::clear()
+{
+    counts.clear();
+}
+
+std::vector<TrackStore::Id> TrackStore::ValueCounts::getValues() const
+{
+    std::vector<Id> values;
+
+    for (size_t id = 0; id < counts.size(); ++id)
+    {
+        if (counts[id] > 0)
+            values.push_back(static_cast<Id>(id));
+    }
+
+    return values;
+}
+
+std::vector<int> TrackStore::ValueCounts::getSortRanks() const
+{
+    auto& interner = StringInterner::getShared();
+    std::vector<std::pair<const std::string*, Id>> order;
+
+    for (auto id : getValues())
+        order.emplace_back(&interner.getSortKey(id), id);
+
+    std::sort(order.begin(), order.end(), [](const auto& a, const auto& b) { return *a.first < *b.first; });
+
+    std::vector<int> ranks(counts.size());
+    int rank = 0;
+
+    for (size_t i = 0; i < order.size(); ++i)
+    {
+        if (i > 0 && *order[i - 1].first != *order[i].first)
+            ++rank;
+
+        ranks[order[i].second] = rank;
+    }
+
+    return ranks;
+}
+
+void TrackStore::add(const Track& track)
+{
+    files.push_back(track.getFile());
+    titles.push_back(track.getTitle());
+    titleKeys.push_back(StringInterner::makeSortKey(track.getTitle()));
+    artistIds.push_back(track.getArtistId());
+    albumIds.push_back(track.getAlbumId());
+    genreIds.push_back(track.getGenreId());
+    keyIds.push_back(track.getKeyId());
+    durations.push_back(track.getDuration());
+    bpms.push_back(track.getBPM());
+    playCounts.push_back(track.getPlayCount());
+    datesAdded.push_back(track.getDateAdded());
+    beatGridOffsets.push_back(0.0);
+    cueSlots.push_back(0);
+
+    countValues(files.size() - 1);
+    storeAnalysis(size() - 1, track);
+}
+
+void TrackStore::set(int row, const Track& track)
+{
+    auto index = static_cast<size_t>(row);
+
+    uncountValues(index);
+
+    files[index] = track.getFile();
+    titles[index] = track.getTitle();
+    titleKeys[index] = StringInterner::makeSortKey(track.getTitle());
+    artistIds[index] = track.getArtistId();
+    albumIds[index] = track.getAlbumId();
+    genreIds[index] = track.getGenreId();
+    keyIds[index] = track.getKeyId();
+    durations[index] = track.getDuration();
+    bpms[index] = track.getBPM();
+    playCounts[index] = track.getPlayCount();
+    datesAdded[index] = track.getDateAdded();
+
+    countValues(index);
+    storeAnalysis(row, track);
+}
+
+Track TrackStore::getTrack(int row) const
+{
+    auto index = static_cast<size_t>(row);
+
+    Track track(files[index], false);
+    track.setTitle(titles[index]);
+    track.setArtistId(artistIds[index]);
+    track.setAlbumId(albumIds[index]);
+    track.setGenreId(genreIds[index]);
+    track.setKeyId(keyIds[index]);
+    track.setDuration(durations[index]);
+    track.setBPM(bpms[index]);
+    track.setPlayCount(playCounts[index]);
+    track.setDateAdded(datesAdded[index]);
+    track.setBeatGridOffset(beatGridOffsets[index]);
+
+    if (auto slot = cueSlots[index])
+    {
+        const auto& cues = cueTable[slot];
+
+        for (int cue = 0; cue < Track::numHotCues; ++cue)
+        {
+            if (cues[static_cast<size_t>(cue)] >= 0.0)
+                track.setHotCue(cue, cues[static_cast<size_t>(cue)]);
+        }
+    }
+
+    return track;
+}
+
+void TrackStore::remove(int row)
+{
+    uncountValues(static_cast<size_t>(row));
+    releaseCues(row);
+    forEachColumn([row](auto& column) { column.erase(column.begin() + row); });
+}
+
+void TrackStore::removeIf(const std::vector<bool>& shouldRemove)
+{
+    for (int row = 0; row < size(); ++row)
+    {
+        if (shouldRemove[static_cast<size_t>(row)])
+        {
+            uncountValues(static_cast<size_t>(row));
+            releaseCues(row);
+        }
+    }
+
+    forEachColumn([&shouldRemove](auto& column) {
+        size_t kept = 0;
+
+        for (size_t i = 0; i < column.size(); ++i)
+        {
+            if (!shouldRemove[i])
+                column[kept++] = std::move(column[i]);
+        }
+
+        column.resize(kept);
+    });
+}
+
+void TrackStore::move(int fromRow, int toRow)
+{
+    forEachColumn([fromRow, toRow](auto& column) {
+        auto from = column.begin() + fromRow;
+        auto to = column.begin() + toRow;
+
+        if (fromRow < toRow)
+            std::rotate(from, from + 1, to + 1);
+        else
+            std::rotate(to, from, from + 1);
+    });
+}
+
+void TrackStore::reorder(const std::vector<size_t>& order)
+{
+    forEachColumn([&order](auto& column) {
+        std::remove_reference_t<decltype(column)> ordered;
+        ordered.reserve(order.size());
+
+        for (auto index : order)
+            ordered.push_back(std::move(column[index]));
+
+        column = std::move(ordered);
+    });
+}
+
+void TrackStore::clear()
+{
+    forEachColumn([](auto& column) { column.clear(); });
+
+    artists.clear();
+    albums.clear();
+    genres.clear();
+    keys.clear();
+
+    cueTable.resize(1);
+    freeCueSlots.clear();
+}
+
+void TrackStore::setPlayCount(int row, int playCount)
+{
+    playCounts[static_cast<size_t>(row)] = juce::jmax(0, playCount);
+}
+
+void TrackStore::setAnalysis(int row, const Track& track)
+{
+    storeAnalysis(row, track);
+}
+
+void TrackStore::countValues(size_t row)
+{
+    artists.add(artistIds[row]);
+    albums.add(albumIds[row]);
+    genres.add(genreIds[row]);
+    keys.add(keyIds[row]);
+}
+
+void TrackStore::uncountValues(size_t row)
+{
+    artists.remove(artistIds[row]);
+    albums.remove(albumIds[row]);
+    genres.remove(genreIds[row]);
+    keys.remove(keyIds[row]);
+}
+
+void TrackStore::storeAnalysis(int row, const Track& track)
+{
+    auto index = static_cast<size_t>(row);
+    beatGridOffsets[index] = track.getBeatGridOffset();
+
+    bool hasCues = false;
+    for (int cue = 0; cue < Track::numHotCues && !hasCues; ++cue)
+        hasCues = track.hasHotCue(cue);
+
+    if (!hasCues)
+    {
+        releaseCues(row);
+        return;
+    }
+
+    if (cueSlots[index] == 0)
+    {
+        if (freeCueSlots.empty())
+        {
+            cueSlots[index] = static_cast<juce::uint32>(cueTable.size());
+            cueTable.emplace_back();
+        }
+        else
+        {
+            cueSlots[index] = freeCueSlots.back();
+            freeCueSlots.pop_back();
+        }
+    }
+
+    auto& cues = cueTable[cueSlots[index]];
+
+    for (int cue = 0; cue < Track::numHotCues; ++cue)
+        cues[static_cast<size_t>(cue)] = track.getHotCue(cue);
+}
+
+void TrackStore::releaseCues(int row)
+{
+    auto& slot = cueSlots[static_cast<size_t>(row)];
+
+    if (slot != 0)
+    {
+        freeCueSlots.push_back(slot);
+        slot = 0;
+    }
+}
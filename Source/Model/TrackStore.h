@@ -0,0 +1,117 @@
+#pragma once
+#include <JuceHeader.h>
+#include "Track.h"
+#include "StringInterner.h"
+#include <array>
+#include <string>
+#include <vector>
+
+// A track list kept column by column instead of as Track objects. Numbers
+// live in dense arrays of their own, so a total, an average or a range filter
+// runs down one contiguous column. Artists, albums, genres and keys are held
+// as interned ids, alongside a count of the rows using each, so the distinct
+// values in use are known without a pass over the rows. Hot cues are rare and
+// sit in a side table. Reordering rows moves ids and numbers, never strings.
+class TrackStore
+{
+public:
+    using Id = StringInterner::Id;
+
+    // How many rows hold each value of a text column
+    class ValueCounts
+    {
+    public:
+        void add(Id id);
+        void remove(Id id);
+        void clear();
+        bool contains(Id id) const { return id < counts.size() && counts[id] > 0; }
+        std::vector<Id> getValues() const; // the ones in use, by id
+
+        // For each value in use, indexed by id, its place when the values are
+        // sorted ignoring case; values that differ only in case share a place
+        std::vector<int> getSortRanks() const;
+
+    private:
+        std::vector<int> counts; // by id
+    };
+
+    TrackStore() = default;
+
+    int size() const { return static_cast<int>(files.size()); }
+    bool empty() const { return files.empty(); }
+
+    void add(const Track& track);
+    void set(int row, const Track& track);
+    Track getTrack(int row) const;
+    void remove(int row);
+    void removeIf(const std::vector<bool>& shouldRemove); // one flag per row
+    void move(int fromRow, int toRow);
+    void reorder(const std::vector<size_t>& order); // row i takes what was at order[i]
+    void clear();
+
+    void setPlayCount(int row, int playCount);
+    void setAnalysis(int row, const Track& track); // hot cues and beat grid
+
+    // Columns, one entry per row
+    const std::vector<juce::File>& getFiles() const { return files; }
+    const std::vector<juce::String>& getTitles() const { return titles; }
+    const std::vector<std::string>& getTitleSortKeys() const { return titleKeys; }
+    const std::vector<Id>& getArtistIds() const { return artistIds; }
+    const std::vector<Id>& getAlbumIds() const { return albumIds; }
+    const std::vector<Id>& getGenreIds() const { return genreIds; }
+    const std::vector<Id>& getKeyIds() const { return keyIds; }
+    const std::vector<double>& getDurations() const { return durations; }
+    const std::vector<int>& getBPMs() const { return bpms; }
+    const std::vector<int>& getPlayCounts() const { return playCounts; }
+    const std::vector<juce::int64>& getDatesAdded() const { return datesAdded; }
+
+    const ValueCounts& getArtists() const { return artists; }
+    const ValueCounts& getAlbums() const { return albums; }
+    const ValueCounts& getGenres() const { return genres; }
+    const ValueCounts& getKeys() const { return keys; }
+
+private:
+    using HotCues = std::array<double, Track::numHotCues>;
+
+    ValueCounts artists, albums, genres, keys;
+
+    std::vector<juce::File> files;
+    std::vector<juce::String> titles;
+    std::vector<std::string> titleKeys;
+    std::vector<Id> artistIds, albumIds, genreIds, keyIds;
+    std::vector<double> durations;
+    std::vector<int> bpms;
+    std::vector<int> playCounts;
+    std::vector<juce::int64> datesAdded;
+    std::vector<double> beatGridOffsets;
+    std::vector<juce::uint32> cueSlots; // 0 for rows without hot cues
+
+    std::vector<HotCues> cueTable { HotCues {} }; // slot 0 is never used
+    std::vector<juce::uint32> freeCueSlots;
+
+    void countValues(size_t row);
+    void uncountValues(size_t row);
+    void storeAnalysis(int row, const Track& track);
+    void releaseCues(int row);
+
+    // Calls function with every per-row column, so rows move as one
+    template <typename Function>
+    void forEachColumn(Function&& function)
+    {
+        function(files);
+        function(titles);
+        function(titleKeys);
+        function(artistIds);
+        function(albumIds);
+        function(genreIds);
+        function(keyIds);
+        function(durations);
+        function(bpms);
+        function(playCounts);
+        function(datesAdded);
+        function(beatGridOffsets);
+        function(cueSlots);
+    }
+
+    JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR(TrackStore)
+};
@@ -98,8 +98,41 @@ void DeckView::setupComponents()
     highEQSlider->addListener(this);
     addAndMakeVisible(*highEQSlider);
     
+    // Effects
+    fxMix.fill(0.5f);
+    fxAmount.fill(0.5f);
+    
+    fxTypeBox = std::make_unique<juce::ComboBox>("fxType");
+    fxTypeBox->addItemList({ "FILTER", "ECHO", "FLANGER", "REVERB", "CRUSH" }, 1);
+    fxTypeBox->setSelectedId(1, juce::dontSendNotification);
+    fxTypeBox->setColour(juce::ComboBox::backgroundColourId, juce::Colour(0xff2a2a2a));
+    fxTypeBox->setColour(juce::ComboBox::textColourId, juce::Colour(0xffcccccc));
+    fxTypeBox->setColour(juce::ComboBox::outlineColourId, juce::Colour(0xff404040));
+    fxTypeBox->addListener(this);
+    addAndMakeVisible(*fxTypeBox);
+    
+    fxButton = std::make_unique<ModernButton>("FX");
+    fxButton->setButtonStyle(ModernButton::Style::Toggle);
+    fxButton->addListener(this);
+    addAndMakeVisible(*fxButton);
+    
+    fxMixSlider = std::make_unique<ModernSlider>();
+    fxMixSlider->setSliderStyle(ModernSlider::Style::Rotary);
+    fxMixSlider->setRange(0.0, 1.0, 0.01);
+    fxMixSlider->addListener(this);
+    addAndMakeVisible(*fxMixSlider);
+    
+    fxAmountSlider = std::make_unique<ModernSlider>();
+    fxAmountSlider->setSliderStyle(ModernSlider::Style::Rotary);
+    fxAmountSlider->setRange(0.0, 1.0, 0.01);
+    fxAmountSlider->addListener(this);
+    addAndMakeVisible(*fxAmountSlider);
+    
+    showSelectedEffect();
+    
     // Waveform display
-    waveformDisplay = std::make_unique<WaveformView>(djController.getFormatManager(), djController.getThumbnailCache());
+    waveformDisplay = std::make_unique<WaveformView>(djController.getFormatManager(), djController.getThumbnailCache(),
+                                                     djController.getJobScheduler());
     addAndMakeVisible(*waveformDisplay);
     
     // VU Meter
@@ -234,6 +267,13 @@ void DeckView::resized()
     auto jogBounds = juce::Rectangle<int>(jogSize, jogSize).withCentre(jogArea.getCentre());
     jogWheel->setBounds(jogBounds);
     
+    // Effects row under the jog wheel
+    auto fxArea = centerArea.removeFromTop(35);
+    fxTypeBox->setBounds(fxArea.removeFromLeft(90).reduced(2, 5));
+    fxButton->setBounds(fxArea.removeFromLeft(40).reduced(2));
+    fxMixSlider->setBounds(fxArea.removeFromLeft(35));
+    fxAmountSlider->setBounds(fxArea.removeFromLeft(35));
+    
     // Right side - VU Meter
     vuMeter->setBounds(mainArea.reduced(5));
 }
@@ -264,6 +304,12 @@ void DeckView::buttonClicked(juce::Button* button)
     {
         djController.toggleLoop(deckIndex);
     }
+    else if (button == fxButton.get())
+    {
+        auto type = getSelectedEffect();
+        fxEnabled[static_cast<size_t>(type)] = button->getToggleState();
+        djController.setDeckEffectEnabled(deckIndex, type, button->getToggleState());
+    }
 }
 
 void DeckView::sliderValueChanged(juce::Slider* slider)
@@ -276,6 +322,18 @@ void DeckView::sliderValueChanged(juce::Slider* slider)
     {
         djController.setDeckSpeed(deckIndex, slider->getValue());
     }
+    else if (slider == fxMixSlider.get())
+    {
+        auto type = getSelectedEffect();
+        fxMix[static_cast<size_t>(type)] = static_cast<float>(slider->getValue());
+        djController.setDeckEffectMix(deckIndex, type, static_cast<float>(slider->getValue()));
+    }
+    else if (slider == fxAmountSlider.get())
+    {
+        auto type = getSelectedEffect();
+        fxAmount[static_cast<size_t>(type)] = static_cast<float>(slider->getValue());
+        djController.setDeckEffectAmount(deckIndex, type, static_cast<float>(slider->getValue()));
+    }
     else if (slider == lowEQSlider.get())
     {
         // Update low EQ - need to get current mid and high values
@@ -302,6 +360,25 @@ void DeckView::sliderValueChanged(juce::Slider* slider)
     }
 }
 
+void DeckView::comboBoxChanged(juce::ComboBox* comboBox)
+{
+    if (comboBox == fxTypeBox.get())
+        showSelectedEffect();
+}
+
+EffectsRack::EffectType DeckView::getSelectedEffect() const
+{
+    return static_cast<EffectsRack::EffectType>(juce::jlimit(0, EffectsRack::numEffects - 1, fxTypeBox->getSelectedId() - 1));
+}
+
+void DeckView::showSelectedEffect()
+{
+    auto index = static_cast<size_t>(getSelectedEffect());
+    fxButton->setToggleState(fxEnabled[index], juce::dontSendNotification);
+    fxMixSlider->setValue(fxMix[index], juce::dontSendNotification);
+    fxAmountSlider->setValue(fxAmount[index], juce::dontSendNotification);
+}
+
 void DeckView::timerCallback()
 {
     // Update VU meter
@@ -6,10 +6,12 @@
 #include "../Components/WaveformView.h"
 #include "../Components/VUMeter.h"
 #include "../Components/JogWheel.h"
+#include <array>
 
 class DeckView : public juce::Component,
                 public juce::Button::Listener,
                 public juce::Slider::Listener,
+                public juce::ComboBox::Listener,
                 public juce::Timer,
                 public JogWheel::Listener
 {
@@ -26,6 +28,9 @@ public:
     // Slider::Listener
     void sliderValueChanged(juce::Slider* slider) override;
     
+    // ComboBox::Listener
+    void comboBoxChanged(juce::ComboBox* comboBox) override;
+    
     // Timer
     void timerCallback() override;
     
@@ -62,6 +67,15 @@ private:
     std::unique_ptr<ModernSlider> midEQSlider;
     std::unique_ptr<ModernSlider> highEQSlider;
     
+    // Effects: one slot at a time is shown, each keeps its own settings
+    std::unique_ptr<juce::ComboBox> fxTypeBox;
+    std::unique_ptr<ModernButton> fxButton;
+    std::unique_ptr<ModernSlider> fxMixSlider;
+    std::unique_ptr<ModernSlider> fxAmountSlider;
+    std::array<bool, EffectsRack::numEffects> fxEnabled {};
+    std::array<float, EffectsRack::numEffects> fxMix {};
+    std::array<float, EffectsRack::numEffects> fxAmount {};
+    
     std::unique_ptr<WaveformView> waveformDisplay;
     std::unique_ptr<VUMeter> vuMeter;
     std::unique_ptr<JogWheel> jogWheel;
@@ -90,6 +104,8 @@ private:
     void setupColors();
     void setupLayout();
     void updatePlayButton();
+    EffectsRack::EffectType getSelectedEffect() const;
+    void showSelectedEffect();
     juce::String formatTime(double seconds);
     void updateBPM(double bpm);
     void updateTimeDisplays();
@@ -0,0 +1,182 @@
+#include "FacetBrowserView.h"
+#include <algorithm>
+
+FacetBrowserView::FacetBrowserView()
+    : backgroundColour(juce::Colour(0xff1a1a1a)),
+      selectedRowColour(juce::Colour(0xff0066cc)),
+      textColour(juce::Colour(0xffeeeeee))
+{
+    setupComponents();
+}
+
+FacetBrowserView::~FacetBrowserView() = default;
+
+void FacetBrowserView::setupComponents()
+{
+    // Facet selector; item ids are the facet plus one
+    facetSelector = std::make_unique<juce::ComboBox>("facet");
+    facetSelector->addItem("Genre", static_cast<int>(FacetIndex::Facet::Genre) + 1);
+    facetSelector->addItem("Artist", static_cast<int>(FacetIndex::Facet::Artist) + 1);
+    facetSelector->addItem("Album", static_cast<int>(FacetIndex::Facet::Album) + 1);
+    facetSelector->addItem("BPM", static_cast<int>(FacetIndex::Facet::BPM) + 1);
+    facetSelector->addItem("Key", static_cast<int>(FacetIndex::Facet::Key) + 1);
+    facetSelector->setSelectedId(static_cast<int>(FacetIndex::Facet::Genre) + 1, juce::dontSendNotification);
+    facetSelector->onChange = [this]() {
+        valueList->scrollToEnsureRowIsOnscreen(0);
+        refreshCounts();
+    };
+    addAndMakeVisible(*facetSelector);
+    
+    // Values of the chosen facet
+    valueList = std::make_unique<juce::ListBox>("values", this);
+    valueList->setColour(juce::ListBox::backgroundColourId, backgroundColour);
+    valueList->setColour(juce::ListBox::outlineColourId, juce::Colour(0xff404040));
+    valueList->setOutlineThickness(1);
+    valueList->setRowHeight(20);
+    addAndMakeVisible(*valueList);
+    
+    clearButton = std::make_unique<ModernButton>("Clear");
+    clearButton->setButtonStyle(ModernButton::Style::Secondary);
+    clearButton->addListener(this);
+    addAndMakeVisible(*clearButton);
+}
+
+void FacetBrowserView::paint(juce::Graphics& g)
+{
+    g.fillAll(backgroundColour);
+}
+
+void FacetBrowserView::resized()
+{
+    auto bounds = getLocalBounds();
+    
+    facetSelector->setBounds(bounds.removeFromTop(25));
+    bounds.removeFromTop(5);
+    
+    clearButton->setBounds(bounds.removeFromBottom(25).reduced(2, 0));
+    bounds.removeFromBottom(5);
+    
+    valueList->setBounds(bounds);
+}
+
+int FacetBrowserView::getNumRows()
+{
+    return static_cast<int>(counts.size());
+}
+
+void FacetBrowserView::paintListBoxItem(int rowNumber, juce::Graphics& g, int width, int height, bool)
+{
+    if (rowNumber < 0 || rowNumber >= static_cast<int>(counts.size()))
+        return;
+    
+    const auto& count = counts[static_cast<size_t>(rowNumber)];
+    bool picked = isPicked(count.value);
+    
+    if (picked)
+        g.fillAll(selectedRowColour);
+    
+    g.setFont(juce::Font(12.0f));
+    g.setColour(picked ? juce::Colour(0xffffffff) : textColour);
+    g.drawText(FacetIndex::getLabel(getFacet(), count.value), 4, 0, width - 50, height, juce::Justification::centredLeft, true);
+    
+    g.setColour(juce::Colour(0xffaaaaaa));
+    g.drawText(juce::String(count.numTracks), width - 46, 0, 42, height, juce::Justification::centredRight, false);
+}
+
+void FacetBrowserView::listBoxItemClicked(int row, const juce::MouseEvent&)
+{
+    if (row < 0 || row >= static_cast<int>(counts.size()))
+        return;
+    
+    // Clicking a value picks it, clicking it again lets it go
+    auto& picked = selection[getFacet()];
+    auto value = counts[static_cast<size_t>(row)].value;
+    auto found = std::find(picked.begin(), picked.end(), value);
+    
+    if (found != picked.end())
+        picked.erase(found);
+    else
+        picked.push_back(value);
+    
+    refreshCounts();
+    
+    if (onSelectionChanged)
+        onSelectionChanged(selection);
+}
+
+void FacetBrowserView::buttonClicked(juce::Button* button)
+{
+    if (button == clearButton.get())
+        clearSelection();
+}
+
+void FacetBrowserView::setPlaylistManager(PlaylistManager* manager)
+{
+    playlistManager = manager;
+    selection = {};
+    refreshCounts();
+}
+
+void FacetBrowserView::refreshCounts()
+{
+    counts.clear();
+    
+    if (playlistManager != nullptr)
+    {
+        auto facet = getFacet();
+        
+        // Values no track would be left with are hidden, unless they are picked
+        for (const auto& count : playlistManager->getFacetCounts(facet, selection))
+        {
+            if (count.numTracks > 0 || isPicked(count.value))
+                counts.push_back(count);
+        }
+        
+        // BPM ranges in tempo order, the rest by name, each label worked out once
+        if (facet == FacetIndex::Facet::BPM)
+        {
+            std::sort(counts.begin(), counts.end(), [](const auto& a, const auto& b) { return a.value < b.value; });
+        }
+        else
+        {
+            std::vector<std::pair<juce::String, FacetIndex::Count>> labelled;
+            labelled.reserve(counts.size());
+            
+            for (const auto& count : counts)
+                labelled.emplace_back(FacetIndex::getLabel(facet, count.value), count);
+            
+            std::sort(labelled.begin(), labelled.end(), [](const auto& a, const auto& b) {
+                return a.first.compareNatural(b.first) < 0;
+            });
+            
+            for (size_t i = 0; i < labelled.size(); ++i)
+                counts[i] = labelled[i].second;
+        }
+    }
+    
+    valueList->updateContent();
+    valueList->repaint();
+}
+
+void FacetBrowserView::clearSelection()
+{
+    if (selection.isEmpty())
+        return;
+    
+    selection = {};
+    refreshCounts();
+    
+    if (onSelectionChanged)
+        onSelectionChanged(selection);
+}
+
+FacetIndex::Facet FacetBrowserView::getFacet() const
+{
+    return static_cast<FacetIndex::Facet>(juce::jmax(1, facetSelector->getSelectedId()) - 1);
+}
+
+bool FacetBrowserView::isPicked(FacetIndex::Value value) const
+{
+    const auto& picked = selection[getFacet()];
+    return std::find(picked.begin(), picked.end(), value) != picked.end();
+}
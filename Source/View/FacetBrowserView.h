@@ -0,0 +1,58 @@
+#pragma once
+#include <JuceHeader.h>
+#include "../Model/PlaylistManager.h"
+#include "../Components/ModernButton.h"
+
+// Crate browser beside the playlist: pick a facet, then click its values to
+// narrow the list down. Picks in different facets combine, picks in the same
+// one add up, and every value shows how many tracks it would leave given
+// what is picked elsewhere.
+class FacetBrowserView : public juce::Component,
+                         public juce::ListBoxModel,
+                         public juce::Button::Listener
+{
+public:
+    FacetBrowserView();
+    ~FacetBrowserView() override;
+    
+    void paint(juce::Graphics& g) override;
+    void resized() override;
+    
+    // ListBoxModel
+    int getNumRows() override;
+    void paintListBoxItem(int rowNumber, juce::Graphics& g, int width, int height, bool rowIsSelected) override;
+    void listBoxItemClicked(int row, const juce::MouseEvent& event) override;
+    
+    // Button listener
+    void buttonClicked(juce::Button* button) override;
+    
+    void setPlaylistManager(PlaylistManager* manager);
+    void refreshCounts(); // after the playlist changes
+    void clearSelection();
+    const FacetIndex::Selection& getSelection() const { return selection; }
+    
+    // Callbacks
+    std::function<void(const FacetIndex::Selection&)> onSelectionChanged;
+    
+private:
+    void setupComponents();
+    FacetIndex::Facet getFacet() const;
+    bool isPicked(FacetIndex::Value value) const;
+    
+    // Components
+    std::unique_ptr<juce::ComboBox> facetSelector;
+    std::unique_ptr<juce::ListBox> valueList;
+    std::unique_ptr<ModernButton> clearButton;
+    
+    // Data
+    PlaylistManager* playlistManager = nullptr;
+    FacetIndex::Selection selection;
+    std::vector<FacetIndex::Count> counts; // the shown facet's values, in display order
+    
+    // Visual settings
+    juce::Colour backgroundColour;
+    juce::Colour selectedRowColour;
+    juce::Colour textColour;
+    
+    JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR(FacetBrowserView)
+};
@@ -13,18 +13,33 @@ MainView::MainView()
     setWantsKeyboardFocus(true);
 }
 
-MainView::~MainView() = default;
+MainView::~MainView()
+{
+    // Auto-play follows the playlists, which go before the controller
+    djController->enableAutoPlay(0, false);
+    djController->enableAutoPlay(1, false);
+    
+    // The views hold on to the controller's job scheduler, so they go first
+    deckView1.reset();
+    deckView2.reset();
+    mixerView.reset();
+    playlistView1.reset();
+    playlistView2.reset();
+}
 
 void MainView::setupComponents()
 {
     // Create controllers and models
     djController = std::make_unique<DJController>();
-    playlistManager1 = std::make_unique<PlaylistManager>();
-    playlistManager2 = std::make_unique<PlaylistManager>();
+    playlistManager1 = std::make_unique<PlaylistManager>(djController->getJobScheduler(), djController->getLibraryDatabase());
+    playlistManager2 = std::make_unique<PlaylistManager>(djController->getJobScheduler(), djController->getLibraryDatabase());
+    
+    // The first playlist opens with the library from the last session
+    playlistManager1->loadLibrary();
     
     // Create deck views
-    deckView1 = std::make_unique<DeckView>(*djController, 1);
-    deckView2 = std::make_unique<DeckView>(*djController, 2);
+    deckView1 = std::make_unique<DeckView>(*djController, 0);
+    deckView2 = std::make_unique<DeckView>(*djController, 1);
     addAndMakeVisible(*deckView1);
     addAndMakeVisible(*deckView2);
     
@@ -54,16 +69,51 @@ void MainView::setupCallbacks()
     // Mixer callbacks
     mixerView->onCrossfaderChanged = [this](float value) {
         djController->setCrossfader(value);
+        showCrossfaderGains();
+    };
+    
+    mixerView->onCrossfaderCurveChanged = [this](int curveIndex) {
+        djController->setCrossfaderCurve(static_cast<Crossfader::Curve>(curveIndex));
+        showCrossfaderGains();
     };
     
+    showCrossfaderGains();
+    
     mixerView->onMasterGainChanged = [this](float gain) {
         djController->setMasterGain(gain);
     };
     
+    mixerView->onMasterFilterChanged = [this](float position) {
+        djController->setMasterFilter(position);
+    };
+    
     mixerView->onCueGainChanged = [this](float gain) {
         djController->setCueGain(gain);
     };
     
+    mixerView->onCueMixChanged = [this](float mix) {
+        djController->setCueMix(mix);
+    };
+    
+    mixerView->onDeckPFLToggled = [this](int deckIndex, bool enabled) {
+        djController->setDeckPFL(deckIndex, enabled);
+    };
+    
+    // Headphones go to outputs 3/4 of the main interface unless a second device is picked
+    mixerView->setHeadphoneDevices(djController->getHeadphoneDeviceNames(), djController->getHeadphoneDeviceName());
+    mixerView->onHeadphoneDeviceChanged = [this](const juce::String& deviceName) {
+        if (!djController->setHeadphoneDevice(deviceName))
+        {
+            juce::AlertWindow::showMessageBoxAsync(juce::AlertWindow::WarningIcon, "Headphones",
+                                                   "Could not open " + deviceName + ".");
+            mixerView->setHeadphoneDevices(djController->getHeadphoneDeviceNames(), djController->getHeadphoneDeviceName());
+        }
+    };
+    
+    mixerView->onLimiterToggled = [this](bool enabled) {
+        djController->setLimiterEnabled(enabled);
+    };
+    
     mixerView->onRecordingToggled = [this](bool recording) {
         if (recording)
             djController->startRecording(juce::File::getSpecialLocation(juce::File::userDesktopDirectory).getChildFile("DJ_Recording.wav"));
@@ -75,40 +125,87 @@ void MainView::setupCallbacks()
         djController->enableBeatSync(true);
     };
     
-    // Playlist 1 callbacks
+    // Auto-play runs both decks on through the playlists their tracks came from
+    mixerView->onAutoMixToggled = [this](bool enabled) {
+        djController->enableAutoPlay(0, enabled);
+        djController->enableAutoPlay(1, enabled);
+    };
+    
+    // Playlist 1 callbacks (the views number decks from 1)
     playlistView1->onTrackLoadRequested = [this](int trackIndex, int deckNumber) {
         auto track = playlistManager1->getTrack(trackIndex);
         if (track)
         {
-            djController->loadTrackToDeck(deckNumber, *track);
+            djController->loadTrackToDeck(deckNumber - 1, *track, playlistManager1.get());
         }
     };
     
+    playlistView1->onPlaylistChanged = [this]() {
+        djController->refreshAutoPlay(*playlistManager1);
+    };
+    
     // Playlist 2 callbacks
     playlistView2->onTrackLoadRequested = [this](int trackIndex, int deckNumber) {
         auto track = playlistManager2->getTrack(trackIndex);
         if (track)
         {
-            djController->loadTrackToDeck(deckNumber, *track);
+            djController->loadTrackToDeck(deckNumber - 1, *track, playlistManager2.get());
         }
     };
     
+    playlistView2->onPlaylistChanged = [this]() {
+        djController->refreshAutoPlay(*playlistManager2);
+    };
+    
     // DJ Controller callbacks
     djController->onDeckPositionChanged = [this](int deckId, double position) {
-        if (deckId == 1)
+        if (deckId == 0)
             deckView1->updatePosition(position);
-        else if (deckId == 2)
+        else if (deckId == 1)
             deckView2->updatePosition(position);
     };
     
+    djController->onCueLevelsChanged = [this](float rms, float peak) {
+        mixerView->updateCueLevels(rms, peak);
+    };
+    
+    djController->onMasterLevelsChanged = [this](float rms, float peak) {
+        mixerView->updateMasterLevels(rms, peak);
+    };
+    
+    // Keep the playlists' copies of the loaded tracks in step with cue edits
+    djController->onDeckHotCuesChanged = [this](int deckIndex) {
+        auto& deck = deckIndex == 0 ? djController->getDeck1() : djController->getDeck2();
+        if (auto* track = deck.getCurrentTrack())
+        {
+            playlistManager1->updateHotCues(*track);
+            playlistManager2->updateHotCues(*track);
+        }
+    };
+    
+    djController->onTrackPlayCountChanged = [this](const juce::File& file, int playCount) {
+        playlistManager1->updatePlayCount(file, playCount);
+        playlistManager2->updatePlayCount(file, playCount);
+    };
+    
+    djController->onLimiterGainReductionChanged = [this](float gainReductionDb) {
+        mixerView->updateLimiterGainReduction(gainReductionDb);
+    };
+    
     djController->onDeckLevelsChanged = [this](int deckId, float rms, float peak) {
-        if (deckId == 1)
+        if (deckId == 0)
             deckView1->updateLevels(rms, peak);
-        else if (deckId == 2)
+        else if (deckId == 1)
             deckView2->updateLevels(rms, peak);
     };
 }
 
+void MainView::showCrossfaderGains()
+{
+    mixerView->updateCrossfaderGains(static_cast<float>(djController->getDeckCrossfaderGain(0)),
+                                     static_cast<float>(djController->getDeckCrossfaderGain(1)));
+}
+
 void MainView::setupMenuBar()
 {
     menuBar->setModel(this);
@@ -50,6 +50,7 @@ private:
     void setupComponents();
     void setupCallbacks();
     void setupMenuBar();
+    void showCrossfaderGains();
     void showSettingsDialog();
     void showAboutDialog();
     void loadAudioFiles();
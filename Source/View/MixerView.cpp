@@ -27,6 +27,23 @@ void MixerView::setupComponents()
     crossfaderLabel->setJustificationType(juce::Justification::centred);
     addAndMakeVisible(*crossfaderLabel);
     
+    crossfaderCurveBox = std::make_unique<juce::ComboBox>("crossfaderCurve");
+    crossfaderCurveBox->addItem("POWER", 1);
+    crossfaderCurveBox->addItem("LINEAR", 2);
+    crossfaderCurveBox->addItem("SCRATCH", 3);
+    crossfaderCurveBox->setSelectedId(1, juce::dontSendNotification);
+    crossfaderCurveBox->setColour(juce::ComboBox::backgroundColourId, juce::Colour(0xff2a2a2a));
+    crossfaderCurveBox->setColour(juce::ComboBox::textColourId, juce::Colour(0xffcccccc));
+    crossfaderCurveBox->setColour(juce::ComboBox::outlineColourId, juce::Colour(0xff404040));
+    crossfaderCurveBox->addListener(this);
+    addAndMakeVisible(*crossfaderCurveBox);
+    
+    crossfaderGainLabel = std::make_unique<juce::Label>("crossfaderGain", "");
+    crossfaderGainLabel->setFont(juce::Font(10.0f));
+    crossfaderGainLabel->setColour(juce::Label::textColourId, juce::Colour(0xffaaaaaa));
+    crossfaderGainLabel->setJustificationType(juce::Justification::centred);
+    addAndMakeVisible(*crossfaderGainLabel);
+    
     // Master section
     masterGainSlider = std::make_unique<ModernSlider>();
     masterGainSlider->setSliderStyle(ModernSlider::Style::Vertical);
@@ -52,6 +69,12 @@ void MixerView::setupComponents()
     masterLabel->setJustificationType(juce::Justification::centred);
     addAndMakeVisible(*masterLabel);
     
+    limiterLabel = std::make_unique<juce::Label>("limiter", "GR 0.0");
+    limiterLabel->setFont(juce::Font(10.0f));
+    limiterLabel->setColour(juce::Label::textColourId, juce::Colour(0xffff8800));
+    limiterLabel->setJustificationType(juce::Justification::centred);
+    addAndMakeVisible(*limiterLabel);
+    
     // Cue section
     cueGainSlider = std::make_unique<ModernSlider>();
     cueGainSlider->setSliderStyle(ModernSlider::Style::Vertical);
@@ -60,6 +83,23 @@ void MixerView::setupComponents()
     cueGainSlider->addListener(this);
     addAndMakeVisible(*cueGainSlider);
     
+    cueMixSlider = std::make_unique<ModernSlider>();
+    cueMixSlider->setSliderStyle(ModernSlider::Style::Rotary);
+    cueMixSlider->setRange(0.0, 1.0, 0.01);
+    cueMixSlider->setValue(0.0);
+    cueMixSlider->addListener(this);
+    addAndMakeVisible(*cueMixSlider);
+    
+    pflButton1 = std::make_unique<ModernButton>("PFL 1");
+    pflButton1->setButtonStyle(ModernButton::Style::Toggle);
+    pflButton1->addListener(this);
+    addAndMakeVisible(*pflButton1);
+    
+    pflButton2 = std::make_unique<ModernButton>("PFL 2");
+    pflButton2->setButtonStyle(ModernButton::Style::Toggle);
+    pflButton2->addListener(this);
+    addAndMakeVisible(*pflButton2);
+    
     cueVUMeter = std::make_unique<VUMeter>(VUMeter::Orientation::Vertical);
     cueVUMeter->setColors(juce::Colour(0xff0088ff), juce::Colour(0xff00aaff), juce::Colour(0xff0066cc));
     addAndMakeVisible(*cueVUMeter);
@@ -70,6 +110,15 @@ void MixerView::setupComponents()
     cueLabel->setJustificationType(juce::Justification::centred);
     addAndMakeVisible(*cueLabel);
     
+    headphoneDeviceBox = std::make_unique<juce::ComboBox>("headphoneDevice");
+    headphoneDeviceBox->addItem("OUT 3/4", 1);
+    headphoneDeviceBox->setSelectedId(1, juce::dontSendNotification);
+    headphoneDeviceBox->setColour(juce::ComboBox::backgroundColourId, juce::Colour(0xff2a2a2a));
+    headphoneDeviceBox->setColour(juce::ComboBox::textColourId, juce::Colour(0xffcccccc));
+    headphoneDeviceBox->setColour(juce::ComboBox::outlineColourId, juce::Colour(0xff404040));
+    headphoneDeviceBox->addListener(this);
+    addAndMakeVisible(*headphoneDeviceBox);
+    
     // Control buttons
     recordButton = std::make_unique<ModernButton>("REC");
     recordButton->setButtonStyle(ModernButton::Style::Danger);
@@ -85,6 +134,12 @@ void MixerView::setupComponents()
     beatSyncButton->setButtonStyle(ModernButton::Style::Primary);
     beatSyncButton->addListener(this);
     addAndMakeVisible(*beatSyncButton);
+    
+    limiterButton = std::make_unique<ModernButton>("LIMIT");
+    limiterButton->setButtonStyle(ModernButton::Style::Toggle);
+    limiterButton->setToggleState(true, juce::dontSendNotification);
+    limiterButton->addListener(this);
+    addAndMakeVisible(*limiterButton);
 }
 
 void MixerView::paint(juce::Graphics& g)
@@ -138,17 +193,21 @@ void MixerView::resized()
     
     // Crossfader section at bottom
     auto crossfaderArea = bounds.removeFromBottom(60);
-    crossfaderLabel->setBounds(crossfaderArea.removeFromTop(20));
-    crossfaderSlider->setBounds(crossfaderArea.reduced(20, 10));
+    auto crossfaderHeader = crossfaderArea.removeFromTop(20);
+    crossfaderCurveBox->setBounds(crossfaderHeader.removeFromRight(80));
+    crossfaderLabel->setBounds(crossfaderHeader);
+    crossfaderGainLabel->setBounds(crossfaderArea.removeFromBottom(14));
+    crossfaderSlider->setBounds(crossfaderArea.reduced(20, 5));
     
     bounds.removeFromBottom(10); // Spacing
     
     // Control buttons section
     auto buttonArea = bounds.removeFromBottom(40);
-    int buttonWidth = buttonArea.getWidth() / 3;
-    recordButton->setBounds(buttonArea.removeFromLeft(buttonWidth).reduced(5));
-    autoMixButton->setBounds(buttonArea.removeFromLeft(buttonWidth).reduced(5));
-    beatSyncButton->setBounds(buttonArea.reduced(5));
+    int buttonWidth = buttonArea.getWidth() / 4;
+    recordButton->setBounds(buttonArea.removeFromLeft(buttonWidth).reduced(3));
+    autoMixButton->setBounds(buttonArea.removeFromLeft(buttonWidth).reduced(3));
+    beatSyncButton->setBounds(buttonArea.removeFromLeft(buttonWidth).reduced(3));
+    limiterButton->setBounds(buttonArea.reduced(3));
     
     bounds.removeFromBottom(10); // Spacing
     
@@ -159,6 +218,12 @@ void MixerView::resized()
     auto cueSection = bounds.removeFromLeft(sectionWidth).reduced(5);
     cueLabel->setBounds(cueSection.removeFromTop(20));
     
+    auto pflArea = cueSection.removeFromBottom(24);
+    pflButton1->setBounds(pflArea.removeFromLeft(pflArea.getWidth() / 2).reduced(1));
+    pflButton2->setBounds(pflArea.reduced(1));
+    headphoneDeviceBox->setBounds(cueSection.removeFromBottom(22).reduced(1));
+    cueMixSlider->setBounds(cueSection.removeFromBottom(40).reduced(2));
+    
     auto cueControls = cueSection.removeFromTop(cueSection.getHeight() - 20);
     cueGainSlider->setBounds(cueControls.removeFromLeft(30).reduced(2));
     cueVUMeter->setBounds(cueControls.reduced(5));
@@ -168,6 +233,7 @@ void MixerView::resized()
     masterLabel->setBounds(masterSection.removeFromTop(20));
     
     auto masterControls = masterSection.removeFromTop(masterSection.getHeight() - 20);
+    limiterLabel->setBounds(masterSection);
     auto masterSliders = masterControls.removeFromLeft(60);
     
     masterGainSlider->setBounds(masterSliders.removeFromLeft(30).reduced(2));
@@ -193,6 +259,11 @@ void MixerView::sliderValueChanged(juce::Slider* slider)
         if (onCueGainChanged)
             onCueGainChanged(static_cast<float>(slider->getValue()));
     }
+    else if (slider == cueMixSlider.get())
+    {
+        if (onCueMixChanged)
+            onCueMixChanged(static_cast<float>(slider->getValue()));
+    }
     else if (slider == masterFilterSlider.get())
     {
         if (onMasterFilterChanged)
@@ -217,6 +288,30 @@ void MixerView::buttonClicked(juce::Button* button)
         if (onBeatSyncPressed)
             onBeatSyncPressed();
     }
+    else if (button == limiterButton.get())
+    {
+        if (onLimiterToggled)
+            onLimiterToggled(button->getToggleState());
+    }
+    else if (button == pflButton1.get() || button == pflButton2.get())
+    {
+        if (onDeckPFLToggled)
+            onDeckPFLToggled(button == pflButton1.get() ? 0 : 1, button->getToggleState());
+    }
+}
+
+void MixerView::comboBoxChanged(juce::ComboBox* comboBox)
+{
+    if (comboBox == crossfaderCurveBox.get())
+    {
+        if (onCrossfaderCurveChanged)
+            onCrossfaderCurveChanged(comboBox->getSelectedId() - 1);
+    }
+    else if (comboBox == headphoneDeviceBox.get())
+    {
+        if (onHeadphoneDeviceChanged)
+            onHeadphoneDeviceChanged(comboBox->getSelectedId() > 1 ? comboBox->getText() : juce::String());
+    }
 }
 
 void MixerView::timerCallback()
@@ -225,6 +320,9 @@ void MixerView::timerCallback()
     masterVUMeter->setLevel(masterRMSLevel, masterPeakLevel);
     cueVUMeter->setLevel(cueRMSLevel, cuePeakLevel);
     
+    // Limiter gain reduction
+    limiterLabel->setText("GR " + juce::String(limiterGainReduction, 1), juce::dontSendNotification);
+    
     // Update recording button state
     if (isRecording)
     {
@@ -250,6 +348,27 @@ void MixerView::updateCueLevels(float rms, float peak)
     cuePeakLevel = peak;
 }
 
+void MixerView::updateLimiterGainReduction(float gainReductionDb)
+{
+    limiterGainReduction = gainReductionDb;
+}
+
+void MixerView::updateCrossfaderGains(float deck1Gain, float deck2Gain)
+{
+    auto toPercent = [](float gain) { return juce::String(juce::roundToInt(gain * 100.0f)) + "%"; };
+    crossfaderGainLabel->setText("1: " + toPercent(deck1Gain) + "   2: " + toPercent(deck2Gain), juce::dontSendNotification);
+}
+
+void MixerView::setHeadphoneDevices(const juce::StringArray& deviceNames, const juce::String& currentDevice)
+{
+    headphoneDeviceBox->clear(juce::dontSendNotification);
+    headphoneDeviceBox->addItem("OUT 3/4", 1);
+    headphoneDeviceBox->addItemList(deviceNames, 2);
+    
+    int index = deviceNames.indexOf(currentDevice);
+    headphoneDeviceBox->setSelectedId(index >= 0 ? index + 2 : 1, juce::dontSendNotification);
+}
+
 void MixerView::updateRecordingState(bool recording)
 {
     if (isRecording != recording)
@@ -7,6 +7,7 @@
 class MixerView : public juce::Component,
                  public juce::Slider::Listener,
                  public juce::Button::Listener,
+                 public juce::ComboBox::Listener,
                  public juce::Timer
 {
 public:
@@ -19,6 +20,7 @@ public:
     // Slider and button listeners
     void sliderValueChanged(juce::Slider* slider) override;
     void buttonClicked(juce::Button* button) override;
+    void comboBoxChanged(juce::ComboBox* comboBox) override;
     
     // Timer
     void timerCallback() override;
@@ -26,16 +28,24 @@ public:
     // Update methods
     void updateMasterLevels(float rms, float peak);
     void updateCueLevels(float rms, float peak);
+    void updateLimiterGainReduction(float gainReductionDb);
+    void updateCrossfaderGains(float deck1Gain, float deck2Gain); // what the curve gives each deck
     void updateRecordingState(bool isRecording);
+    void setHeadphoneDevices(const juce::StringArray& deviceNames, const juce::String& currentDevice); // empty = outputs 3/4
     
     // Callbacks
     std::function<void(float)> onCrossfaderChanged;
+    std::function<void(int)> onCrossfaderCurveChanged; // 0 = constant power, 1 = linear, 2 = scratch cut
     std::function<void(float)> onMasterGainChanged;
     std::function<void(float)> onCueGainChanged;
+    std::function<void(float)> onCueMixChanged;
+    std::function<void(int, bool)> onDeckPFLToggled; // deckIndex, enabled
+    std::function<void(const juce::String&)> onHeadphoneDeviceChanged; // empty = outputs 3/4
     std::function<void(float)> onMasterFilterChanged;
     std::function<void(bool)> onRecordingToggled;
     std::function<void(bool)> onAutoMixToggled;
     std::function<void()> onBeatSyncPressed;
+    std::function<void(bool)> onLimiterToggled;
     
 private:
     void setupComponents();
@@ -44,28 +54,37 @@ private:
     // Crossfader
     std::unique_ptr<ModernSlider> crossfaderSlider;
     std::unique_ptr<juce::Label> crossfaderLabel;
+    std::unique_ptr<juce::ComboBox> crossfaderCurveBox;
+    std::unique_ptr<juce::Label> crossfaderGainLabel;
     
     // Master section
     std::unique_ptr<ModernSlider> masterGainSlider;
     std::unique_ptr<ModernSlider> masterFilterSlider;
     std::unique_ptr<VUMeter> masterVUMeter;
     std::unique_ptr<juce::Label> masterLabel;
+    std::unique_ptr<juce::Label> limiterLabel;
     
     // Cue section
     std::unique_ptr<ModernSlider> cueGainSlider;
+    std::unique_ptr<ModernSlider> cueMixSlider;
+    std::unique_ptr<ModernButton> pflButton1;
+    std::unique_ptr<ModernButton> pflButton2;
     std::unique_ptr<VUMeter> cueVUMeter;
     std::unique_ptr<juce::Label> cueLabel;
+    std::unique_ptr<juce::ComboBox> headphoneDeviceBox;
     
     // Control buttons
     std::unique_ptr<ModernButton> recordButton;
     std::unique_ptr<ModernButton> autoMixButton;
     std::unique_ptr<ModernButton> beatSyncButton;
+    std::unique_ptr<ModernButton> limiterButton;
     
     // Level values
     float masterRMSLevel = 0.0f;
     float masterPeakLevel = 0.0f;
     float cueRMSLevel = 0.0f;
     float cuePeakLevel = 0.0f;
+    float limiterGainReduction = 0.0f;
     
     // State
     bool isRecording = false;
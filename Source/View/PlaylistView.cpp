@@ -1,4 +1,6 @@
 #include "PlaylistView.h"
+#include <algorithm>
+#include <numeric>
 
 PlaylistView::PlaylistView()
     : backgroundColour(juce::Colour(0xff1a1a1a)),
@@ -15,6 +17,13 @@ PlaylistView::PlaylistView()
 PlaylistView::~PlaylistView()
 {
     stopTimer();
+    
+    if (playlistManager != nullptr)
+    {
+        playlistManager->onTracksChanged = nullptr;
+        playlistManager->onImportProgress = nullptr;
+        playlistManager->onSmartPlaylistChanged = nullptr;
+    }
 }
 
 void PlaylistView::setupComponents()
@@ -79,6 +88,32 @@ void PlaylistView::setupComponents()
     loadPlaylistButton->addListener(this);
     addAndMakeVisible(*loadPlaylistButton);
     
+    browseButton = std::make_unique<ModernButton>("Browse");
+    browseButton->setButtonStyle(ModernButton::Style::Toggle);
+    browseButton->setClickingTogglesState(true);
+    browseButton->addListener(this);
+    addAndMakeVisible(*browseButton);
+    
+    // Facet browser, shown beside the table while Browse is on
+    facetBrowser = std::make_unique<FacetBrowserView>();
+    facetBrowser->onSelectionChanged = [this](const FacetIndex::Selection&) {
+        updateFilteredTracks();
+    };
+    addChildComponent(*facetBrowser);
+    
+    smartButton = std::make_unique<ModernButton>("Smart");
+    smartButton->setButtonStyle(ModernButton::Style::Toggle);
+    smartButton->setClickingTogglesState(true);
+    smartButton->addListener(this);
+    addAndMakeVisible(*smartButton);
+    
+    // Smart playlists, shown beside the table while Smart is on
+    smartPlaylistView = std::make_unique<SmartPlaylistView>();
+    smartPlaylistView->onPlaylistSelected = [this](int) {
+        updateFilteredTracks();
+    };
+    addChildComponent(*smartPlaylistView);
+    
     // Stats label
     statsLabel = std::make_unique<juce::Label>("stats", "0 tracks");
     statsLabel->setFont(juce::Font(12.0f));
@@ -98,6 +133,7 @@ void PlaylistView::setupTableHeader()
     header.addColumn("Genre", 5, 100, 60, 200, juce::TableHeaderComponent::defaultFlags);
     header.addColumn("Duration", 6, 80, 60, 100, juce::TableHeaderComponent::defaultFlags);
     header.addColumn("BPM", 7, 60, 50, 80, juce::TableHeaderComponent::defaultFlags);
+    header.addColumn("Date Added", 9, 90, 70, 120, juce::TableHeaderComponent::defaultFlags);
     header.addColumn("Load", 8, 80, 80, 80, juce::TableHeaderComponent::notResizable);
     
     header.setColour(juce::TableHeaderComponent::backgroundColourId, headerColour);
@@ -140,10 +176,12 @@ void PlaylistView::resized()
     
     // Control buttons (bottom row)
     auto buttonArea2 = bounds.removeFromTop(30);
-    buttonWidth = buttonArea2.getWidth() / 3;
+    buttonWidth = buttonArea2.getWidth() / 5;
     shuffleButton->setBounds(buttonArea2.removeFromLeft(buttonWidth).reduced(2));
     savePlaylistButton->setBounds(buttonArea2.removeFromLeft(buttonWidth).reduced(2));
-    loadPlaylistButton->setBounds(buttonArea2.reduced(2));
+    loadPlaylistButton->setBounds(buttonArea2.removeFromLeft(buttonWidth).reduced(2));
+    browseButton->setBounds(buttonArea2.removeFromLeft(buttonWidth).reduced(2));
+    smartButton->setBounds(buttonArea2.reduced(2));
     
     bounds.removeFromTop(5);
     
@@ -151,6 +189,28 @@ void PlaylistView::resized()
     statsLabel->setBounds(bounds.removeFromBottom(20));
     bounds.removeFromBottom(5);
     
+    // Side panels; with both shown, the facet browser takes the top half
+    if (facetBrowser->isVisible() || smartPlaylistView->isVisible())
+    {
+        auto side = bounds.removeFromLeft(juce::jmin(180, bounds.getWidth() / 3));
+        bounds.removeFromLeft(5);
+        
+        if (facetBrowser->isVisible() && smartPlaylistView->isVisible())
+        {
+            facetBrowser->setBounds(side.removeFromTop(side.getHeight() / 2));
+            side.removeFromTop(5);
+            smartPlaylistView->setBounds(side);
+        }
+        else if (facetBrowser->isVisible())
+        {
+            facetBrowser->setBounds(side);
+        }
+        else
+        {
+            smartPlaylistView->setBounds(side);
+        }
+    }
+    
     // Table
     tableListBox->setBounds(bounds);
 }
@@ -216,6 +276,10 @@ void PlaylistView::paintCell(juce::Graphics& g, int rowNumber, int columnId, int
             break;
         case 8: // Load column - handled by component
             return;
+        case 9: // Date added
+            if (track->getDateAdded() > 0)
+                text = juce::Time(track->getDateAdded()).formatted("%Y-%m-%d");
+            break;
     }
     
     g.drawText(text, 2, 0, width - 4, height, juce::Justification::centredLeft, true);
@@ -275,7 +339,6 @@ void PlaylistView::buttonClicked(juce::Button* button)
                                  if (!files.isEmpty() && playlistManager)
                                  {
                                      playlistManager->loadTracksFromFiles(files);
-                                     refreshPlaylist();
                                  }
                              });
     }
@@ -289,34 +352,23 @@ void PlaylistView::buttonClicked(juce::Button* button)
                                  if (folder != juce::File{} && playlistManager)
                                  {
                                      playlistManager->loadTracksFromDirectory(folder);
-                                     refreshPlaylist();
                                  }
                              });
     }
     else if (button == removeButton.get())
     {
         if (selectedRow >= 0 && selectedRow < static_cast<int>(filteredTrackIndices.size()) && playlistManager)
-        {
-            int trackIndex = filteredTrackIndices[selectedRow];
-            playlistManager->removeTrack(trackIndex);
-            refreshPlaylist();
-        }
+            playlistManager->removeTrack(filteredTrackIndices[selectedRow]);
     }
     else if (button == clearButton.get())
     {
         if (playlistManager)
-        {
             playlistManager->clearPlaylist();
-            refreshPlaylist();
-        }
     }
     else if (button == shuffleButton.get())
     {
         if (playlistManager)
-        {
             playlistManager->shufflePlaylist();
-            refreshPlaylist();
-        }
     }
     else if (button == savePlaylistButton.get())
     {
@@ -329,6 +381,31 @@ void PlaylistView::buttonClicked(juce::Button* button)
                                     playlistManager->savePlaylist(file);
                             });
     }
+    else if (button == browseButton.get())
+    {
+        // Picks only apply while they can be seen
+        bool show = browseButton->getToggleState();
+        facetBrowser->setVisible(show);
+        
+        if (show)
+            facetBrowser->refreshCounts();
+        else
+            facetBrowser->clearSelection();
+        
+        resized();
+    }
+    else if (button == smartButton.get())
+    {
+        bool show = smartButton->getToggleState();
+        smartPlaylistView->setVisible(show);
+        
+        if (show)
+            smartPlaylistView->refreshList();
+        else
+            smartPlaylistView->clearSelection();
+        
+        resized();
+    }
     else if (button == loadPlaylistButton.get())
     {
         auto chooser = std::make_unique<juce::FileChooser>("Load playlist", juce::File(), "*.m3u");
@@ -337,10 +414,7 @@ void PlaylistView::buttonClicked(juce::Button* button)
                             {
                                 auto file = fc.getResult();
                                 if (file != juce::File{} && playlistManager)
-                                {
                                     playlistManager->loadPlaylist(file);
-                                    refreshPlaylist();
-                                }
                             });
     }
 }
@@ -370,13 +444,58 @@ void PlaylistView::timerCallback()
         if (totalDuration > 0.0)
             statsText += " • " + formatDuration(totalDuration);
         
+        if (playlistManager->isImporting())
+            statsText += " • importing " + juce::String(importScanned) + " of " + juce::String(importFound);
+        
         statsLabel->setText(statsText, juce::dontSendNotification);
     }
 }
 
 void PlaylistView::setPlaylistManager(PlaylistManager* manager)
 {
+    if (playlistManager != nullptr)
+    {
+        playlistManager->onTracksChanged = nullptr;
+        playlistManager->onImportProgress = nullptr;
+        playlistManager->onSmartPlaylistChanged = nullptr;
+    }
+    
+    playlistSearch.reset();
     playlistManager = manager;
+    importScanned = 0;
+    importFound = 0;
+    facetBrowser->setPlaylistManager(manager);
+    smartPlaylistView->setPlaylistManager(manager);
+    
+    if (playlistManager != nullptr)
+    {
+        // Imports add tracks in batches while they run
+        playlistManager->onTracksChanged = [this](const std::vector<PlaylistManager::Change>& changes) {
+            applyChanges(changes);
+        };
+        playlistManager->onImportProgress = [this](int scanned, int found) {
+            importScanned = scanned;
+            importFound = found;
+        };
+        playlistManager->onSmartPlaylistChanged = [this](int index) {
+            smartPlaylistView->refreshList();
+            
+            if (index == smartPlaylistView->getSelectedPlaylist())
+                updateFilteredTracks();
+        };
+        
+        playlistSearch = std::make_unique<PlaylistSearch>(*playlistManager);
+        playlistSearch->onResults = [this](std::vector<int>&& trackIndices) {
+            filteredTrackIndices = std::move(trackIndices);
+            
+            // A picked smart playlist keeps only its own tracks
+            if (smartPlaylistView->getSelectedPlaylist() >= 0)
+                playlistManager->keepSmartPlaylistTracks(smartPlaylistView->getSelectedPlaylist(), filteredTrackIndices);
+            
+            tableListBox->updateContent();
+        };
+    }
+    
     refreshPlaylist();
 }
 
@@ -385,6 +504,9 @@ void PlaylistView::refreshPlaylist()
     updateFilteredTracks();
     tableListBox->updateContent();
     
+    if (facetBrowser->isVisible())
+        facetBrowser->refreshCounts();
+    
     if (onPlaylistChanged)
         onPlaylistChanged();
 }
@@ -408,76 +530,172 @@ void PlaylistView::setSearchFilter(const juce::String& filter)
 {
     currentSearchFilter = filter;
     updateFilteredTracks();
-    tableListBox->updateContent();
 }
 
 void PlaylistView::setSortColumn(int columnId, bool ascending)
 {
+    // The column sorted by before stays on as the tie-breaker
+    if (columnId != sortColumnId)
+    {
+        previousSortColumnId = sortColumnId;
+        previousSortAscending = sortAscending;
+    }
+    
     sortColumnId = columnId;
     sortAscending = ascending;
     updateFilteredTracks();
-    tableListBox->updateContent();
+}
+
+void PlaylistView::sortOrderChanged(int newSortColumnId, bool isForwards)
+{
+    setSortColumn(newSortColumnId, isForwards);
+}
+
+std::optional<PlaylistManager::SortCriteria> PlaylistView::getSortCriteria(int columnId)
+{
+    switch (columnId)
+    {
+        case 2: // Title
+            return PlaylistManager::SortCriteria::Title;
+        case 3: // Artist
+            return PlaylistManager::SortCriteria::Artist;
+        case 4: // Album
+            return PlaylistManager::SortCriteria::Album;
+        case 5: // Genre
+            return PlaylistManager::SortCriteria::Genre;
+        case 6: // Duration
+            return PlaylistManager::SortCriteria::Duration;
+        case 7: // BPM
+            return PlaylistManager::SortCriteria::BPM;
+        case 9: // Date added
+            return PlaylistManager::SortCriteria::DateAdded;
+        default: // Track number
+            return std::nullopt;
+    }
 }
 
 void PlaylistView::updateFilteredTracks()
 {
-    filteredTrackIndices.clear();
-    
-    if (!playlistManager)
+    if (!playlistSearch)
+    {
+        filteredTrackIndices.clear();
         return;
+    }
+    
+    // Searched and sorted in the background; the rows are swapped in when the results arrive
+    std::vector<PlaylistManager::SortKey> order;
     
-    // Apply search filter
-    if (currentSearchFilter.isEmpty())
+    if (auto primary = getSortCriteria(sortColumnId))
     {
-        // No filter - include all tracks
-        for (int i = 0; i < playlistManager->getNumTracks(); ++i)
-            filteredTrackIndices.push_back(i);
+        order.push_back({ *primary, sortAscending });
+        
+        if (auto secondary = getSortCriteria(previousSortColumnId); secondary && *secondary != *primary)
+            order.push_back({ *secondary, previousSortAscending });
     }
-    else
+    
+    playlistSearch->search(currentSearchFilter, order, sortAscending, facetBrowser->getSelection());
+}
+
+void PlaylistView::applyChanges(const std::vector<PlaylistManager::Change>& changes)
+{
+    // Results still on their way were found before these changes, so search again rather than patch
+    if (!playlistSearch || playlistSearch->isSearching())
     {
-        // Apply search filter
-        auto searchResults = playlistManager->searchTracks(currentSearchFilter);
-        filteredTrackIndices = searchResults;
+        refreshPlaylist();
+        return;
     }
     
-    // Apply sorting
-    std::sort(filteredTrackIndices.begin(), filteredTrackIndices.end(),
-              [this](int a, int b) {
-                  auto trackA = playlistManager->getTrack(a);
-                  auto trackB = playlistManager->getTrack(b);
-                  
-                  if (!trackA || !trackB)
-                      return false;
-                  
-                  bool result = false;
-                  
-                  switch (sortColumnId)
-                  {
-                      case 2: // Title
-                          result = trackA->getTitle().compareIgnoreCase(trackB->getTitle()) < 0;
-                          break;
-                      case 3: // Artist
-                          result = trackA->getArtist().compareIgnoreCase(trackB->getArtist()) < 0;
-                          break;
-                      case 4: // Album
-                          result = trackA->getAlbum().compareIgnoreCase(trackB->getAlbum()) < 0;
-                          break;
-                      case 5: // Genre
-                          result = trackA->getGenre().compareIgnoreCase(trackB->getGenre()) < 0;
-                          break;
-                      case 6: // Duration
-                          result = trackA->getDuration() < trackB->getDuration();
-                          break;
-                      case 7: // BPM
-                          result = trackA->getBPM() < trackB->getBPM();
-                          break;
-                      default: // Track number
-                          result = a < b;
-                          break;
-                  }
-                  
-                  return sortAscending ? result : !result;
-              });
+    // With no search, no facet picks or smart playlist and no column to sort by, the rows are the playlist itself
+    bool showsWholePlaylist = currentSearchFilter.isEmpty() && facetBrowser->getSelection().isEmpty()
+                              && smartPlaylistView->getSelectedPlaylist() < 0 && sortColumnId == 1 && sortAscending;
+    bool needsSearch = false;
+    
+    for (const auto& change : changes)
+    {
+        auto start = change.range.getStart();
+        auto end = change.range.getEnd();
+        auto length = change.range.getLength();
+        
+        switch (change.type)
+        {
+            case PlaylistManager::Change::Type::Added:
+            {
+                for (auto& index : filteredTrackIndices)
+                {
+                    if (index >= start)
+                        index += length;
+                }
+                
+                // Whether new tracks match a search, and where they sort, is for the search to say
+                if (showsWholePlaylist)
+                {
+                    std::vector<int> added(static_cast<size_t>(length));
+                    std::iota(added.begin(), added.end(), start);
+                    filteredTrackIndices.insert(filteredTrackIndices.begin() + start, added.begin(), added.end());
+                }
+                else
+                {
+                    needsSearch = true;
+                }
+                break;
+            }
+                
+            case PlaylistManager::Change::Type::Removed:
+            {
+                auto gone = std::remove_if(filteredTrackIndices.begin(), filteredTrackIndices.end(),
+                                           [&change](int index) { return change.range.contains(index); });
+                filteredTrackIndices.erase(gone, filteredTrackIndices.end());
+                
+                for (auto& index : filteredTrackIndices)
+                {
+                    if (index >= end)
+                        index -= length;
+                }
+                break;
+            }
+                
+            case PlaylistManager::Change::Type::Moved:
+            {
+                for (auto& index : filteredTrackIndices)
+                {
+                    if (change.range.contains(index))
+                    {
+                        index = change.destination + (index - start);
+                    }
+                    else
+                    {
+                        if (index >= end)
+                            index -= length;
+                        if (index >= change.destination)
+                            index += length;
+                    }
+                }
+                
+                // Elsewhere the rows keep their place; here they follow the playlist
+                if (showsWholePlaylist)
+                    std::sort(filteredTrackIndices.begin(), filteredTrackIndices.end());
+                break;
+            }
+                
+            case PlaylistManager::Change::Type::Updated:
+            case PlaylistManager::Change::Type::Reordered:
+                // The whole playlist in order stays as it is; the tracks in its rows are read as they are painted
+                needsSearch = needsSearch || !showsWholePlaylist;
+                break;
+        }
+    }
+    
+    if (needsSearch)
+        updateFilteredTracks();
+    
+    tableListBox->updateContent();
+    tableListBox->repaint();
+    
+    if (facetBrowser->isVisible())
+        facetBrowser->refreshCounts();
+    
+    if (onPlaylistChanged)
+        onPlaylistChanged();
 }
 
 juce::String PlaylistView::formatDuration(double seconds) const
@@ -1,6 +1,9 @@
 #pragma once
 #include <JuceHeader.h>
 #include "../Model/PlaylistManager.h"
+#include "../Model/PlaylistSearch.h"
+#include "FacetBrowserView.h"
+#include "SmartPlaylistView.h"
 #include "../Components/ModernButton.h"
 
 class PlaylistView : public juce::Component,
@@ -23,6 +26,7 @@ public:
     juce::Component* refreshComponentForCell(int rowNumber, int columnId, bool isRowSelected, juce::Component* existingComponentToUpdate) override;
     void cellClicked(int rowNumber, int columnId, const juce::MouseEvent& event) override;
     void cellDoubleClicked(int rowNumber, int columnId, const juce::MouseEvent& event) override;
+    void sortOrderChanged(int newSortColumnId, bool isForwards) override;
     
     // Button listener
     void buttonClicked(juce::Button* button) override;
@@ -51,7 +55,9 @@ private:
     void setupComponents();
     void setupTableHeader();
     void updateFilteredTracks();
+    void applyChanges(const std::vector<PlaylistManager::Change>& changes);
     juce::String formatDuration(double seconds) const;
+    static std::optional<PlaylistManager::SortCriteria> getSortCriteria(int columnId);
     
     // Components
     std::unique_ptr<juce::TableListBox> tableListBox;
@@ -64,6 +70,10 @@ private:
     std::unique_ptr<ModernButton> addFolderButton;
     std::unique_ptr<ModernButton> savePlaylistButton;
     std::unique_ptr<ModernButton> loadPlaylistButton;
+    std::unique_ptr<ModernButton> browseButton;
+    std::unique_ptr<FacetBrowserView> facetBrowser;
+    std::unique_ptr<ModernButton> smartButton;
+    std::unique_ptr<SmartPlaylistView> smartPlaylistView;
     
     // Labels
     std::unique_ptr<juce::Label> titleLabel;
@@ -71,11 +81,16 @@ private:
     
     // Data
     PlaylistManager* playlistManager = nullptr;
+    std::unique_ptr<PlaylistSearch> playlistSearch;
     std::vector<int> filteredTrackIndices;
     juce::String currentSearchFilter;
     int selectedRow = -1;
     int sortColumnId = 1; // Default sort by title
     bool sortAscending = true;
+    int previousSortColumnId = 1; // breaks ties in the current column
+    bool previousSortAscending = true;
+    int importScanned = 0;
+    int importFound = 0;
     
     // Visual settings
     juce::Colour backgroundColour;
@@ -0,0 +1,264 @@
+#include "SmartPlaylistView.h"
+
+SmartPlaylistView::SmartPlaylistView()
+    : backgroundColour(juce::Colour(0xff1a1a1a)),
+      selectedRowColour(juce::Colour(0xff0066cc)),
+      textColour(juce::Colour(0xffeeeeee))
+{
+    setupComponents();
+}
+
+SmartPlaylistView::~SmartPlaylistView() = default;
+
+void SmartPlaylistView::setupComponents()
+{
+    // Row 0 is the whole playlist, the smart playlists follow
+    playlistList = std::make_unique<juce::ListBox>("smart playlists", this);
+    playlistList->setColour(juce::ListBox::backgroundColourId, backgroundColour);
+    playlistList->setColour(juce::ListBox::outlineColourId, juce::Colour(0xff404040));
+    playlistList->setOutlineThickness(1);
+    playlistList->setRowHeight(20);
+    addAndMakeVisible(*playlistList);
+    
+    newButton = std::make_unique<ModernButton>("New");
+    newButton->setButtonStyle(ModernButton::Style::Primary);
+    newButton->addListener(this);
+    addAndMakeVisible(*newButton);
+    
+    editButton = std::make_unique<ModernButton>("Edit");
+    editButton->setButtonStyle(ModernButton::Style::Secondary);
+    editButton->addListener(this);
+    addAndMakeVisible(*editButton);
+    
+    deleteButton = std::make_unique<ModernButton>("Delete");
+    deleteButton->setButtonStyle(ModernButton::Style::Danger);
+    deleteButton->addListener(this);
+    addAndMakeVisible(*deleteButton);
+}
+
+void SmartPlaylistView::paint(juce::Graphics& g)
+{
+    g.fillAll(backgroundColour);
+}
+
+void SmartPlaylistView::resized()
+{
+    auto bounds = getLocalBounds();
+    
+    auto buttonArea = bounds.removeFromBottom(25);
+    int buttonWidth = buttonArea.getWidth() / 3;
+    newButton->setBounds(buttonArea.removeFromLeft(buttonWidth).reduced(2, 0));
+    editButton->setBounds(buttonArea.removeFromLeft(buttonWidth).reduced(2, 0));
+    deleteButton->setBounds(buttonArea.reduced(2, 0));
+    bounds.removeFromBottom(5);
+    
+    playlistList->setBounds(bounds);
+}
+
+int SmartPlaylistView::getNumRows()
+{
+    return playlistManager != nullptr ? playlistManager->getNumSmartPlaylists() + 1 : 0;
+}
+
+void SmartPlaylistView::paintListBoxItem(int rowNumber, juce::Graphics& g, int width, int height, bool rowIsSelected)
+{
+    if (playlistManager == nullptr || rowNumber < 0 || rowNumber > playlistManager->getNumSmartPlaylists())
+        return;
+    
+    if (rowIsSelected)
+        g.fillAll(selectedRowColour);
+    
+    juce::String name = "All Tracks";
+    int numTracks = playlistManager->getNumTracks();
+    
+    if (rowNumber > 0)
+    {
+        name = playlistManager->getSmartPlaylist(rowNumber - 1).getName();
+        numTracks = playlistManager->getSmartPlaylistSize(rowNumber - 1);
+    }
+    
+    g.setFont(juce::Font(12.0f));
+    g.setColour(rowIsSelected ? juce::Colour(0xffffffff) : textColour);
+    g.drawText(name, 4, 0, width - 50, height, juce::Justification::centredLeft, true);
+    
+    g.setColour(juce::Colour(0xffaaaaaa));
+    g.drawText(juce::String(numTracks), width - 46, 0, 42, height, juce::Justification::centredRight, false);
+}
+
+void SmartPlaylistView::selectedRowsChanged(int lastRowSelected)
+{
+    selectPlaylist(lastRowSelected - 1);
+}
+
+void SmartPlaylistView::buttonClicked(juce::Button* button)
+{
+    if (playlistManager == nullptr)
+        return;
+    
+    if (button == newButton.get())
+    {
+        showEditor(-1);
+    }
+    else if (button == editButton.get())
+    {
+        if (selectedPlaylist >= 0)
+            showEditor(selectedPlaylist);
+    }
+    else if (button == deleteButton.get())
+    {
+        if (selectedPlaylist >= 0)
+        {
+            playlistManager->removeSmartPlaylist(selectedPlaylist);
+            playlistList->selectRow(0);
+            refreshList();
+        }
+    }
+}
+
+void SmartPlaylistView::setPlaylistManager(PlaylistManager* manager)
+{
+    playlistManager = manager;
+    selectedPlaylist = -1;
+    playlistList->updateContent();
+    playlistList->selectRow(0, false, true);
+}
+
+void SmartPlaylistView::refreshList()
+{
+    playlistList->updateContent();
+    playlistList->repaint();
+}
+
+void SmartPlaylistView::clearSelection()
+{
+    playlistList->selectRow(0);
+}
+
+void SmartPlaylistView::selectPlaylist(int index)
+{
+    index = juce::jmax(-1, index);
+    
+    if (index == selectedPlaylist)
+        return;
+    
+    selectedPlaylist = index;
+    
+    if (onPlaylistSelected)
+        onPlaylistSelected(selectedPlaylist);
+}
+
+void SmartPlaylistView::showEditor(int index)
+{
+    using Field = SmartPlaylist::Rule::Field;
+    using Test = SmartPlaylist::Rule::Test;
+    
+    auto existing = index >= 0 ? playlistManager->getSmartPlaylist(index) : SmartPlaylist();
+    
+    auto* window = new juce::AlertWindow(index >= 0 ? "Edit Smart Playlist" : "New Smart Playlist",
+                                         "Tracks have to meet every rule that is filled in.",
+                                         juce::AlertWindow::NoIcon, this);
+    window->addTextEditor("name", existing.getName().isNotEmpty() ? existing.getName() : juce::String("Smart Playlist"), "Name");
+    window->addTextEditor("genre", getRuleText(existing, Field::Genre, Test::Is), "Genre is");
+    window->addTextEditor("artist", getRuleText(existing, Field::Artist, Test::Contains), "Artist contains");
+    window->addTextEditor("bpmLow", getRuleText(existing, Field::BPM, Test::Between), "BPM from");
+    window->addTextEditor("bpmHigh", getRuleText(existing, Field::BPM, Test::Between, true), "BPM to");
+    window->addTextEditor("key", getRuleText(existing, Field::Key, Test::CompatibleWith), "Key compatible with");
+    window->addTextEditor("days", getRuleText(existing, Field::DateAdded, Test::WithinLastDays), "Added in the last days");
+    window->addButton("Save", 1, juce::KeyPress(juce::KeyPress::returnKey));
+    window->addButton("Cancel", 0, juce::KeyPress(juce::KeyPress::escapeKey));
+    
+    juce::Component::SafePointer<SmartPlaylistView> safeThis(this);
+    
+    window->enterModalState(true, juce::ModalCallbackFunction::create([safeThis, window, index, existing](int result) {
+        if (result != 1 || safeThis == nullptr || safeThis->playlistManager == nullptr)
+            return;
+        
+        // Rules the form covers are rebuilt from it; any others stay as they were
+        std::vector<SmartPlaylist::Rule> rules;
+        
+        for (const auto& rule : existing.getRules())
+        {
+            bool covered = (rule.field == Field::Genre && rule.test == Test::Is)
+                           || (rule.field == Field::Artist && rule.test == Test::Contains)
+                           || (rule.field == Field::BPM && rule.test == Test::Between)
+                           || (rule.field == Field::Key && rule.test == Test::CompatibleWith)
+                           || (rule.field == Field::DateAdded && rule.test == Test::WithinLastDays);
+            if (!covered)
+                rules.push_back(rule);
+        }
+        
+        auto addRule = [&rules](Field field, Test test, const juce::String& text, double low = 0.0, double high = 0.0) {
+            SmartPlaylist::Rule rule;
+            rule.field = field;
+            rule.test = test;
+            rule.text = text;
+            rule.low = low;
+            rule.high = high;
+            rules.push_back(rule);
+        };
+        
+        auto genre = window->getTextEditorContents("genre").trim();
+        if (genre.isNotEmpty())
+            addRule(Field::Genre, Test::Is, genre);
+        
+        auto artist = window->getTextEditorContents("artist").trim();
+        if (artist.isNotEmpty())
+            addRule(Field::Artist, Test::Contains, artist);
+        
+        auto bpmLow = window->getTextEditorContents("bpmLow").trim();
+        auto bpmHigh = window->getTextEditorContents("bpmHigh").trim();
+        if (bpmLow.isNotEmpty() || bpmHigh.isNotEmpty())
+        {
+            addRule(Field::BPM, Test::Between, {},
+                    bpmLow.isNotEmpty() ? bpmLow.getDoubleValue() : 0.0,
+                    bpmHigh.isNotEmpty() ? bpmHigh.getDoubleValue() : 999.0);
+        }
+        
+        auto key = window->getTextEditorContents("key").trim();
+        if (key.isNotEmpty())
+            addRule(Field::Key, Test::CompatibleWith, key);
+        
+        auto days = window->getTextEditorContents("days").trim();
+        if (days.isNotEmpty())
+            addRule(Field::DateAdded, Test::WithinLastDays, {}, days.getDoubleValue());
+        
+        auto name = window->getTextEditorContents("name").trim();
+        SmartPlaylist playlist(name.isNotEmpty() ? name : juce::String("Smart Playlist"), std::move(rules));
+        auto& manager = *safeThis->playlistManager;
+        
+        if (index >= 0)
+        {
+            manager.setSmartPlaylist(index, playlist);
+            safeThis->refreshList();
+            
+            // The same playlist, with new rules, so what it shows has changed
+            if (safeThis->onPlaylistSelected)
+                safeThis->onPlaylistSelected(index);
+        }
+        else
+        {
+            auto added = manager.addSmartPlaylist(playlist);
+            safeThis->refreshList();
+            safeThis->playlistList->selectRow(added + 1);
+        }
+    }), true);
+}
+
+juce::String SmartPlaylistView::getRuleText(const SmartPlaylist& playlist, SmartPlaylist::Rule::Field field, SmartPlaylist::Rule::Test test, bool high)
+{
+    for (const auto& rule : playlist.getRules())
+    {
+        if (rule.field != field || rule.test != test)
+            continue;
+        
+        if (test == SmartPlaylist::Rule::Test::Between)
+            return juce::String(high ? rule.high : rule.low);
+        
+        if (test == SmartPlaylist::Rule::Test::WithinLastDays)
+            return juce::String(rule.low);
+        
+        return rule.text;
+    }
+    
+    return {};
+}
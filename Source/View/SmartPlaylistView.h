@@ -0,0 +1,59 @@
+#pragma once
+#include <JuceHeader.h>
+#include "../Model/PlaylistManager.h"
+#include "../Components/ModernButton.h"
+
+// The playlist's smart playlists, with how many tracks each holds. Picking
+// one narrows the table to its tracks; New and Edit open a small form with
+// the common rules (genre, artist, BPM range, compatible key, recently
+// added), and rules the form has no field for are kept as they are.
+class SmartPlaylistView : public juce::Component,
+                          public juce::ListBoxModel,
+                          public juce::Button::Listener
+{
+public:
+    SmartPlaylistView();
+    ~SmartPlaylistView() override;
+    
+    void paint(juce::Graphics& g) override;
+    void resized() override;
+    
+    // ListBoxModel
+    int getNumRows() override;
+    void paintListBoxItem(int rowNumber, juce::Graphics& g, int width, int height, bool rowIsSelected) override;
+    void selectedRowsChanged(int lastRowSelected) override;
+    
+    // Button listener
+    void buttonClicked(juce::Button* button) override;
+    
+    void setPlaylistManager(PlaylistManager* manager);
+    void refreshList(); // after smart playlists or their members change
+    void clearSelection(); // back to the whole playlist
+    int getSelectedPlaylist() const { return selectedPlaylist; } // -1 for the whole playlist
+    
+    // Callbacks
+    std::function<void(int smartPlaylistIndex)> onPlaylistSelected;
+    
+private:
+    void setupComponents();
+    void showEditor(int index); // -1 for a new one
+    void selectPlaylist(int index);
+    static juce::String getRuleText(const SmartPlaylist& playlist, SmartPlaylist::Rule::Field field, SmartPlaylist::Rule::Test test, bool high = false);
+    
+    // Components
+    std::unique_ptr<juce::ListBox> playlistList;
+    std::unique_ptr<ModernButton> newButton;
+    std::unique_ptr<ModernButton> editButton;
+    std::unique_ptr<ModernButton> deleteButton;
+    
+    // Data
+    PlaylistManager* playlistManager = nullptr;
+    int selectedPlaylist = -1;
+    
+    // Visual settings
+    juce::Colour backgroundColour;
+    juce::Colour selectedRowColour;
+    juce::Colour textColour;
+    
+    JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR(SmartPlaylistView)
+};